@@ -14,6 +14,9 @@
 #include "stdafx.h"
 #include "Client.h"
 
+#include "Compression.h"
+#include "FileCache.h"
+
 namespace Net
 {
 
@@ -42,11 +45,34 @@ Client::Client(const std::string& a_clientName) : m_stats(&m_server)
 
 	m_isConnected = false;
 
-	m_offsetTime = 0;
+	m_isWorldSyncronized = false;
+
+	m_sessionToken = 0;
+
+	m_commandKey = 0;
+
+	m_serverCommandKey = 0;
+
+	m_sessionPort = 0;
+
+	m_receivedFrames = 0;
+
+	m_remainingSyncroSamples = 0;
+
+	m_lastSyncroRequest = 0;
+
+	m_lastSyncroBurst = 0;
+
+	m_loopbackSession = 0;
+
+	FileCache::RemoveTemporaryFiles(); // the copies interrupted by a previous run
 
 	m_server.m_isConsideredAlive = false; // we start not connected
 
-	m_clientThread = std::thread(Client::ClientThread, this);	
+	m_selector.add(m_udpSystem.GetUdpSocket());
+
+	if (!InternalComm::IsPollMode()) // in poll mode the game loop calls Poll instead
+		m_clientThread = std::thread(Client::ClientThread, this);	
 }
 
 
@@ -63,7 +89,8 @@ Client::~Client()
 	{
 		m_isRunning = false;
 
-		m_clientThread.join(); // we now expect that the thread will end soon
+		if (m_clientThread.joinable()) // there is no thread in poll mode
+			m_clientThread.join(); // we now expect that the thread will end soon
 	}
 
 
@@ -116,19 +143,55 @@ void Client::SendPacket(sf::Packet& a_packet)
 
 	m_stats.m_emittedPackets++;
 	
-	if (m_server.m_isUDPConnection) // UDP
+	if (m_server.m_isLoopback) // server of this application, no socket
+	{
+		std::shared_ptr<sf::Packet> l_packet = std::make_shared<sf::Packet>(a_packet); // the packet of the caller is on its stack
+
+		if (!m_loopback->SendToServer(l_packet, m_loopbackSession)) // the server has been shut down, nothing can be sent anymore
+			m_server.m_isConsideredAlive = false;
+	}
+	else if (m_server.m_isUDPConnection) // UDP
 	{
 		m_udpSystem.GetUdpSocket().send(a_packet, m_server.m_ipAddress, m_server.m_port);
 	}
 	else // TCP
 	{
-		m_server.m_TCPSocket.send(a_packet);
+		m_server.SendFrame(Frame::Create(a_packet)); // a full socket is never waited, the next update sends the rest
+	}
+
+	m_udpSystem.Unlock();
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Send a packet to the server, a server of this
+/// application takes it without any copy
+///
+/// \param a_packet the packet that contains all data
+///
+////////////////////////////////////////////////////////////
+void Client::SendPacket(std::shared_ptr<sf::Packet>& a_packet)
+{
+	m_udpSystem.WaitForLock(); // thread safe
+
+	if (m_server.m_isLoopback) // server of this application, the packet is handed over
+	{
+		m_stats.m_emittedPackets++;
+
+		if (!m_loopback->SendToServer(a_packet, m_loopbackSession)) // the server has been shut down, nothing can be sent anymore
+			m_server.m_isConsideredAlive = false;
+
+		m_udpSystem.Unlock();
+
+		return;
 	}
 
 	m_udpSystem.Unlock();
+
+	SendPacket(*a_packet);
 }
 
 
+
 ////////////////////////////////////////////////////////////
 /// \brief Send a command to the server
 ///
@@ -143,11 +206,28 @@ void Client::SendCommand(NetworkData& a_data, sf::Uint16 a_customCommand)
 	if(!m_server.m_isConsideredAlive || !m_isConnected)
 		throw NetworkException("Error : Cannot send without connection");
 
-	sf::Packet l_packet;
+	std::shared_ptr<sf::Packet> l_packet = std::make_shared<sf::Packet>(); // a local server reads this packet, without any copy
+
+ 	*l_packet << (sf::Uint16)CT_CustomCommand << m_commandKey << a_customCommand;
+
+	InternalComm::WriteCommand(*l_packet, a_data);
+
+	InternalComm::CaptureTraffic(static_cast<const char*>(l_packet->getData()), l_packet->getDataSize());
+
+	PacketBuffer l_compressed;
 
- 	l_packet << (sf::Uint16)CT_CustomCommand << m_clientName << a_customCommand;
+	std::shared_ptr<const CompressionDictionary> l_dictionary = GetDictionary(); // kept alive even if the network thread replaces it
 
-	InternalComm::WriteCommand(l_packet, a_data);
+	if (l_dictionary != NULL && Compression::CompressFrame(static_cast<const char*>(l_packet->getData()), l_packet->getDataSize(), l_compressed, l_dictionary.get()))
+	{
+		sf::Packet l_frame;
+
+		l_frame.append(l_compressed.GetData(), l_compressed.GetDataSize());
+
+		SendPacket(l_frame);
+
+		return;
+	}
 
 	SendPacket(l_packet);
 }
@@ -193,7 +273,17 @@ void Client::Receive(sf::Packet& a_packet)
 	case CT_NewObject:     ReceiveCreate(a_packet);		   break;
 	case CT_UpdateObjects: ReceiveUpdate(a_packet);		   break;
 	case CT_Ping:          ReceivePing(a_packet);		   break;
+	case CT_ClockSyncro:   ReceiveClockSyncro(a_packet);   break;
+	case CT_SyncroComplete: ReceiveSyncroComplete(a_packet); break;
+	case CT_Session:       ReceiveSession(a_packet);       break;
+	case CT_WorldHash:     ReceiveWorldHash(a_packet);     break;
 	case CT_File:          ReceiveFile(a_packet);		   break;
+	case CT_FileManifest:  ReceiveFileManifest(a_packet);  break;
+	case CT_FileSignatures: ReceiveFileSignatures(a_packet); break;
+	case CT_FileDelta:     ReceiveFileDelta(a_packet);     break;
+	case CT_Compressed:    ReceiveCompressed(a_packet);    break;
+	case CT_Dictionary:    ReceiveDictionary(a_packet);    break;
+	case CT_CommandRefused: ReceiveCommandRefused(a_packet); break;
 	case CT_EndConnection: ReceiveEndConnection(a_packet); break;
 
 	case CT_Broadcast: /* for now, we don't care about broadcast of the connected server */  break;
@@ -249,6 +339,266 @@ void Client::ReceivePing(sf::Packet& a_packet)
 
 
 
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server has sent all the objects that existed when this
+/// client was connected, an udp client acknowledges it
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveSyncroComplete(sf::Packet& a_packet)
+{
+	m_isWorldSyncronized = true;
+
+	if (m_server.m_isUDPConnection) // the server sends it again until it is acknowledged
+	{
+		sf::Packet l_packet;
+
+		l_packet << (sf::Uint16)CT_SyncroComplete;
+
+		SendPacket(l_packet);
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server sends its world hash, the leaves that differ are
+/// sent back
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveWorldHash(sf::Packet& a_packet)
+{
+	sf::Uint32 l_check;
+	sf::Uint64 l_root;
+	std::array<sf::Uint64, WORLD_HASH_NODES> l_nodes;
+
+	if (!(a_packet >> l_check >> l_root))
+	{
+		throw NetworkException("Error : reading world hash has failed");
+	}
+
+	for (size_t i = 0; i < WORLD_HASH_NODES; i++)
+	{
+		if (!(a_packet >> l_nodes[i]))
+		{
+			throw NetworkException("Error : reading world hash has failed");
+		}
+	}
+
+	if (IsClientAndServer() || !m_isWorldSyncronized) // the local client shares the objects, and a new client does not have all of them yet
+		return;
+
+	m_worldHash.Update();
+
+	if (l_root == m_worldHash.GetRoot()) // nearly always, so nothing else is computed
+		return;
+
+	// the ids of the objects of the nodes that differ, the server needs them to find the deletions we missed
+	std::vector<std::vector<sf::Uint16>> l_leafIds(WORLD_HASH_LEAVES);
+
+	const size_t l_leavesPerNode = WORLD_HASH_LEAVES / WORLD_HASH_NODES;
+
+	InternalComm::GetObjectsMutex().lock(); // the game thread can destroy the objects meanwhile
+
+	for (std::pair<sf::Uint16, NetworkObject*> object : NetworkObject::GetObjectList())
+	{
+		size_t l_leaf = WorldHash::GetLeafIndex(object.first);
+
+		if (l_nodes[l_leaf / l_leavesPerNode] != m_worldHash.GetNode(l_leaf / l_leavesPerNode))
+			l_leafIds[l_leaf].push_back(object.first);
+	}
+
+	InternalComm::GetObjectsMutex().unlock();
+
+	sf::Packet l_packet;
+
+	l_packet << (sf::Uint16)CT_WorldHash << l_check;
+
+	for (size_t i = 0; i < WORLD_HASH_NODES; i++)
+	{
+		if (l_nodes[i] == m_worldHash.GetNode(i))
+			continue;
+
+		if (l_packet.getDataSize() > FRAME_BYTE_BUDGET) // the other nodes will be repaired after the next comparison
+			break;
+
+		for (size_t leaf = i * l_leavesPerNode; leaf < (i + 1) * l_leavesPerNode; leaf++)
+		{
+			l_packet << (sf::Uint8)leaf << m_worldHash.GetLeaf(leaf);
+
+			InternalComm::WriteVarint(l_packet, (sf::Uint32)l_leafIds[leaf].size());
+
+			for (sf::Uint16 id : l_leafIds[leaf])
+			{
+				l_packet << id;
+			}
+		}
+	}
+
+	SendPacket(l_packet);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server gives the token of the session, an udp client
+/// acknowledges it
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveSession(sf::Packet& a_packet)
+{
+	bool l_isResumed;
+
+	if (!(a_packet >> m_sessionToken >> l_isResumed >> m_commandKey >> m_serverCommandKey))
+	{
+		throw NetworkException("Error : reading session has failed");
+	}
+
+	if (m_server.m_isUDPConnection) // the server sends it again until it is acknowledged
+	{
+		sf::Packet l_packet;
+
+		l_packet << (sf::Uint16)CT_Session;
+
+		SendPacket(l_packet);
+	}
+
+	if (l_isResumed || m_sessionToken == 0 || IsClientAndServer()) // an udp session only gives the command keys
+		return;
+
+	// new session : the server sends all its objects again, so the objects of the previous session may not exist anymore
+	std::vector<NetworkObject*> l_oldObjects;
+
+	for (std::pair<sf::Uint16, NetworkObject*> object : NetworkObject::GetObjectList())
+	{
+		l_oldObjects.push_back(object.second);
+	}
+
+	for (NetworkObject* object : l_oldObjects)
+	{
+		InternalComm::DestroyObject(object);
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// protocol code of the packet indicate a clock syncronization
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveClockSyncro(sf::Packet& a_packet)
+{
+	sf::Int64 l_receiveTime = m_clock.getElapsedTime().asMicroseconds();
+
+	sf::Int64 l_clientTime;
+	sf::Int64 l_serverReceiveTime;
+	sf::Int64 l_serverSendTime;
+
+	if (!(a_packet >> l_clientTime))
+		throw NetworkException("Error : reading clock syncronization has failed");
+
+	if (l_clientTime < 0) // the server ask for a new syncronization
+	{
+		m_remainingSyncroSamples = CLOCK_SYNCRO_BURST;
+		m_lastSyncroBurst = l_receiveTime;
+
+		SendClockSyncroRequest();
+		return;
+	}
+
+	if (!(a_packet >> l_serverReceiveTime >> l_serverSendTime))
+		throw NetworkException("Error : reading clock syncronization has failed");
+
+	m_udpSystem.WaitForLock(); // the game thread reads the estimates in GetServerTime
+
+	m_clockSyncro.AddSample(l_clientTime, l_serverReceiveTime, l_serverSendTime, l_receiveTime);
+
+	m_stats.m_clockOffset = (int)(m_clockSyncro.GetOffset(l_receiveTime) / 1000);
+	m_stats.m_currentLatency = (int)(m_clockSyncro.GetLastRoundTrip() / 2000); // latency is the half of the round trip
+	m_stats.m_averageLatency = (int)(m_clockSyncro.GetAverageRoundTrip() / 2000);
+
+	m_udpSystem.Unlock();
+
+	if (m_remainingSyncroSamples > 0) // samples are asked one after the other, so they do not queue behind each other
+		SendClockSyncroRequest();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send a request for one clock syncronization sample
+///
+////////////////////////////////////////////////////////////
+void Client::SendClockSyncroRequest()
+{
+	if (!m_server.m_isConsideredAlive || !m_isConnected)
+		return;
+
+	m_lastSyncroRequest = m_clock.getElapsedTime().asMicroseconds();
+
+	m_remainingSyncroSamples--;
+
+	sf::Packet l_packet;
+
+	l_packet << (sf::Uint16)CT_ClockSyncro << m_lastSyncroRequest;
+
+	SendPacket(l_packet);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Start a new burst of clock syncronization samples
+/// when needed, and ask again the samples that were lost
+///
+////////////////////////////////////////////////////////////
+void Client::HandleClockSyncro()
+{
+	if (!m_server.m_isConsideredAlive || !m_isConnected)
+		return;
+
+	sf::Int64 l_now = m_clock.getElapsedTime().asMicroseconds();
+
+	if (m_remainingSyncroSamples > 0)
+	{
+		if (l_now - m_lastSyncroRequest >= CLOCK_SYNCRO_RETRY * 1000) // the answer was lost (or the request came before the connection)
+			SendClockSyncroRequest();
+	}
+	else if (l_now - m_lastSyncroBurst >= CLOCK_SYNCRO_INTERVAL * 1000) // clocks drift, so we regularly measure again
+	{
+		m_remainingSyncroSamples = CLOCK_SYNCRO_BURST;
+		m_lastSyncroBurst = l_now;
+
+		SendClockSyncroRequest();
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the current time of the server clock, estimated
+/// from the clock syncronization
+///
+/// \return the server time (the client time while not syncronized)
+///
+////////////////////////////////////////////////////////////
+sf::Time Client::GetServerTime()
+{
+	m_udpSystem.WaitForLock(); // the client thread updates the estimates meanwhile
+
+	sf::Int64 l_serverTime = m_clockSyncro.GetServerTime(m_clock.getElapsedTime().asMicroseconds());
+
+	m_udpSystem.Unlock();
+
+	return sf::microseconds(l_serverTime);
+}
+
+
 ////////////////////////////////////////////////////////////
 /// \brief check if a server exist at a non local address
 ///
@@ -321,6 +671,8 @@ void Client::CloseConnection()
 			m_server.m_TCPSocket.disconnect();
 
 		m_isConnected = false;
+
+		m_sessionToken = 0; // we leave on purpose, the server forgets the session
 	}
 }
 
@@ -333,7 +685,25 @@ void Client::CloseConnection()
 ////////////////////////////////////////////////////////////
 void Client::ReceiveUpdate(sf::Packet& a_packet)
 {
+	if (IsClientAndServer()) // in case of a listener server, the objects are already up to date
+		return;
+
+	while (!a_packet.endOfPacket()) // the objects are read until the end of the frame
+	{
+		NetworkData l_data(&ScratchArena::GetThreadArena()); // only used during this batch
+
+		if (!InternalComm::ReadObject(a_packet, l_data))
+		{
+			throw NetworkException("Error : reading update has failed");
+		}
+
+		if (NetworkObject::GetObjectList().find(l_data.GetId()) != NetworkObject::GetObjectList().end()) // the object may have been deleted meanwhile
+		{
+			InternalComm::SendUpdateToObject(l_data, false);
 
+			m_worldHash.SetDirty(l_data.GetId());
+		}
+	}
 }
 
 
@@ -362,68 +732,117 @@ void Client::ReceiveCreate(sf::Packet& a_packet)
 	if (IsClientAndServer()) // in case of a listener server, we ignore the creation
 		return;
 
-	sf::Uint8 l_numberObject;
-
-	if (!(a_packet >> l_numberObject))
-	{
-		throw NetworkException("Error : reading creator has failed");
-	}
+	std::string l_typeName;
 
-	for (int i = 0; i < l_numberObject; i++)
+	while (!a_packet.endOfPacket()) // the objects of the same type are grouped behind their type name, until the end of the frame
 	{
-		std::string l_typeName;
-		NetworkData l_data;
+		sf::Uint32 l_numberObject;
 
-		if (!(a_packet >> l_typeName))
+		if (!(a_packet >> l_typeName) || !InternalComm::ReadVarint(a_packet, l_numberObject))
 		{
 			throw NetworkException("Error : Unreadable type name");
 		}
 
-		if (!InternalComm::ReadObject(a_packet, l_data))
+		FactoryMethod l_factory = InternalComm::GetFactory(l_typeName);
+
+		if (l_factory == NULL)
 		{
-			throw NetworkException("Error : reading new object has failed");
+			throw NetworkException("Error : the type of the new object is not instanciable");
 		}
-		
-		NetworkObject* l_object = InternalComm::InstanciateType(l_typeName);
-		l_object->SetTypeName(l_typeName);
-		l_object->ReceiveUpdate(l_data, true);
-	}
-}
 
+		for (sf::Uint32 i = 0; i < l_numberObject; i++)
+		{
+			NetworkData l_data(&ScratchArena::GetThreadArena()); // only used during this batch
 
-////////////////////////////////////////////////////////////
-/// \brief Called after first step of reading packet, if the
-/// protocol code of the packet indicate a deletion
-///
-/// \param a_packet the packet that contains data without the protocol code
-///
-////////////////////////////////////////////////////////////
-void Client::ReceiveDelete(sf::Packet& a_packet)
-{
+			if (!InternalComm::ReadObject(a_packet, l_data))
+			{
+				throw NetworkException("Error : reading new object has failed");
+			}
 
+			m_worldHash.SetDirty(l_data.GetId());
+
+			ObjectList::iterator l_previous = NetworkObject::GetObjectList().find(l_data.GetId());
+
+			if (l_previous != NetworkObject::GetObjectList().end() && l_previous->second->GetTypeName() == l_typeName) // already received (resumed session), it is only updated
+			{
+				l_previous->second->ReceiveUpdate(l_data, false);
+				continue;
+			}
+
+			if (l_previous != NetworkObject::GetObjectList().end()) // the id was reused by an object of another type, the new one replaces it
+			{
+				InternalComm::DestroyObject(l_previous->second);
+			}
+
+			NetworkObject* l_object = InternalComm::InstanciateType(l_factory, l_data.GetId());
+			l_object->SetTypeName(l_typeName);
+			l_object->ReceiveUpdate(l_data, false);
+		}
+	}
 }
 
 
 ////////////////////////////////////////////////////////////
 /// \brief Called after first step of reading packet, if the
-/// protocol code of the packet indicate a command
+/// protocol code of the packet indicate a deletion
 ///
 /// \param a_packet the packet that contains data without the protocol code
 ///
 ////////////////////////////////////////////////////////////
-void Client::ReceiveCommand(sf::Packet& a_packet)
+void Client::ReceiveDelete(sf::Packet& a_packet)
 {
-	if (IsClientAndServer()) // in case of an listener server, we ignore the command, since the server already send it to the concerned object
+	if (IsClientAndServer()) // in case of a listener server, the server has already destroyed the objects
 		return;
 
-	NetworkData l_data;
+	sf::Uint16 l_numberObject;
 
-	std::string l_serverName;
+	if (!(a_packet >> l_numberObject))
+	{
+		throw NetworkException("Error : reading deletion has failed");
+	}
+
+	for (int i = 0; i < l_numberObject; i++)
+	{
+		sf::Uint16 l_id;
+
+		if (!(a_packet >> l_id))
+		{
+			throw NetworkException("Error : reading deletion has failed");
+		}
+
+		ObjectList::iterator l_object = NetworkObject::GetObjectList().find(l_id);
+
+		if (l_object != NetworkObject::GetObjectList().end()) // the memory and the id are reused by the next creations
+		{
+			InternalComm::DestroyObject(l_object->second);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// protocol code of the packet indicate a command
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveCommand(sf::Packet& a_packet)
+{
+	if (IsClientAndServer()) // in case of an listener server, we ignore the command, since the server already send it to the concerned object
+		return;
+
+	NetworkData l_data(&ScratchArena::GetThreadArena()); // only used during this batch
+
+	sf::Uint32 l_commandKey;
 	sf::Uint16 l_command;
 
-	if(! (a_packet >> l_serverName >> l_command))
+	if(! (a_packet >> l_commandKey >> l_command))
 		throw NetworkException("Error : reading command has failed");
 
+	if (l_commandKey != m_serverCommandKey && !m_server.m_isLoopback) // the key of the server comes with the session
+		throw NetworkException("Error : Authentication error!");
+
 	if (InternalComm::ReadCommand(a_packet, l_data))
 	{
 		InternalComm::SendCommandToObject(Command(l_command, l_data));
@@ -513,14 +932,12 @@ const std::map<std::string, FileTransfer*>& Client::GetReceivedFiles() const
 ////////////////////////////////////////////////////////////
 bool Client::IsReady() const
 {
-	// TODO : make this answer more accurate
-
-	if (!m_isConnected)
+	if (!m_isConnected || !m_isWorldSyncronized)
 		return false;
 
 	for (std::pair<std::string, FileTransfer*> transfert : m_receivedFiles)
 	{
-		if (!transfert.second->IsComplete())
+		if (transfert.second != NULL && !transfert.second->IsComplete()) // NULL if the file was not replaced
 			return false;
 	}
 
@@ -548,24 +965,390 @@ void Client::ReceiveFile(sf::Packet& a_packet)
 
 		a_packet >> l_fileSize >> l_originPath;
 
+		delete m_receivedFiles[l_fileName]; // the transfert of a previous version is replaced, it releases the file
+
 		if (l_originPath == FileTransfer::GetExecutablePath() && m_server.m_isLocalHost)
 		{
 			m_receivedFiles[l_fileName] = NULL; // server.exe is at the same place than client.exe, so we do not replace it
 		}
 		else
 		{
-			m_receivedFiles[l_fileName] = new FileTransfer(l_fileName, l_fileSize); // TODO : handle the case where the file already exist
+			m_receivedFiles[l_fileName] = new FileTransfer(l_fileName, l_fileSize, std::vector<sf::Uint64>());
 		}
 	}
 	else
 	{
-		if(m_receivedFiles[l_fileName] != NULL)
-			m_receivedFiles[l_fileName]->ReceivePacket(a_packet);
+		sf::Uint32 l_offset;
+		sf::Uint32 l_size;
+
+		FileTransfer* l_transfert = m_receivedFiles[l_fileName];
+
+		if (l_transfert == NULL)
+			return;
+
+		bool l_hadFailed = l_transfert->HasFailed();
+
+		if (l_transfert->ReceivePacket(a_packet, l_offset, l_size))
+		{
+			sf::Packet l_ack; // the sender waits for it to send the next parts
+
+			l_ack << (sf::Uint16)CT_FileAck << l_fileName << l_offset << l_size;
+
+			SendPacket(l_ack);
+		}
+		else if (!l_hadFailed && l_transfert->HasFailed() && !l_transfert->IsCanceled())
+		{
+			SendFileFailure(l_fileName);
+		}
 	}
 
 }
 
 
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server sends the manifest of its syncronized files, the
+/// chunks that differ from our copy are asked
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveFileManifest(sf::Packet& a_packet)
+{
+	sf::Packet l_answer;
+
+	l_answer << (sf::Uint16)CT_FileManifest;
+
+	bool l_isAsking = false;
+
+	std::vector<sf::Uint64> l_hashes;
+
+	std::vector<sf::Uint64> l_localHashes;
+
+	std::vector<sf::Uint64> l_known;
+
+	std::vector<sf::Uint32> l_missing;
+
+	size_t l_readSize = sizeof(sf::Uint16); // the packet has no reading position, the command was read before
+
+	while (!a_packet.endOfPacket()) // the files until the end of the frame
+	{
+		std::string l_fileName;
+		sf::Uint32 l_fileSize;
+		sf::Uint32 l_numberChunks;
+		size_t l_length;
+
+		if (!(a_packet >> l_fileName >> l_fileSize) || !InternalComm::ReadVarint(a_packet, l_numberChunks, l_length))
+		{
+			throw NetworkException("Error : reading file manifest has failed");
+		}
+
+		l_readSize += sizeof(sf::Uint32) + l_fileName.size() + sizeof(sf::Uint32) + l_length;
+
+		// one hash per chunk of the file, and they must all be in the packet
+		if (l_numberChunks != (l_fileSize + (sf::Uint64)FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE
+			|| l_numberChunks > (a_packet.getDataSize() - l_readSize) / sizeof(sf::Uint64))
+		{
+			throw NetworkException("Error : reading file manifest has failed");
+		}
+
+		l_readSize += l_numberChunks * sizeof(sf::Uint64);
+
+		l_hashes.resize(l_numberChunks);
+
+		for (sf::Uint32 i = 0; i < l_numberChunks; i++)
+		{
+			if (!(a_packet >> l_hashes[i]))
+			{
+				throw NetworkException("Error : reading file manifest has failed");
+			}
+		}
+
+		std::map<std::string, FileTransfer*>::iterator l_previous = m_receivedFiles.find(l_fileName);
+
+		if (l_previous != m_receivedFiles.end()) // the transfert of a previous version is replaced, it releases the file
+		{
+			delete l_previous->second;
+			m_receivedFiles.erase(l_previous);
+		}
+
+		sf::Uint32 l_localSize;
+
+		std::string l_key = FileCache::GetKey(l_fileSize, l_hashes);
+
+		// an interrupted transfert knows its received chunks, else we read our copy (nothing if we do not have the file)
+		if (!FileManifest::ReadParts(l_fileName, l_localSize, l_localHashes))
+			FileManifest::ComputeChunks(l_fileName, l_localSize, l_localHashes);
+
+		FileManifest::CompareChunks(l_hashes, l_localHashes, l_known, l_missing);
+
+		if ((l_missing.size() != 0 || l_localSize != l_fileSize) && FileCache::Restore(l_key, l_fileName)) // this version was received before, maybe from another server
+		{
+			DeleteFileA((l_fileName + FILE_PARTS_SUFFIX).c_str());
+
+			FileManifest::ComputeChunks(l_fileName, l_localSize, l_localHashes); // the entry is checked like our copy, a damaged chunk is still asked
+
+			FileManifest::CompareChunks(l_hashes, l_localHashes, l_known, l_missing);
+		}
+
+		if (l_missing.size() == 0 && l_localSize == l_fileSize) // our copy is already up to date
+		{
+			DeleteFileA((l_fileName + FILE_PARTS_SUFFIX).c_str()); // in case the last part was received just before a crash
+
+			FileCache::Store(l_key, l_fileName); // nothing if the cache already has it
+
+			continue;
+		}
+
+		m_receivedFiles[l_fileName] = new FileTransfer(l_fileName, (int)l_fileSize, l_known); // it also gives the right size to our copy
+
+		if (l_missing.size() == 0)
+			continue;
+
+		l_answer << l_fileName;
+
+		InternalComm::WriteVarint(l_answer, (sf::Uint32)l_missing.size());
+
+		for (sf::Uint32 chunk : l_missing)
+		{
+			InternalComm::WriteVarint(l_answer, chunk);
+		}
+
+		l_isAsking = true;
+	}
+
+	if (l_isAsking)
+		SendPacket(l_answer);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server has changed a syncronized file, the signatures of
+/// the blocks of our copy are sent so only the changes come
+/// back
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveFileSignatures(sf::Packet& a_packet)
+{
+	std::string l_fileName;
+	std::string l_originPath;
+
+	if (!(a_packet >> l_fileName >> l_originPath))
+		throw NetworkException("Error : reading file signatures has failed");
+
+	if (l_originPath == FileTransfer::GetExecutablePath() && m_server.m_isLocalHost)
+		return; // server.exe is at the same place than client.exe, so the file is already the new one
+
+	std::map<std::string, FileTransfer*>::iterator l_previous = m_receivedFiles.find(l_fileName);
+
+	if (l_previous != m_receivedFiles.end()) // the transfert of a previous version is replaced, it releases the file
+	{
+		delete l_previous->second;
+		m_receivedFiles.erase(l_previous);
+	}
+
+	std::vector<BlockSignature> l_blocks;
+
+	FileManifest::ComputeBlocks(l_fileName, l_blocks); // no block if we do not have the file, then everything is sent
+
+	sf::Uint32 l_first = 0;
+
+	do // a large file has too many blocks for one datagram
+	{
+		sf::Uint32 l_count = (sf::Uint32)std::min<size_t>(l_blocks.size() - l_first, FILE_SIGNATURES_PER_PACKET);
+
+		bool l_isLast = l_first + l_count == l_blocks.size();
+
+		sf::Packet l_answer;
+
+		l_answer << (sf::Uint16)CT_FileSignatures << l_fileName << l_isLast;
+
+		InternalComm::WriteVarint(l_answer, l_first);
+		InternalComm::WriteVarint(l_answer, l_count);
+
+		for (sf::Uint32 i = l_first; i < l_first + l_count; i++)
+		{
+			l_answer << l_blocks[i].m_weak << l_blocks[i].m_strong;
+		}
+
+		SendPacket(l_answer);
+
+		l_first += l_count;
+	}
+	while (l_first < l_blocks.size());
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive a part of a delta transfert : its start,
+/// or the blocks of our copy to reuse (the changed bytes come
+/// as ordinary parts of the file)
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveFileDelta(sf::Packet& a_packet)
+{
+	bool l_startFile;
+
+	std::string l_fileName;
+
+	if (!(a_packet >> l_startFile >> l_fileName))
+		throw NetworkException("Error : reading file delta has failed");
+
+	if (l_startFile)
+	{
+		sf::Uint32 l_fileSize;
+
+		if (!(a_packet >> l_fileSize) || l_fileSize > 0x7FFFFFFF) // the sizes of the files are kept in int
+			throw NetworkException("Error : reading file delta has failed");
+
+		delete m_receivedFiles[l_fileName]; // the transfert of a previous version is replaced
+
+		m_receivedFiles[l_fileName] = new FileTransfer(l_fileName, l_fileSize, std::vector<sf::Uint64>(), true);
+	}
+	else
+	{
+		std::map<std::string, FileTransfer*>::iterator l_transfert = m_receivedFiles.find(l_fileName);
+
+		if (l_transfert != m_receivedFiles.end() && l_transfert->second != NULL && !l_transfert->second->HasFailed())
+		{
+			l_transfert->second->ReceiveBlocks(a_packet);
+
+			if (l_transfert->second->HasFailed()) // our copy has changed since the signatures
+				SendFileFailure(l_fileName);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Tell the server that the reception of a file has
+/// failed, so it stops the transfert instead of waiting for
+/// the acknowledgements
+///
+/// \param a_fileName the name of the file
+///
+////////////////////////////////////////////////////////////
+void Client::SendFileFailure(const std::string& a_fileName)
+{
+	sf::Packet l_packet;
+
+	l_packet << (sf::Uint16)CT_FileFailed << a_fileName;
+
+	SendPacket(l_packet);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server sends a compressed frame : it is decompressed and
+/// read as if it was received
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveCompressed(sf::Packet& a_packet)
+{
+	std::shared_ptr<const CompressionDictionary> l_dictionary = GetDictionary();
+
+	if (!Compression::DecompressFrame(a_packet, m_decompressed, l_dictionary.get()))
+	{
+		throw NetworkException("Error : reading compressed frame has failed");
+	}
+
+	sf::Packet l_frame;
+
+	l_frame.append(m_decompressed.data(), m_decompressed.size());
+
+	Receive(l_frame);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server sends the dictionary of the realtime packets
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveDictionary(sf::Packet& a_packet)
+{
+	sf::Uint32 l_size;
+
+	size_t l_sizeLength;
+
+	if (!InternalComm::ReadVarint(a_packet, l_size, l_sizeLength) || l_size > COMPRESSION_MAX_OFFSET)
+	{
+		throw NetworkException("Error : reading dictionary has failed");
+	}
+
+	size_t l_headerSize = sizeof(sf::Uint16) + l_sizeLength; // the command and the size come first
+
+	if (l_headerSize + l_size != a_packet.getDataSize())
+	{
+		throw NetworkException("Error : reading dictionary has failed");
+	}
+
+	const char* l_content = static_cast<const char*>(a_packet.getData()) + l_headerSize;
+
+	std::shared_ptr<CompressionDictionary> l_dictionary = std::make_shared<CompressionDictionary>(); // indexed before the game thread can see it
+
+	l_dictionary->Load(std::vector<char>(l_content, l_content + l_size));
+
+	if (l_dictionary->IsEmpty())
+		l_dictionary.reset();
+
+	m_udpSystem.WaitForLock();
+
+	m_dictionary = l_dictionary;
+
+	m_udpSystem.Unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the dictionary of the realtime packets, it can
+/// be replaced by the network thread at any time
+///
+/// \return the dictionary, NULL if there is none
+///
+////////////////////////////////////////////////////////////
+std::shared_ptr<const CompressionDictionary> Client::GetDictionary()
+{
+	m_udpSystem.WaitForLock();
+
+	std::shared_ptr<const CompressionDictionary> l_dictionary = m_dictionary;
+
+	m_udpSystem.Unlock();
+
+	return l_dictionary;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Called after first step of reading packet, if the
+/// server refused a command because its game was late
+///
+/// \param a_packet the packet that contains data without the protocol code
+///
+////////////////////////////////////////////////////////////
+void Client::ReceiveCommandRefused(sf::Packet& a_packet)
+{
+	sf::Uint16 l_customCommand;
+
+	if (!(a_packet >> l_customCommand))
+		throw NetworkException("Error : unreadable message (refused command)!");
+
+	m_stats.m_refusedCommands++;
+
+	std::cout << "The server refused the command " << l_customCommand << ", too many commands are waiting" << std::endl;
+}
+
+
 ////////////////////////////////////////////////////////////
 /// \brief Get the information that the connected server send
 /// by broadcast
@@ -583,6 +1366,64 @@ InfoServer* Client::GetInfoOfTheConnection()
 	return NULL;
 }
 
+////////////////////////////////////////////////////////////
+/// \brief Handle the packets sent by the server of the same
+/// application through the loopback channel
+///
+/// \return true if at least one message was received
+///
+////////////////////////////////////////////////////////////
+bool Client::HandleLoopbackMessages()
+{
+	if (!m_server.m_isLoopback || m_loopback == NULL)
+		return false;
+
+	bool l_hasReceived = false;
+
+	LoopbackFrame l_frame;
+
+	sf::Packet l_packet; // the readers need a sf::Packet, which can not take the buffer of the frame
+
+	while (m_loopback->ReceiveFromServer(l_frame))
+	{
+		if (l_frame.m_session == m_loopbackSession && m_isConnected) // the frames of the previous sessions are dropped
+		{
+			l_packet.clear(); // keeps its storage for the next frames
+
+			l_packet.append(l_frame.m_frame->GetData(), l_frame.m_frame->GetSize());
+
+			Receive(l_packet);
+
+			l_hasReceived = true;
+		}
+	}
+
+	if (m_isConnected && m_loopback->IsClosed()) // the server has been shut down, like a disconnected socket
+	{
+		m_server.m_isConsideredAlive = false;
+
+		m_isConnected = false;
+	}
+
+	return l_hasReceived;
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Send the frames still waiting in the queue of the
+/// TCP socket (non blocking socket only)
+///
+////////////////////////////////////////////////////////////
+void Client::FlushSendQueue()
+{
+	m_udpSystem.WaitForLock(); // the queue is filled under the same lock
+
+	if (m_server.HasPendingFrames())
+		m_server.FlushSendQueue(); // a closed socket is detected by the reception
+
+	m_udpSystem.Unlock();
+}
+
+
 ////////////////////////////////////////////////////////////
 /// \brief Connect this client to an existing server
 ///
@@ -608,16 +1449,51 @@ bool Client::Connect(const InfoServer* a_server, bool a_TcpConnect)
 
 	sf::Packet l_packet; // prepare a message for the server to indicate clearly who I'am
 
-	l_packet << (sf::Uint16)CT_NewConnection << m_clientName << m_udpSystem.GetUdpPort();
+	l_packet << (sf::Uint16)CT_NewConnection << m_clientName << m_udpSystem.GetUdpPort() << InternalComm::IsCompressionEnabled();
 
-	if (a_TcpConnect)
+	if (a_server->m_address.toInteger() != m_sessionAddress.toInteger() || a_server->m_port != m_sessionPort) // a token is only known by the server that gave it
+		m_sessionToken = 0;
+
+	m_sessionAddress = a_server->m_address;
+	m_sessionPort = a_server->m_port;
+
+	m_udpSystem.WaitForLock();
+
+	m_dictionary.reset(); // each server sends its own dictionary
+
+	m_udpSystem.Unlock();
+
+	m_commandKey = 0; // the keys are given again by each session
+	m_serverCommandKey = 0;
+
+	sf::Uint32 l_receivedFrames = m_receivedFrames; // what we received during the previous session
+
+	std::shared_ptr<LoopbackChannel> l_loopback = InternalComm::GetLoopbackChannel(a_server);
+
+	m_server.m_isLoopback = l_loopback != NULL;
+
+	if (m_server.m_isLoopback) // the server runs on this application, so we do not need any socket
 	{
+		m_loopback = l_loopback;
+
+		m_loopbackSession = m_loopback->Open(); // the server accepts a new session as a new connection
+
+		m_server.m_isUDPConnection = false;
+	}
+	else if (a_TcpConnect)
+	{
+		m_server.m_TCPSocket.setBlocking(true); // even in poll mode, the connection itself is waited
+
+		m_receivedFrames = 0; // the server counts the frames of the new socket from its acceptance
+
 		sf::Socket::Status status = m_server.m_TCPSocket.connect(a_server->m_address, a_server->m_port); //  TODO : Check if this is as wrong as UDP port system
 		if (status != sf::Socket::Done)
 		{
 			return false;
 		}
 
+		m_server.m_TCPSocket.setBlocking(!InternalComm::IsPollMode());
+
 		std::cout << "I m now connected !" << std::endl;
 
 		m_server.m_isUDPConnection = false;
@@ -634,15 +1510,188 @@ bool Client::Connect(const InfoServer* a_server, bool a_TcpConnect)
 	m_server.m_name = a_server->m_name;
 	m_server.m_isLocalHost = a_server->m_address.toInteger() == sf::IpAddress::getLocalAddress().toInteger();
 	m_isConnected = true;
+	m_isWorldSyncronized = false; // the server streams the existing objects, then it sends CT_SyncroComplete
 
 	m_stats.m_serverInfo = GetInfoOfTheConnection();
 
+	if (m_sessionToken != 0 && !m_server.m_isUDPConnection && !m_server.m_isLoopback) // ask the server to resume the previous session
+		l_packet << m_sessionToken << l_receivedFrames;
+
 	SendPacket(l_packet);
 
+	// syncronize the clock as soon as possible
+	m_udpSystem.WaitForLock();
+
+	m_clockSyncro.Reset();
+
+	m_udpSystem.Unlock();
+	m_remainingSyncroSamples = CLOCK_SYNCRO_BURST;
+	m_lastSyncroBurst = m_clock.getElapsedTime().asMicroseconds();
+
+	SendClockSyncroRequest();
+
+	return true;
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Poll mode] Run one loop of the client on the
+/// calling thread, without waiting
+///
+/// \return true if at least one message was received
+///
+////////////////////////////////////////////////////////////
+bool Client::Poll()
+{
+	if (!m_isRunning)
+		return false;
+
+	try
+	{
+		return Update(true);
+	}
+	catch (const NetworkException& ex)
+	{
+		std::cout << "Crash by exception : " << ex.what() << std::endl;
+
+		m_isRunning = false; // like the thread, the client stops
+	}
+
+	return false;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Indicate that an object was destroyed, so its hash
+/// is not valid anymore
+///
+/// \param a_id the id of the object
+///
+////////////////////////////////////////////////////////////
+void Client::ObjectWasDestroyed(sf::Uint16 a_id)
+{
+	m_worldHash.SetDirty(a_id);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive a message from the server on the TCP socket
+///
+/// \return true if a message was received
+///
+////////////////////////////////////////////////////////////
+bool Client::ReceiveTcpMessage()
+{
+	if (!m_isConnected || m_server.m_isUDPConnection || m_server.m_isLoopback)
+		return false;
+
+	sf::Packet l_packet;
+
+	sf::Socket::Status l_status = m_server.m_TCPSocket.receive(l_packet);
+
+	if (l_status == sf::Socket::Disconnected || l_status == sf::Socket::Error) // the server has left without warning us
+	{
+		m_server.m_isConsideredAlive = false;
+
+		m_isConnected = false;
+
+		m_selector.remove(m_server.m_TCPSocket);
+
+		return false;
+	}
+
+	if (l_status != sf::Socket::Done) // a non blocking socket can have received only a part of the packet
+		return false;
+
+	const sf::Uint8* l_data = static_cast<const sf::Uint8*>(l_packet.getData());
+
+	if (l_packet.getDataSize() >= sizeof(sf::Uint16) && Frame::IsStateCommand((sf::Uint16)((l_data[0] << 8) | l_data[1]))) // counted like the server does, to resume the session
+		m_receivedFrames++;
+
+	Receive(l_packet); // received data are supposed to be processed in the ReceiveInformation method
+
 	return true;
 }
 
 
+////////////////////////////////////////////////////////////
+/// \brief Receive a message on the UDP socket, from the server
+/// or from a broadcasting server
+///
+/// \return true if a message was received
+///
+////////////////////////////////////////////////////////////
+bool Client::ReceiveUdpMessage()
+{
+	sf::Packet l_packet;
+	sf::IpAddress l_ipAddress;
+	unsigned short l_port;
+
+	if (m_udpSystem.GetUdpSocket().receive(l_packet, l_ipAddress, l_port) != sf::Socket::Done)
+		return false;
+
+	if (l_ipAddress.toInteger() == m_server.m_ipAddress.toInteger() && m_server.m_isUDPConnection)
+	{
+		Receive(l_packet); // received data are supposed to be processed in the ReceiveInformation method
+	}
+	else // if we receive a message from an unknow source (probably a broadcasting server)
+	{
+		ReceiveBroadcast(l_packet, l_ipAddress); //we supposed that this is a broadcast, but if not this function will do nothing
+	}
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief One loop of the client : receive, dispatch and
+/// clock syncronization
+///
+/// \param a_isPolling if true nothing waits (poll mode), else
+/// the loop waits the sockets for a short time
+///
+/// \return true if at least one message was received
+///
+////////////////////////////////////////////////////////////
+bool Client::Update(bool a_isPolling)
+{
+	ScratchScope l_scratch; // the decoding scratch of this loop is released at its end
+
+	bool l_hasReceived = false;
+
+	if (a_isPolling) // non blocking sockets, we just try to read all of them
+	{
+		l_hasReceived |= ReceiveTcpMessage();
+
+		l_hasReceived |= ReceiveUdpMessage();
+	}
+	else
+	{
+		// 50ms loop to allow the thread to stop quickly, and much less when the loopback must be read
+		int l_waitTime = m_server.m_isLoopback && m_isConnected ? LOOPBACK_POLL_DELAY : 50;
+
+		if (m_selector.wait(sf::milliseconds(l_waitTime)))
+		{
+			if (m_selector.isReady(m_server.m_TCPSocket)) //TCP
+				ReceiveTcpMessage();
+
+			if (m_selector.isReady(m_udpSystem.GetUdpSocket())) // Udp
+				ReceiveUdpMessage();
+
+			l_hasReceived = true;
+		}
+	}
+
+	l_hasReceived |= HandleLoopbackMessages(); // the server of this application does not wake up the selector
+
+	FlushSendQueue();
+
+	HandleClockSyncro();
+
+	return l_hasReceived;
+}
+
 
 ////////////////////////////////////////////////////////////
 /// \brief This function is called as thread for each client,
@@ -655,41 +1704,9 @@ void Client::ClientThread(Client* a_client)
 {
 	try
 	{
-		a_client->m_selector.add(a_client->m_udpSystem.GetUdpSocket());
-
 		while (a_client->m_isRunning)
 		{
-			if (a_client->m_selector.wait(sf::milliseconds(50))) // 50ms loop to allow the thread to stop quickly
-			{
-
-				if (a_client->m_selector.isReady(a_client->m_server.m_TCPSocket)) //TCP
-				{
-					sf::Packet l_packet;
-
-					a_client->m_server.m_TCPSocket.receive(l_packet);
-
-					a_client->Receive(l_packet); // received data are supposed to be processed in the ReceiveInformation method
-				}
-
-				if (a_client->m_selector.isReady(a_client->m_udpSystem.GetUdpSocket())) // Udp
-				{
-					sf::Packet l_packet;
-					sf::IpAddress l_ipAddress;
-					unsigned short l_port;
-
-					a_client->m_udpSystem.GetUdpSocket().receive(l_packet, l_ipAddress, l_port);
-
-					if (l_ipAddress.toInteger() == a_client->m_server.m_ipAddress.toInteger() && a_client->m_server.m_isUDPConnection)
-					{
-						a_client->Receive(l_packet); // received data are supposed to be processed in the ReceiveInformation method
-					}
-					else // if we receive a message from an unknow source (probably a broadcasting server)
-					{
-						a_client->ReceiveBroadcast(l_packet, l_ipAddress); //we supposed that this is a broadcast, but if not this function will do nothing
-					}
-				}
-				
-			}
+			a_client->Update(false);
 		}
 	}
 	catch (const NetworkException& ex)
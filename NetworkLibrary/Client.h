@@ -26,6 +26,8 @@
 #include "Connection.h" //(included in server)
 #include "Server.h"
 #include "ClientStat.h"
+#include "ClockSyncro.h"
+#include "WorldHash.h"
 
 #include "UdpHandler.h"
 #include "FileTransfer.h"
@@ -202,8 +204,64 @@ public:
 	////////////////////////////////////////////////////////////
 	bool IsReady() const;
 
+	////////////////////////////////////////////////////////////
+	/// \brief Get the current time of the server clock, estimated
+	/// from the clock syncronization
+	///
+	/// \return the server time (the client time while not syncronized)
+	///
+	////////////////////////////////////////////////////////////
+	sf::Time GetServerTime();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Poll mode] Run one loop of the client on the
+	/// calling thread, without waiting
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool Poll();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Indicate that an object was destroyed, so its hash
+	/// is not valid anymore
+	///
+	/// \param a_id the id of the object
+	///
+	////////////////////////////////////////////////////////////
+	void ObjectWasDestroyed(sf::Uint16 a_id);
+
 private:
 
+	////////////////////////////////////////////////////////////
+	/// \brief Receive a message from the server on the TCP socket
+	///
+	/// \return true if a message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool ReceiveTcpMessage();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive a message on the UDP socket, from the server
+	/// or from a broadcasting server
+	///
+	/// \return true if a message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool ReceiveUdpMessage();
+
+	////////////////////////////////////////////////////////////
+	/// \brief One loop of the client : receive, dispatch and
+	/// clock syncronization
+	///
+	/// \param a_isPolling if true nothing waits (poll mode), else
+	/// the loop waits the sockets for a short time
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool Update(bool a_isPolling);
+
 	////////////////////////////////////////////////////////////
 	/// \brief This function is called as thread for each client,
 	/// this is the equivalent of main for clients.
@@ -222,6 +280,15 @@ private:
 	////////////////////////////////////////////////////////////
 	void SendPacket(sf::Packet& a_packet);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Send a packet to the server, a server of this
+	/// application takes it without any copy
+	///
+	/// \param a_packet the packet that contains all data
+	///
+	////////////////////////////////////////////////////////////
+	void SendPacket(std::shared_ptr<sf::Packet>& a_packet);
+
 
 	////////////////////////////////////////////////////////////
 	/// \brief Called when the socket selector receive a packet
@@ -300,6 +367,136 @@ private:
 	////////////////////////////////////////////////////////////
 	void ReceivePing(sf::Packet& a_packet);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server has sent all the objects that existed when this
+	/// client was connected, an udp client acknowledges it
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveSyncroComplete(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server gives the token of the session, an udp client
+	/// acknowledges it
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveSession(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server sends its world hash, the leaves that differ are
+	/// sent back
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveWorldHash(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server sends the manifest of its syncronized files, the
+	/// chunks that differ from our copy are asked
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileManifest(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server has changed a syncronized file, the signatures of
+	/// the blocks of our copy are sent so only the changes come
+	/// back
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileSignatures(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive a part of a delta transfert : its start,
+	/// or the blocks of our copy to reuse (the changed bytes come
+	/// as ordinary parts of the file)
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileDelta(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Tell the server that the reception of a file has
+	/// failed, so it stops the transfert instead of waiting for
+	/// the acknowledgements
+	///
+	/// \param a_fileName the name of the file
+	///
+	////////////////////////////////////////////////////////////
+	void SendFileFailure(const std::string& a_fileName);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server sends a compressed frame : it is decompressed and
+	/// read as if it was received
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveCompressed(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server sends the dictionary of the realtime packets
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveDictionary(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the dictionary of the realtime packets, it can
+	/// be replaced by the network thread at any time
+	///
+	/// \return the dictionary, NULL if there is none
+	///
+	////////////////////////////////////////////////////////////
+	std::shared_ptr<const CompressionDictionary> GetDictionary();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// server refused a command because its game was late
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveCommandRefused(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// protocol code of the packet indicate a clock syncronization
+	///
+	/// \param a_packet the packet that contains data without the protocol code
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveClockSyncro(sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send a request for one clock syncronization sample
+	///
+	////////////////////////////////////////////////////////////
+	void SendClockSyncroRequest();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Start a new burst of clock syncronization samples
+	/// when needed, and ask again the samples that were lost
+	///
+	////////////////////////////////////////////////////////////
+	void HandleClockSyncro();
+
 	////////////////////////////////////////////////////////////
 	/// \brief Called after first step of reading packet, if the
 	/// protocol code of the packet indicate a broadcast
@@ -318,6 +515,22 @@ private:
 	////////////////////////////////////////////////////////////
 	InfoServer* GetInfoOfTheConnection();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Handle the packets sent by the server of the same
+	/// application through the loopback channel
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool HandleLoopbackMessages();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the frames still waiting in the queue of the
+	/// TCP socket (non blocking socket only)
+	///
+	////////////////////////////////////////////////////////////
+	void FlushSendQueue();
+
 
 
 
@@ -326,11 +539,33 @@ private:
 	////////////////////////////////////////////////////////////
 	bool m_isConnected; ///< Flag to know if this client is conected to any server
 
+	bool m_isWorldSyncronized; ///< Flag to know if the server has sent all the objects that existed when this client was connected
+
+	sf::Uint64 m_sessionToken; ///< The token given by the server to resume the session after a drop, 0 if there is none
+
+	sf::Uint32 m_commandKey; ///< The key given by the server with the session, carried by the commands of this client
+
+	sf::Uint32 m_serverCommandKey; ///< The key carried by the commands of the server, given with the session
+
+	sf::IpAddress m_sessionAddress; ///< The address of the server that gave the session token
+
+	sf::Uint16 m_sessionPort; ///< The port of the server that gave the session token
+
+	sf::Uint32 m_receivedFrames; ///< The number of state frames (see Frame::IsStateCommand) received on the TCP socket during the current session
+
+	WorldHash m_worldHash; ///< The hash tree of the objects, compared with the one of the server
+
 	bool m_isUsingUDPOnly; ///< Flag to know if the main communication is one with UDP protocol
 
 	bool m_isRunning; ///< Flag to know if the client work and run fine
 
-	int m_offsetTime; ///< The (theoritical) clock offset between the client and the server (in ms)
+	ClockSyncro m_clockSyncro; ///< The estimation of the server clock
+
+	int m_remainingSyncroSamples; ///< The number of samples still to ask in the current clock syncronization burst
+
+	sf::Int64 m_lastSyncroRequest; ///< The client time of the last clock syncronization request (in us)
+
+	sf::Int64 m_lastSyncroBurst; ///< The client time of the start of the last clock syncronization burst (in us)
 
 	std::thread m_clientThread; ///< The thread used by this client for data communication
 
@@ -338,7 +573,7 @@ private:
 
 	sf::SocketSelector m_selector; ///< The selector for sockets since the client can communicate with the UDP and its TCP sockets
 
-	std::string m_clientName; ///< The client name sent in many packets. This can be used in addition to the ip address for authentication
+	std::string m_clientName; ///< The client name sent in the new connection packet, the commands carry the command key instead
 							  
 	ClientStat m_stats; ///< Contains all informations that the end user might want about this client
 
@@ -346,7 +581,15 @@ private:
 
 	UdpHandler m_udpSystem; ///< The system that handle all the udp communication
 
+	std::shared_ptr<LoopbackChannel> m_loopback; ///< The in process channel, if the server is running on this application
+
+	sf::Uint32 m_loopbackSession; ///< The session of the current loopback connection
+
 	std::map<std::string, FileTransfer*> m_receivedFiles; ///< The list of all the files that the client has received
+
+	std::vector<char> m_decompressed; ///< The storage of the last decompressed frame, kept to avoid an allocation per frame
+
+	std::shared_ptr<const CompressionDictionary> m_dictionary; ///< The dictionary of the realtime packets given by the server, NULL if there is none. Replaced under the udp lock, the game thread compresses its commands with it
 };
 
 }
\ No newline at end of file
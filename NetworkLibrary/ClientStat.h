@@ -46,7 +46,7 @@ public:
 	///
 	////////////////////////////////////////////////////////////
 	ClientStat(Connection* a_connection) : m_emittedPackets(0), m_ReceivedPackets(0), m_clockOffset(0), m_serverInfo(NULL),
-		                                   m_isInternet(true), m_currentLatency(0), m_averageLatency(0), m_connection(a_connection) {}
+		                                   m_isInternet(true), m_currentLatency(0), m_averageLatency(0), m_refusedCommands(0), m_connection(a_connection) {}
 
 
 	////////////////////////////////////////////////////////////
@@ -58,6 +58,7 @@ public:
 	bool m_isInternet;     ///< If the client is connect on a non local server
 	int m_currentLatency;  ///< The current latency to communicate with the server
 	int m_averageLatency;  ///< The average latency to communicate with the server
+	int m_refusedCommands; ///< The number of commands refused by the server because too many were waiting for its game
 
 	const Connection* m_connection; ///< Infos about the connection
 	InfoServer* m_serverInfo;       ///< Infos about the server itself
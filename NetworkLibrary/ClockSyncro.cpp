@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "ClockSyncro.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+ClockSyncro::ClockSyncro()
+{
+	Reset();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Forget all the samples and the estimates
+///
+////////////////////////////////////////////////////////////
+void ClockSyncro::Reset()
+{
+	m_numberOfSamples = 0;
+	m_nextSample = 0;
+	m_lastUsedSample = -1;
+	m_offset = 0.0;
+	m_drift = 0.0;
+	m_referenceTime = 0;
+	m_averageRoundTrip = 0.0;
+	m_lastRoundTrip = 0;
+	m_isSyncronized = false;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add a new sample and update the estimates
+///
+/// \param a_clientSend the client time when the request was sent
+///
+/// \param a_serverReceive the server time when the request was received
+///
+/// \param a_serverSend the server time when the answer was sent
+///
+/// \param a_clientReceive the client time when the answer was received
+///
+////////////////////////////////////////////////////////////
+void ClockSyncro::AddSample(sf::Int64 a_clientSend, sf::Int64 a_serverReceive, sf::Int64 a_serverSend, sf::Int64 a_clientReceive)
+{
+	Sample l_sample;
+
+	l_sample.m_roundTrip = (a_clientReceive - a_clientSend) - (a_serverSend - a_serverReceive); // the time spent on the server is not a network delay
+	l_sample.m_offset = ((a_serverReceive - a_clientSend) + (a_serverSend - a_clientReceive)) / 2;
+	l_sample.m_time = a_clientReceive;
+
+	if (l_sample.m_roundTrip < 0)
+		l_sample.m_roundTrip = 0;
+
+	// latency statistics use all the samples
+	m_lastRoundTrip = l_sample.m_roundTrip;
+
+	if (m_numberOfSamples == 0 && !m_isSyncronized)
+		m_averageRoundTrip = (double)l_sample.m_roundTrip;
+	else
+		m_averageRoundTrip += CLOCK_SYNCRO_LATENCY_GAIN * (l_sample.m_roundTrip - m_averageRoundTrip);
+
+	m_samples[m_nextSample] = l_sample;
+	m_nextSample = (m_nextSample + 1) % CLOCK_SYNCRO_WINDOW;
+
+	if (m_numberOfSamples < CLOCK_SYNCRO_WINDOW)
+		m_numberOfSamples++;
+
+	// minimum round trip filter : the fastest sample is the one with the smallest error
+	const Sample* l_best = &m_samples[0];
+
+	for (int i = 1; i < m_numberOfSamples; i++)
+	{
+		if (m_samples[i].m_roundTrip < l_best->m_roundTrip)
+			l_best = &m_samples[i];
+	}
+
+	if (l_best->m_time == m_lastUsedSample)
+		return; // nothing new, the previous best sample is still the best
+
+	m_lastUsedSample = l_best->m_time;
+
+	if (!m_isSyncronized)
+	{
+		m_offset = (double)l_best->m_offset;
+		m_referenceTime = l_best->m_time;
+		m_isSyncronized = true;
+
+		return;
+	}
+
+	double l_elapsed = (double)(l_best->m_time - m_referenceTime);
+
+	double l_predicted = m_offset + m_drift * l_elapsed;
+
+	double l_error = l_best->m_offset - l_predicted;
+
+	if (l_error > CLOCK_SYNCRO_MAX_ERROR || l_error < -CLOCK_SYNCRO_MAX_ERROR) // one of the clocks has jumped
+	{
+		m_offset = (double)l_best->m_offset;
+		m_drift = 0.0;
+		m_referenceTime = l_best->m_time;
+
+		return;
+	}
+
+	if (l_elapsed > 1000000.0) // the drift is only measurable over a long enough time
+	{
+		m_drift += CLOCK_SYNCRO_DRIFT_GAIN * l_error / l_elapsed;
+
+		if (m_drift > CLOCK_SYNCRO_MAX_DRIFT)
+			m_drift = CLOCK_SYNCRO_MAX_DRIFT;
+		else if (m_drift < -CLOCK_SYNCRO_MAX_DRIFT)
+			m_drift = -CLOCK_SYNCRO_MAX_DRIFT;
+	}
+
+	m_offset = l_predicted + CLOCK_SYNCRO_GAIN * l_error;
+	m_referenceTime = l_best->m_time;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Convert a client time into a server time
+///
+/// \param a_clientTime the time of the client clock
+///
+/// \return the estimated time of the server clock
+///
+////////////////////////////////////////////////////////////
+sf::Int64 ClockSyncro::GetServerTime(sf::Int64 a_clientTime) const
+{
+	return a_clientTime + GetOffset(a_clientTime);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the current offset between the clocks
+///
+/// \param a_clientTime the time of the client clock
+///
+/// \return the server time minus the client time
+///
+////////////////////////////////////////////////////////////
+sf::Int64 ClockSyncro::GetOffset(sf::Int64 a_clientTime) const
+{
+	return (sf::Int64)(m_offset + m_drift * (double)(a_clientTime - m_referenceTime));
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the round trip time of the last sample
+///
+/// \return the last round trip time
+///
+////////////////////////////////////////////////////////////
+sf::Int64 ClockSyncro::GetLastRoundTrip() const
+{
+	return m_lastRoundTrip;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the smoothed round trip time
+///
+/// \return the average round trip time
+///
+////////////////////////////////////////////////////////////
+sf::Int64 ClockSyncro::GetAverageRoundTrip() const
+{
+	return (sf::Int64)m_averageRoundTrip;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the estimated drift between the clocks
+///
+/// \return the drift (server microseconds gained per client microsecond)
+///
+////////////////////////////////////////////////////////////
+double ClockSyncro::GetDrift() const
+{
+	return m_drift;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if at least one sample was received
+///
+/// \return true if the estimates can be used
+///
+////////////////////////////////////////////////////////////
+bool ClockSyncro::IsSyncronized() const
+{
+	return m_isSyncronized;
+}
+
+}
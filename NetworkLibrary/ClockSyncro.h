@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define CLOCK_SYNCRO_WINDOW 8 // number of recent samples where we search the one with the minimum round trip
+
+#define CLOCK_SYNCRO_GAIN 0.25 // how fast the offset estimate follows the measurements (EWMA factor)
+
+#define CLOCK_SYNCRO_LATENCY_GAIN 0.125 // EWMA factor of the average round trip
+
+#define CLOCK_SYNCRO_DRIFT_GAIN 0.1 // how fast the drift estimate follows the measurements
+
+#define CLOCK_SYNCRO_MAX_DRIFT 0.0005 // 500 ppm, more than that is not a drift but an error
+
+#define CLOCK_SYNCRO_MAX_ERROR 100000 // us, if the estimate is so wrong the clock has jumped, so we restart from the measurement
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Estimate the clock of the server from
+/// NTP like samples
+///
+/// Each sample is made of four timestamps : the client send
+/// time, the server receive and send times, and the client
+/// receive time. Only the sample with the smallest round trip
+/// of the recent window is used (it is the less delayed by
+/// queues), then the offset is smoothed and the drift between
+/// both clocks is estimated
+///
+/// All times are in microseconds
+///
+////////////////////////////////////////////////////////////
+class NET ClockSyncro
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	ClockSyncro();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Forget all the samples and the estimates
+	///
+	////////////////////////////////////////////////////////////
+	void Reset();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add a new sample and update the estimates
+	///
+	/// \param a_clientSend the client time when the request was sent
+	///
+	/// \param a_serverReceive the server time when the request was received
+	///
+	/// \param a_serverSend the server time when the answer was sent
+	///
+	/// \param a_clientReceive the client time when the answer was received
+	///
+	////////////////////////////////////////////////////////////
+	void AddSample(sf::Int64 a_clientSend, sf::Int64 a_serverReceive, sf::Int64 a_serverSend, sf::Int64 a_clientReceive);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Convert a client time into a server time
+	///
+	/// \param a_clientTime the time of the client clock
+	///
+	/// \return the estimated time of the server clock
+	///
+	////////////////////////////////////////////////////////////
+	sf::Int64 GetServerTime(sf::Int64 a_clientTime) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the current offset between the clocks
+	///
+	/// \param a_clientTime the time of the client clock
+	///
+	/// \return the server time minus the client time
+	///
+	////////////////////////////////////////////////////////////
+	sf::Int64 GetOffset(sf::Int64 a_clientTime) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the round trip time of the last sample
+	///
+	/// \return the last round trip time
+	///
+	////////////////////////////////////////////////////////////
+	sf::Int64 GetLastRoundTrip() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the smoothed round trip time
+	///
+	/// \return the average round trip time
+	///
+	////////////////////////////////////////////////////////////
+	sf::Int64 GetAverageRoundTrip() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the estimated drift between the clocks
+	///
+	/// \return the drift (server microseconds gained per client microsecond)
+	///
+	////////////////////////////////////////////////////////////
+	double GetDrift() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if at least one sample was received
+	///
+	/// \return true if the estimates can be used
+	///
+	////////////////////////////////////////////////////////////
+	bool IsSyncronized() const;
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief One measurement of the offset
+	///
+	////////////////////////////////////////////////////////////
+	struct Sample
+	{
+		sf::Int64 m_offset;    ///< The measured offset
+		sf::Int64 m_roundTrip; ///< The round trip time of the measurement, the error of the offset is at most the half
+		sf::Int64 m_time;      ///< The client time of the measurement
+	};
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::array<Sample, CLOCK_SYNCRO_WINDOW> m_samples; ///< The recent samples (circular buffer)
+
+	int m_numberOfSamples; ///< The number of valid samples in the buffer
+
+	int m_nextSample; ///< The position of the next sample in the buffer
+
+	sf::Int64 m_lastUsedSample; ///< The time of the last sample used for the estimate (a sample is used only once)
+
+	double m_offset; ///< The estimated offset at the reference time
+
+	double m_drift; ///< The estimated drift of the server clock relative to the client clock
+
+	sf::Int64 m_referenceTime; ///< The client time of the last estimate
+
+	double m_averageRoundTrip; ///< The smoothed round trip time
+
+	sf::Int64 m_lastRoundTrip; ///< The round trip time of the last sample
+
+	bool m_isSyncronized; ///< Flag to know if at least one sample was used
+};
+
+}
@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "CommandQueue.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+CommandQueue::CommandQueue()
+{
+	for (size_t i = 0; i < COMMAND_QUEUE_SIZE; i++)
+		m_nodes[i].m_sequence = i; // all the nodes are free for their first position
+
+	m_head = 0;
+	m_tail = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Producers] Add a command at the end of the queue
+///
+/// \param a_commandCode the custom command code
+///
+/// \param a_data the data of the command, it is moved in the
+/// queue only if the command is added
+///
+/// \return false if the queue is full
+///
+////////////////////////////////////////////////////////////
+bool CommandQueue::Push(sf::Uint16 a_commandCode, NetworkData& a_data)
+{
+	size_t l_position = m_tail.load(std::memory_order_relaxed);
+
+	Node* l_node;
+
+	while (true)
+	{
+		l_node = &m_nodes[l_position & (COMMAND_QUEUE_SIZE - 1)];
+
+		size_t l_sequence = l_node->m_sequence.load(std::memory_order_acquire);
+
+		if (l_sequence == l_position) // the node is free, we try to take this position
+		{
+			if (m_tail.compare_exchange_weak(l_position, l_position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (l_sequence < l_position) // the node still contains the command of the previous turn
+		{
+			return false;
+		}
+		else // another producer took this position
+		{
+			l_position = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	l_node->m_command.m_commandCode = a_commandCode;
+	l_node->m_command.m_data = std::move(a_data);
+	l_node->m_command.m_isAccepted = false;
+
+	l_node->m_sequence.store(l_position + 1, std::memory_order_release); // the command is written before it becomes visible
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Consumer] Take the oldest command of the queue
+///
+/// \param a_command the command that receives the oldest one
+///
+/// \return false if the queue is empty
+///
+////////////////////////////////////////////////////////////
+bool CommandQueue::Pop(PendingCommand& a_command)
+{
+	size_t l_position = m_head.load(std::memory_order_relaxed);
+
+	Node& l_node = m_nodes[l_position & (COMMAND_QUEUE_SIZE - 1)];
+
+	if (l_node.m_sequence.load(std::memory_order_acquire) != l_position + 1) // not filled yet
+		return false;
+
+	a_command.m_commandCode = l_node.m_command.m_commandCode;
+	a_command.m_data = std::move(l_node.m_command.m_data);
+	a_command.m_isAccepted = l_node.m_command.m_isAccepted;
+
+	l_node.m_sequence.store(l_position + COMMAND_QUEUE_SIZE, std::memory_order_release); // free for the next turn
+
+	m_head.store(l_position + 1, std::memory_order_relaxed);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Measure the throughput of a queue : the producers
+/// push empty commands from their own threads while the
+/// calling thread pops them, as the network threads and the
+/// game thread do
+///
+/// \param a_numberOfCommands the number of commands to send
+/// through the queue
+///
+/// \param a_numberOfProducers the number of producer threads
+///
+/// \return the number of commands handled per second
+///
+////////////////////////////////////////////////////////////
+double CommandQueue::Measure(size_t a_numberOfCommands, int a_numberOfProducers)
+{
+	if (a_numberOfProducers <= 0)
+		return 0;
+
+	std::unique_ptr<CommandQueue> l_queue(new CommandQueue()); // the nodes are too large for the stack
+
+	size_t l_commandsPerProducer = a_numberOfCommands / a_numberOfProducers;
+	size_t l_total = l_commandsPerProducer * a_numberOfProducers;
+
+	std::vector<std::thread> l_producers;
+
+	sf::Clock l_clock;
+
+	for (int i = 0; i < a_numberOfProducers; i++)
+		l_producers.push_back(std::thread(&CommandQueue::Produce, l_queue.get(), l_commandsPerProducer));
+
+	PendingCommand l_command;
+	size_t l_received = 0;
+
+	while (l_received < l_total)
+	{
+		if (l_queue->Pop(l_command))
+			l_received++;
+		else
+			std::this_thread::yield();
+	}
+
+	float l_seconds = l_clock.getElapsedTime().asSeconds();
+
+	for (size_t i = 0; i < l_producers.size(); i++)
+		l_producers[i].join();
+
+	if (l_seconds <= 0)
+		return 0;
+
+	return l_received / l_seconds;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Body of a producer thread of Measure
+///
+/// \param a_queue the measured queue
+///
+/// \param a_numberOfCommands the number of commands to push
+///
+////////////////////////////////////////////////////////////
+void CommandQueue::Produce(CommandQueue* a_queue, size_t a_numberOfCommands)
+{
+	for (size_t i = 0; i < a_numberOfCommands; i++)
+	{
+		NetworkData l_data;
+
+		while (!a_queue->Push((sf::Uint16)i, l_data)) // full, wait for the consumer
+			std::this_thread::yield();
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+CommandResultRing::CommandResultRing()
+{
+	m_head = 0;
+	m_tail = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Producer] Add a result at the end of the ring,
+/// the data of the command is moved in the ring
+///
+/// \param a_result the result to add
+///
+/// \return false if the ring is full
+///
+////////////////////////////////////////////////////////////
+bool CommandResultRing::Push(PendingCommand& a_result)
+{
+	size_t l_tail = m_tail.load(std::memory_order_relaxed);
+
+	if (l_tail - m_head.load(std::memory_order_acquire) == COMMAND_RESULT_RING_SIZE)
+		return false;
+
+	PendingCommand& l_slot = m_results[l_tail & (COMMAND_RESULT_RING_SIZE - 1)];
+
+	l_slot.m_commandCode = a_result.m_commandCode;
+	l_slot.m_data = std::move(a_result.m_data);
+	l_slot.m_isAccepted = a_result.m_isAccepted;
+
+	m_tail.store(l_tail + 1, std::memory_order_release); // the result is written before it becomes visible
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Producer] Know if the ring is full
+///
+/// \return true if the next push will fail
+///
+////////////////////////////////////////////////////////////
+bool CommandResultRing::IsFull() const
+{
+	return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire) == COMMAND_RESULT_RING_SIZE;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Consumer] Take the oldest result of the ring
+///
+/// \param a_result the result that receives the oldest one
+///
+/// \return false if the ring is empty
+///
+////////////////////////////////////////////////////////////
+bool CommandResultRing::Pop(PendingCommand& a_result)
+{
+	size_t l_head = m_head.load(std::memory_order_relaxed);
+
+	if (l_head == m_tail.load(std::memory_order_acquire))
+		return false;
+
+	PendingCommand& l_slot = m_results[l_head & (COMMAND_RESULT_RING_SIZE - 1)];
+
+	a_result.m_commandCode = l_slot.m_commandCode;
+	a_result.m_data = std::move(l_slot.m_data);
+	a_result.m_isAccepted = l_slot.m_isAccepted;
+
+	m_head.store(l_head + 1, std::memory_order_release);
+
+	return true;
+}
+
+}
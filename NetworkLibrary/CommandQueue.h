@@ -0,0 +1,209 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkData.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define COMMAND_QUEUE_SIZE 1024 // commands waiting for the game, must be a power of two
+
+#define COMMAND_RESULT_RING_SIZE 1024 // decisions of the game waiting for the server, must be a power of two
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief A received command waiting in a queue, then the
+/// decision of the game for this command
+///
+////////////////////////////////////////////////////////////
+struct PendingCommand
+{
+	sf::Uint16 m_commandCode; ///< The custom command code
+
+	NetworkData m_data; ///< The data of the command, moved between the nodes so its buffer is not copied
+
+	bool m_isAccepted; ///< [Result] Flag to know if the game has accepted the command
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Bounded lock free queue of received commands, with
+/// several producers (the network threads) and one consumer
+/// (the game thread)
+///
+/// The nodes are allocated once with the queue. Each node has
+/// a sequence number that tells if it is free for the producer
+/// of a position or filled for the consumer, so the producers
+/// only compete on the tail index
+///
+////////////////////////////////////////////////////////////
+class NET CommandQueue
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	CommandQueue();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Producers] Add a command at the end of the queue
+	///
+	/// \param a_commandCode the custom command code
+	///
+	/// \param a_data the data of the command, it is moved in the
+	/// queue only if the command is added
+	///
+	/// \return false if the queue is full
+	///
+	////////////////////////////////////////////////////////////
+	bool Push(sf::Uint16 a_commandCode, NetworkData& a_data);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Consumer] Take the oldest command of the queue
+	///
+	/// \param a_command the command that receives the oldest one
+	///
+	/// \return false if the queue is empty
+	///
+	////////////////////////////////////////////////////////////
+	bool Pop(PendingCommand& a_command);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Measure the throughput of a queue : the producers
+	/// push empty commands from their own threads while the
+	/// calling thread pops them, as the network threads and the
+	/// game thread do
+	///
+	/// \param a_numberOfCommands the number of commands to send
+	/// through the queue
+	///
+	/// \param a_numberOfProducers the number of producer threads
+	///
+	/// \return the number of commands handled per second
+	///
+	////////////////////////////////////////////////////////////
+	static double Measure(size_t a_numberOfCommands, int a_numberOfProducers);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Body of a producer thread of Measure
+	///
+	/// \param a_queue the measured queue
+	///
+	/// \param a_numberOfCommands the number of commands to push
+	///
+	////////////////////////////////////////////////////////////
+	static void Produce(CommandQueue* a_queue, size_t a_numberOfCommands);
+
+	////////////////////////////////////////////////////////////
+	/// \brief One preallocated position of the queue
+	///
+	////////////////////////////////////////////////////////////
+	struct Node
+	{
+		std::atomic<size_t> m_sequence; ///< Equal to the position when the node is free, position + 1 when it is filled
+
+		PendingCommand m_command; ///< The command stored in the node
+	};
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::array<Node, COMMAND_QUEUE_SIZE> m_nodes; ///< The nodes, indexed by position modulo the size
+
+	alignas(64) std::atomic<size_t> m_head; ///< The position of the next command to read, only written by the consumer
+
+	alignas(64) std::atomic<size_t> m_tail; ///< The position of the next command to write, shared by the producers
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Lock free ring of command results with one producer
+/// (the game thread) and one consumer (the server thread)
+///
+////////////////////////////////////////////////////////////
+class NET CommandResultRing
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	CommandResultRing();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Producer] Add a result at the end of the ring,
+	/// the data of the command is moved in the ring
+	///
+	/// \param a_result the result to add
+	///
+	/// \return false if the ring is full
+	///
+	////////////////////////////////////////////////////////////
+	bool Push(PendingCommand& a_result);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Producer] Know if the ring is full
+	///
+	/// \return true if the next push will fail
+	///
+	////////////////////////////////////////////////////////////
+	bool IsFull() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Consumer] Take the oldest result of the ring
+	///
+	/// \param a_result the result that receives the oldest one
+	///
+	/// \return false if the ring is empty
+	///
+	////////////////////////////////////////////////////////////
+	bool Pop(PendingCommand& a_result);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::array<PendingCommand, COMMAND_RESULT_RING_SIZE> m_results; ///< The results, indexed by position modulo the size
+
+	alignas(64) std::atomic<size_t> m_head; ///< The position of the next result to read, only written by the consumer
+
+	alignas(64) std::atomic<size_t> m_tail; ///< The position of the next result to write, only written by the producer
+};
+
+}
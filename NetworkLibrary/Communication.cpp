@@ -163,4 +163,202 @@ std::vector<const Connection*> Communication::GetNotRespondingConnections()
 	return InternalComm::GetNotRespondingConnections();
 }
 
+
+////////////////////////////////////////////////////////////
+/// \brief get the time of the server clock, on the client
+/// side it is estimated with the clock syncronization
+///
+/// \return the server time, zero if there is no connection
+///
+////////////////////////////////////////////////////////////
+sf::Time Communication::GetServerTime()
+{
+	return InternalComm::GetServerTime();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Choose if the library runs its own threads or if
+/// everything is done by Poll, from the game loop thread.
+/// Must be called before starting a server or a client
+///
+/// \param a_isPollMode true to run the library with Poll
+///
+////////////////////////////////////////////////////////////
+void Communication::SetPollMode(bool a_isPollMode)
+{
+	InternalComm::SetPollMode(a_isPollMode);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Choose who gives the received commands
+/// to the objects. By default the game must call
+/// HandleReceivedCommands once per frame, without it the
+/// commands wait until the queue is full then are refused.
+/// With false the server thread handles them itself, as in
+/// the previous versions (the game code then runs on the server
+/// thread)
+///
+/// \param a_isDeferred true if the game calls HandleReceivedCommands
+///
+////////////////////////////////////////////////////////////
+void Communication::SetDeferredCommands(bool a_isDeferred)
+{
+	InternalComm::SetDeferredCommands(a_isDeferred);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Limit the bandwidth used by the file transferts,
+/// so they do not delay the updates and the pings. Each
+/// client receives file parts with at most a_share of the
+/// bandwidth that the other frames left unused
+///
+/// \param a_bandwidth the bandwidth of a client in bytes per
+/// second, 0 for no limit (a part is then only sent when the
+/// send queue of the client is empty)
+///
+/// \param a_share the part of the unused bandwidth given to
+/// the files, between 0 and 1
+///
+////////////////////////////////////////////////////////////
+void Communication::SetFileBandwidth(sf::Uint32 a_bandwidth, float a_share)
+{
+	InternalComm::SetFileBandwidth(a_bandwidth, a_share);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Enable the compression of the file parts and of
+/// the frames that stream the world to a new client. It is
+/// used with a server only if both sides enable it, and a
+/// part or a frame is only compressed if it shrinks
+///
+/// \param a_isEnabled true to compress (the default)
+///
+////////////////////////////////////////////////////////////
+void Communication::SetCompression(bool a_isEnabled)
+{
+	InternalComm::SetCompression(a_isEnabled);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Choose the directory where the
+/// received files are cached by content, so a version of a
+/// file is never downloaded twice, even from another server.
+/// Must be called before starting a client
+///
+/// \param a_directory the directory, empty to disable the
+/// cache (FILE_CACHE_DIRECTORY by default)
+///
+////////////////////////////////////////////////////////////
+void Communication::SetFileCache(const std::string& a_directory)
+{
+	InternalComm::SetFileCache(a_directory);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Limit the size of the cache of the
+/// received files : when a new entry makes it larger, the
+/// entries used least recently are removed
+///
+/// \param a_bytes the size of the cache in bytes, 0 for no
+/// limit (FILE_CACHE_BUDGET by default)
+///
+////////////////////////////////////////////////////////////
+void Communication::SetFileCacheBudget(sf::Uint64 a_bytes)
+{
+	InternalComm::SetFileCacheBudget(a_bytes);
+}
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Set the dictionary of the realtime
+/// packets (updates and commands). It is sent to each client
+/// that accepts the compression when it connects, then the
+/// packets refer to it. Must be called before starting a
+/// server
+///
+/// \param a_content the dictionary, made by
+/// CompressionDictionary::Train, empty to remove it
+///
+////////////////////////////////////////////////////////////
+void Communication::SetCompressionDictionary(const std::vector<char>& a_content)
+{
+	InternalComm::SetCompressionDictionary(a_content);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Record the realtime packets that are sent, to train
+/// a dictionary from a real game
+///
+/// \param a_maxPackets the number of packets to keep, 0 to
+/// stop the capture and forget the packets
+///
+////////////////////////////////////////////////////////////
+void Communication::SetTrafficCapture(size_t a_maxPackets)
+{
+	InternalComm::SetTrafficCapture(a_maxPackets);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the packets recorded by the capture
+///
+/// \return a copy of the packets
+///
+////////////////////////////////////////////////////////////
+std::vector<std::vector<char>> Communication::GetCapturedTraffic()
+{
+	return InternalComm::GetCapturedTraffic();
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Poll mode] Do all the pending network work : read
+/// the sockets, handle the messages, send the file parts and
+/// run the timers. Never waits on a socket
+///
+/// \param a_budget the maximum time spent, the work continues
+/// while there is something to do and some budget left
+///
+////////////////////////////////////////////////////////////
+void Communication::Poll(sf::Time a_budget)
+{
+	InternalComm::Poll(a_budget);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Let the network objects accept or
+/// reject the commands received from the clients. Must be
+/// called regularly by the game thread (once per frame), unless
+/// SetDeferredCommands(false) was called
+///
+/// \return the number of commands handled
+///
+////////////////////////////////////////////////////////////
+int Communication::HandleReceivedCommands()
+{
+	return InternalComm::HandleReceivedCommands();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destroy a network object that was spawned, its
+/// memory and its id are reused by the next objects. From
+/// server side, the deletion is sent to all clients
+///
+/// \param a_object the object to destroy
+///
+////////////////////////////////////////////////////////////
+void Communication::DestroyObject(NetworkObject* a_object)
+{
+	InternalComm::DestroyObject(a_object);
+}
+
 }
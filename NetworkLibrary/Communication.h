@@ -134,6 +134,152 @@ public:
 	////////////////////////////////////////////////////////////
 	static std::vector<const Connection*> GetNotRespondingConnections();
 
+	////////////////////////////////////////////////////////////
+	/// \brief get the time of the server clock, on the client
+	/// side it is estimated with the clock syncronization
+	///
+	/// \return the server time, zero if there is no connection
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Time GetServerTime();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Choose if the library runs its own threads or if
+	/// everything is done by Poll, from the game loop thread.
+	/// Must be called before starting a server or a client
+	///
+	/// \param a_isPollMode true to run the library with Poll
+	///
+	////////////////////////////////////////////////////////////
+	static void SetPollMode(bool a_isPollMode);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Choose who gives the received commands
+	/// to the objects. By default the game must call
+	/// HandleReceivedCommands once per frame, without it the
+	/// commands wait until the queue is full then are refused.
+	/// With false the server thread handles them itself, as in
+	/// the previous versions (the game code then runs on the server
+	/// thread)
+	///
+	/// \param a_isDeferred true if the game calls HandleReceivedCommands
+	///
+	////////////////////////////////////////////////////////////
+	static void SetDeferredCommands(bool a_isDeferred);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Limit the bandwidth used by the file transferts,
+	/// so they do not delay the updates and the pings. Each
+	/// client receives file parts with at most a_share of the
+	/// bandwidth that the other frames left unused
+	///
+	/// \param a_bandwidth the bandwidth of a client in bytes per
+	/// second, 0 for no limit (a part is then only sent when the
+	/// send queue of the client is empty)
+	///
+	/// \param a_share the part of the unused bandwidth given to
+	/// the files, between 0 and 1
+	///
+	////////////////////////////////////////////////////////////
+	static void SetFileBandwidth(sf::Uint32 a_bandwidth, float a_share);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Enable the compression of the file parts and of
+	/// the frames that stream the world to a new client. It is
+	/// used with a server only if both sides enable it, and a
+	/// part or a frame is only compressed if it shrinks
+	///
+	/// \param a_isEnabled true to compress (the default)
+	///
+	////////////////////////////////////////////////////////////
+	static void SetCompression(bool a_isEnabled);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Choose the directory where the
+	/// received files are cached by content, so a version of a
+	/// file is never downloaded twice, even from another server.
+	/// Must be called before starting a client
+	///
+	/// \param a_directory the directory, empty to disable the
+	/// cache (FILE_CACHE_DIRECTORY by default)
+	///
+	////////////////////////////////////////////////////////////
+	static void SetFileCache(const std::string& a_directory);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Limit the size of the cache of the
+	/// received files : when a new entry makes it larger, the
+	/// entries used least recently are removed
+	///
+	/// \param a_bytes the size of the cache in bytes, 0 for no
+	/// limit (FILE_CACHE_BUDGET by default)
+	///
+	////////////////////////////////////////////////////////////
+	static void SetFileCacheBudget(sf::Uint64 a_bytes);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Set the dictionary of the realtime
+	/// packets (updates and commands). It is sent to each client
+	/// that accepts the compression when it connects, then the
+	/// packets refer to it. Must be called before starting a
+	/// server
+	///
+	/// \param a_content the dictionary, made by
+	/// CompressionDictionary::Train, empty to remove it
+	///
+	////////////////////////////////////////////////////////////
+	static void SetCompressionDictionary(const std::vector<char>& a_content);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Record the realtime packets that are sent, to train
+	/// a dictionary from a real game
+	///
+	/// \param a_maxPackets the number of packets to keep, 0 to
+	/// stop the capture and forget the packets
+	///
+	////////////////////////////////////////////////////////////
+	static void SetTrafficCapture(size_t a_maxPackets);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the packets recorded by the capture
+	///
+	/// \return a copy of the packets
+	///
+	////////////////////////////////////////////////////////////
+	static std::vector<std::vector<char>> GetCapturedTraffic();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Poll mode] Do all the pending network work : read
+	/// the sockets, handle the messages, send the file parts and
+	/// run the timers. Never waits on a socket
+	///
+	/// \param a_budget the maximum time spent, the work continues
+	/// while there is something to do and some budget left
+	///
+	////////////////////////////////////////////////////////////
+	static void Poll(sf::Time a_budget);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Let the network objects accept or
+	/// reject the commands received from the clients. Must be
+	/// called regularly by the game thread (once per frame), unless
+	/// SetDeferredCommands(false) was called
+	///
+	/// \return the number of commands handled
+	///
+	////////////////////////////////////////////////////////////
+	static int HandleReceivedCommands();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destroy a network object that was spawned, its
+	/// memory and its id are reused by the next objects. From
+	/// server side, the deletion is sent to all clients
+	///
+	/// \param a_object the object to destroy
+	///
+	////////////////////////////////////////////////////////////
+	static void DestroyObject(NetworkObject* a_object);
+
 	////////////////////////////////////////////////////////////
 	/// \brief Add a file taht will be syncronized on each client 
 	/// that will connect
@@ -176,6 +322,32 @@ public:
 		return InternalComm::SpawnObjectFromServer<T>(std::forward<Args>(args)...);
 	}
 
+	////////////////////////////////////////////////////////////
+	/// \brief spawn several objects of the same type if we are
+	/// from server side, else this will not do anything
+	///
+	/// The objects are built with their default constructor in
+	/// contiguous memory, then initialized by the given function.
+	/// The clients receive them together, in the same spawn frame
+	///
+	/// \param a_count the number of objects to spawn
+	///
+	/// \param a_init the function called on each object, as
+	/// a_init(T& object, size_t index)
+	///
+	/// \tparam T the class of the objects to instanciate
+	///
+	/// \tparam Init the type of the initialization function
+	///
+	/// \return the new spawned objects
+	///
+	////////////////////////////////////////////////////////////
+	template<class T, class Init>
+	static std::vector<T*> SpawnObjectsFromServer(size_t a_count, Init a_init)
+	{
+		return InternalComm::SpawnObjectsFromServer<T>(a_count, a_init);
+	}
+
 
 
 	////////////////////////////////////////////////////////////
@@ -0,0 +1,779 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "Compression.h"
+#include "InternalComm.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Compress a block of data
+///
+/// \param a_source the data to compress
+///
+/// \param a_size the size of the data
+///
+/// \param a_destination receives the compressed data
+///
+/// \param a_capacity the size of the destination, give less
+/// than a_size to only accept a compression that shrinks
+///
+/// \param a_dictionary the dictionary, NULL if there is none
+///
+/// \return the size of the compressed data, 0 if it does not
+/// fit in the destination or if the data is too small
+///
+////////////////////////////////////////////////////////////
+size_t Compression::Compress(const char* a_source, size_t a_size, char* a_destination, size_t a_capacity, const CompressionDictionary* a_dictionary)
+{
+	if (a_dictionary != NULL && a_dictionary->IsEmpty())
+		a_dictionary = NULL;
+
+	if (a_size <= COMPRESSION_MATCH_LIMIT || (a_dictionary == NULL && a_size < COMPRESSION_MIN_SIZE) || a_size > COMPRESSION_MAX_SIZE)
+		return 0; // with a dictionary, even the small packets have something to refer to
+
+	const sf::Uint8* l_source = reinterpret_cast<const sf::Uint8*>(a_source);
+
+	sf::Uint8* l_output = reinterpret_cast<sf::Uint8*>(a_destination);
+
+	const sf::Uint8* l_outputEnd = l_output + a_capacity;
+
+	const int l_hashBits = a_size <= COMPRESSION_SMALL_SIZE ? COMPRESSION_SMALL_HASH_BITS : COMPRESSION_HASH_BITS;
+
+	sf::Uint32 l_table[1 << COMPRESSION_HASH_BITS]; // the last position of each hashed sequence
+
+	std::memset(l_table, 0, sizeof(sf::Uint32) << l_hashBits); // only the part that is used
+
+	const sf::Uint8* l_dictionary = a_dictionary != NULL ? reinterpret_cast<const sf::Uint8*>(a_dictionary->m_content.data()) : NULL;
+
+	const size_t l_dictionarySize = a_dictionary != NULL ? a_dictionary->m_content.size() : 0;
+
+	const size_t l_matchLimit = a_size - COMPRESSION_MATCH_LIMIT;
+
+	const size_t l_matchEnd = a_size - COMPRESSION_LAST_LITERALS;
+
+	size_t l_anchor = 0; // the first literal of the current sequence
+
+	size_t l_position = l_dictionary != NULL ? 0 : 1; // without a dictionary, the first byte can only be a literal
+
+	while (l_position < l_matchLimit)
+	{
+		sf::Uint32 l_sequence = Read32(l_source + l_position);
+
+		sf::Uint32 l_hash = HashSequence(l_source + l_position, l_hashBits);
+
+		size_t l_candidate = l_table[l_hash];
+
+		l_table[l_hash] = (sf::Uint32)l_position;
+
+		size_t l_offset = 0;
+
+		size_t l_matchSize = 0;
+
+		if (l_candidate < l_position && l_position - l_candidate <= COMPRESSION_MAX_OFFSET && Read32(l_source + l_candidate) == l_sequence)
+		{
+			while (l_position > l_anchor && l_candidate > 0 && l_source[l_position - 1] == l_source[l_candidate - 1]) // the repetition may start before
+			{
+				l_position--;
+				l_candidate--;
+			}
+
+			l_matchSize = COMPRESSION_MIN_MATCH;
+
+			while (l_position + l_matchSize < l_matchEnd && l_source[l_position + l_matchSize] == l_source[l_candidate + l_matchSize])
+			{
+				l_matchSize++;
+			}
+
+			l_offset = l_position - l_candidate;
+		}
+		else if (l_dictionary != NULL) // the data placed before the packet
+		{
+			size_t l_entry = a_dictionary->m_table[HashSequence(l_source + l_position, COMPRESSION_HASH_BITS)];
+
+			if (l_entry != 0 && l_dictionarySize - (l_entry - 1) + l_position <= COMPRESSION_MAX_OFFSET && Read32(l_dictionary + l_entry - 1) == l_sequence)
+			{
+				size_t l_start = l_entry - 1;
+
+				l_matchSize = COMPRESSION_MIN_MATCH;
+
+				while (l_start + l_matchSize < l_dictionarySize && l_position + l_matchSize < l_matchEnd && l_dictionary[l_start + l_matchSize] == l_source[l_position + l_matchSize])
+				{
+					l_matchSize++;
+				}
+
+				l_offset = l_dictionarySize - l_start + l_position;
+			}
+		}
+
+		if (l_matchSize == 0)
+		{
+			l_position += 1 + ((l_position - l_anchor) >> 6); // the search speeds up in the data that does not repeat
+			continue;
+		}
+
+		if (!WriteSequence(l_output, l_outputEnd, l_source + l_anchor, l_position - l_anchor, l_offset, l_matchSize))
+			return 0;
+
+		l_position += l_matchSize;
+
+		l_anchor = l_position;
+
+		if (l_position < l_matchLimit) // the end of the repetition is a good candidate for the next ones
+			l_table[HashSequence(l_source + l_position - 2, l_hashBits)] = (sf::Uint32)(l_position - 2);
+	}
+
+	if (!WriteSequence(l_output, l_outputEnd, l_source + l_anchor, a_size - l_anchor, 0, 0))
+		return 0;
+
+	return l_output - reinterpret_cast<sf::Uint8*>(a_destination);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Decompress a block of data, every reference is
+/// checked so a corrupted block can not write outside of
+/// the destination
+///
+/// \param a_source the compressed data
+///
+/// \param a_size the size of the compressed data
+///
+/// \param a_destination receives the data
+///
+/// \param a_originalSize the size of the data before the
+/// compression
+///
+/// \param a_dictionary the dictionary used by the
+/// compression, NULL if there was none
+///
+/// \return false if the block is corrupted or does not give
+/// exactly a_originalSize bytes
+///
+////////////////////////////////////////////////////////////
+bool Compression::Decompress(const char* a_source, size_t a_size, char* a_destination, size_t a_originalSize, const CompressionDictionary* a_dictionary)
+{
+	const sf::Uint8* l_dictionary = a_dictionary != NULL ? reinterpret_cast<const sf::Uint8*>(a_dictionary->m_content.data()) : NULL;
+
+	const size_t l_dictionarySize = a_dictionary != NULL ? a_dictionary->m_content.size() : 0;
+
+	const sf::Uint8* l_input = reinterpret_cast<const sf::Uint8*>(a_source);
+
+	const sf::Uint8* l_inputEnd = l_input + a_size;
+
+	sf::Uint8* l_output = reinterpret_cast<sf::Uint8*>(a_destination);
+
+	sf::Uint8* l_outputEnd = l_output + a_originalSize;
+
+	while (l_input < l_inputEnd)
+	{
+		sf::Uint8 l_token = *l_input++;
+
+		size_t l_literalSize = l_token >> 4;
+
+		if (l_literalSize == 15 && !ReadLength(l_input, l_inputEnd, l_literalSize))
+			return false;
+
+		if (l_literalSize > (size_t)(l_inputEnd - l_input) || l_literalSize > (size_t)(l_outputEnd - l_output))
+			return false;
+
+		std::memcpy(l_output, l_input, l_literalSize);
+
+		l_input += l_literalSize;
+		l_output += l_literalSize;
+
+		if (l_input == l_inputEnd) // the last sequence has no repetition
+			break;
+
+		if (l_inputEnd - l_input < 2)
+			return false;
+
+		size_t l_offset = l_input[0] | (l_input[1] << 8);
+
+		l_input += 2;
+
+		size_t l_matchSize = l_token & 0x0F;
+
+		if (l_matchSize == 15 && !ReadLength(l_input, l_inputEnd, l_matchSize))
+			return false;
+
+		l_matchSize += COMPRESSION_MIN_MATCH;
+
+		size_t l_produced = l_output - reinterpret_cast<sf::Uint8*>(a_destination);
+
+		if (l_offset == 0 || l_offset > l_produced + l_dictionarySize || l_matchSize > (size_t)(l_outputEnd - l_output))
+			return false;
+
+		if (l_offset > l_produced) // the repetition starts in the dictionary, and may continue in the data
+		{
+			size_t l_fromDictionary = std::min(l_offset - l_produced, l_matchSize);
+
+			std::memcpy(l_output, l_dictionary + l_dictionarySize - (l_offset - l_produced), l_fromDictionary);
+
+			l_output += l_fromDictionary;
+			l_matchSize -= l_fromDictionary;
+		}
+
+		const sf::Uint8* l_match = l_output - l_offset;
+
+		if (l_offset >= l_matchSize)
+		{
+			std::memcpy(l_output, l_match, l_matchSize);
+		}
+		else // the repetition overlaps the bytes it writes (a run), so it is copied byte by byte
+		{
+			for (size_t i = 0; i < l_matchSize; i++)
+			{
+				l_output[i] = l_match[i];
+			}
+		}
+
+		l_output += l_matchSize;
+	}
+
+	return l_output == l_outputEnd;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write a packet in a CT_Compressed frame
+///
+/// \param a_data the packet, with its command
+///
+/// \param a_size the size of the packet
+///
+/// \param a_frame receives the frame
+///
+/// \param a_dictionary the dictionary, NULL if there is none
+///
+/// \return false if the frame would not be smaller than the
+/// packet, the packet must be sent as it is
+///
+////////////////////////////////////////////////////////////
+bool Compression::CompressFrame(const char* a_data, size_t a_size, PacketBuffer& a_frame, const CompressionDictionary* a_dictionary)
+{
+	if (a_dictionary != NULL && a_dictionary->IsEmpty())
+		a_dictionary = NULL;
+
+	a_frame.Clear();
+
+	a_frame << (sf::Uint16)CT_Compressed << (a_dictionary != NULL);
+
+	InternalComm::WriteVarint(a_frame, (sf::Uint32)a_size);
+
+	const size_t l_headerSize = a_frame.GetDataSize();
+
+	if (a_size <= l_headerSize + 1)
+		return false;
+
+	const size_t l_capacity = a_size - l_headerSize - 1; // the compressed frame must be smaller than the packet
+
+	size_t l_size = Compress(a_data, a_size, a_frame.Expand(l_capacity), l_capacity, a_dictionary);
+
+	if (l_size == 0)
+		return false;
+
+	a_frame.Truncate(l_headerSize + l_size);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read a CT_Compressed frame, a compressed frame
+/// can not contain another one
+///
+/// \param a_packet the frame, after its command
+///
+/// \param a_data receives the packet, with its command
+///
+/// \param a_dictionary the dictionary given by the other
+/// side, NULL if there is none
+///
+/// \return false if the frame is corrupted or needs a
+/// dictionary that we do not have
+///
+////////////////////////////////////////////////////////////
+bool Compression::DecompressFrame(sf::Packet& a_packet, std::vector<char>& a_data, const CompressionDictionary* a_dictionary)
+{
+	bool l_hasDictionary;
+
+	sf::Uint32 l_size;
+
+	size_t l_sizeLength;
+
+	if (!(a_packet >> l_hasDictionary) || !InternalComm::ReadVarint(a_packet, l_size, l_sizeLength) || l_size > COMPRESSION_MAX_SIZE)
+		return false;
+
+	if (l_hasDictionary && (a_dictionary == NULL || a_dictionary->IsEmpty()))
+		return false;
+
+	size_t l_headerSize = sizeof(sf::Uint16) + 1 + l_sizeLength; // the command, the flag and the size as it was written, even if it is not minimal
+
+	if (l_headerSize > a_packet.getDataSize() || l_size < sizeof(sf::Uint16))
+		return false;
+
+	a_data.resize(l_size);
+
+	if (!Decompress(static_cast<const char*>(a_packet.getData()) + l_headerSize, a_packet.getDataSize() - l_headerSize, a_data.data(), l_size, l_hasDictionary ? a_dictionary : NULL))
+		return false;
+
+	sf::Uint16 l_command = (sf::Uint16)(((sf::Uint8)a_data[0] << 8) | (sf::Uint8)a_data[1]); // packets are big endian
+
+	return l_command != CT_Compressed; // a frame in a frame could be nested without end
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write a sequence : literals followed by a
+/// repetition of previous bytes
+///
+/// \param a_output the position in the destination, moved
+/// after the sequence
+///
+/// \param a_outputEnd the end of the destination
+///
+/// \param a_literals the bytes to copy as they are
+///
+/// \param a_literalSize the number of literals
+///
+/// \param a_offset the distance of the repetition
+///
+/// \param a_matchSize the size of the repetition, 0 for the
+/// last sequence that only has literals
+///
+/// \return false if the sequence does not fit
+///
+////////////////////////////////////////////////////////////
+bool Compression::WriteSequence(sf::Uint8*& a_output, const sf::Uint8* a_outputEnd, const sf::Uint8* a_literals, size_t a_literalSize, size_t a_offset, size_t a_matchSize)
+{
+	size_t l_matchLength = a_matchSize != 0 ? a_matchSize - COMPRESSION_MIN_MATCH : 0;
+
+	size_t l_needed = 1 + a_literalSize + (a_literalSize / 255 + 1) + (a_matchSize != 0 ? 2 + l_matchLength / 255 + 1 : 0); // the worst case
+
+	if (l_needed > (size_t)(a_outputEnd - a_output))
+		return false;
+
+	sf::Uint8* l_token = a_output++;
+
+	*l_token = (sf::Uint8)(std::min(a_literalSize, (size_t)15) << 4);
+
+	if (a_literalSize >= 15)
+		WriteLength(a_output, a_literalSize - 15);
+
+	std::memcpy(a_output, a_literals, a_literalSize);
+
+	a_output += a_literalSize;
+
+	if (a_matchSize == 0)
+		return true;
+
+	*a_output++ = (sf::Uint8)(a_offset & 0xFF); // little endian, as in the LZ4 format
+	*a_output++ = (sf::Uint8)(a_offset >> 8);
+
+	*l_token |= (sf::Uint8)std::min(l_matchLength, (size_t)15);
+
+	if (l_matchLength >= 15)
+		WriteLength(a_output, l_matchLength - 15);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write the rest of a length that does not fit in
+/// the 4 bits of the token (bytes of 255, then the remainder)
+///
+/// \param a_output the position in the destination, moved
+/// after the length
+///
+/// \param a_length the length minus 15
+///
+////////////////////////////////////////////////////////////
+void Compression::WriteLength(sf::Uint8*& a_output, size_t a_length)
+{
+	while (a_length >= 255)
+	{
+		*a_output++ = 255;
+		a_length -= 255;
+	}
+
+	*a_output++ = (sf::Uint8)a_length;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read the rest of a length written by WriteLength
+///
+/// \param a_input the position in the source, moved after
+/// the length
+///
+/// \param a_inputEnd the end of the source
+///
+/// \param a_length receives the length added to the 15 of
+/// the token
+///
+/// \return false if the source ends in the length
+///
+////////////////////////////////////////////////////////////
+bool Compression::ReadLength(const sf::Uint8*& a_input, const sf::Uint8* a_inputEnd, size_t& a_length)
+{
+	sf::Uint8 l_byte;
+
+	do
+	{
+		if (a_input >= a_inputEnd || a_length > COMPRESSION_MAX_SIZE)
+			return false;
+
+		l_byte = *a_input++;
+
+		a_length += l_byte;
+	}
+	while (l_byte == 255);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Hash a sequence of 4 bytes in a table of the last
+/// positions
+///
+/// \param a_data the first byte of the sequence
+///
+/// \param a_bits the size of the table (in bits)
+///
+/// \return the index in the table
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 Compression::HashSequence(const sf::Uint8* a_data, int a_bits)
+{
+	return (Read32(a_data) * 2654435761u) >> (32 - a_bits); // Knuth multiplicative hash, the high bits are the best mixed
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read 4 bytes without alignment
+///
+/// \param a_data the first byte
+///
+/// \return the 4 bytes
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 Compression::Read32(const sf::Uint8* a_data)
+{
+	sf::Uint32 l_value;
+
+	std::memcpy(&l_value, a_data, sizeof(l_value));
+
+	return l_value;
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor, the dictionary is empty
+///
+////////////////////////////////////////////////////////////
+CompressionDictionary::CompressionDictionary()
+{
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Set the content of the dictionary and index its
+/// sequences
+///
+/// \param a_content the content, empty to remove the
+/// dictionary (only the last COMPRESSION_MAX_OFFSET bytes
+/// can be used)
+///
+////////////////////////////////////////////////////////////
+void CompressionDictionary::Load(const std::vector<char>& a_content)
+{
+	const size_t l_usable = COMPRESSION_MAX_OFFSET - COMPRESSION_SMALL_SIZE; // a reference from the end of a small packet must still reach it
+
+	if (a_content.size() > l_usable)
+		m_content.assign(a_content.end() - l_usable, a_content.end());
+	else
+		m_content = a_content;
+
+	m_table.assign((size_t)1 << COMPRESSION_HASH_BITS, 0);
+
+	const sf::Uint8* l_content = reinterpret_cast<const sf::Uint8*>(m_content.data());
+
+	for (size_t i = 0; i + COMPRESSION_MIN_MATCH <= m_content.size(); i++)
+	{
+		m_table[Compression::HashSequence(l_content + i, COMPRESSION_HASH_BITS)] = (sf::Uint32)(i + 1); // the last one wins, it gives the smallest offsets
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the dictionary has a content
+///
+/// \return true if there is nothing to refer to
+///
+////////////////////////////////////////////////////////////
+bool CompressionDictionary::IsEmpty() const
+{
+	return m_content.size() < COMPRESSION_MIN_MATCH;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the content of the dictionary
+///
+/// \return the content
+///
+////////////////////////////////////////////////////////////
+const std::vector<char>& CompressionDictionary::GetContent() const
+{
+	return m_content;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Compress and decompress some recorded packets with
+/// this dictionary, to know what it saves and what it costs
+///
+/// \param a_samples the packets
+///
+/// \return the sizes and the average times
+///
+////////////////////////////////////////////////////////////
+CompressionStats CompressionDictionary::Measure(const std::vector<std::vector<char>>& a_samples) const
+{
+	CompressionStats l_stats;
+
+	l_stats.m_packets = 0;
+	l_stats.m_rawBytes = 0;
+	l_stats.m_compressedBytes = 0;
+	l_stats.m_compressNanoseconds = 0.0;
+	l_stats.m_decompressNanoseconds = 0.0;
+
+	// the frames are made and read as the server and the clients do, so the sizes include the header of the frames
+	std::vector<std::vector<char>> l_compressed(a_samples.size());
+
+	PacketBuffer l_frame;
+
+	std::vector<char> l_output;
+
+	sf::Clock l_clock;
+
+	for (int l_round = 0; l_round < COMPRESSION_MEASURE_ROUNDS; l_round++)
+	{
+		for (size_t i = 0; i < a_samples.size(); i++)
+		{
+			const std::vector<char>& l_sample = a_samples[i];
+
+			if (!l_sample.empty() && Compression::CompressFrame(l_sample.data(), l_sample.size(), l_frame, this))
+				l_compressed[i].assign(l_frame.GetData(), l_frame.GetData() + l_frame.GetDataSize());
+			else
+				l_compressed[i].clear(); // the packet is sent as it is
+		}
+	}
+
+	sf::Int64 l_compressTime = l_clock.restart().asMicroseconds();
+
+	for (int l_round = 0; l_round < COMPRESSION_MEASURE_ROUNDS; l_round++)
+	{
+		for (size_t i = 0; i < a_samples.size(); i++)
+		{
+			if (l_compressed[i].empty())
+				continue;
+
+			sf::Packet l_packet; // as received, the command is read before the frame
+
+			l_packet.append(l_compressed[i].data(), l_compressed[i].size());
+
+			sf::Uint16 l_command;
+
+			if (!(l_packet >> l_command) || !Compression::DecompressFrame(l_packet, l_output, this) || l_output != a_samples[i])
+				throw NetworkException("Error : a measured packet does not decompress");
+		}
+	}
+
+	sf::Int64 l_decompressTime = l_clock.getElapsedTime().asMicroseconds();
+
+	for (size_t i = 0; i < a_samples.size(); i++)
+	{
+		l_stats.m_packets++;
+		l_stats.m_rawBytes += a_samples[i].size();
+		l_stats.m_compressedBytes += l_compressed[i].empty() ? a_samples[i].size() : l_compressed[i].size();
+	}
+
+	if (l_stats.m_packets != 0)
+	{
+		double l_calls = (double)l_stats.m_packets * COMPRESSION_MEASURE_ROUNDS;
+
+		l_stats.m_compressNanoseconds = l_compressTime * 1000.0 / l_calls;
+		l_stats.m_decompressNanoseconds = l_decompressTime * 1000.0 / l_calls;
+	}
+
+	return l_stats;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Build a dictionary from some recorded packets :
+/// the pieces of packets whose sequences are the most
+/// frequent are chosen, each sequence being counted once
+///
+/// \param a_samples the packets
+///
+/// \param a_size the maximum size of the dictionary
+///
+/// \return the content of the dictionary
+///
+////////////////////////////////////////////////////////////
+std::vector<char> CompressionDictionary::Train(const std::vector<std::vector<char>>& a_samples, size_t a_size)
+{
+	std::unordered_map<sf::Uint64, sf::Uint32> l_counts; // the number of occurrences of each sequence
+
+	for (const std::vector<char>& l_sample : a_samples)
+	{
+		for (size_t i = 0; i + COMPRESSION_TRAINING_GRAM <= l_sample.size(); i++)
+		{
+			l_counts[ReadGram(l_sample.data() + i)]++;
+		}
+	}
+
+	std::priority_queue<TrainingSegment> l_segments;
+
+	for (size_t l_index = 0; l_index < a_samples.size(); l_index++)
+	{
+		const std::vector<char>& l_sample = a_samples[l_index];
+
+		size_t l_length = std::min(l_sample.size(), (size_t)COMPRESSION_TRAINING_SEGMENT);
+
+		for (size_t i = 0; i + l_length <= l_sample.size() && l_length >= COMPRESSION_TRAINING_GRAM; i += COMPRESSION_TRAINING_SEGMENT / 4)
+		{
+			TrainingSegment l_segment;
+
+			l_segment.m_score = ScoreSegment(l_counts, l_sample.data() + i, l_length);
+			l_segment.m_sample = (sf::Uint32)l_index;
+			l_segment.m_position = (sf::Uint32)i;
+
+			if (l_segment.m_score != 0)
+				l_segments.push(l_segment);
+		}
+	}
+
+	std::vector<TrainingSegment> l_chosen;
+
+	size_t l_total = 0;
+
+	while (!l_segments.empty() && l_total < a_size)
+	{
+		TrainingSegment l_segment = l_segments.top();
+
+		l_segments.pop();
+
+		const std::vector<char>& l_sample = a_samples[l_segment.m_sample];
+
+		size_t l_length = std::min(l_sample.size(), (size_t)COMPRESSION_TRAINING_SEGMENT);
+
+		l_segment.m_score = ScoreSegment(l_counts, l_sample.data() + l_segment.m_position, l_length); // the chosen segments may have taken some of its sequences
+
+		if (l_segment.m_score == 0)
+			continue;
+
+		if (!l_segments.empty() && l_segment.m_score < l_segments.top().m_score) // the scores only decrease, so it is put back with its new score
+		{
+			l_segments.push(l_segment);
+			continue;
+		}
+
+		l_chosen.push_back(l_segment);
+
+		l_total += l_length;
+
+		for (size_t i = 0; i + COMPRESSION_TRAINING_GRAM <= l_length; i++)
+		{
+			l_counts[ReadGram(l_sample.data() + l_segment.m_position + i)] = 0; // a sequence in the dictionary is not worth a second copy
+		}
+	}
+
+	std::vector<char> l_dictionary;
+
+	l_dictionary.reserve(l_total);
+
+	for (size_t i = l_chosen.size(); i > 0; i--) // the best segments at the end, where the offsets are the smallest
+	{
+		const TrainingSegment& l_segment = l_chosen[i - 1];
+
+		const std::vector<char>& l_sample = a_samples[l_segment.m_sample];
+
+		size_t l_length = std::min(l_sample.size(), (size_t)COMPRESSION_TRAINING_SEGMENT);
+
+		l_dictionary.insert(l_dictionary.end(), l_sample.begin() + l_segment.m_position, l_sample.begin() + l_segment.m_position + l_length);
+	}
+
+	if (l_dictionary.size() > a_size) // the worst segment is only partly kept
+		l_dictionary.erase(l_dictionary.begin(), l_dictionary.end() - a_size);
+
+	return l_dictionary;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read a sequence of COMPRESSION_TRAINING_GRAM bytes
+///
+/// \param a_data the first byte
+///
+/// \return the sequence
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 CompressionDictionary::ReadGram(const char* a_data)
+{
+	sf::Uint64 l_gram = 0;
+
+	std::memcpy(&l_gram, a_data, COMPRESSION_TRAINING_GRAM);
+
+	return l_gram;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Compute the score of a segment
+///
+/// \param a_counts the number of occurrences of each sequence
+///
+/// \param a_data the first byte of the segment
+///
+/// \param a_size the size of the segment
+///
+/// \return the sum of the counts of the sequences seen more
+/// than once
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 CompressionDictionary::ScoreSegment(const std::unordered_map<sf::Uint64, sf::Uint32>& a_counts, const char* a_data, size_t a_size)
+{
+	sf::Uint64 l_score = 0;
+
+	for (size_t i = 0; i + COMPRESSION_TRAINING_GRAM <= a_size; i++)
+	{
+		std::unordered_map<sf::Uint64, sf::Uint32>::const_iterator l_count = a_counts.find(ReadGram(a_data + i));
+
+		if (l_count != a_counts.end() && l_count->second > 1) // a sequence seen once will not be seen again
+			l_score += l_count->second;
+	}
+
+	return l_score;
+}
+
+}
@@ -0,0 +1,396 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+#include "PacketBuffer.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define COMPRESSION_HASH_BITS 12 // size of the table of the last positions of each 4 bytes sequence (4096 entries)
+
+#define COMPRESSION_SMALL_HASH_BITS 9 // size of the table for the payloads of at most COMPRESSION_SMALL_SIZE bytes, so a small packet only clears 2 KB
+
+#define COMPRESSION_SMALL_SIZE 2048 // bytes, the payloads up to this size use the small table
+
+#define COMPRESSION_MIN_MATCH 4 // bytes, shorter repetitions are sent as literals
+
+#define COMPRESSION_MAX_OFFSET 65535 // bytes, a repetition is only searched in this window
+
+#define COMPRESSION_LAST_LITERALS 5 // bytes at the end of the data that are always literals (as in the LZ4 block format)
+
+#define COMPRESSION_MATCH_LIMIT 12 // bytes, no repetition starts in the last bytes of the data
+
+#define COMPRESSION_MIN_SIZE 64 // bytes, smaller payloads are never compressed without a dictionary
+
+#define COMPRESSION_MAX_SIZE (16 * 1024 * 1024) // bytes, a compressed frame announcing more is refused
+
+#define COMPRESSION_DICTIONARY_SIZE 4096 // bytes, default size of a trained dictionary
+
+#define COMPRESSION_TRAINING_GRAM 6 // bytes of the sequences counted by the training of a dictionary
+
+#define COMPRESSION_TRAINING_SEGMENT 32 // bytes of the pieces of samples that are added to a dictionary
+
+#define COMPRESSION_MEASURE_ROUNDS 16 // number of times the samples are compressed by a measure, for a precise timing
+
+
+namespace Net
+{
+
+
+class CompressionDictionary;
+
+
+////////////////////////////////////////////////////////////
+/// \brief The result of a measure of a dictionary on some
+/// recorded packets
+///
+////////////////////////////////////////////////////////////
+struct CompressionStats
+{
+	size_t m_packets;              ///< The number of packets
+	size_t m_rawBytes;             ///< The size of the packets
+	size_t m_compressedBytes;      ///< The size of the packets once compressed, the packets that do not shrink are counted as they are
+	double m_compressNanoseconds;  ///< The average time to compress a packet
+	double m_decompressNanoseconds;///< The average time to decompress a packet
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Fast LZ77 compression of the file parts and of the
+/// frames, in the LZ4 block format
+///
+/// Each block is compressed alone, so a compressed chunk can
+/// be cached and sent to any receiver, in any order. The data
+/// is only worth compressing if it shrinks : Compress fails as
+/// soon as the output does not fit in the given capacity, the
+/// caller then sends the data as it is
+///
+/// The small realtime packets are compressed with a dictionary
+/// known by both sides : the repetitions can also refer to the
+/// dictionary, as if it was placed before the data
+///
+////////////////////////////////////////////////////////////
+class NET Compression
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Compress a block of data
+	///
+	/// \param a_source the data to compress
+	///
+	/// \param a_size the size of the data
+	///
+	/// \param a_destination receives the compressed data
+	///
+	/// \param a_capacity the size of the destination, give less
+	/// than a_size to only accept a compression that shrinks
+	///
+	/// \param a_dictionary the dictionary, NULL if there is none
+	///
+	/// \return the size of the compressed data, 0 if it does not
+	/// fit in the destination or if the data is too small
+	///
+	////////////////////////////////////////////////////////////
+	static size_t Compress(const char* a_source, size_t a_size, char* a_destination, size_t a_capacity, const CompressionDictionary* a_dictionary = NULL);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Decompress a block of data, every reference is
+	/// checked so a corrupted block can not write outside of
+	/// the destination
+	///
+	/// \param a_source the compressed data
+	///
+	/// \param a_size the size of the compressed data
+	///
+	/// \param a_destination receives the data
+	///
+	/// \param a_originalSize the size of the data before the
+	/// compression
+	///
+	/// \param a_dictionary the dictionary used by the
+	/// compression, NULL if there was none
+	///
+	/// \return false if the block is corrupted or does not give
+	/// exactly a_originalSize bytes
+	///
+	////////////////////////////////////////////////////////////
+	static bool Decompress(const char* a_source, size_t a_size, char* a_destination, size_t a_originalSize, const CompressionDictionary* a_dictionary = NULL);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write a packet in a CT_Compressed frame
+	///
+	/// \param a_data the packet, with its command
+	///
+	/// \param a_size the size of the packet
+	///
+	/// \param a_frame receives the frame
+	///
+	/// \param a_dictionary the dictionary, NULL if there is none
+	///
+	/// \return false if the frame would not be smaller than the
+	/// packet, the packet must be sent as it is
+	///
+	////////////////////////////////////////////////////////////
+	static bool CompressFrame(const char* a_data, size_t a_size, PacketBuffer& a_frame, const CompressionDictionary* a_dictionary);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read a CT_Compressed frame, a compressed frame
+	/// can not contain another one
+	///
+	/// \param a_packet the frame, after its command
+	///
+	/// \param a_data receives the packet, with its command
+	///
+	/// \param a_dictionary the dictionary given by the other
+	/// side, NULL if there is none
+	///
+	/// \return false if the frame is corrupted or needs a
+	/// dictionary that we do not have
+	///
+	////////////////////////////////////////////////////////////
+	static bool DecompressFrame(sf::Packet& a_packet, std::vector<char>& a_data, const CompressionDictionary* a_dictionary);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write a sequence : literals followed by a
+	/// repetition of previous bytes
+	///
+	/// \param a_output the position in the destination, moved
+	/// after the sequence
+	///
+	/// \param a_outputEnd the end of the destination
+	///
+	/// \param a_literals the bytes to copy as they are
+	///
+	/// \param a_literalSize the number of literals
+	///
+	/// \param a_offset the distance of the repetition
+	///
+	/// \param a_matchSize the size of the repetition, 0 for the
+	/// last sequence that only has literals
+	///
+	/// \return false if the sequence does not fit
+	///
+	////////////////////////////////////////////////////////////
+	static bool WriteSequence(sf::Uint8*& a_output, const sf::Uint8* a_outputEnd, const sf::Uint8* a_literals, size_t a_literalSize, size_t a_offset, size_t a_matchSize);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write the rest of a length that does not fit in
+	/// the 4 bits of the token (bytes of 255, then the remainder)
+	///
+	/// \param a_output the position in the destination, moved
+	/// after the length
+	///
+	/// \param a_length the length minus 15
+	///
+	////////////////////////////////////////////////////////////
+	static void WriteLength(sf::Uint8*& a_output, size_t a_length);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read the rest of a length written by WriteLength
+	///
+	/// \param a_input the position in the source, moved after
+	/// the length
+	///
+	/// \param a_inputEnd the end of the source
+	///
+	/// \param a_length receives the length added to the 15 of
+	/// the token
+	///
+	/// \return false if the source ends in the length
+	///
+	////////////////////////////////////////////////////////////
+	static bool ReadLength(const sf::Uint8*& a_input, const sf::Uint8* a_inputEnd, size_t& a_length);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Hash a sequence of 4 bytes in a table of the last
+	/// positions
+	///
+	/// \param a_data the first byte of the sequence
+	///
+	/// \param a_bits the size of the table (in bits)
+	///
+	/// \return the index in the table
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint32 HashSequence(const sf::Uint8* a_data, int a_bits);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read 4 bytes without alignment
+	///
+	/// \param a_data the first byte
+	///
+	/// \return the 4 bytes
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint32 Read32(const sf::Uint8* a_data);
+
+	friend class CompressionDictionary;
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Content shared by both sides of a connection that
+/// the small packets can refer to
+///
+/// A dictionary is trained offline from recorded packets (see
+/// InternalComm::SetTrafficCapture), saved by the game, and
+/// given to the server with SetCompressionDictionary. The
+/// server sends it to each client in the handshake. The table
+/// of its sequences is built once when it is loaded, so a
+/// packet only pays the clearing of a small table
+///
+////////////////////////////////////////////////////////////
+class NET CompressionDictionary
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor, the dictionary is empty
+	///
+	////////////////////////////////////////////////////////////
+	CompressionDictionary();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Set the content of the dictionary and index its
+	/// sequences
+	///
+	/// \param a_content the content, empty to remove the
+	/// dictionary (only the last COMPRESSION_MAX_OFFSET bytes
+	/// can be used)
+	///
+	////////////////////////////////////////////////////////////
+	void Load(const std::vector<char>& a_content);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the dictionary has a content
+	///
+	/// \return true if there is nothing to refer to
+	///
+	////////////////////////////////////////////////////////////
+	bool IsEmpty() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the content of the dictionary
+	///
+	/// \return the content
+	///
+	////////////////////////////////////////////////////////////
+	const std::vector<char>& GetContent() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Compress and decompress some recorded packets with
+	/// this dictionary, to know what it saves and what it costs
+	///
+	/// \param a_samples the packets
+	///
+	/// \return the sizes and the average times
+	///
+	////////////////////////////////////////////////////////////
+	CompressionStats Measure(const std::vector<std::vector<char>>& a_samples) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Build a dictionary from some recorded packets :
+	/// the pieces of packets whose sequences are the most
+	/// frequent are chosen, each sequence being counted once
+	///
+	/// \param a_samples the packets
+	///
+	/// \param a_size the maximum size of the dictionary
+	///
+	/// \return the content of the dictionary
+	///
+	////////////////////////////////////////////////////////////
+	static std::vector<char> Train(const std::vector<std::vector<char>>& a_samples, size_t a_size = COMPRESSION_DICTIONARY_SIZE);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief A piece of a sample that can be added to a
+	/// dictionary during the training
+	///
+	////////////////////////////////////////////////////////////
+	struct TrainingSegment
+	{
+		sf::Uint64 m_score;   ///< The sum of the counts of its sequences, it can only decrease
+		sf::Uint32 m_sample;  ///< The index of the sample
+		sf::Uint32 m_position;///< The position in the sample
+
+		////////////////////////////////////////////////////////////
+		/// \brief Order the segments by score
+		///
+		/// \param other another segment
+		///
+		/// \return true if this segment has a smaller score
+		///
+		////////////////////////////////////////////////////////////
+		bool operator<(const TrainingSegment& other) const
+		{
+			return m_score < other.m_score;
+		}
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read a sequence of COMPRESSION_TRAINING_GRAM bytes
+	///
+	/// \param a_data the first byte
+	///
+	/// \return the sequence
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint64 ReadGram(const char* a_data);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Compute the score of a segment
+	///
+	/// \param a_counts the number of occurrences of each sequence
+	///
+	/// \param a_data the first byte of the segment
+	///
+	/// \param a_size the size of the segment
+	///
+	/// \return the sum of the counts of the sequences seen more
+	/// than once
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint64 ScoreSegment(const std::unordered_map<sf::Uint64, sf::Uint32>& a_counts, const char* a_data, size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::vector<char> m_content; ///< The content of the dictionary
+
+	std::vector<sf::Uint32> m_table; ///< The last position + 1 of each hashed sequence of the content, 0 if none (COMPRESSION_HASH_BITS)
+
+	friend class Compression;
+};
+
+}
@@ -48,7 +48,45 @@ Connection::Connection(const Connection& other)
 ////////////////////////////////////////////////////////////
 Connection::Connection()
 {
+	m_port = 0;
 
+	m_sessionId = 0;
+
+	m_isConsideredAlive = false;
+
+	m_isLocalHost = false;
+
+	m_isUDPConnection = false;
+
+	m_isLoopback = false;
+
+	m_isCompressed = false;
+
+	m_hasDictionary = false;
+
+	m_sentBytes = 0;
+
+	m_syncroPosition = 0;
+
+	m_syncroCompleteTime = 0;
+
+	m_sessionTime = 0;
+
+	m_sessionToken = 0;
+
+	m_commandKey = 0;
+
+	m_sentStateFrames = 0;
+
+	m_fileTokens = 0;
+
+	m_realtimeBytes = 0;
+
+	m_fileRefillTime = 0;
+
+	m_keepAliveTimer.SetOwner(this);
+
+	m_deadlineTimer.SetOwner(this);
 }
 
 ////////////////////////////////////////////////////////////
@@ -63,4 +101,107 @@ void Connection::RefuseConnection()
 	}
 }
 
+////////////////////////////////////////////////////////////
+/// \brief Add a frame in the send queue of the TCP socket,
+/// and send as much as possible of the queue. The server and
+/// the client never wait on a full socket, the rest is sent
+/// by their next update
+///
+/// \param a_frame the frame to send, it can be shared with
+/// other connections
+///
+/// \return the status of the socket
+///
+////////////////////////////////////////////////////////////
+sf::Socket::Status Connection::SendFrame(const SharedFrame& a_frame)
+{
+	if (m_sendQueue.empty())
+		m_lastSend.restart(); // the stall delay starts with the first waiting frame
+
+	m_sendQueue.push(a_frame);
+
+	return FlushSendQueue();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send as much as possible of the send queue,
+/// without waiting on the socket
+///
+/// If nothing can be sent during CONNECTION_TIMEOUT the other
+/// side does not read anymore, so the connection is closed
+///
+/// \return Done if the queue is empty, NotReady if a part is
+/// still waiting, else the error of the socket
+///
+////////////////////////////////////////////////////////////
+sf::Socket::Status Connection::FlushSendQueue()
+{
+	while (!m_sendQueue.empty())
+	{
+		const Frame& l_frame = *m_sendQueue.front();
+
+		size_t l_sent = 0;
+
+		// the bytes are read in the shared frame, nothing is copied for this connection
+		sf::Socket::Status l_status = m_TCPSocket.send(l_frame.GetTcpData() + m_sentBytes, l_frame.GetTcpSize() - m_sentBytes, l_sent);
+
+		m_sentBytes += l_sent;
+
+		if (l_sent != 0)
+			m_lastSend.restart();
+
+		if (l_status == sf::Socket::Done)
+		{
+			m_sendQueue.pop();
+			m_sentBytes = 0;
+		}
+		else if (l_status == sf::Socket::Partial || l_status == sf::Socket::NotReady) // only non blocking sockets arrive here
+		{
+			if (m_lastSend.getElapsedTime().asMilliseconds() < CONNECTION_TIMEOUT)
+				return sf::Socket::NotReady; // the next update sends the rest
+
+			m_TCPSocket.disconnect(); // the other side does not read anymore
+
+			m_sendQueue = FrameQueue();
+			m_sentBytes = 0;
+
+			return sf::Socket::Disconnected;
+		}
+		else
+		{
+			m_sendQueue = FrameQueue();
+			m_sentBytes = 0;
+
+			return l_status;
+		}
+	}
+
+	return sf::Socket::Done;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if some frames are waiting to be sent
+///
+/// \return true if the send queue is not empty
+///
+////////////////////////////////////////////////////////////
+bool Connection::HasPendingFrames() const
+{
+	return !m_sendQueue.empty();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the number of frames waiting to be sent
+///
+/// \return the size of the send queue
+///
+////////////////////////////////////////////////////////////
+size_t Connection::GetNumberOfPendingFrames() const
+{
+	return m_sendQueue.size();
+}
+
 }
\ No newline at end of file
@@ -22,6 +22,8 @@
 #include "stdafx.h"
 
 #include "NetworkEnums.h"
+#include "Frame.h"
+#include "TimerWheel.h"
 
 namespace Net
 {
@@ -69,6 +71,49 @@ public:
 	////////////////////////////////////////////////////////////
 	void RefuseConnection();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Add a frame in the send queue of the TCP socket,
+	/// and send as much as possible of the queue. The server and
+	/// the client never wait on a full socket, the rest is sent
+	/// by their next update
+	///
+	/// \param a_frame the frame to send, it can be shared with
+	/// other connections
+	///
+	/// \return the status of the socket
+	///
+	////////////////////////////////////////////////////////////
+	sf::Socket::Status SendFrame(const SharedFrame& a_frame);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send as much as possible of the send queue,
+	/// without waiting on the socket
+	///
+	/// If nothing can be sent during CONNECTION_TIMEOUT the other
+	/// side does not read anymore, so the connection is closed
+	///
+	/// \return Done if the queue is empty, NotReady if a part is
+	/// still waiting, else the error of the socket
+	///
+	////////////////////////////////////////////////////////////
+	sf::Socket::Status FlushSendQueue();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if some frames are waiting to be sent
+	///
+	/// \return true if the send queue is not empty
+	///
+	////////////////////////////////////////////////////////////
+	bool HasPendingFrames() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of frames waiting to be sent
+	///
+	/// \return the size of the send queue
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetNumberOfPendingFrames() const;
+
 	////////////////////////////////////////////////////////////
 	// Public member data
 	////////////////////////////////////////////////////////////
@@ -79,6 +124,8 @@ public:
 
 	sf::Uint16 m_port; ///< The port to use to communicate with this entity
 
+	sf::Uint32 m_sessionId; ///< [Server side] The id given by the connection table of the server, 0 if the connection is not stored
+
 	sf::IpAddress m_ipAddress; ///< The ip address of the entity to wich we are connected
 
 	bool m_isConsideredAlive; ///< Flag to know if the connection is still working
@@ -87,7 +134,51 @@ public:
 
 	bool m_isUDPConnection; ///< Flag to know if the connection uses UDP protocol
 
+	bool m_isLoopback; ///< Flag to know if the connection is the in process loopback (client and server in the same application)
+
+	bool m_isCompressed; ///< [Server side] Flag to know if the client accepts compressed file parts and bulk frames
+
+	bool m_hasDictionary; ///< [Server side] Flag to know if the client received the dictionary of the realtime packets
+
 	sf::Clock m_lastPing; ///< The last time when the client was sending info
 
+	Timer m_keepAliveTimer; ///< [Server side] The timer that ping the client when it is silent
+
+	Timer m_deadlineTimer; ///< [Server side] The timer for the handshake expiry, the idle timeout or the deletion of the connection
+
+	std::vector<sf::Uint16> m_syncroQueue; ///< [Server side] The ids of the existing objects to send to this new client, the most relevant first
+
+	size_t m_syncroPosition; ///< [Server side] The position of the next object of the syncronization queue to send
+
+	sf::Int32 m_syncroCompleteTime; ///< [Server side] The time when CT_SyncroComplete was last sent to this udp client
+
+	sf::Int32 m_sessionTime; ///< [Server side] The time when CT_Session was last sent to this udp client
+
+	sf::Uint32 m_sentStateFrames; ///< [Server side] The number of state frames (see Frame::IsStateCommand) sent on the TCP socket since it was accepted
+
+	std::deque<SharedFrame> m_stateFrames; ///< [Server side] The last SESSION_REPLAY_FRAMES state frames, the ones missed by the client are sent again if it resumes its session
+
+	sf::Uint64 m_sessionToken; ///< [Server side] The token given to the client to resume its session after a drop, 0 if it can not be resumed
+
+	sf::Uint32 m_commandKey; ///< [Server side] The random key given to the client in the session packet, its commands must carry it (0 for a loopback client)
+
+	sf::Int64 m_fileTokens; ///< [Server side] The bytes of file parts this client can still receive (token bucket), negative after a part bigger than the budget
+
+	sf::Uint64 m_realtimeBytes; ///< [Server side] The bytes of the other frames sent to this client since the last refill of the tokens
+
+	sf::Int32 m_fileRefillTime; ///< [Server side] The server time of the last refill of the tokens, in ms
+
+private:
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	FrameQueue m_sendQueue; ///< The frames waiting for the TCP socket, on the server side the buffers are shared with the other connections
+
+	size_t m_sentBytes; ///< The number of bytes of the first frame of the queue already sent
+
+	sf::Clock m_lastSend; ///< The last time when some bytes of the queue were sent
+
 };
 }
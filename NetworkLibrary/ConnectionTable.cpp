@@ -0,0 +1,496 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "ConnectionTable.h"
+
+namespace Net
+{
+
+const sf::Uint32 ConnectionTable::EMPTY_SLOT = 0xFFFFFFFF; ///< The slot value of a free bucket
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+ConnectionTable::ConnectionTable()
+{
+	IndexEntry l_empty = { 0, EMPTY_SLOT };
+
+	m_addressIndex.m_buckets.assign(CONNECTION_TABLE_MIN_CAPACITY, l_empty);
+	m_sessionIndex.m_buckets.assign(CONNECTION_TABLE_MIN_CAPACITY, l_empty);
+	m_nameIndex.m_buckets.assign(CONNECTION_TABLE_MIN_CAPACITY, l_empty);
+
+	m_addressIndex.m_used = 0;
+	m_sessionIndex.m_used = 0;
+	m_nameIndex.m_used = 0;
+
+	m_nextSessionId = 1; // 0 is kept for connections that are not in a table
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add a connection in the table and give it a new
+/// session id
+///
+/// If the address of the connection is already known (port
+/// not null), the connection is also indexed by address
+///
+/// \param a_connection the connection to add
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::Add(Connection* a_connection)
+{
+	sf::Uint32 l_slot = m_connections.size();
+
+	m_connections.push_back(a_connection);
+
+	a_connection->m_sessionId = m_nextSessionId++;
+
+	if (m_nextSessionId == 0) // never give the 0 id, even after a wrap around
+		m_nextSessionId = 1;
+
+	Insert(m_sessionIndex, a_connection->m_sessionId, l_slot);
+
+	Insert(m_nameIndex, NameKey(a_connection->m_name), l_slot);
+
+	if (a_connection->m_port != 0)
+	{
+		SetAddress(a_connection, a_connection->m_ipAddress, a_connection->m_port);
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove a connection from the table, the connection
+/// is not deleted
+///
+/// The last connection of the array takes the place of the
+/// removed one, so the order of the connections can change
+///
+/// \param a_connection the connection to remove
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::Remove(Connection* a_connection)
+{
+	sf::Uint32 l_slot = Find(m_sessionIndex, a_connection->m_sessionId);
+
+	if (l_slot == EMPTY_SLOT || m_connections[l_slot] != a_connection)
+		return; // not in this table
+
+	Unindex(a_connection, l_slot);
+
+	sf::Uint32 l_lastSlot = m_connections.size() - 1;
+
+	if (l_slot != l_lastSlot) // the last connection fill the hole to keep the array compact
+	{
+		Connection* l_moved = m_connections[l_lastSlot];
+
+		Move(m_sessionIndex, l_moved->m_sessionId, l_lastSlot, l_slot);
+		Move(m_nameIndex, NameKey(l_moved->m_name), l_lastSlot, l_slot);
+
+		if (l_moved->m_port != 0)
+			Move(m_addressIndex, AddressKey(l_moved->m_ipAddress, l_moved->m_port), l_lastSlot, l_slot);
+
+		m_connections[l_slot] = l_moved;
+	}
+
+	m_connections.pop_back();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Change the address of a connection and update the
+/// address index
+///
+/// If another connection already uses this address, the
+/// new one replace it in the index
+///
+/// \param a_connection the connection to update
+///
+/// \param a_address the new ip address of the connection
+///
+/// \param a_port the new port of the connection
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::SetAddress(Connection* a_connection, const sf::IpAddress& a_address, sf::Uint16 a_port)
+{
+	sf::Uint32 l_slot = Find(m_sessionIndex, a_connection->m_sessionId);
+
+	if (l_slot != EMPTY_SLOT && m_connections[l_slot] == a_connection)
+	{
+		if (a_connection->m_port != 0)
+			Erase(m_addressIndex, AddressKey(a_connection->m_ipAddress, a_connection->m_port), l_slot);
+
+		sf::Uint64 l_key = AddressKey(a_address, a_port);
+
+		sf::Uint32 l_oldOwner = Find(m_addressIndex, l_key);
+
+		if (l_oldOwner != EMPTY_SLOT) // the newest connection wins
+			Erase(m_addressIndex, l_key, l_oldOwner);
+
+		if (a_port != 0)
+			Insert(m_addressIndex, l_key, l_slot);
+	}
+
+	a_connection->m_ipAddress = a_address;
+	a_connection->m_port = a_port;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Change the name of a connection and update the
+/// name index
+///
+/// \param a_connection the connection to update
+///
+/// \param a_name the new name of the connection
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::SetName(Connection* a_connection, const std::string& a_name)
+{
+	sf::Uint32 l_slot = Find(m_sessionIndex, a_connection->m_sessionId);
+
+	if (l_slot != EMPTY_SLOT && m_connections[l_slot] == a_connection)
+	{
+		Erase(m_nameIndex, NameKey(a_connection->m_name), l_slot);
+
+		Insert(m_nameIndex, NameKey(a_name), l_slot);
+	}
+
+	a_connection->m_name = a_name;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Find a connection from its address
+///
+/// \param a_address the ip address of the connection
+///
+/// \param a_port the port of the connection
+///
+/// \return the connection, or NULL if there is none
+///
+////////////////////////////////////////////////////////////
+Connection* ConnectionTable::FindByAddress(const sf::IpAddress& a_address, sf::Uint16 a_port) const
+{
+	sf::Uint32 l_slot = Find(m_addressIndex, AddressKey(a_address, a_port));
+
+	return l_slot == EMPTY_SLOT ? NULL : m_connections[l_slot];
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Find a connection from its session id
+///
+/// \param a_sessionId the session id given by the table
+///
+/// \return the connection, or NULL if there is none
+///
+////////////////////////////////////////////////////////////
+Connection* ConnectionTable::FindBySession(sf::Uint32 a_sessionId) const
+{
+	sf::Uint32 l_slot = Find(m_sessionIndex, a_sessionId);
+
+	return l_slot == EMPTY_SLOT ? NULL : m_connections[l_slot];
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Find a connection from its name
+///
+/// \param a_name the name of the connection
+///
+/// \return the connection, or NULL if there is none
+///
+////////////////////////////////////////////////////////////
+Connection* ConnectionTable::FindByName(const std::string& a_name) const
+{
+	sf::Uint64 l_key = NameKey(a_name);
+
+	size_t l_mask = m_nameIndex.m_buckets.size() - 1;
+
+	// names are not unique keys, so we must compare the names of all the entries of the cluster
+	for (size_t i = FirstBucket(m_nameIndex, l_key); m_nameIndex.m_buckets[i].m_slot != EMPTY_SLOT; i = (i + 1) & l_mask)
+	{
+		if (m_nameIndex.m_buckets[i].m_key == l_key && m_connections[m_nameIndex.m_buckets[i].m_slot]->m_name == a_name)
+			return m_connections[m_nameIndex.m_buckets[i].m_slot];
+	}
+
+	return NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the compact array of all the connections
+///
+/// \return the list of all connections
+///
+////////////////////////////////////////////////////////////
+const std::vector<Connection*>& ConnectionTable::GetConnections() const
+{
+	return m_connections;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the number of connections in the table
+///
+/// \return the number of connections
+///
+////////////////////////////////////////////////////////////
+size_t ConnectionTable::size() const
+{
+	return m_connections.size();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get a connection from its position in the array
+///
+/// \param a_index the position in the array
+///
+/// \return the connection at this position
+///
+////////////////////////////////////////////////////////////
+Connection* ConnectionTable::operator[](size_t a_index) const
+{
+	return m_connections[a_index];
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Iterators, to allow range based loops
+///
+////////////////////////////////////////////////////////////
+std::vector<Connection*>::const_iterator ConnectionTable::begin() const
+{
+	return m_connections.begin();
+}
+
+std::vector<Connection*>::const_iterator ConnectionTable::end() const
+{
+	return m_connections.end();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Build the key of an address
+///
+/// \param a_address the ip address
+///
+/// \param a_port the port
+///
+/// \return the key (ip in the high bits, port in the low bits)
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 ConnectionTable::AddressKey(const sf::IpAddress& a_address, sf::Uint16 a_port)
+{
+	return ((sf::Uint64)a_address.toInteger() << 16) | a_port;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Build the key of a name
+///
+/// \param a_name the name
+///
+/// \return the key (different names can share the same key)
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 ConnectionTable::NameKey(const std::string& a_name)
+{
+	return std::hash<std::string>()(a_name);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the first bucket to probe for a key
+///
+/// \param a_index the index to probe
+///
+/// \param a_key the key
+///
+/// \return the position of the first bucket
+///
+////////////////////////////////////////////////////////////
+size_t ConnectionTable::FirstBucket(const Index& a_index, sf::Uint64 a_key)
+{
+	// mix the bits, because keys like session ids or ports are often consecutive
+	a_key ^= a_key >> 33;
+	a_key *= 0xff51afd7ed558ccdULL;
+	a_key ^= a_key >> 33;
+
+	return (size_t)a_key & (a_index.m_buckets.size() - 1);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Insert an entry in an index, grow the index if
+/// it is more than half full
+///
+/// \param a_index the index
+///
+/// \param a_key the key of the entry
+///
+/// \param a_slot the position of the connection in the array
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::Insert(Index& a_index, sf::Uint64 a_key, sf::Uint32 a_slot)
+{
+	if ((a_index.m_used + 1) * 2 > a_index.m_buckets.size()) // keep the load factor under 0.5 so clusters stay short
+	{
+		IndexEntry l_empty = { 0, EMPTY_SLOT };
+
+		std::vector<IndexEntry> l_oldBuckets;
+		l_oldBuckets.swap(a_index.m_buckets);
+
+		a_index.m_buckets.assign(l_oldBuckets.size() * 2, l_empty);
+		a_index.m_used = 0;
+
+		for (const IndexEntry& entry : l_oldBuckets)
+		{
+			if (entry.m_slot != EMPTY_SLOT)
+				Insert(a_index, entry.m_key, entry.m_slot);
+		}
+	}
+
+	size_t l_mask = a_index.m_buckets.size() - 1;
+	size_t i = FirstBucket(a_index, a_key);
+
+	while (a_index.m_buckets[i].m_slot != EMPTY_SLOT)
+		i = (i + 1) & l_mask;
+
+	a_index.m_buckets[i].m_key = a_key;
+	a_index.m_buckets[i].m_slot = a_slot;
+
+	a_index.m_used++;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Erase an entry from an index. The following entries
+/// of the cluster are shifted back, so no tombstone is needed
+///
+/// \param a_index the index
+///
+/// \param a_key the key of the entry
+///
+/// \param a_slot the position of the connection in the array
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::Erase(Index& a_index, sf::Uint64 a_key, sf::Uint32 a_slot)
+{
+	size_t l_mask = a_index.m_buckets.size() - 1;
+	size_t i = FirstBucket(a_index, a_key);
+
+	while (a_index.m_buckets[i].m_slot != EMPTY_SLOT && !(a_index.m_buckets[i].m_key == a_key && a_index.m_buckets[i].m_slot == a_slot))
+		i = (i + 1) & l_mask;
+
+	if (a_index.m_buckets[i].m_slot == EMPTY_SLOT)
+		return; // not indexed
+
+	size_t l_hole = i;
+
+	for (size_t j = (i + 1) & l_mask; a_index.m_buckets[j].m_slot != EMPTY_SLOT; j = (j + 1) & l_mask)
+	{
+		size_t l_home = FirstBucket(a_index, a_index.m_buckets[j].m_key);
+
+		// the entry can fill the hole only if the hole is between its home bucket and its current bucket
+		if (((j - l_home) & l_mask) >= ((j - l_hole) & l_mask))
+		{
+			a_index.m_buckets[l_hole] = a_index.m_buckets[j];
+			l_hole = j;
+		}
+	}
+
+	a_index.m_buckets[l_hole].m_key = 0;
+	a_index.m_buckets[l_hole].m_slot = EMPTY_SLOT;
+
+	a_index.m_used--;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Change the position stored in an entry, used when
+/// a connection is moved in the array
+///
+/// \param a_index the index
+///
+/// \param a_key the key of the entry
+///
+/// \param a_oldSlot the previous position of the connection
+///
+/// \param a_newSlot the new position of the connection
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::Move(Index& a_index, sf::Uint64 a_key, sf::Uint32 a_oldSlot, sf::Uint32 a_newSlot)
+{
+	size_t l_mask = a_index.m_buckets.size() - 1;
+
+	for (size_t i = FirstBucket(a_index, a_key); a_index.m_buckets[i].m_slot != EMPTY_SLOT; i = (i + 1) & l_mask)
+	{
+		if (a_index.m_buckets[i].m_key == a_key && a_index.m_buckets[i].m_slot == a_oldSlot)
+		{
+			a_index.m_buckets[i].m_slot = a_newSlot;
+			return;
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Find the position of the connection of a unique key
+///
+/// \param a_index the index
+///
+/// \param a_key the key
+///
+/// \return the position in the array, or EMPTY_SLOT
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 ConnectionTable::Find(const Index& a_index, sf::Uint64 a_key)
+{
+	size_t l_mask = a_index.m_buckets.size() - 1;
+
+	for (size_t i = FirstBucket(a_index, a_key); a_index.m_buckets[i].m_slot != EMPTY_SLOT; i = (i + 1) & l_mask)
+	{
+		if (a_index.m_buckets[i].m_key == a_key)
+			return a_index.m_buckets[i].m_slot;
+	}
+
+	return EMPTY_SLOT;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove all the entries of a connection from the indexes
+///
+/// \param a_connection the connection
+///
+/// \param a_slot the position of the connection in the array
+///
+////////////////////////////////////////////////////////////
+void ConnectionTable::Unindex(Connection* a_connection, sf::Uint32 a_slot)
+{
+	Erase(m_sessionIndex, a_connection->m_sessionId, a_slot);
+
+	Erase(m_nameIndex, NameKey(a_connection->m_name), a_slot);
+
+	if (a_connection->m_port != 0)
+		Erase(m_addressIndex, AddressKey(a_connection->m_ipAddress, a_connection->m_port), a_slot);
+}
+
+}
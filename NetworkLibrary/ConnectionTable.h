@@ -0,0 +1,316 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "Connection.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define CONNECTION_TABLE_MIN_CAPACITY 16 // the minimum number of buckets of each index (must be a power of 2)
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief Store all the connections of a server in a compact
+/// array, with hash indexes to find them in constant time
+///
+/// The connections can be found by address (ip + port), by
+/// session id or by name. The indexes use open addressing
+/// with linear probing, so a lookup only touch a few
+/// contiguous entries
+///
+////////////////////////////////////////////////////////////
+class NET ConnectionTable
+{
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	ConnectionTable();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add a connection in the table and give it a new
+	/// session id
+	///
+	/// If the address of the connection is already known (port
+	/// not null), the connection is also indexed by address
+	///
+	/// \param a_connection the connection to add
+	///
+	////////////////////////////////////////////////////////////
+	void Add(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove a connection from the table, the connection
+	/// is not deleted
+	///
+	/// The last connection of the array takes the place of the
+	/// removed one, so the order of the connections can change
+	///
+	/// \param a_connection the connection to remove
+	///
+	////////////////////////////////////////////////////////////
+	void Remove(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Change the address of a connection and update the
+	/// address index
+	///
+	/// If another connection already uses this address, the
+	/// new one replace it in the index
+	///
+	/// \param a_connection the connection to update
+	///
+	/// \param a_address the new ip address of the connection
+	///
+	/// \param a_port the new port of the connection
+	///
+	////////////////////////////////////////////////////////////
+	void SetAddress(Connection* a_connection, const sf::IpAddress& a_address, sf::Uint16 a_port);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Change the name of a connection and update the
+	/// name index
+	///
+	/// \param a_connection the connection to update
+	///
+	/// \param a_name the new name of the connection
+	///
+	////////////////////////////////////////////////////////////
+	void SetName(Connection* a_connection, const std::string& a_name);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Find a connection from its address
+	///
+	/// \param a_address the ip address of the connection
+	///
+	/// \param a_port the port of the connection
+	///
+	/// \return the connection, or NULL if there is none
+	///
+	////////////////////////////////////////////////////////////
+	Connection* FindByAddress(const sf::IpAddress& a_address, sf::Uint16 a_port) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Find a connection from its session id
+	///
+	/// \param a_sessionId the session id given by the table
+	///
+	/// \return the connection, or NULL if there is none
+	///
+	////////////////////////////////////////////////////////////
+	Connection* FindBySession(sf::Uint32 a_sessionId) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Find a connection from its name
+	///
+	/// \param a_name the name of the connection
+	///
+	/// \return the connection, or NULL if there is none
+	///
+	////////////////////////////////////////////////////////////
+	Connection* FindByName(const std::string& a_name) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the compact array of all the connections
+	///
+	/// \return the list of all connections
+	///
+	////////////////////////////////////////////////////////////
+	const std::vector<Connection*>& GetConnections() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of connections in the table
+	///
+	/// \return the number of connections
+	///
+	////////////////////////////////////////////////////////////
+	size_t size() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get a connection from its position in the array
+	///
+	/// \param a_index the position in the array
+	///
+	/// \return the connection at this position
+	///
+	////////////////////////////////////////////////////////////
+	Connection* operator[](size_t a_index) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Iterators, to allow range based loops
+	///
+	////////////////////////////////////////////////////////////
+	std::vector<Connection*>::const_iterator begin() const;
+	std::vector<Connection*>::const_iterator end() const;
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief One bucket of an index
+	///
+	////////////////////////////////////////////////////////////
+	struct IndexEntry
+	{
+		sf::Uint64 m_key;  ///< The hashed key of the connection
+		sf::Uint32 m_slot; ///< The position of the connection in the array, EMPTY_SLOT if the bucket is free
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief An open addressing index (the number of buckets
+	/// is always a power of 2)
+	///
+	////////////////////////////////////////////////////////////
+	struct Index
+	{
+		std::vector<IndexEntry> m_buckets; ///< All the buckets, free or not
+
+		size_t m_used; ///< The number of buckets in use
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief Build the key of an address
+	///
+	/// \param a_address the ip address
+	///
+	/// \param a_port the port
+	///
+	/// \return the key (ip in the high bits, port in the low bits)
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint64 AddressKey(const sf::IpAddress& a_address, sf::Uint16 a_port);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Build the key of a name
+	///
+	/// \param a_name the name
+	///
+	/// \return the key (different names can share the same key)
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint64 NameKey(const std::string& a_name);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the first bucket to probe for a key
+	///
+	/// \param a_index the index to probe
+	///
+	/// \param a_key the key
+	///
+	/// \return the position of the first bucket
+	///
+	////////////////////////////////////////////////////////////
+	static size_t FirstBucket(const Index& a_index, sf::Uint64 a_key);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Insert an entry in an index, grow the index if
+	/// it is more than half full
+	///
+	/// \param a_index the index
+	///
+	/// \param a_key the key of the entry
+	///
+	/// \param a_slot the position of the connection in the array
+	///
+	////////////////////////////////////////////////////////////
+	static void Insert(Index& a_index, sf::Uint64 a_key, sf::Uint32 a_slot);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Erase an entry from an index. The following entries
+	/// of the cluster are shifted back, so no tombstone is needed
+	///
+	/// \param a_index the index
+	///
+	/// \param a_key the key of the entry
+	///
+	/// \param a_slot the position of the connection in the array
+	///
+	////////////////////////////////////////////////////////////
+	static void Erase(Index& a_index, sf::Uint64 a_key, sf::Uint32 a_slot);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Change the position stored in an entry, used when
+	/// a connection is moved in the array
+	///
+	/// \param a_index the index
+	///
+	/// \param a_key the key of the entry
+	///
+	/// \param a_oldSlot the previous position of the connection
+	///
+	/// \param a_newSlot the new position of the connection
+	///
+	////////////////////////////////////////////////////////////
+	static void Move(Index& a_index, sf::Uint64 a_key, sf::Uint32 a_oldSlot, sf::Uint32 a_newSlot);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Find the position of the connection of a unique key
+	///
+	/// \param a_index the index
+	///
+	/// \param a_key the key
+	///
+	/// \return the position in the array, or EMPTY_SLOT
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint32 Find(const Index& a_index, sf::Uint64 a_key);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove all the entries of a connection from the indexes
+	///
+	/// \param a_connection the connection
+	///
+	/// \param a_slot the position of the connection in the array
+	///
+	////////////////////////////////////////////////////////////
+	void Unindex(Connection* a_connection, sf::Uint32 a_slot);
+
+	////////////////////////////////////////////////////////////
+	// Static member data
+	////////////////////////////////////////////////////////////
+
+	static const sf::Uint32 EMPTY_SLOT; ///< The slot value of a free bucket
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::vector<Connection*> m_connections; ///< The compact array of all connections
+
+	Index m_addressIndex; ///< Index from (ip, port) to the position in the array
+
+	Index m_sessionIndex; ///< Index from session id to the position in the array
+
+	Index m_nameIndex; ///< Index from the name to the position in the array (keys can collide)
+
+	sf::Uint32 m_nextSessionId; ///< The session id that will be given to the next connection
+};
+
+}
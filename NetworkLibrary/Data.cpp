@@ -35,9 +35,8 @@ Data::Data(sf::Uint8 a_id, bool& a_bool, bool a_copieValue) : m_id(a_id), m_type
 {
 	if (a_copieValue)
 	{
-		bool* l_data = new bool();
-		*l_data = a_bool;
-		m_data = l_data;
+		m_value.m_bool = a_bool; // no allocation for a basic type
+		m_data = &m_value.m_bool;
 	}
 }
 
@@ -45,9 +44,8 @@ Data::Data(sf::Uint8 a_id, float& a_float, bool a_copieValue) : m_id(a_id), m_ty
 {
 	if (a_copieValue)
 	{
-		float* l_data = new float();
-		*l_data = a_float;
-		m_data = l_data;
+		m_value.m_float = a_float; // no allocation for a basic type
+		m_data = &m_value.m_float;
 	}
 }
 
@@ -55,9 +53,8 @@ Data::Data(sf::Uint8 a_id, double& a_double, bool a_copieValue) : m_id(a_id), m_
 {
 	if (a_copieValue)
 	{
-		double* l_data = new double();
-		*l_data = a_double;
-		m_data = l_data;
+		m_value.m_double = a_double; // no allocation for a basic type
+		m_data = &m_value.m_double;
 	}
 }
 
@@ -75,9 +72,8 @@ Data::Data(sf::Uint8 a_id, sf::Int32& a_int32, bool a_copieValue) : m_id(a_id),
 {
 	if (a_copieValue)
 	{
-		sf::Int32* l_data = new sf::Int32();
-		*l_data = a_int32;
-		m_data = l_data;
+		m_value.m_int32 = a_int32; // no allocation for a basic type
+		m_data = &m_value.m_int32;
 	}
 }
 
@@ -85,9 +81,8 @@ Data::Data(sf::Uint8 a_id, sf::Uint32& a_uint32, bool a_copieValue) : m_id(a_id)
 {
 	if (a_copieValue)
 	{
-		sf::Uint32* l_data = new sf::Uint32();
-		*l_data = a_uint32;
-		m_data = l_data;
+		m_value.m_uint32 = a_uint32; // no allocation for a basic type
+		m_data = &m_value.m_uint32;
 	}
 }
 
@@ -95,9 +90,8 @@ Data::Data(sf::Uint8 a_id, sf::Uint8& a_uint8, bool a_copieValue) : m_id(a_id),
 {
 	if (a_copieValue)
 	{
-		sf::Uint8* l_data = new sf::Uint8();
-		*l_data = a_uint8;
-		m_data = l_data;
+		m_value.m_uint8 = a_uint8; // no allocation for a basic type
+		m_data = &m_value.m_uint8;
 	}
 }
 
@@ -107,10 +101,8 @@ Data::Data(sf::Uint8 a_id, sf::Uint8& a_uint8, bool a_copieValue) : m_id(a_id),
 ////////////////////////////////////////////////////////////
 Data::~Data()
 {
-	
-	if (m_copied)
-		delete m_data;
-		
+	if (m_copied && m_type == DT_string) // the other copied values are stored in m_value
+		delete static_cast<std::string*>(m_data);
 }
 
 
@@ -253,16 +245,10 @@ Data::Data(const Data& other) : m_data(other.m_data), m_id(other.m_id), m_type(o
 {
 	if (m_copied)
 	{
-		switch (m_type)
-		{
-		case DT_bool:   m_data = new bool(); break;
-		case DT_double: m_data = new double(); break;
-		case DT_float:  m_data = new float(); break;
-		case DT_Int32:  m_data = new sf::Int32(); break;
-		case DT_string: m_data = new std::string(); break;
-		case DT_Uint32: m_data = new sf::Uint32(); break; 
-		case DT_Uint8:  m_data = new sf::Uint8(); break;
-		}
+		if (m_type == DT_string)
+			m_data = new std::string();
+		else
+			m_data = &m_value; // all the members of the union are at its address
 
 		OverrideData(other); // since the 'other' may be delete because of local scope, we need to keep an address still alive
 	}
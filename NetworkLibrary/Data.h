@@ -35,6 +35,9 @@ namespace Net
 /// The internal operation of this class is a bit tricky since
 /// the main data is a void pointer that can be copied
 ///
+/// A copied value of a basic type is stored inside the data
+/// itself, only the copied strings are allocated
+///
 ////////////////////////////////////////////////////////////
 class NET Data
 {
@@ -141,11 +144,27 @@ private :
 	////////////////////////////////////////////////////////////
 	static size_t GetTypeCode(DataType a_type);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Storage of a copied value of a basic type
+	///
+	////////////////////////////////////////////////////////////
+	union Value
+	{
+		bool m_bool;
+		float m_float;
+		double m_double;
+		sf::Int32 m_int32;
+		sf::Uint32 m_uint32;
+		sf::Uint8 m_uint8;
+	};
+
 
 	////////////////////////////////////////////////////////////
 	// Member data
 	////////////////////////////////////////////////////////////
 
+	Value m_value; ///< The copied value, if this data was created from a copie of a basic type
+
 	const bool m_copied; ///< Flag to know if this data was created from a copie (the m_data ptr will be automatically deleted)
 
 public: // public attributs because of const attributs
@@ -0,0 +1,281 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "FileCache.h"
+
+#include "InternalComm.h"
+#include "WorldHash.h"
+
+namespace Net
+{
+
+std::mutex FileCache::s_mutex; ///< Lock of the directory, the clients of the application can store their files at the same time
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the key of a version of a file
+///
+/// \param a_size the size of the file
+///
+/// \param a_hashes the hash of each chunk of the file
+///
+/// \return the key, the name of the entry in the cache
+///
+////////////////////////////////////////////////////////////
+std::string FileCache::GetKey(sf::Uint32 a_size, const std::vector<sf::Uint64>& a_hashes)
+{
+	sf::Uint64 l_hash = WorldHash::Hash(&a_size, sizeof(a_size));
+
+	if (!a_hashes.empty())
+		l_hash = WorldHash::Hash(a_hashes.data(), a_hashes.size() * sizeof(sf::Uint64), l_hash);
+
+	static const char l_digits[] = "0123456789abcdef";
+
+	std::string l_key(2 * sizeof(l_hash), '0'); // in hexadecimal, it is a valid file name
+
+	for (size_t i = l_key.size(); i > 0; i--)
+	{
+		l_key[i - 1] = l_digits[l_hash & 0x0F];
+
+		l_hash >>= 4;
+	}
+
+	return l_key;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Copy a file in the cache, nothing is done if the
+/// cache is disabled or already has this version
+///
+/// \param a_key the key of the content of the file
+///
+/// \param a_filePath the path of the file
+///
+////////////////////////////////////////////////////////////
+void FileCache::Store(const std::string& a_key, const std::string& a_filePath)
+{
+	std::string l_entry = GetEntryPath(a_key);
+
+	if (l_entry.empty())
+		return;
+
+	s_mutex.lock();
+
+	if (GetFileAttributesA(l_entry.c_str()) != INVALID_FILE_ATTRIBUTES) // the entries never change, a known key is up to date
+	{
+		Touch(l_entry);
+
+		s_mutex.unlock();
+
+		return;
+	}
+
+	CreateDirectoryA(InternalComm::GetFileCache().c_str(), NULL); // fails if it already exists
+
+	std::string l_temp = l_entry + FILE_CACHE_TEMP_SUFFIX;
+
+	if (!CopyFileA(a_filePath.c_str(), l_temp.c_str(), FALSE) || !MoveFileExA(l_temp.c_str(), l_entry.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileA(l_temp.c_str()); // the file will be stored after its next reception
+	}
+	else
+	{
+		Touch(l_entry); // the copy keeps the times of the received file
+
+		Evict(l_entry);
+	}
+
+	s_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Copy a version of a file from the cache, the
+/// current copy is replaced
+///
+/// \param a_key the key of the content of the file
+///
+/// \param a_filePath the path of the file
+///
+/// \return false if the cache does not have this version
+///
+////////////////////////////////////////////////////////////
+bool FileCache::Restore(const std::string& a_key, const std::string& a_filePath)
+{
+	std::string l_entry = GetEntryPath(a_key);
+
+	if (l_entry.empty())
+		return false;
+
+	s_mutex.lock(); // the entry is not evicted during the copy
+
+	bool l_isRestored = GetFileAttributesA(l_entry.c_str()) != INVALID_FILE_ATTRIBUTES && CopyFileA(l_entry.c_str(), a_filePath.c_str(), FALSE) != 0; // a copy, so the game can modify its file without changing the entry
+
+	if (l_isRestored)
+		Touch(l_entry);
+
+	s_mutex.unlock();
+
+	return l_isRestored;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove the copies that a previous run of the
+/// application did not finish, called when a client starts
+///
+////////////////////////////////////////////////////////////
+void FileCache::RemoveTemporaryFiles()
+{
+	const std::string& l_directory = InternalComm::GetFileCache();
+
+	if (l_directory.empty())
+		return;
+
+	s_mutex.lock();
+
+	WIN32_FIND_DATAA l_data;
+
+	HANDLE l_find = FindFirstFileA((l_directory + "\\*" + FILE_CACHE_TEMP_SUFFIX).c_str(), &l_data);
+
+	if (l_find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			DeleteFileA((l_directory + "\\" + l_data.cFileName).c_str()); // fails if another application is still copying it
+		}
+		while (FindNextFileA(l_find, &l_data));
+
+		FindClose(l_find);
+	}
+
+	s_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the path of an entry of the cache
+///
+/// \param a_key the key of the entry
+///
+/// \return the path, empty if the cache is disabled
+///
+////////////////////////////////////////////////////////////
+std::string FileCache::GetEntryPath(const std::string& a_key)
+{
+	const std::string& l_directory = InternalComm::GetFileCache();
+
+	if (l_directory.empty())
+		return std::string();
+
+	return l_directory + "\\" + a_key;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Mark an entry as used now, so it is removed after
+/// the entries used less recently
+///
+/// \param a_entry the path of the entry
+///
+////////////////////////////////////////////////////////////
+void FileCache::Touch(const std::string& a_entry)
+{
+	HANDLE l_file = CreateFileA(a_entry.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (l_file == INVALID_HANDLE_VALUE)
+		return;
+
+	FILETIME l_now;
+
+	GetSystemTimeAsFileTime(&l_now);
+
+	SetFileTime(l_file, NULL, &l_now, NULL); // set by hand, the system may not update the access times
+
+	CloseHandle(l_file);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove the entries used least recently until the
+/// cache fits in its budget
+///
+/// \param a_newEntry the path of the entry just stored, it is
+/// removed last
+///
+////////////////////////////////////////////////////////////
+void FileCache::Evict(const std::string& a_newEntry)
+{
+	sf::Uint64 l_budget = InternalComm::GetFileCacheBudget();
+
+	if (l_budget == 0)
+		return;
+
+	const std::string& l_directory = InternalComm::GetFileCache();
+
+	WIN32_FIND_DATAA l_data;
+
+	HANDLE l_find = FindFirstFileA((l_directory + "\\*").c_str(), &l_data);
+
+	if (l_find == INVALID_HANDLE_VALUE)
+		return;
+
+	std::vector<CachedEntry> l_entries;
+
+	CachedEntry l_newEntry;
+
+	sf::Uint64 l_total = 0;
+
+	do
+	{
+		std::string l_name(l_data.cFileName);
+
+		if ((l_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 || (l_name.size() > strlen(FILE_CACHE_TEMP_SUFFIX) && l_name.compare(l_name.size() - strlen(FILE_CACHE_TEMP_SUFFIX), std::string::npos, FILE_CACHE_TEMP_SUFFIX) == 0))
+			continue; // the copies in progress are not entries yet
+
+		CachedEntry l_entry;
+
+		l_entry.m_path = l_directory + "\\" + l_name;
+		l_entry.m_size = ((sf::Uint64)l_data.nFileSizeHigh << 32) | l_data.nFileSizeLow;
+		l_entry.m_accessTime = ((sf::Uint64)l_data.ftLastAccessTime.dwHighDateTime << 32) | l_data.ftLastAccessTime.dwLowDateTime;
+
+		l_total += l_entry.m_size;
+
+		if (l_entry.m_path == a_newEntry)
+			l_newEntry = l_entry;
+		else
+			l_entries.push_back(l_entry);
+	}
+	while (FindNextFileA(l_find, &l_data));
+
+	FindClose(l_find);
+
+	if (l_total <= l_budget)
+		return;
+
+	std::sort(l_entries.begin(), l_entries.end());
+
+	if (!l_newEntry.m_path.empty()) // a file larger than the whole budget is not kept either
+		l_entries.push_back(l_newEntry);
+
+	for (size_t i = 0; i < l_entries.size() && l_total > l_budget; i++)
+	{
+		if (DeleteFileA(l_entries[i].m_path.c_str())) // fails if another application is restoring it
+			l_total -= l_entries[i].m_size;
+	}
+}
+
+}
@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define FILE_CACHE_DIRECTORY "NetCache" // default directory of the cache of the received files
+
+#define FILE_CACHE_TEMP_SUFFIX ".tmp" // an entry is copied in this file, then renamed, so an interrupted copy is never used
+
+#define FILE_CACHE_BUDGET 1073741824 // default bytes of the cache, the entries used least recently are removed above it
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Cache of the received files, indexed
+/// by their content
+///
+/// The key of a file is a hash of its size and of the hashes
+/// of its chunks, so it is known from a manifest before any
+/// byte is received. The cache is shared by all the sessions
+/// and all the servers : a player that joins another server
+/// with the same map copies it from the cache instead of
+/// downloading it again. The entries are only copies, so the
+/// directory can be emptied at any time. Above its budget, the
+/// entries used least recently (by their last access time) are
+/// removed
+///
+////////////////////////////////////////////////////////////
+class NET FileCache
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the key of a version of a file
+	///
+	/// \param a_size the size of the file
+	///
+	/// \param a_hashes the hash of each chunk of the file
+	///
+	/// \return the key, the name of the entry in the cache
+	///
+	////////////////////////////////////////////////////////////
+	static std::string GetKey(sf::Uint32 a_size, const std::vector<sf::Uint64>& a_hashes);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy a file in the cache, nothing is done if the
+	/// cache is disabled or already has this version
+	///
+	/// \param a_key the key of the content of the file
+	///
+	/// \param a_filePath the path of the file
+	///
+	////////////////////////////////////////////////////////////
+	static void Store(const std::string& a_key, const std::string& a_filePath);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy a version of a file from the cache, the
+	/// current copy is replaced
+	///
+	/// \param a_key the key of the content of the file
+	///
+	/// \param a_filePath the path of the file
+	///
+	/// \return false if the cache does not have this version
+	///
+	////////////////////////////////////////////////////////////
+	static bool Restore(const std::string& a_key, const std::string& a_filePath);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove the copies that a previous run of the
+	/// application did not finish, called when a client starts
+	///
+	////////////////////////////////////////////////////////////
+	static void RemoveTemporaryFiles();
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief An entry found in the directory of the cache
+	///
+	////////////////////////////////////////////////////////////
+	struct CachedEntry
+	{
+		std::string m_path;       ///< The path of the entry
+		sf::Uint64 m_size;        ///< The size of the entry in bytes
+		sf::Uint64 m_accessTime;  ///< The last access to the entry (FILETIME)
+
+		////////////////////////////////////////////////////////////
+		/// \brief Order the entries from the least recently used
+		///
+		////////////////////////////////////////////////////////////
+		bool operator<(const CachedEntry& a_other) const { return m_accessTime < a_other.m_accessTime; }
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the path of an entry of the cache
+	///
+	/// \param a_key the key of the entry
+	///
+	/// \return the path, empty if the cache is disabled
+	///
+	////////////////////////////////////////////////////////////
+	static std::string GetEntryPath(const std::string& a_key);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Mark an entry as used now, so it is removed after
+	/// the entries used less recently
+	///
+	/// \param a_entry the path of the entry
+	///
+	////////////////////////////////////////////////////////////
+	static void Touch(const std::string& a_entry);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove the entries used least recently until the
+	/// cache fits in its budget
+	///
+	/// \param a_newEntry the path of the entry just stored, it is
+	/// removed last
+	///
+	////////////////////////////////////////////////////////////
+	static void Evict(const std::string& a_newEntry);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	static std::mutex s_mutex; ///< Lock of the directory, the clients of the application can store their files at the same time
+};
+
+}
@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#include "stdafx.h"
+#include "FileManifest.h"
+
+#include "InternalComm.h"
+#include "WorldHash.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Write the manifest of a file in a packet, its
+/// hashes are computed if they are not known yet
+///
+/// \param a_packet the packet where the manifest is written
+///
+/// \param a_filePath the path of the file
+///
+/// \return false if the file can not be read, nothing is written
+///
+////////////////////////////////////////////////////////////
+bool FileManifest::WriteEntry(PacketBuffer& a_packet, const std::string& a_filePath)
+{
+	m_mutex.lock();
+
+	Entry* l_entry = FindEntry(a_filePath);
+
+	if (l_entry == NULL)
+	{
+		m_mutex.unlock();
+		return false;
+	}
+
+	a_packet << a_filePath << l_entry->m_size;
+
+	InternalComm::WriteVarint(a_packet, (sf::Uint32)l_entry->m_hashes.size());
+
+	for (sf::Uint64 hash : l_entry->m_hashes)
+	{
+		a_packet << hash;
+	}
+
+	m_mutex.unlock();
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the number of chunks of a file, its hashes are
+/// computed if they are not known yet
+///
+/// \param a_filePath the path of the file
+///
+/// \return the number of chunks, 0 if the file can not be read
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 FileManifest::GetNumberChunks(const std::string& a_filePath)
+{
+	m_mutex.lock();
+
+	Entry* l_entry = FindEntry(a_filePath);
+
+	sf::Uint32 l_numberChunks = l_entry != NULL ? (sf::Uint32)l_entry->m_hashes.size() : 0;
+
+	m_mutex.unlock();
+
+	return l_numberChunks;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Indicate that a file was changed, its hashes will
+/// be computed again
+///
+/// \param a_filePath the path of the file
+///
+////////////////////////////////////////////////////////////
+void FileManifest::Invalidate(const std::string& a_filePath)
+{
+	m_mutex.lock();
+
+	m_entries.erase(a_filePath);
+
+	m_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read a file and hash each chunk of FILE_CHUNK_SIZE
+/// bytes
+///
+/// \param a_filePath the path of the file
+///
+/// \param a_size receives the size of the file
+///
+/// \param a_hashes receives the hash of each chunk
+///
+/// \return false if the file can not be read
+///
+////////////////////////////////////////////////////////////
+bool FileManifest::ComputeChunks(const std::string& a_filePath, sf::Uint32& a_size, std::vector<sf::Uint64>& a_hashes)
+{
+	a_size = 0;
+	a_hashes.clear();
+
+	std::ifstream l_file(a_filePath, std::ios::in | std::ios::binary);
+
+	if (!l_file)
+		return false;
+
+	std::vector<char> l_chunk(FILE_CHUNK_SIZE);
+
+	while (l_file.read(l_chunk.data(), FILE_CHUNK_SIZE) || l_file.gcount() > 0) // the last chunk is shorter
+	{
+		size_t l_read = (size_t)l_file.gcount();
+
+		a_hashes.push_back(WorldHash::Hash(l_chunk.data(), l_read));
+
+		a_size += (sf::Uint32)l_read;
+	}
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read the hashes of the chunks already received
+/// from the parts file of an interrupted transfert, a
+/// missing chunk has the hash 0
+///
+/// \param a_filePath the path of the received file
+///
+/// \param a_size receives the size of the file
+///
+/// \param a_hashes receives the hash of each chunk
+///
+/// \return false if there is no valid parts file
+///
+////////////////////////////////////////////////////////////
+bool FileManifest::ReadParts(const std::string& a_filePath, sf::Uint32& a_size, std::vector<sf::Uint64>& a_hashes)
+{
+	a_size = 0;
+	a_hashes.clear();
+
+	std::ifstream l_file(a_filePath + FILE_PARTS_SUFFIX, std::ios::in | std::ios::binary);
+
+	if (!l_file || !l_file.read(reinterpret_cast<char*>(&a_size), sizeof(a_size)))
+		return false;
+
+	a_hashes.resize((a_size + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE);
+
+	if (!a_hashes.empty() && !l_file.read(reinterpret_cast<char*>(a_hashes.data()), a_hashes.size() * sizeof(sf::Uint64)))
+	{
+		a_hashes.clear(); // the transfert was interrupted while the parts file was written
+
+		return false;
+	}
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Compare the manifest of a file with the chunks of
+/// our copy
+///
+/// \param a_hashes the hashes of the manifest
+///
+/// \param a_localHashes the hashes of our copy
+///
+/// \param a_known receives the hash of each chunk that we
+/// already have, 0 for the others
+///
+/// \param a_missing receives the indexes of the chunks that
+/// we do not have
+///
+////////////////////////////////////////////////////////////
+void FileManifest::CompareChunks(const std::vector<sf::Uint64>& a_hashes, const std::vector<sf::Uint64>& a_localHashes, std::vector<sf::Uint64>& a_known, std::vector<sf::Uint32>& a_missing)
+{
+	a_missing.clear();
+
+	a_known.assign(a_hashes.size(), 0);
+
+	for (sf::Uint32 i = 0; i < a_hashes.size(); i++)
+	{
+		if (i >= a_localHashes.size() || a_localHashes[i] != a_hashes[i])
+			a_missing.push_back(i);
+		else
+			a_known[i] = a_hashes[i];
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read a file and compute the signature of each
+/// complete block of FILE_DELTA_BLOCK bytes
+///
+/// \param a_filePath the path of the file
+///
+/// \param a_blocks receives the signature of each block
+///
+/// \return false if the file can not be read
+///
+////////////////////////////////////////////////////////////
+bool FileManifest::ComputeBlocks(const std::string& a_filePath, std::vector<BlockSignature>& a_blocks)
+{
+	a_blocks.clear();
+
+	std::ifstream l_file(a_filePath, std::ios::in | std::ios::binary);
+
+	if (!l_file)
+		return false;
+
+	std::vector<char> l_block(FILE_DELTA_BLOCK);
+
+	while (l_file.read(l_block.data(), FILE_DELTA_BLOCK)) // the last incomplete block is never reused, it is sent again
+	{
+		BlockSignature l_signature;
+
+		l_signature.m_weak = RollingChecksum(l_block.data(), FILE_DELTA_BLOCK);
+		l_signature.m_strong = WorldHash::Hash(l_block.data(), FILE_DELTA_BLOCK);
+
+		a_blocks.push_back(l_signature);
+	}
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Compute the rolling checksum of some bytes (the
+/// sum of the bytes in the low 16 bits, the sum of the
+/// partial sums in the high 16 bits)
+///
+/// \param a_data the bytes
+///
+/// \param a_size the number of bytes
+///
+/// \return the checksum
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 FileManifest::RollingChecksum(const char* a_data, size_t a_size)
+{
+	const sf::Uint8* l_bytes = reinterpret_cast<const sf::Uint8*>(a_data);
+
+	sf::Uint32 l_sum = 0;
+	sf::Uint32 l_weightedSum = 0;
+
+	for (size_t i = 0; i < a_size; i++)
+	{
+		l_sum += l_bytes[i];
+		l_weightedSum += (sf::Uint32)(a_size - i) * l_bytes[i];
+	}
+
+	return (l_sum & 0xFFFF) | (l_weightedSum << 16);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Find the manifest of a file, it is computed if it
+/// is not known yet. The mutex must be locked
+///
+/// \param a_filePath the path of the file
+///
+/// \return the manifest, NULL if the file can not be read
+///
+////////////////////////////////////////////////////////////
+FileManifest::Entry* FileManifest::FindEntry(const std::string& a_filePath)
+{
+	std::unordered_map<std::string, Entry>::iterator l_entry = m_entries.find(a_filePath);
+
+	if (l_entry == m_entries.end())
+	{
+		Entry l_new;
+
+		if (!ComputeChunks(a_filePath, l_new.m_size, l_new.m_hashes))
+			return NULL;
+
+		l_entry = m_entries.insert(std::make_pair(a_filePath, l_new)).first;
+	}
+
+	return &l_entry->second;
+}
+
+}
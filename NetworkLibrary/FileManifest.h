@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+#include "PacketBuffer.h"
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief The checksums of a block of FILE_DELTA_BLOCK bytes
+/// of the copy of a client, for a delta transfert
+///
+////////////////////////////////////////////////////////////
+struct BlockSignature
+{
+	sf::Uint32 m_weak;   ///< The rolling checksum, cheap to slide byte by byte over the new file
+	sf::Uint64 m_strong; ///< The FNV-1a hash, only compared when the rolling checksum matches
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] The size and the hashes of the chunks
+/// of the syncronized files
+///
+/// A client compares the manifest of a file with its own copy
+/// and asks only the chunks that differ. The hashes of a file
+/// are computed once, until the file is invalidated
+///
+////////////////////////////////////////////////////////////
+class NET FileManifest
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write the manifest of a file in a packet, its
+	/// hashes are computed if they are not known yet
+	///
+	/// \param a_packet the packet where the manifest is written
+	///
+	/// \param a_filePath the path of the file
+	///
+	/// \return false if the file can not be read, nothing is written
+	///
+	////////////////////////////////////////////////////////////
+	bool WriteEntry(PacketBuffer& a_packet, const std::string& a_filePath);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of chunks of a file, its hashes are
+	/// computed if they are not known yet
+	///
+	/// \param a_filePath the path of the file
+	///
+	/// \return the number of chunks, 0 if the file can not be read
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint32 GetNumberChunks(const std::string& a_filePath);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Indicate that a file was changed, its hashes will
+	/// be computed again
+	///
+	/// \param a_filePath the path of the file
+	///
+	////////////////////////////////////////////////////////////
+	void Invalidate(const std::string& a_filePath);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read a file and hash each chunk of FILE_CHUNK_SIZE
+	/// bytes
+	///
+	/// \param a_filePath the path of the file
+	///
+	/// \param a_size receives the size of the file
+	///
+	/// \param a_hashes receives the hash of each chunk
+	///
+	/// \return false if the file can not be read
+	///
+	////////////////////////////////////////////////////////////
+	static bool ComputeChunks(const std::string& a_filePath, sf::Uint32& a_size, std::vector<sf::Uint64>& a_hashes);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read the hashes of the chunks already received
+	/// from the parts file of an interrupted transfert, a
+	/// missing chunk has the hash 0
+	///
+	/// \param a_filePath the path of the received file
+	///
+	/// \param a_size receives the size of the file
+	///
+	/// \param a_hashes receives the hash of each chunk
+	///
+	/// \return false if there is no valid parts file
+	///
+	////////////////////////////////////////////////////////////
+	static bool ReadParts(const std::string& a_filePath, sf::Uint32& a_size, std::vector<sf::Uint64>& a_hashes);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Compare the manifest of a file with the chunks of
+	/// our copy
+	///
+	/// \param a_hashes the hashes of the manifest
+	///
+	/// \param a_localHashes the hashes of our copy
+	///
+	/// \param a_known receives the hash of each chunk that we
+	/// already have, 0 for the others
+	///
+	/// \param a_missing receives the indexes of the chunks that
+	/// we do not have
+	///
+	////////////////////////////////////////////////////////////
+	static void CompareChunks(const std::vector<sf::Uint64>& a_hashes, const std::vector<sf::Uint64>& a_localHashes, std::vector<sf::Uint64>& a_known, std::vector<sf::Uint32>& a_missing);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read a file and compute the signature of each
+	/// complete block of FILE_DELTA_BLOCK bytes
+	///
+	/// \param a_filePath the path of the file
+	///
+	/// \param a_blocks receives the signature of each block
+	///
+	/// \return false if the file can not be read
+	///
+	////////////////////////////////////////////////////////////
+	static bool ComputeBlocks(const std::string& a_filePath, std::vector<BlockSignature>& a_blocks);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Compute the rolling checksum of some bytes (the
+	/// sum of the bytes in the low 16 bits, the sum of the
+	/// partial sums in the high 16 bits)
+	///
+	/// \param a_data the bytes
+	///
+	/// \param a_size the number of bytes
+	///
+	/// \return the checksum
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint32 RollingChecksum(const char* a_data, size_t a_size);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief The manifest of one file
+	///
+	////////////////////////////////////////////////////////////
+	struct Entry
+	{
+		sf::Uint32 m_size;                 ///< The size of the file
+		std::vector<sf::Uint64> m_hashes;  ///< The hash of each chunk
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief Find the manifest of a file, it is computed if it
+	/// is not known yet. The mutex must be locked
+	///
+	/// \param a_filePath the path of the file
+	///
+	/// \return the manifest, NULL if the file can not be read
+	///
+	////////////////////////////////////////////////////////////
+	Entry* FindEntry(const std::string& a_filePath);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::unordered_map<std::string, Entry> m_entries; ///< The manifests already computed, indexed by path
+
+	std::mutex m_mutex; ///< The files can be invalidated from the game thread
+};
+
+}
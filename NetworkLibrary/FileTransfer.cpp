@@ -15,237 +15,1180 @@
 #include "stdafx.h"
 #include "FileTransfer.h"
 
+#include "WorldHash.h"
+#include "TransfertScheduler.h"
+#include "Compression.h"
+#include "FileCache.h"
+
 namespace Net
 {
 
 ////////////////////////////////////////////////////////////
-/// \brief Start a new file transfert
-///
-/// \param a_fileName The name of the file to send
+/// \brief Start a new file transfert
+///
+/// \param a_fileName The name of the file to send
+///
+/// \param a_senderEntity The client that send the file
+///
+////////////////////////////////////////////////////////////
+FileTransfer::FileTransfer(const std::string& a_fileName, Client* a_senderEntity) : m_fileName(a_fileName)
+{
+	m_client = a_senderEntity;
+	m_server = NULL;
+	m_receiver = NULL;
+
+	Init();
+
+	StartSending();
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Start a new file transfert
+///
+/// \param a_fileName The name of the file to send
+///
+/// \param a_senderEntity The server that send the file
+///
+/// \param a_receiver Optionaly, we can specify a connection
+/// where to send the file. If NULL everyone will receive
+///
+////////////////////////////////////////////////////////////
+FileTransfer::FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver) : m_fileName(a_fileName)
+{
+	m_client = NULL;
+	m_server = a_senderEntity;
+	m_receiver = a_receiver;
+
+	Init();
+
+	StartSending();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send only some chunks of a file to a client that
+/// already knows the file from its manifest
+///
+/// \param a_fileName The name of the file to send
+///
+/// \param a_senderEntity The server that send the file
+///
+/// \param a_receiver The connection where to send the chunks
+///
+/// \param a_chunks The indexes of the chunks to send
+///
+////////////////////////////////////////////////////////////
+FileTransfer::FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver, const std::vector<sf::Uint32>& a_chunks) : m_fileName(a_fileName)
+{
+	m_client = NULL;
+	m_server = a_senderEntity;
+	m_receiver = a_receiver;
+
+	Init();
+
+	m_isAnnounced = true;
+	m_chunks = a_chunks;
+
+	StartSending();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send a new version of a file as a delta against
+/// the copy of a client, the blocks found in this copy are
+/// not sent again
+///
+/// \param a_fileName The name of the file to send
+///
+/// \param a_senderEntity The server that send the file
+///
+/// \param a_receiver The connection where to send the delta
+///
+/// \param a_blocks The signatures of the blocks of the copy
+/// of the receiver
+///
+////////////////////////////////////////////////////////////
+FileTransfer::FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver, const std::vector<BlockSignature>& a_blocks) : m_fileName(a_fileName)
+{
+	m_client = NULL;
+	m_server = a_senderEntity;
+	m_receiver = a_receiver;
+
+	Init();
+
+	m_isDelta = true;
+	m_blocks = a_blocks;
+
+	StartSending();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief This constructor is for receiving file, the
+/// existing content of the file is kept
+///
+/// \param a_fileName The name of the file to send
+///
+/// \param a_fileSize The expetected size of the file
+///
+/// \param a_chunkHashes The hashes of the chunks that we
+/// already have, 0 (or no hash) for the chunks that will be
+/// received
+///
+/// \param a_isDelta true if the file is received as a delta,
+/// it is then built aside and replaces the current copy at
+/// the end (a_chunkHashes is not used)
+///
+////////////////////////////////////////////////////////////
+FileTransfer::FileTransfer(const std::string& a_fileName, int a_fileSize, const std::vector<sf::Uint64>& a_chunkHashes, bool a_isDelta) : m_fileName(a_fileName)
+{
+	m_client = NULL;
+	m_server = NULL;
+	m_receiver = NULL;
+
+	Init();
+
+	m_totalBits = a_fileSize;
+	m_isDelta = a_isDelta;
+
+	if (m_isDelta)
+	{
+		m_expectedBits = a_fileSize; // every byte is either copied from our copy or received
+
+		if (!OpenView(m_fileName, false, m_sourceBits, m_sourceHandle, m_sourceMapping, m_sourceView))
+		{
+			CloseView(m_sourceHandle, m_sourceMapping, m_sourceView); // no current copy, every block will be a literal
+
+			m_sourceBits = 0;
+		}
+	}
+	else
+	{
+		m_chunkHashes = a_chunkHashes;
+		m_chunkHashes.resize((a_fileSize + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE, 0); // the chunks without hash are missing
+
+		for (sf::Uint32 i = 0; i < m_chunkHashes.size(); i++)
+		{
+			if (m_chunkHashes[i] == 0)
+				m_expectedBits += GetChunkSize(i, a_fileSize);
+		}
+	}
+
+	if (!MapFile(true))
+		FailReception();
+	else if (m_expectedBits == 0) // no part will be sent, the file only had to be resized
+		CompleteReception();
+	else if (!m_isDelta)
+		SaveParts();
+}
+
+////////////////////////////////////////////////////////////
+/// \brief init commun variables for file transfert
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::Init()
+{
+	m_completion = 0.0f;
+	m_hasFailed = false;
+	m_isCanceled = false;
+	m_isComplete = false;
+	m_sendedBits = 0;
+	m_totalBits = 0;
+	m_expectedBits = 0;
+	m_ackedBits = 0;
+	m_inFlight = 0;
+	m_isSent = false;
+	m_isTransfering = false;
+	m_isStarted = false;
+	m_isAnnounced = false;
+	m_nextChunk = 0;
+	m_fileHandle = NULL;
+	m_mapping = NULL;
+	m_view = NULL;
+	m_isShared = false;
+	m_isDelta = false;
+	m_nextRange = 0;
+	m_rangePosition = 0;
+	m_scanPosition = 0;
+	m_scanLiteral = 0;
+	m_scanSum = 0;
+	m_scanWeightedSum = 0;
+	m_isScanRolling = false;
+	m_isScanned = false;
+	m_sourceHandle = NULL;
+	m_sourceMapping = NULL;
+	m_sourceView = NULL;
+	m_sourceBits = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Map the file in memory, the parts are copied
+/// directly between the mapped file and the packets
+///
+/// \param a_isWriting true to create the received file with
+/// the expected size, false to read the file to send and get
+/// its size (this mapping is shared by all the senders)
+///
+/// \return false if the file can not be opened or mapped
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::MapFile(bool a_isWriting)
+{
+	if (!a_isWriting) // the file is mapped once for all its receivers
+	{
+		m_isShared = TransfertScheduler::AcquireFile(m_fileName, m_view, m_totalBits);
+
+		return m_isShared;
+	}
+
+	// a delta is built aside, the current copy is still read until the end of the transfert
+	const std::string l_path = (a_isWriting && m_isDelta) ? m_fileName + FILE_DELTA_SUFFIX : m_fileName;
+
+	return OpenView(l_path, a_isWriting, m_totalBits, m_fileHandle, m_mapping, m_view);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Release the mappings and close the files (with the
+/// parts file), nothing happens if they are not opened
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::UnmapFile()
+{
+	if (m_isShared)
+	{
+		TransfertScheduler::ReleaseFile(m_fileName);
+
+		m_view = NULL;
+		m_isShared = false;
+	}
+	else
+	{
+		CloseView(m_fileHandle, m_mapping, m_view); // the system writes the received pages in the file
+	}
+
+	CloseView(m_sourceHandle, m_sourceMapping, m_sourceView);
+
+	if (m_partsFile.is_open())
+		m_partsFile.close();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Open a file and map it in memory
+///
+/// \param a_path the path of the file
+///
+/// \param a_isWriting true to resize the file to a_size and
+/// map it for writing, false to map it for reading and get
+/// its size in a_size
+///
+/// \param a_size the size of the file
+///
+/// \param a_file receives the opened file
+///
+/// \param a_mapping receives the mapping
+///
+/// \param a_view receives the content, NULL for an empty file
+///
+/// \return false if the file can not be opened or mapped,
+/// what was opened must still be released by CloseView
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::OpenView(const std::string& a_path, bool a_isWriting, int& a_size, HANDLE& a_file, HANDLE& a_mapping, char*& a_view)
+{
+	if (a_isWriting) // the chunks that are not sent are already in the existing file
+		a_file = CreateFileA(a_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	else // the game can still write a new version of the file (a save), it calls ResyncronizeFile after
+		a_file = CreateFileA(a_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (a_file == INVALID_HANDLE_VALUE)
+	{
+		a_file = NULL;
+		return false;
+	}
+
+	LARGE_INTEGER l_size;
+
+	if (a_isWriting)
+	{
+		l_size.QuadPart = a_size;
+
+		if (!SetFilePointerEx(a_file, l_size, NULL, FILE_BEGIN) || !SetEndOfFile(a_file)) // the previous version may be longer
+			return false;
+	}
+	else
+	{
+		if (!GetFileSizeEx(a_file, &l_size) || l_size.QuadPart > 0x7FFFFFFF) // the sizes are sent on 32 bits
+			return false;
+
+		a_size = (int)l_size.QuadPart;
+	}
+
+	if (a_size == 0) // an empty file can not be mapped, and there is nothing to copy
+		return true;
+
+	a_mapping = CreateFileMappingA(a_file, NULL, a_isWriting ? PAGE_READWRITE : PAGE_READONLY, 0, (DWORD)a_size, NULL);
+
+	if (a_mapping == NULL)
+		return false;
+
+	a_view = static_cast<char*>(MapViewOfFile(a_mapping, a_isWriting ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+
+	return a_view != NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Release a view opened by OpenView
+///
+/// \param a_file the opened file
+///
+/// \param a_mapping the mapping
+///
+/// \param a_view the content
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::CloseView(HANDLE& a_file, HANDLE& a_mapping, char*& a_view)
+{
+	if (a_view != NULL)
+		UnmapViewOfFile(a_view);
+
+	if (a_mapping != NULL)
+		CloseHandle(a_mapping);
+
+	if (a_file != NULL)
+		CloseHandle(a_file);
+
+	a_view = NULL;
+	a_mapping = NULL;
+	a_file = NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Start the sending, the parts are sent by the
+/// transfert scheduler
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::StartSending()
+{
+	m_isTransfering = true;
+
+	TransfertScheduler::Add(this);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the receivers have read the previous parts,
+/// so the next one can be sent
+///
+/// \return false if the send queue of a receiver is full
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::IsReadyToSend() const
+{
+	if (m_server == NULL) // a client only sends to its server, its own socket paces the parts
+		return true;
+
+	if (IsWindowed() && m_inFlight >= FILE_PARTS_IN_FLIGHT) // wait for an acknowledgement
+		return false;
+
+	return m_server->CanSendFilePart(m_receiver); // without receiver, the part waits for every client
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the parts are acknowledged by the receiver
+/// (a server sending to one client)
+///
+/// \return true if the parts in flight are limited
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::IsWindowed() const
+{
+	return m_server != NULL && m_receiver != NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send a part that makes the reading fail, so the
+/// transfert is canceled at the other side
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::SendFailure()
+{
+	PacketBuffer l_packet;
+
+	l_packet << (sf::Uint16)CT_File << false << m_fileName << true;
+
+	SendPacket(l_packet, m_receiver);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write a part of the file in a packet, compressed
+/// if the receiver accepts it and if it shrinks
+///
+/// \param a_packet the packet, after the name of the file
+///
+/// \param a_offset the position of the part in the file
+///
+/// \param a_size the size of the part
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::WritePart(PacketBuffer& a_packet, sf::Uint32 a_offset, sf::Uint32 a_size)
+{
+	a_packet << a_offset << a_size;
+
+	if (m_server != NULL && m_receiver != NULL && m_receiver->m_isCompressed) // the frames sent to everyone are not compressed
+	{
+		sf::Uint32 l_chunk = a_offset / FILE_CHUNK_SIZE;
+
+		const char* l_data = NULL;
+
+		sf::Uint32 l_size = 0;
+
+		if (m_isShared && a_offset % FILE_CHUNK_SIZE == 0 && (int)a_size == GetChunkSize(l_chunk, m_totalBits)) // a whole chunk is compressed once for all the receivers
+		{
+			if (TransfertScheduler::GetCompressedChunk(m_fileName, l_chunk, l_data, l_size))
+			{
+				a_packet << l_size;
+				a_packet.Append(l_data, l_size);
+
+				return;
+			}
+		}
+		else if (a_size > 1)
+		{
+			m_compressed.resize(a_size - 1); // only a compression that shrinks is sent
+
+			l_size = (sf::Uint32)Compression::Compress(m_view + a_offset, a_size, m_compressed.data(), m_compressed.size());
+
+			if (l_size != 0)
+			{
+				a_packet << l_size;
+				a_packet.Append(m_compressed.data(), l_size);
+
+				return;
+			}
+		}
+	}
+
+	a_packet << a_size; // stored as it is
+
+	a_packet.Append(m_view + a_offset, a_size);
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor of the file transfert, it end the thread
+///
+////////////////////////////////////////////////////////////
+FileTransfer::~FileTransfer()
+{
+	StopTransfert();
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief Must be called when this transfert receive a
+/// new packet full of data to add to the file
+///
+/// \param a_packet the packet full of data
+///
+/// \param a_offset receives the position of the part
+///
+/// \param a_size receives the size of the part
+///
+/// \return true if the part is in the file, so it can be
+/// acknowledged
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::ReceivePacket(sf::Packet& a_packet, sf::Uint32& a_offset, sf::Uint32& a_size)
+{
+	if (m_hasFailed || m_isComplete)
+		return false;
+
+	bool l_hasFailed = false;
+
+	sf::Uint32 l_offset;
+
+	sf::Uint32 l_size;
+
+	if (!(a_packet >> l_hasFailed) || l_hasFailed)
+	{
+		m_isCanceled = l_hasFailed; // a packet that can not be read is our failure
+
+		FailReception();
+
+		return false;
+	}
+
+	if (!(a_packet >> l_offset >> l_size) || (sf::Uint64)l_offset + l_size > (sf::Uint64)m_totalBits)
+	{
+		FailReception(); // this part does not match the announced file
+
+		return false;
+	}
+
+	sf::Uint32 l_storedSize;
+
+	if (!(a_packet >> l_storedSize) || l_storedSize > l_size || l_storedSize > a_packet.getDataSize())
+	{
+		FailReception();
+
+		return false;
+	}
+
+	sf::Uint32 l_chunk = l_offset / FILE_CHUNK_SIZE;
+
+	if (!m_isDelta) // outside of a delta, the parts are whole chunks
+	{
+		if (l_offset % FILE_CHUNK_SIZE != 0 || (int)l_size != GetChunkSize(l_chunk, m_totalBits))
+		{
+			FailReception();
+
+			return false;
+		}
+
+		a_offset = l_offset;
+		a_size = l_size;
+
+		if (m_chunkHashes[l_chunk] != 0) // already received before a resume, acknowledged again but not counted
+			return true;
+	}
+
+	// the bytes are at the end of the packet, they are copied (or decompressed) once in the mapped file
+	const char* l_data = static_cast<const char*>(a_packet.getData()) + a_packet.getDataSize() - l_storedSize;
+
+	if (l_storedSize == l_size)
+	{
+		std::memcpy(m_view + l_offset, l_data, l_size);
+	}
+	else if (!Compression::Decompress(l_data, l_storedSize, m_view + l_offset, l_size))
+	{
+		FailReception();
+
+		return false;
+	}
+
+	if (!m_isDelta)
+	{
+		m_chunkHashes[l_chunk] = WorldHash::Hash(m_view + l_offset, l_size);
+
+		SaveChunk(l_chunk);
+	}
+
+	a_offset = l_offset;
+	a_size = l_size;
+
+	ReceiveBits(l_size);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Sending to one client] Must be called when the
+/// receiver acknowledges a part of the file
+///
+/// \param a_bits the size of the part
+///
+/// \return false if this transfert was not waiting for an
+/// acknowledgement
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::Acknowledge(int a_bits)
+{
+	if (!IsWindowed() || m_isComplete || m_hasFailed || m_inFlight <= 0)
+		return false;
+
+	m_inFlight--;
+
+	m_ackClock.restart();
+
+	m_ackedBits += a_bits;
+
+	m_completion = ((float)m_ackedBits / m_expectedBits) * 100.0f;
+
+	if (m_isSent && m_ackedBits >= m_expectedBits) // the sending can also end after the last acknowledgement
+	{
+		m_completion = 100.0f;
+		m_isComplete = true;
+	}
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Sending to one client] Know if the receiver has
+/// not acknowledged any part in flight for FILE_ACK_TIMEOUT
+/// ms. Must be called regularly by the thread that calls
+/// Acknowledge
+///
+/// \return true if the transfert must be stopped
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::HasTimedOut()
+{
+	if (!IsWindowed() || m_isComplete || m_hasFailed || m_inFlight <= 0)
+	{
+		m_ackClock.restart(); // nothing is waited, the delay starts with the next part in flight
+
+		return false;
+	}
+
+	return m_ackClock.getElapsedTime().asMilliseconds() >= FILE_ACK_TIMEOUT;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Receiving] Know if the sender has canceled the
+/// transfert, else a failure comes from our side and the
+/// sender must be told
+///
+/// \return true if the sender has sent a failed part
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::IsCanceled() const
+{
+	return m_isCanceled;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Must be called when this transfert receive a
+/// packet of blocks to copy from the current version of the
+/// file (delta transfert)
 ///
-/// \param a_senderEntity The client that send the file
+/// \param a_packet the packet with the list of blocks
 ///
 ////////////////////////////////////////////////////////////
-FileTransfer::FileTransfer(const std::string& a_fileName, Client* a_senderEntity) : m_fileName(a_fileName)
+void FileTransfer::ReceiveBlocks(sf::Packet& a_packet)
 {
-	m_client = a_senderEntity;
-	m_server = NULL;
-	m_receiver = NULL;
+	if (m_hasFailed || m_isComplete)
+		return;
 
-	Init();
+	sf::Uint32 l_offset;
+
+	sf::Uint32 l_sourceOffset;
+
+	sf::Uint32 l_size;
+
+	while (!m_isComplete && a_packet >> l_offset >> l_sourceOffset >> l_size) // until the end of the packet
+	{
+		if (!m_isDelta || (sf::Uint64)l_offset + l_size > (sf::Uint64)m_totalBits || (sf::Uint64)l_sourceOffset + l_size > (sf::Uint64)m_sourceBits)
+		{
+			FailReception(); // the blocks do not match our copy, it has changed since the signatures
+
+			return;
+		}
+
+		std::memcpy(m_view + l_offset, m_sourceView + l_sourceOffset, l_size);
 
-	m_thread = std::thread(TransfertThread, this);
+		ReceiveBits(l_size);
+	}
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief Start a new file transfert
-///
-/// \param a_fileName The name of the file to send
-///
-/// \param a_senderEntity The server that send the file
+/// \brief Count received bytes and end the reception when
+/// the whole file is there
 ///
-/// \param a_receiver Optionaly, we can specify a connection
-/// where to send the file. If NULL everyone will receive
+/// \param a_bits the number of bytes written in the file
 ///
 ////////////////////////////////////////////////////////////
-FileTransfer::FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver) : m_fileName(a_fileName)
+void FileTransfer::ReceiveBits(int a_bits)
 {
-	m_client = NULL;
-	m_server = a_senderEntity;
-	m_receiver = a_receiver;
+	m_sendedBits += a_bits;
 
-	Init();
+	m_completion = ((float)m_sendedBits / m_expectedBits) * 100.0f;
 
-	m_thread = std::thread(TransfertThread, this);
+	if (m_sendedBits >= m_expectedBits)
+		CompleteReception();
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief This constructor is for receiving file
-///
-/// \param a_fileName The name of the file to send
-///
-/// \param a_fileSize The expetected size of the file
+/// \brief Close the received file, and in a delta transfert
+/// replace the current copy by the new version
 ///
 ////////////////////////////////////////////////////////////
-FileTransfer::FileTransfer(const std::string& a_fileName, int a_fileSize) : m_fileName(a_fileName)
+void FileTransfer::CompleteReception()
 {
-	m_client = NULL;
-	m_server = NULL;
-	m_receiver = NULL;
+	UnmapFile(); // the current copy must be closed before being replaced
 
-	Init();
+	if (!m_isDelta)
+		DeleteFileA((m_fileName + FILE_PARTS_SUFFIX).c_str()); // nothing to resume anymore
 
-	m_totalBits = a_fileSize;
+	if (m_isDelta && !MoveFileExA((m_fileName + FILE_DELTA_SUFFIX).c_str(), m_fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		FailReception();
 
-	m_file = std::ofstream(m_fileName, std::ios::out | std::ios::binary);
+		return;
+	}
 
-	if (!m_file)
-		m_hasFailed = true;
+	if (!m_isDelta) // the hashes of all the chunks are known
+	{
+		FileCache::Store(FileCache::GetKey((sf::Uint32)m_totalBits, m_chunkHashes), m_fileName);
+	}
+	else if (!InternalComm::GetFileCache().empty())
+	{
+		sf::Uint32 l_size;
+
+		std::vector<sf::Uint64> l_hashes;
+
+		if (FileManifest::ComputeChunks(m_fileName, l_size, l_hashes))
+			FileCache::Store(FileCache::GetKey(l_size, l_hashes), m_fileName);
+	}
+
+	m_completion = 100.0f;
+	m_isComplete = true;
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief init commun variables for file transfert
+/// \brief Stop the reception after an error, the partial new
+/// version of a delta transfert is removed
 ///
 ////////////////////////////////////////////////////////////
-void FileTransfer::Init()
+void FileTransfer::FailReception()
 {
-	m_completion = 0.0f;
-	m_hasFailed = false;
-	m_isComplete = false;
-	m_sendedBits = 0;
-	m_totalBits = 0;
+	m_hasFailed = true;
+
+	UnmapFile(); // the parts file is kept, the next manifest resumes from it
+
+	if (m_isDelta)
+		DeleteFileA((m_fileName + FILE_DELTA_SUFFIX).c_str()); // the current copy stays unchanged
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief Destructor of the file transfert, it end the thread
+/// \brief Write the hashes of the chunks that we have next to
+/// the received file, so an interrupted transfert can be
+/// resumed without reading the file again
 ///
 ////////////////////////////////////////////////////////////
-FileTransfer::~FileTransfer()
+void FileTransfer::SaveParts()
 {
-	StopTransfert();
+	m_partsFile.open(m_fileName + FILE_PARTS_SUFFIX, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	sf::Uint32 l_size = (sf::Uint32)m_totalBits;
+
+	m_partsFile.write(reinterpret_cast<const char*>(&l_size), sizeof(l_size));
+	m_partsFile.write(reinterpret_cast<const char*>(m_chunkHashes.data()), m_chunkHashes.size() * sizeof(sf::Uint64));
+
+	m_partsFile.flush();
 }
 
 
+////////////////////////////////////////////////////////////
+/// \brief Write the hash of a received chunk in the parts file
+///
+/// \param a_chunk the index of the chunk
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::SaveChunk(sf::Uint32 a_chunk)
+{
+	if (!m_partsFile.is_open())
+		return;
+
+	m_partsFile.seekp(sizeof(sf::Uint32) + (std::streamoff)a_chunk * sizeof(sf::Uint64));
+	m_partsFile.write(reinterpret_cast<const char*>(&m_chunkHashes[a_chunk]), sizeof(sf::Uint64));
+
+	m_partsFile.flush(); // the chunk is in the mapped file, the system writes it even if we crash
+}
 
 ////////////////////////////////////////////////////////////
-/// \brief Must be called when this transfert receive a
-/// new packet full of data to add to the file
+/// \brief Ask to the correct entity to send a packet
 ///
-/// \param a_packet the packet full of data
+/// \param a_packet the packet to send
+///
+/// \param a_receiver The receiver, if NULL send it to everyone
 ///
 ////////////////////////////////////////////////////////////
-void FileTransfer::ReceivePacket(sf::Packet a_packet)
+void FileTransfer::SendPacket(PacketBuffer& a_packet, Connection* a_receiver)
 {
-	if (!m_hasFailed)
+	if (m_server != NULL)
+	{
+		m_server->SendPartialFile(a_packet, a_receiver);
+	}
+	else if(m_client != NULL) // or just else ?
 	{
-		bool l_hasFailed;
+		sf::Packet l_packet;
+		l_packet.append(a_packet.GetData(), a_packet.GetDataSize());
+
+		m_client->SendPartialFile(l_packet);
+	}
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Send the next part of the file, the first call
+/// opens the file and sends its description
+///
+/// \return true if there is still something to send
+///
+////////////////////////////////////////////////////////////
+bool FileTransfer::SendNextPart()
+{
+	if (!m_isTransfering)
+		return false;
 
-		a_packet >> l_hasFailed;
+	if (!m_isStarted)
+	{
+		m_isStarted = true;
 
-		if (l_hasFailed)
+		if (!MapFile(false)) // open the file and get its size
 		{
+			UnmapFile();
+
+			if (m_isAnnounced) // the receiver already waits for the chunks
+				SendFailure();
+
 			m_hasFailed = true;
-			m_file.close();
+			m_isTransfering = false;
+
+			return false;
+		}
+
+		if (m_isDelta) // the delta is searched by the next calls
+			return true;
+
+		if (!m_isAnnounced) // the whole file
+		{
+			for (sf::Uint32 i = 0; (sf::Uint64)i * FILE_CHUNK_SIZE < (sf::Uint64)m_totalBits; i++)
+			{
+				m_chunks.push_back(i);
+			}
 		}
 
-		int l_count = 0;
-		sf::Int8 l_char;
-		while (a_packet >> l_char)
+		size_t l_kept = 0;
+
+		for (sf::Uint32 chunk : m_chunks) // the file may have changed since the manifest
 		{
-			l_count++;
-			if (l_count % 4 == 0) // TODO : understand why we receive 32bits data instead of 8
+			if ((sf::Uint64)chunk * FILE_CHUNK_SIZE < (sf::Uint64)m_totalBits)
 			{
-				m_file.put(l_char);
+				m_chunks[l_kept++] = chunk;
+
+				m_expectedBits += GetChunkSize(chunk, m_totalBits);
 			}
 		}
 
-		m_sendedBits = m_file.tellp();
+		m_chunks.resize(l_kept);
+
+		if (m_isAnnounced)
+			return true;
+
+		// send a fisrt packet with just the name of the file
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_File << true << m_fileName << (sf::Uint32)m_totalBits << GetExecutablePath();
+		SendPacket(l_packet, m_receiver);
+
+		return true;
+	}
+
+	if (m_isDelta && !m_isScanned)
+	{
+		if (!ComputeDelta())
+			return true;
+
+		m_isScanned = true;
+
+		m_expectedBits = m_totalBits; // every byte is either copied by the receiver or sent
+
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_FileDelta << true << m_fileName << (sf::Uint32)m_totalBits;
+		SendPacket(l_packet, m_receiver);
+
+		return true;
+	}
+
+	if (m_isDelta)
+	{
+		if (m_nextRange < m_ranges.size())
+			SendNextRange();
+	}
+	else if (m_nextChunk < m_chunks.size())
+	{
+		sf::Uint32 l_offset = m_chunks[m_nextChunk] * FILE_CHUNK_SIZE;
+
+		sf::Uint32 l_size = (sf::Uint32)GetChunkSize(m_chunks[m_nextChunk], m_totalBits);
+
+		m_nextChunk++;
+
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_File << false << m_fileName << false;
+
+		WritePart(l_packet, l_offset, l_size); // the only copy, from the mapped file (or the compressed chunk) to the frame
 
-		m_completion = ((float)m_sendedBits / m_totalBits) * 100.0f;
+		SendPacket(l_packet, m_receiver);
 
-		if (m_sendedBits == m_totalBits)
+		m_sendedBits += l_size;
+
+		if (IsWindowed())
+			m_inFlight++; // the completion follows the acknowledgements
+		else
+			m_completion = ((float)m_sendedBits / m_expectedBits) * 100.0f;
+	}
+
+	if (m_isDelta ? m_nextRange >= m_ranges.size() : m_nextChunk >= m_chunks.size()) // end of the file
+	{
+		UnmapFile();
+
+		m_isTransfering = false;
+		m_isSent = true;
+
+		if (!IsWindowed() || m_ackedBits >= m_expectedBits) // else the last acknowledgement completes it
 		{
+			m_completion = 100.0f;
 			m_isComplete = true;
-			m_file.close();
 		}
+
+		return false;
 	}
+
+	return true;
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief Ask to the correct entity to send a packet
-///
-/// \param a_packet the packet to send
-///
-/// \param a_receiver The receiver, if NULL send it to everyone
+/// \brief Send the next range of a delta transfert, the
+/// following copies are grouped in the same packet and the
+/// literals are sent in parts of FILE_CHUNK_SIZE
 ///
 ////////////////////////////////////////////////////////////
-void FileTransfer::SendPacket(sf::Packet& a_packet, Connection* a_receiver)
+void FileTransfer::SendNextRange()
 {
-	if (m_server != NULL)
+	PacketBuffer l_packet;
+
+	if (m_ranges[m_nextRange].m_isCopy)
 	{
-		m_server->SendPartialFile(a_packet, a_receiver);
+		l_packet << (sf::Uint16)CT_FileDelta << false << m_fileName;
+
+		// each copy is 12 bytes, so a packet can reference many blocks
+		while (m_nextRange < m_ranges.size() && m_ranges[m_nextRange].m_isCopy && l_packet.GetDataSize() + 3 * sizeof(sf::Uint32) <= FRAME_BYTE_BUDGET)
+		{
+			const DeltaRange& l_range = m_ranges[m_nextRange];
+
+			l_packet << l_range.m_offset << l_range.m_sourceOffset << l_range.m_size;
+
+			m_sendedBits += l_range.m_size;
+
+			if (IsWindowed()) // the copies are not acknowledged
+				m_ackedBits += l_range.m_size;
+
+			m_nextRange++;
+		}
 	}
-	else if(m_client != NULL) // or just else ?
+	else
 	{
-		m_client->SendPartialFile(a_packet);
+		const DeltaRange& l_range = m_ranges[m_nextRange];
+
+		sf::Uint32 l_offset = l_range.m_offset + m_rangePosition;
+
+		sf::Uint32 l_size = std::min(l_range.m_size - m_rangePosition, (sf::Uint32)FILE_CHUNK_SIZE);
+
+		// the literals are ordinary parts of the file
+		l_packet << (sf::Uint16)CT_File << false << m_fileName << false;
+
+		WritePart(l_packet, l_offset, l_size);
+
+		m_sendedBits += l_size;
+
+		if (IsWindowed())
+			m_inFlight++;
+
+		m_rangePosition += l_size;
+
+		if (m_rangePosition >= l_range.m_size)
+		{
+			m_rangePosition = 0;
+			m_nextRange++;
+		}
 	}
+
+	SendPacket(l_packet, m_receiver);
+
+	m_completion = ((float)(IsWindowed() ? m_ackedBits.load() : m_sendedBits) / m_expectedBits) * 100.0f;
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief The main function of the thread for transfering files
+/// \brief Search the blocks of the receiver in the mapped
+/// file with a rolling checksum and build the list of ranges.
+/// Each call searches FILE_DELTA_SCAN bytes, so the scheduler
+/// keeps sending the other transferts meanwhile
+///
+/// \return true when the whole file was searched
 ///
 ////////////////////////////////////////////////////////////
-void FileTransfer::TransfertThread(FileTransfer* a_transfert)
+bool FileTransfer::ComputeDelta()
 {
-	a_transfert->m_isTransfering = true;
+	if (m_blockFilter.empty()) // first call
+	{
+		m_ranges.clear();
 
-	std::ifstream l_file(a_transfert->m_fileName, std::ios::in | std::ios::binary);
+		m_blockFilter.assign(0x10000, false);
 
-	l_file.seekg(0, std::ios::end);  // go to the end
-	sf::Uint32 l_fileSize = l_file.tellg(); // get the current position
-	l_file.seekg(0, std::ios::beg);  // go back to the begining
+		for (sf::Uint32 i = 0; i < m_blocks.size(); i++)
+		{
+			if (m_blocks[i].m_weak == 0 && m_blocks[i].m_strong == 0) // lost with its packet
+				continue;
 
-	if (l_file) // open the file
-	{
-		char l_char;
+			m_blockIndex[m_blocks[i].m_weak].push_back(i);
 
-		sf::Packet l_packet;
+			m_blockFilter[(m_blocks[i].m_weak & 0xFFFF) ^ (m_blocks[i].m_weak >> 16)] = true;
+		}
+	}
 
-		int l_currentPacketSize = 0;
+	const sf::Uint8* l_bytes = reinterpret_cast<const sf::Uint8*>(m_view);
 
-		// send a fisrt packet with just the name of the file
-		l_packet << (sf::Uint16)CT_File << true << a_transfert->m_fileName << l_fileSize << GetExecutablePath();
-		a_transfert->SendPacket(l_packet, a_transfert->m_receiver);
+	// the state of the search is kept in locals during the slice
+	sf::Uint32 l_position = m_scanPosition; // the start of the window
+
+	sf::Uint32 l_literal = m_scanLiteral; // the start of the bytes that were not found in the receiver copy
 
-		while (l_file.get(l_char) && a_transfert->m_isTransfering) // while there is still a character in the file
+	sf::Uint32 l_sum = m_scanSum;
+
+	sf::Uint32 l_weightedSum = m_scanWeightedSum;
+
+	bool l_isRolling = m_isScanRolling; // if the sums are those of the current window
+
+	sf::Uint64 l_sliceEnd = (sf::Uint64)l_position + FILE_DELTA_SCAN;
+
+	while (!m_blockIndex.empty() && (sf::Uint64)l_position + FILE_DELTA_BLOCK <= (sf::Uint64)m_totalBits && l_position < l_sliceEnd)
+	{
+		if (!l_isRolling)
 		{
-			if (l_currentPacketSize == 0) // init the packet
-			{
-				l_packet = sf::Packet();
+			sf::Uint32 l_checksum = FileManifest::RollingChecksum(m_view + l_position, FILE_DELTA_BLOCK);
 
-				l_packet << (sf::Uint16)CT_File << false << a_transfert->m_fileName << false;
-			}
-			l_packet << l_char; // add the char in the packet
+			l_sum = l_checksum & 0xFFFF;
+			l_weightedSum = l_checksum >> 16;
+			l_isRolling = true;
+		}
 
-			l_currentPacketSize++; // imcremente the size
+		bool l_isFound = false;
 
-			if (l_currentPacketSize >= 8192) // if we have reach the maximum size TODO : what is the best size ?? 2^13 seems nice
+		if (m_blockFilter[l_sum ^ l_weightedSum]) // most windows stop here
+		{
+			std::unordered_map<sf::Uint32, std::vector<sf::Uint32>>::const_iterator l_candidates = m_blockIndex.find(l_sum | (l_weightedSum << 16));
+
+			if (l_candidates != m_blockIndex.end()) // the strong hash is only computed on a match of the rolling checksum
 			{
-				a_transfert->SendPacket(l_packet, a_transfert->m_receiver); // send the packet
+				sf::Uint64 l_hash = WorldHash::Hash(m_view + l_position, FILE_DELTA_BLOCK);
+
+				for (sf::Uint32 block : l_candidates->second)
+				{
+					if (m_blocks[block].m_strong == l_hash)
+					{
+						if (l_literal < l_position)
+							AddRange(l_literal, 0, l_position - l_literal, false);
+
+						AddRange(l_position, block * FILE_DELTA_BLOCK, FILE_DELTA_BLOCK, true);
 
-				a_transfert->m_completion = ((float)l_file.tellg() / l_fileSize) * 100.0f;
+						l_position += FILE_DELTA_BLOCK;
+						l_literal = l_position;
+						l_isRolling = false;
+						l_isFound = true;
 
-				l_currentPacketSize = 0; // reset the packet
+						break;
+					}
+				}
 			}
 		}
 
-		if (l_currentPacketSize != 0 && a_transfert->m_isTransfering) // handle a non complete packet
+		if (!l_isFound) // slide the window of one byte
 		{
-			a_transfert->SendPacket(l_packet, a_transfert->m_receiver);
-			a_transfert->m_completion = 100.0f;
-		}
-			
+			if ((sf::Uint64)l_position + FILE_DELTA_BLOCK < (sf::Uint64)m_totalBits)
+			{
+				sf::Uint32 l_out = l_bytes[l_position];
+				sf::Uint32 l_in = l_bytes[l_position + FILE_DELTA_BLOCK];
 
-		l_file.close();
+				l_sum = (l_sum - l_out + l_in) & 0xFFFF;
+				l_weightedSum = (l_weightedSum - FILE_DELTA_BLOCK * l_out + l_sum) & 0xFFFF;
+			}
 
-		a_transfert->m_isComplete = true;
+			l_position++;
+		}
 	}
 
-	else
-	{
-		a_transfert->m_hasFailed = true;
-	}
+	m_scanPosition = l_position;
+	m_scanLiteral = l_literal;
+	m_scanSum = l_sum;
+	m_scanWeightedSum = l_weightedSum;
+	m_isScanRolling = l_isRolling;
+
+	if (!m_blockIndex.empty() && (sf::Uint64)l_position + FILE_DELTA_BLOCK <= (sf::Uint64)m_totalBits) // the next slice
+		return false;
+
+	if (l_literal < (sf::Uint32)m_totalBits)
+		AddRange(l_literal, 0, m_totalBits - l_literal, false);
+
+	std::vector<BlockSignature>().swap(m_blocks);
+	std::unordered_map<sf::Uint32, std::vector<sf::Uint32>>().swap(m_blockIndex);
+	std::vector<bool>().swap(m_blockFilter);
+
+	return true;
+}
 
-	if (a_transfert->m_hasFailed) // transfert can also failed if the transfert was manually stoped
+
+////////////////////////////////////////////////////////////
+/// \brief Add a range at the end of the delta, a copy that
+/// follows the previous one is merged with it
+///
+/// \param a_offset the position in the new version
+///
+/// \param a_sourceOffset the position in the copy of the receiver
+///
+/// \param a_size the number of bytes
+///
+/// \param a_isCopy true if the receiver already has these bytes
+///
+////////////////////////////////////////////////////////////
+void FileTransfer::AddRange(sf::Uint32 a_offset, sf::Uint32 a_sourceOffset, sf::Uint32 a_size, bool a_isCopy)
+{
+	if (a_isCopy && !m_ranges.empty())
 	{
-		// we send a packet that will cause the reading to fail and allow the transfert to be canceled at the other side
-		sf::Packet l_packet;
-		l_packet = sf::Packet();
-		l_packet << (sf::Uint16)CT_File << false << a_transfert->m_fileName << true;
+		DeltaRange& l_last = m_ranges.back();
+
+		if (l_last.m_isCopy && l_last.m_offset + l_last.m_size == a_offset && l_last.m_sourceOffset + l_last.m_size == a_sourceOffset)
+		{
+			l_last.m_size += a_size;
+			return;
+		}
 	}
 
-	a_transfert->m_isTransfering = false;
+	DeltaRange l_range;
+
+	l_range.m_offset = a_offset;
+	l_range.m_sourceOffset = a_sourceOffset;
+	l_range.m_size = a_size;
+	l_range.m_isCopy = a_isCopy;
+
+	m_ranges.push_back(l_range);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the size of a chunk of a file, the last one is
+/// shorter than FILE_CHUNK_SIZE
+///
+/// \param a_chunk the index of the chunk
+///
+/// \param a_fileSize the size of the file
+///
+/// \return the number of bytes of the chunk
+///
+////////////////////////////////////////////////////////////
+int FileTransfer::GetChunkSize(sf::Uint32 a_chunk, int a_fileSize)
+{
+	return std::min(a_fileSize - (int)(a_chunk * FILE_CHUNK_SIZE), FILE_CHUNK_SIZE);
 }
 
 
@@ -255,21 +1198,19 @@ void FileTransfer::TransfertThread(FileTransfer* a_transfert)
 ////////////////////////////////////////////////////////////
 void FileTransfer::StopTransfert()
 {
+	TransfertScheduler::Remove(this); // waits if a part is being sent, nothing is sent after
+
 	if (!m_isComplete)
 	{
-		m_hasFailed = true;
+		if (m_isStarted && !m_hasFailed) // the receivers are waiting for the next parts, or for the ones that were not acknowledged
+			SendFailure();
 
-		if (m_isTransfering)
-		{
-			m_isTransfering = false;
+		m_hasFailed = true;
 
-			m_thread.join();
-		}
+		m_isTransfering = false;
 	}
 
-	if (m_file)
-		m_file.close();
-
+	UnmapFile();
 }
 
 
@@ -324,7 +1265,9 @@ bool FileTransfer::HasFailed() const
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Get the current completion of the transfert
+/// \brief Get the current completion of the transfert, for
+/// a sending to one client only the parts that it has
+/// acknowledged are counted
 ///
 /// \return the pourcentage of transfert completion
 ///
@@ -334,4 +1277,28 @@ float FileTransfer::Completion() const
 	return m_completion;
 }
 
+
+////////////////////////////////////////////////////////////
+/// \brief Get the specific receiver of this transfert
+///
+/// \return the receiver, NULL if everyone receive the file
+///
+////////////////////////////////////////////////////////////
+Connection* FileTransfer::GetReceiver() const
+{
+	return m_receiver;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the name of the transfered file
+///
+/// \return the name of the file
+///
+////////////////////////////////////////////////////////////
+const std::string& FileTransfer::GetFileName() const
+{
+	return m_fileName;
+}
+
 }
\ No newline at end of file
@@ -21,6 +21,8 @@
 ////////////////////////////////////////////////////////////
 #include "stdafx.h"
 #include "NetworkEnums.h"
+#include "PacketBuffer.h"
+#include "FileManifest.h"
 
 
 namespace Net
@@ -66,14 +68,55 @@ public:
 	FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver = NULL);
 
 	////////////////////////////////////////////////////////////
-	/// \brief This constructor is for receiving file
+	/// \brief Send only some chunks of a file to a client that
+	/// already knows the file from its manifest
+	///
+	/// \param a_fileName The name of the file to send
+	///
+	/// \param a_senderEntity The server that send the file
+	///
+	/// \param a_receiver The connection where to send the chunks
+	///
+	/// \param a_chunks The indexes of the chunks to send
+	///
+	////////////////////////////////////////////////////////////
+	FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver, const std::vector<sf::Uint32>& a_chunks);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send a new version of a file as a delta against
+	/// the copy of a client, the blocks found in this copy are
+	/// not sent again
+	///
+	/// \param a_fileName The name of the file to send
+	///
+	/// \param a_senderEntity The server that send the file
+	///
+	/// \param a_receiver The connection where to send the delta
+	///
+	/// \param a_blocks The signatures of the blocks of the copy
+	/// of the receiver
+	///
+	////////////////////////////////////////////////////////////
+	FileTransfer(const std::string& a_fileName, Server* a_senderEntity, Connection* a_receiver, const std::vector<BlockSignature>& a_blocks);
+
+	////////////////////////////////////////////////////////////
+	/// \brief This constructor is for receiving file, the
+	/// existing content of the file is kept
 	///
 	/// \param a_fileName The name of the file to send
 	///
 	/// \param a_fileSize The expetected size of the file
 	///
+	/// \param a_chunkHashes The hashes of the chunks that we
+	/// already have, 0 (or no hash) for the chunks that will be
+	/// received
+	///
+	/// \param a_isDelta true if the file is received as a delta,
+	/// it is then built aside and replaces the current copy at
+	/// the end (a_chunkHashes is not used)
+	///
 	////////////////////////////////////////////////////////////
-	FileTransfer(const std::string& a_fileName, int a_fileSize);
+	FileTransfer(const std::string& a_fileName, int a_fileSize, const std::vector<sf::Uint64>& a_chunkHashes, bool a_isDelta = false);
 
 	////////////////////////////////////////////////////////////
 	/// \brief Destructor of the file transfert, it end the thread
@@ -105,21 +148,89 @@ public:
 
 
 	////////////////////////////////////////////////////////////
-	/// \brief Get the current completion of the transfert
+	/// \brief Get the current completion of the transfert, for
+	/// a sending to one client only the parts that it has
+	/// acknowledged are counted
 	///
 	/// \return the pourcentage of transfert completion
 	///
 	////////////////////////////////////////////////////////////
 	float Completion() const;
 
+	////////////////////////////////////////////////////////////
+	/// \brief Get the specific receiver of this transfert
+	///
+	/// \return the receiver, NULL if everyone receive the file
+	///
+	////////////////////////////////////////////////////////////
+	Connection* GetReceiver() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the name of the transfered file
+	///
+	/// \return the name of the file
+	///
+	////////////////////////////////////////////////////////////
+	const std::string& GetFileName() const;
+
 	////////////////////////////////////////////////////////////
 	/// \brief Must be called when this transfert receive a
 	/// new packet full of data to add to the file
 	///
 	/// \param a_packet the packet full of data
 	///
+	/// \param a_offset receives the position of the part
+	///
+	/// \param a_size receives the size of the part
+	///
+	/// \return true if the part is in the file, so it can be
+	/// acknowledged
+	///
+	////////////////////////////////////////////////////////////
+	bool ReceivePacket(sf::Packet& a_packet, sf::Uint32& a_offset, sf::Uint32& a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Sending to one client] Must be called when the
+	/// receiver acknowledges a part of the file
+	///
+	/// \param a_bits the size of the part
+	///
+	/// \return false if this transfert was not waiting for an
+	/// acknowledgement
+	///
+	////////////////////////////////////////////////////////////
+	bool Acknowledge(int a_bits);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Sending to one client] Know if the receiver has
+	/// not acknowledged any part in flight for FILE_ACK_TIMEOUT
+	/// ms. Must be called regularly by the thread that calls
+	/// Acknowledge
+	///
+	/// \return true if the transfert must be stopped
+	///
 	////////////////////////////////////////////////////////////
-	void ReceivePacket(sf::Packet a_packet);
+	bool HasTimedOut();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Receiving] Know if the sender has canceled the
+	/// transfert, else a failure comes from our side and the
+	/// sender must be told
+	///
+	/// \return true if the sender has sent a failed part
+	///
+	////////////////////////////////////////////////////////////
+	bool IsCanceled() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Must be called when this transfert receive a
+	/// packet of blocks to copy from the current version of the
+	/// file (delta transfert)
+	///
+	/// \param a_packet the packet with the list of blocks
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveBlocks(sf::Packet& a_packet);
 
 	////////////////////////////////////////////////////////////
 	/// \brief Get the global path of the .exe
@@ -129,13 +240,160 @@ public:
 	////////////////////////////////////////////////////////////
 	static const std::string GetExecutablePath();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Get the size of a chunk of a file, the last one is
+	/// shorter than FILE_CHUNK_SIZE
+	///
+	/// \param a_chunk the index of the chunk
+	///
+	/// \param a_fileSize the size of the file
+	///
+	/// \return the number of bytes of the chunk
+	///
+	////////////////////////////////////////////////////////////
+	static int GetChunkSize(sf::Uint32 a_chunk, int a_fileSize);
+
 private:
 
 	////////////////////////////////////////////////////////////
-	/// \brief The main function of the thread for transfering files
+	/// \brief A range of the new version of a file in a delta
+	/// transfert
+	///
+	////////////////////////////////////////////////////////////
+	struct DeltaRange
+	{
+		sf::Uint32 m_offset;       ///< The position of the range in the new version
+		sf::Uint32 m_sourceOffset; ///< The position of the same bytes in the copy of the receiver, if it is a copy
+		sf::Uint32 m_size;         ///< The number of bytes of the range
+		bool m_isCopy;             ///< true if the receiver already has these bytes, false if they are sent
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief Start the sending, the parts are sent by the
+	/// transfert scheduler
+	///
+	////////////////////////////////////////////////////////////
+	void StartSending();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the receivers have read the previous parts,
+	/// so the next one can be sent
+	///
+	/// \return false if the send queue of a receiver is full
+	///
+	////////////////////////////////////////////////////////////
+	bool IsReadyToSend() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the parts are acknowledged by the receiver
+	/// (a server sending to one client)
+	///
+	/// \return true if the parts in flight are limited
+	///
+	////////////////////////////////////////////////////////////
+	bool IsWindowed() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send a part that makes the reading fail, so the
+	/// transfert is canceled at the other side
+	///
+	////////////////////////////////////////////////////////////
+	void SendFailure();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write a part of the file in a packet, compressed
+	/// if the receiver accepts it and if it shrinks
+	///
+	/// \param a_packet the packet, after the name of the file
+	///
+	/// \param a_offset the position of the part in the file
+	///
+	/// \param a_size the size of the part
+	///
+	////////////////////////////////////////////////////////////
+	void WritePart(PacketBuffer& a_packet, sf::Uint32 a_offset, sf::Uint32 a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the next part of the file, the first call
+	/// opens the file and sends its description
+	///
+	/// \return true if there is still something to send
+	///
+	////////////////////////////////////////////////////////////
+	bool SendNextPart();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the next range of a delta transfert, the
+	/// following copies are grouped in the same packet and the
+	/// literals are sent in parts of FILE_CHUNK_SIZE
 	///
 	////////////////////////////////////////////////////////////
-	static void TransfertThread(FileTransfer* a_transfert);
+	void SendNextRange();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Search the blocks of the receiver in the mapped
+	/// file with a rolling checksum and build the list of ranges.
+	/// Each call searches FILE_DELTA_SCAN bytes, so the scheduler
+	/// keeps sending the other transferts meanwhile
+	///
+	/// \return true when the whole file was searched
+	///
+	////////////////////////////////////////////////////////////
+	bool ComputeDelta();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add a range at the end of the delta, a copy that
+	/// follows the previous one is merged with it
+	///
+	/// \param a_offset the position in the new version
+	///
+	/// \param a_sourceOffset the position in the copy of the receiver
+	///
+	/// \param a_size the number of bytes
+	///
+	/// \param a_isCopy true if the receiver already has these bytes
+	///
+	////////////////////////////////////////////////////////////
+	void AddRange(sf::Uint32 a_offset, sf::Uint32 a_sourceOffset, sf::Uint32 a_size, bool a_isCopy);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Count received bytes and end the reception when
+	/// the whole file is there
+	///
+	/// \param a_bits the number of bytes written in the file
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveBits(int a_bits);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Close the received file, and in a delta transfert
+	/// replace the current copy by the new version
+	///
+	////////////////////////////////////////////////////////////
+	void CompleteReception();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Stop the reception after an error, the partial new
+	/// version of a delta transfert is removed
+	///
+	////////////////////////////////////////////////////////////
+	void FailReception();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write the hashes of the chunks that we have next to
+	/// the received file, so an interrupted transfert can be
+	/// resumed without reading the file again
+	///
+	////////////////////////////////////////////////////////////
+	void SaveParts();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write the hash of a received chunk in the parts file
+	///
+	/// \param a_chunk the index of the chunk
+	///
+	////////////////////////////////////////////////////////////
+	void SaveChunk(sf::Uint32 a_chunk);
 
 	////////////////////////////////////////////////////////////
 	/// \brief init commun variables for file transfert
@@ -143,6 +401,61 @@ private:
 	////////////////////////////////////////////////////////////
 	void Init();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Map the file in memory, the parts are copied
+	/// directly between the mapped file and the packets
+	///
+	/// \param a_isWriting true to create the received file with
+	/// the expected size, false to read the file to send and get
+	/// its size (this mapping is shared by all the senders)
+	///
+	/// \return false if the file can not be opened or mapped
+	///
+	////////////////////////////////////////////////////////////
+	bool MapFile(bool a_isWriting);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Release the mappings and close the files (with the
+	/// parts file), nothing happens if they are not opened
+	///
+	////////////////////////////////////////////////////////////
+	void UnmapFile();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Open a file and map it in memory
+	///
+	/// \param a_path the path of the file
+	///
+	/// \param a_isWriting true to resize the file to a_size and
+	/// map it for writing, false to map it for reading and get
+	/// its size in a_size
+	///
+	/// \param a_size the size of the file
+	///
+	/// \param a_file receives the opened file
+	///
+	/// \param a_mapping receives the mapping
+	///
+	/// \param a_view receives the content, NULL for an empty file
+	///
+	/// \return false if the file can not be opened or mapped,
+	/// what was opened must still be released by CloseView
+	///
+	////////////////////////////////////////////////////////////
+	static bool OpenView(const std::string& a_path, bool a_isWriting, int& a_size, HANDLE& a_file, HANDLE& a_mapping, char*& a_view);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Release a view opened by OpenView
+	///
+	/// \param a_file the opened file
+	///
+	/// \param a_mapping the mapping
+	///
+	/// \param a_view the content
+	///
+	////////////////////////////////////////////////////////////
+	static void CloseView(HANDLE& a_file, HANDLE& a_mapping, char*& a_view);
+
 	////////////////////////////////////////////////////////////
 	/// \brief Ask to the correct entity to send a packet
 	///
@@ -151,26 +464,36 @@ private:
 	/// \param a_receiver The receiver, if NULL send it to everyone
 	///
 	////////////////////////////////////////////////////////////
-	void SendPacket(sf::Packet& a_packet, Connection* a_receiver);
+	void SendPacket(PacketBuffer& a_packet, Connection* a_receiver);
 
 
 	////////////////////////////////////////////////////////////
 	// Member data
 	////////////////////////////////////////////////////////////
 
-	bool m_isComplete; ///< More than just m_completion = 100%, it also mean that the thread has ended without error
+	std::atomic<bool> m_isComplete; ///< More than just m_completion = 100%, it also mean that the thread has ended without error
 
-	bool m_hasFailed; ///< If an error has occured in the transfert
+	std::atomic<bool> m_hasFailed; ///< If an error has occured in the transfert
 
-	bool m_isTransfering; ///< If the thread is running
+	bool m_isCanceled; ///< If we are in receiving mode, if the sender has canceled the transfert
+
+	bool m_isTransfering; ///< If the transfert is in the scheduler
 
 	int m_sendedBits; ///< The currently quantity of data that was sended
 
-	int m_totalBits; ///< The total quantity of data that the transfert must do
+	int m_totalBits; ///< The size of the file
+
+	int m_expectedBits; ///< The total quantity of data that the transfert must do
+
+	std::atomic<int> m_ackedBits; ///< If we are in sending mode to one client, the quantity of data acknowledged by the receiver
 
-	float m_completion; ///< The current pourcentage of completion
+	std::atomic<int> m_inFlight; ///< If we are in sending mode to one client, the number of parts sent and not acknowledged yet
 
-	std::thread m_thread; ///< The thread used for transfering as async operation
+	std::atomic<bool> m_isSent; ///< If we are in sending mode, if the last part was sent
+
+	std::atomic<float> m_completion; ///< The current pourcentage of completion
+
+	sf::Clock m_ackClock; ///< If we are in sending mode to one client, the time since the last acknowledgement (or since no part was in flight)
 
 	const std::string m_fileName; ///< The name of the file to transfer
 
@@ -180,7 +503,63 @@ private:
 
 	Connection* m_receiver; ///< The specific receiver of this transfert, if NULL everyone will receive it
 
-	std::ofstream m_file; ///< If we are in receiving mode, this is the opened file
+	HANDLE m_fileHandle; ///< The opened file, to send or to receive
+
+	HANDLE m_mapping; ///< The mapping of the opened file
+
+	char* m_view; ///< The content of the file mapped in memory, NULL if the file is empty or not opened
+
+	bool m_isShared; ///< If we are in sending mode, if m_view is the mapping shared by the transferts of the file
+
+	bool m_isStarted; ///< If we are in sending mode, if the file was opened
+
+	bool m_isAnnounced; ///< If we are in sending mode, if the receiver already knows the file (from the manifest), so no description is sent
+
+	std::vector<sf::Uint32> m_chunks; ///< If we are in sending mode, the indexes of the chunks to send
+
+	size_t m_nextChunk; ///< If we are in sending mode, the position of the next chunk to send in m_chunks
+
+	bool m_isDelta; ///< If the file is transfered as a delta against the copy of the receiver
+
+	std::vector<BlockSignature> m_blocks; ///< If we are in sending mode, the signatures of the blocks of the receiver
+
+	std::unordered_map<sf::Uint32, std::vector<sf::Uint32>> m_blockIndex; ///< If we are in sending mode, the blocks of the receiver by rolling checksum
+
+	std::vector<bool> m_blockFilter; ///< If we are in sending mode, the rolling checksums of the receiver folded on 16 bits, most windows are rejected without a lookup
+
+	sf::Uint32 m_scanPosition; ///< If we are in sending mode, the start of the window of the delta search
+
+	sf::Uint32 m_scanLiteral; ///< If we are in sending mode, the start of the bytes not found in the copy of the receiver
+
+	sf::Uint32 m_scanSum; ///< If we are in sending mode, the low half of the rolling checksum of the window
+
+	sf::Uint32 m_scanWeightedSum; ///< If we are in sending mode, the high half of the rolling checksum of the window
+
+	bool m_isScanRolling; ///< If we are in sending mode, if the sums are those of the current window
+
+	bool m_isScanned; ///< If we are in sending mode, if the delta search is complete
+
+	std::vector<DeltaRange> m_ranges; ///< If we are in sending mode, the ranges of the delta
+
+	size_t m_nextRange; ///< If we are in sending mode, the position of the next range to send in m_ranges
+
+	sf::Uint32 m_rangePosition; ///< If we are in sending mode, the bytes of the current literal range that were already sent
+
+	HANDLE m_sourceHandle; ///< If we are in receiving mode of a delta, the current copy of the file
+
+	HANDLE m_sourceMapping; ///< The mapping of the current copy
+
+	char* m_sourceView; ///< The content of the current copy, NULL if there is no copy
+
+	int m_sourceBits; ///< The size of the current copy
+
+	std::vector<sf::Uint64> m_chunkHashes; ///< If we are in receiving mode, the hash of each chunk that we have, 0 if it is still missing
+
+	std::ofstream m_partsFile; ///< If we are in receiving mode, the saved copy of m_chunkHashes
+
+	std::vector<char> m_compressed; ///< If we are in sending mode, the storage of the compressed parts that are not cached (the literals of a delta)
+
+	friend class TransfertScheduler;
 };
 
 }
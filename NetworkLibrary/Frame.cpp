@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#include "stdafx.h"
+#include "Frame.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor, use Create instead
+///
+/// \param a_buffer the written packet, its storage is taken
+///
+////////////////////////////////////////////////////////////
+Frame::Frame(PacketBuffer& a_buffer) : m_buffer(std::move(a_buffer))
+{
+	m_buffer.WriteHeader();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Copy a packet in a new frame
+///
+/// \param a_packet the packet to serialize
+///
+/// \return the frame, shared by all the receivers
+///
+////////////////////////////////////////////////////////////
+SharedFrame Frame::Create(const sf::Packet& a_packet)
+{
+	PacketBuffer l_buffer;
+
+	l_buffer.Append(a_packet.getData(), a_packet.getDataSize()); // the only copy of the packet
+
+	return Create(l_buffer);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Turn a written buffer into a new frame, without
+/// any copy
+///
+/// \param a_buffer the written packet, its storage is taken
+/// and it can be reused for the next packet
+///
+/// \return the frame, shared by all the receivers
+///
+////////////////////////////////////////////////////////////
+SharedFrame Frame::Create(PacketBuffer& a_buffer)
+{
+	return std::allocate_shared<Frame>(PoolAllocator<Frame>(), a_buffer); // the frame and its counter are in one pooled block
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the bytes to send on a TCP socket
+///
+/// \return the header followed by the data of the packet
+///
+////////////////////////////////////////////////////////////
+const char* Frame::GetTcpData() const
+{
+	return m_buffer.GetTcpData();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the number of bytes to send on a TCP socket
+///
+/// \return the size of the header and the data
+///
+////////////////////////////////////////////////////////////
+size_t Frame::GetTcpSize() const
+{
+	return m_buffer.GetTcpSize();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the data of the packet (for UDP and the loopback)
+///
+/// \return the data of the packet, without the header
+///
+////////////////////////////////////////////////////////////
+const char* Frame::GetData() const
+{
+	return m_buffer.GetData();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the size of the data of the packet
+///
+/// \return the size of the packet, without the header
+///
+////////////////////////////////////////////////////////////
+size_t Frame::GetSize() const
+{
+	return m_buffer.GetDataSize();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read the command type of the packet
+///
+/// \param a_command the command type that was read
+///
+/// \return false if the packet is too short
+///
+////////////////////////////////////////////////////////////
+bool Frame::PeekCommand(sf::Uint16& a_command) const
+{
+	if (GetSize() < sizeof(sf::Uint16))
+		return false;
+
+	const sf::Uint8* l_data = reinterpret_cast<const sf::Uint8*>(GetData());
+
+	a_command = (sf::Uint16)((l_data[0] << 8) | l_data[1]); // packets are big endian
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if a command type carries the state of the
+/// objects (creations, updates, deletions and commands), only
+/// these frames are counted and replayed to resume a session
+///
+/// \param a_command the command type
+///
+/// \return true for a state frame
+///
+////////////////////////////////////////////////////////////
+bool Frame::IsStateCommand(sf::Uint16 a_command)
+{
+	// the realtime and bulk frames are only compressed for updates, commands and creations
+	return a_command == CT_NewObject || a_command == CT_UpdateObjects || a_command == CT_DeleteObject
+		|| a_command == CT_CustomCommand || a_command == CT_Compressed;
+}
+
+}
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "PacketBuffer.h"
+
+
+namespace Net
+{
+
+class Frame;
+
+typedef std::shared_ptr<const Frame> SharedFrame; ///< A frame referenced by the send queues of several connections
+
+typedef std::queue<SharedFrame, std::deque<SharedFrame, PoolAllocator<SharedFrame>>> FrameQueue; ///< A send queue, its memory comes from the buffer pool
+
+
+////////////////////////////////////////////////////////////
+/// \brief Immutable buffer of a packet ready to be sent
+///
+/// A packet sent to several clients is serialized only once in
+/// a frame, then every connection sends the same bytes. The
+/// buffer starts with the TCP header, so it is sent on a TCP
+/// socket without any copy, and UDP uses the same buffer
+/// without the header
+///
+/// The frame and its buffer are taken in the buffer pool
+///
+////////////////////////////////////////////////////////////
+class NET Frame
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor, use Create instead
+	///
+	/// \param a_buffer the written packet, its storage is taken
+	///
+	////////////////////////////////////////////////////////////
+	Frame(PacketBuffer& a_buffer);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy a packet in a new frame
+	///
+	/// \param a_packet the packet to serialize
+	///
+	/// \return the frame, shared by all the receivers
+	///
+	////////////////////////////////////////////////////////////
+	static SharedFrame Create(const sf::Packet& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Turn a written buffer into a new frame, without
+	/// any copy
+	///
+	/// \param a_buffer the written packet, its storage is taken
+	/// and it can be reused for the next packet
+	///
+	/// \return the frame, shared by all the receivers
+	///
+	////////////////////////////////////////////////////////////
+	static SharedFrame Create(PacketBuffer& a_buffer);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the bytes to send on a TCP socket
+	///
+	/// \return the header followed by the data of the packet
+	///
+	////////////////////////////////////////////////////////////
+	const char* GetTcpData() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of bytes to send on a TCP socket
+	///
+	/// \return the size of the header and the data
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetTcpSize() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the data of the packet (for UDP and the loopback)
+	///
+	/// \return the data of the packet, without the header
+	///
+	////////////////////////////////////////////////////////////
+	const char* GetData() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the size of the data of the packet
+	///
+	/// \return the size of the packet, without the header
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetSize() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read the command type of the packet
+	///
+	/// \param a_command the command type that was read
+	///
+	/// \return false if the packet is too short
+	///
+	////////////////////////////////////////////////////////////
+	bool PeekCommand(sf::Uint16& a_command) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if a command type carries the state of the
+	/// objects (creations, updates, deletions and commands), only
+	/// these frames are counted and replayed to resume a session
+	///
+	/// \param a_command the command type
+	///
+	/// \return true for a state frame
+	///
+	////////////////////////////////////////////////////////////
+	static bool IsStateCommand(sf::Uint16 a_command);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	PacketBuffer m_buffer; ///< The header and the data of the packet
+};
+
+}
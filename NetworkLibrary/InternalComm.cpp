@@ -15,6 +15,9 @@
 #include "stdafx.h"
 #include "InternalComm.h"
 
+#include "TransfertScheduler.h"
+#include "FileCache.h"
+
 namespace Net
 {
 
@@ -36,8 +39,40 @@ std::vector<NetworkObject*> InternalComm::s_newObjects; ///< The list of all the
 
 std::map<std::string, FactoryMethod> InternalComm::s_factoryMap; ///< This map is a bit tricky, it store a pointer of a template function capable of instanciate a type
 
+std::map<std::string, std::pair<DestroyMethod, ReleaseMethod>> InternalComm::s_destroyMap; ///< Same as s_factoryMap, but for destroying the objects of a type and giving back their memory
+
+std::vector<sf::Uint16> InternalComm::s_deletedObjects; ///< The ids of the objects destroyed and not handled yet
+
+std::vector<DestroyedObject> InternalComm::s_destroyedObjects; ///< The destroyed objects whose memory and id wait for the deletion to be sent
+
+std::mutex InternalComm::s_objectsMutex; ///< Lock of the list of the objects and of the new and the destroyed ones, the game thread spawns and destroys them while the server thread sends them
+
+int InternalComm::s_forcedId = -1; ///< The id of the object being instanciated from a creation of the server, -1 if none
+
 void(*InternalComm::s_newConnectionCallback)(Connection*) = NULL; ///< The pointer to the callback function to call when a new connection append
 
+bool InternalComm::s_isPollMode = false; ///< Flag to know if the library is driven by Poll instead of its threads
+
+std::atomic<bool> InternalComm::s_isDeferredCommands(true); ///< Flag to know if the received commands wait for HandleReceivedCommands
+
+std::atomic<sf::Uint32> InternalComm::s_fileBandwidth(0); ///< The bandwidth of a client for the file transferts in bytes per second, 0 for no limit
+
+std::atomic<float> InternalComm::s_fileShare(1.0f); ///< The part of the unused bandwidth given to the file transferts
+
+std::atomic<bool> InternalComm::s_isCompressionEnabled(true); ///< Flag to know if the file parts and the bulk frames can be compressed
+
+std::string InternalComm::s_fileCache(FILE_CACHE_DIRECTORY); ///< The directory of the cache of the received files, empty if it is disabled
+
+sf::Uint64 InternalComm::s_fileCacheBudget = FILE_CACHE_BUDGET; ///< The size limit of the cache of the received files, 0 for no limit
+
+CompressionDictionary InternalComm::s_compressionDictionary; ///< The dictionary of the realtime packets, empty if there is none
+
+std::atomic<size_t> InternalComm::s_captureSize(0); ///< The number of realtime packets to record, 0 if the capture is stopped
+
+std::vector<std::vector<char>> InternalComm::s_capturedTraffic; ///< The recorded realtime packets
+
+std::mutex InternalComm::s_captureMutex; ///< Lock of the recorded packets, they are sent by the server and the client threads
+
 
 ////////////////////////////////////////////////////////////
 /// \brief Start a new server 
@@ -55,9 +90,10 @@ void(*InternalComm::s_newConnectionCallback)(Connection*) = NULL; ///< The point
 ////////////////////////////////////////////////////////////
 Server* InternalComm::StartServer(const std::string& a_name, bool a_autoConnect, bool a_local)
 {
-	NetworkObject::StartUpdateThread(s_updateThread);
+	if (!s_isPollMode) // the update thread does nothing yet, and the game loop updates its objects
+		NetworkObject::StartUpdateThread(s_updateThread);
 
-	s_server = new Server(a_name, a_autoConnect, a_local, CONNECTION_TIMEOUT, SERVER_MAX_CONNECTIONS);
+	s_server = new Server(a_name, a_autoConnect, a_local, CONNECTION_DROP_TIMEOUT, SERVER_MAX_CONNECTIONS);
 	return s_server;
 }
 
@@ -125,6 +161,20 @@ bool InternalComm::IsInstanciable()
 	return s_canInstanciate;
 }
 
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] get the id that the object being
+/// instanciated must take
+///
+/// \return the id given by the server, -1 if the object must
+/// take a new id
+///
+////////////////////////////////////////////////////////////
+int InternalComm::GetForcedId()
+{
+	return s_forcedId;
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief change the callback for new connections
 ///
@@ -206,6 +256,47 @@ bool InternalComm::HasRunningServer()
 	return (s_server != NULL);
 }
 
+////////////////////////////////////////////////////////////
+/// \brief Indicate that an object was destroyed, so its
+/// encoded state and its hash are not valid anymore
+///
+/// \param a_id the id of the object
+///
+////////////////////////////////////////////////////////////
+void InternalComm::ObjectWasDestroyed(sf::Uint16 a_id)
+{
+	if (s_server != NULL)
+		s_server->ObjectWasDestroyed(a_id);
+
+	if (s_client != NULL)
+		s_client->ObjectWasDestroyed(a_id);
+}
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Get the in process channel if the
+/// server to connect is running on this application
+///
+/// \param a_server the informations about the server to connect
+///
+/// \return the loopback channel of the server, NULL if the
+/// server is not the one of this application
+///
+////////////////////////////////////////////////////////////
+std::shared_ptr<LoopbackChannel> InternalComm::GetLoopbackChannel(const InfoServer* a_server)
+{
+	if (s_server == NULL)
+		return NULL;
+
+	sf::Uint32 l_address = a_server->m_address.toInteger();
+
+	bool l_isLocal = (l_address >> 24) == 127 || l_address == sf::IpAddress::getLocalAddress().toInteger(); // 127.0.0.0/8, localhost or the address of this machine
+
+	if (!l_isLocal || a_server->m_port != s_server->GetPort())
+		return NULL; // another server
+
+	return s_server->GetLoopbackChannel();
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief check if a server exist at a non local address
 ///
@@ -310,34 +401,376 @@ std::vector<const Connection*> InternalComm::GetNotRespondingConnections()
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Read a received packet and put the data in a NetworkData
+/// \brief get the time of the server clock, on the client
+/// side it is estimated with the clock syncronization
 ///
-/// \param a_packet the packet we need to read
+/// \return the server time, zero if there is no connection
 ///
-/// \param a_data the data in wich we will put the variables read.
+////////////////////////////////////////////////////////////
+sf::Time InternalComm::GetServerTime()
+{
+	if (s_server != NULL)
+		return s_server->GetTime();
+
+	if (s_client != NULL)
+		return s_client->GetServerTime();
+
+	return sf::Time::Zero;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Choose if the library runs its own threads or if
+/// everything is done by Poll, from the game loop thread.
+/// Must be called before starting a server or a client
 ///
-/// \return if the reading is a success
+/// \param a_isPollMode true to run the library with Poll
 ///
 ////////////////////////////////////////////////////////////
-bool InternalComm::ReadCommand(sf::Packet& a_packet, NetworkData& a_data)
+void InternalComm::SetPollMode(bool a_isPollMode)
 {
-	// for now similar to an object
-	return ReadObject(a_packet, a_data);
+	if (s_server != NULL || s_client != NULL)
+		throw NetworkException("Error : The poll mode must be chosen before starting a server or a client");
+
+	s_isPollMode = a_isPollMode;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the library is driven by Poll
+///
+/// \return true if there is no library thread
+///
+////////////////////////////////////////////////////////////
+bool InternalComm::IsPollMode()
+{
+	return s_isPollMode;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Choose who gives the received commands
+/// to the objects. By default the game must call
+/// HandleReceivedCommands once per frame, without it the
+/// commands wait until the queue is full then are refused.
+/// With false the server thread handles them itself, as in
+/// the previous versions (the game code then runs on the server
+/// thread)
+///
+/// \param a_isDeferred true if the game calls HandleReceivedCommands
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SetDeferredCommands(bool a_isDeferred)
+{
+	s_isDeferredCommands = a_isDeferred;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the received commands wait for the game
+///
+/// \return true if the game must call HandleReceivedCommands
+///
+////////////////////////////////////////////////////////////
+bool InternalComm::IsDeferredCommands()
+{
+	return s_isDeferredCommands;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Limit the bandwidth used by the file transferts,
+/// so they do not delay the updates and the pings. Each
+/// client receives file parts with at most a_share of the
+/// bandwidth that the other frames left unused
+///
+/// \param a_bandwidth the bandwidth of a client in bytes per
+/// second, 0 for no limit (a part is then only sent when the
+/// send queue of the client is empty)
+///
+/// \param a_share the part of the unused bandwidth given to
+/// the files, between 0 and 1
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SetFileBandwidth(sf::Uint32 a_bandwidth, float a_share)
+{
+	if (a_share < 0.0f || a_share > 1.0f)
+		throw NetworkException("Error : The share of the file transferts must be between 0 and 1");
+
+	s_fileBandwidth = a_bandwidth; // the server reads them at each refill, so they can be changed during a transfert
+	s_fileShare = a_share;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the bandwidth of a client for the file
+/// transferts
+///
+/// \return the bandwidth in bytes per second, 0 for no limit
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 InternalComm::GetFileBandwidth()
+{
+	return s_fileBandwidth;
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Write a command data in a packet for transmition
+/// \brief Get the part of the unused bandwidth given to the
+/// file transferts
+///
+/// \return the share, between 0 and 1
 ///
-/// \param a_packet the packet in wich we will write
+////////////////////////////////////////////////////////////
+float InternalComm::GetFileShare()
+{
+	return s_fileShare;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Enable the compression of the file parts and of
+/// the frames that stream the world to a new client. It is
+/// used with a server only if both sides enable it, and a
+/// part or a frame is only compressed if it shrinks
 ///
-/// \param a_data the data we need to write
+/// \param a_isEnabled true to compress (the default)
 ///
 ////////////////////////////////////////////////////////////
-void InternalComm::WriteCommand(sf::Packet& a_packet, const NetworkData& a_data)
+void InternalComm::SetCompression(bool a_isEnabled)
+{
+	s_isCompressionEnabled = a_isEnabled; // a connection keeps the choice made at its start
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the compression is enabled
+///
+/// \return true if the compression can be used
+///
+////////////////////////////////////////////////////////////
+bool InternalComm::IsCompressionEnabled()
+{
+	return s_isCompressionEnabled;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Choose the directory where the
+/// received files are cached by content, so a version of a
+/// file is never downloaded twice, even from another server.
+/// Must be called before starting a client
+///
+/// \param a_directory the directory, empty to disable the
+/// cache (FILE_CACHE_DIRECTORY by default)
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SetFileCache(const std::string& a_directory)
+{
+	s_fileCache = a_directory;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the directory of the cache of the received
+/// files
+///
+/// \return the directory, empty if the cache is disabled
+///
+////////////////////////////////////////////////////////////
+const std::string& InternalComm::GetFileCache()
+{
+	return s_fileCache;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Limit the size of the cache of the
+/// received files : when a new entry makes it larger, the
+/// entries used least recently are removed
+///
+/// \param a_bytes the size of the cache in bytes, 0 for no
+/// limit (FILE_CACHE_BUDGET by default)
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SetFileCacheBudget(sf::Uint64 a_bytes)
+{
+	s_fileCacheBudget = a_bytes;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the size limit of the cache of the received
+/// files
+///
+/// \return the size in bytes, 0 for no limit
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 InternalComm::GetFileCacheBudget()
+{
+	return s_fileCacheBudget;
+}
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Set the dictionary of the realtime
+/// packets (updates and commands). It is sent to each client
+/// that accepts the compression when it connects, then the
+/// packets refer to it. Must be called before starting a
+/// server
+///
+/// \param a_content the dictionary, made by
+/// CompressionDictionary::Train, empty to remove it
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SetCompressionDictionary(const std::vector<char>& a_content)
+{
+	s_compressionDictionary.Load(a_content);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the dictionary of the realtime packets
+///
+/// \return the dictionary, empty if there is none
+///
+////////////////////////////////////////////////////////////
+const CompressionDictionary& InternalComm::GetCompressionDictionary()
+{
+	return s_compressionDictionary;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Record the realtime packets that are sent, to train
+/// a dictionary from a real game
+///
+/// \param a_maxPackets the number of packets to keep, 0 to
+/// stop the capture and forget the packets
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SetTrafficCapture(size_t a_maxPackets)
+{
+	s_captureMutex.lock();
+
+	s_captureSize = a_maxPackets;
+
+	if (a_maxPackets == 0)
+		s_capturedTraffic.clear();
+
+	s_captureMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Record a realtime packet if the capture is running
+///
+/// \param a_data the packet, with its command
+///
+/// \param a_size the size of the packet
+///
+////////////////////////////////////////////////////////////
+void InternalComm::CaptureTraffic(const char* a_data, size_t a_size)
+{
+	if (s_captureSize == 0) // the usual case, without any lock
+		return;
+
+	s_captureMutex.lock();
+
+	if (s_capturedTraffic.size() < s_captureSize)
+		s_capturedTraffic.push_back(std::vector<char>(a_data, a_data + a_size));
+
+	s_captureMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the packets recorded by the capture
+///
+/// \return a copy of the packets
+///
+////////////////////////////////////////////////////////////
+std::vector<std::vector<char>> InternalComm::GetCapturedTraffic()
+{
+	s_captureMutex.lock();
+
+	std::vector<std::vector<char>> l_traffic = s_capturedTraffic;
+
+	s_captureMutex.unlock();
+
+	return l_traffic;
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Poll mode] Do all the pending network work : read
+/// the sockets, handle the messages, send the file parts and
+/// run the timers. Never waits on a socket
+///
+/// \param a_budget the maximum time spent, the work continues
+/// while there is something to do and some budget left
+///
+////////////////////////////////////////////////////////////
+void InternalComm::Poll(sf::Time a_budget)
+{
+	if (!s_isPollMode)
+		throw NetworkException("Error : Poll can only be used in poll mode, the threads already do the work");
+
+	sf::Clock l_clock;
+
+	bool l_hasWork;
+
+	do // at least one pass, even with an empty budget
+	{
+		UdpHandler::PollUdpSharingSystem();
+
+		l_hasWork = false;
+
+		if (s_server != NULL && s_server->Poll())
+			l_hasWork = true;
+
+		if (s_client != NULL && s_client->Poll())
+			l_hasWork = true;
+
+		if (TransfertScheduler::Poll())
+			l_hasWork = true;
+	}
+	while (l_hasWork && l_clock.getElapsedTime() < a_budget);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Let the network objects accept or
+/// reject the commands received from the clients. Must be
+/// called regularly by the game thread (once per frame), unless
+/// SetDeferredCommands(false) was called
+///
+/// \return the number of commands handled
+///
+////////////////////////////////////////////////////////////
+int InternalComm::HandleReceivedCommands()
+{
+	if (s_server == NULL || !s_isDeferredCommands) // else the server thread is the only consumer of the queue
+		return 0;
+
+	return s_server->HandleReceivedCommands();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read a received packet and put the data in a NetworkData
+///
+/// \param a_packet the packet we need to read
+///
+/// \param a_data the data in wich we will put the variables read.
+///
+/// \return if the reading is a success
+///
+////////////////////////////////////////////////////////////
+bool InternalComm::ReadCommand(sf::Packet& a_packet, NetworkData& a_data)
 {
 	// for now similar to an object
-	WriteObject(a_packet, a_data);
+	return ReadObject(a_packet, a_data);
 }
 
 
@@ -381,36 +814,131 @@ void InternalComm::NewObjectsWasHandled()
 
 
 ////////////////////////////////////////////////////////////
-/// \brief [Client side] Send a received command from the server to
-/// the specified object in the command
+/// \brief [Server side] Get the ids of the objects destroyed
+/// since the last syncronization
 ///
-/// \param a_command the received command
+/// \return the list of the destroyed ids
 ///
 ////////////////////////////////////////////////////////////
-void InternalComm::SendCommandToObject(Command& a_command)
+std::vector<sf::Uint16>& InternalComm::GetDeletedObjects()
 {
-	NetworkObject::GetObjectList()[a_command.GetData().GetId()]->ReceiveCommand(a_command);
+	return s_deletedObjects;
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief Write an object data in a packet for transmition
-/// this uses the Object Protocol (Read Me)
+/// \brief [Server side] indicate that the server has sent
+/// the deletions to all clients
+///
+////////////////////////////////////////////////////////////
+void InternalComm::DeletedObjectsWasHandled()
+{
+	s_deletedObjects.clear();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Give back the memory and the ids of
+/// the destroyed objects, once their deletion was sent to all
+/// clients. The objects lock must be held
 ///
-/// \param a_packet the packet in wich we will write
+////////////////////////////////////////////////////////////
+void InternalComm::ReleaseDestroyedObjects()
+{
+	for (DestroyedObject& object : s_destroyedObjects)
+	{
+		(*object.m_release)(object.m_slot);
+
+		NetworkObject::ReleaseId(object.m_id);
+	}
+
+	s_destroyedObjects.clear();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the lock of the list of the objects and of the
+/// new and the destroyed ones, the game thread spawns and
+/// destroys objects while the server thread sends them
 ///
-/// \param a_data the data we need to write
+/// \return the lock of the objects lists
 ///
 ////////////////////////////////////////////////////////////
-void InternalComm::WriteObject(sf::Packet& a_packet, const NetworkData& a_data)
+std::mutex& InternalComm::GetObjectsMutex()
 {
-	sf::Uint8 l_nbData = a_data.GetData().size();
+	return s_objectsMutex;
+}
 
-	a_packet << a_data.GetId() << l_nbData;
 
-	for (const Data& data : a_data.GetData())
+////////////////////////////////////////////////////////////
+/// \brief Destroy a network object, its memory and its id
+/// will be reused by the next objects. From server side, the
+/// deletion is sent to all clients, and the memory and the id
+/// are only reused once the server thread has sent it
+///
+/// \param a_object the object to destroy
+///
+////////////////////////////////////////////////////////////
+void InternalComm::DestroyObject(NetworkObject* a_object)
+{
+	std::map<std::string, std::pair<DestroyMethod, ReleaseMethod>>::iterator l_destroy = s_destroyMap.find(a_object->GetTypeName());
+
+	if (l_destroy == s_destroyMap.end())
+		throw NetworkException("Error : the type of the object to destroy is unknown!");
+
+	if (s_server == NULL) // no id to give back, the memory is reused now
 	{
-		WriteVariable(a_packet, data);
+		(*l_destroy->second.second)((*l_destroy->second.first)(a_object));
+
+		return;
 	}
+
+	sf::Uint16 l_id = (sf::Uint16)a_object->GetId();
+
+	bool l_isKnown = true;
+
+	s_objectsMutex.lock();
+
+	std::vector<NetworkObject*>::iterator l_new = std::find(s_newObjects.begin(), s_newObjects.end(), a_object);
+
+	if (l_new != s_newObjects.end()) // the clients do not know it yet
+	{
+		s_newObjects.erase(l_new);
+
+		l_isKnown = false;
+	}
+
+	s_objectsMutex.unlock();
+
+	void* l_slot = (*l_destroy->second.first)(a_object); // outside of the lock, the destructor can destroy other objects
+
+	DestroyedObject l_destroyed;
+
+	l_destroyed.m_id = l_id;
+	l_destroyed.m_slot = l_slot;
+	l_destroyed.m_release = l_destroy->second.second;
+
+	s_objectsMutex.lock();
+
+	if (l_isKnown)
+		s_deletedObjects.push_back(l_id); // sent before the next creations, so the id can be reused
+
+	s_destroyedObjects.push_back(l_destroyed); // released by the server thread after the deletion is sent
+
+	s_objectsMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Send a received command from the server to
+/// the specified object in the command
+///
+/// \param a_command the received command
+///
+////////////////////////////////////////////////////////////
+void InternalComm::SendCommandToObject(Command& a_command)
+{
+	NetworkObject::GetObjectList()[a_command.GetData().GetId()]->ReceiveCommand(a_command);
 }
 
 ////////////////////////////////////////////////////////////
@@ -426,18 +954,25 @@ void InternalComm::WriteObject(sf::Packet& a_packet, const NetworkData& a_data)
 ////////////////////////////////////////////////////////////
 bool InternalComm::ReadObject(sf::Packet& a_packet, NetworkData& a_data)
 {
-	sf::Uint8 l_numberVariable;
+	sf::Uint32 l_numberVariable;
 	sf::Uint16 l_idObject;
 
-	if (!(a_packet >> l_idObject >> l_numberVariable))
+	if (!(a_packet >> l_idObject) || !ReadVarint(a_packet, l_numberVariable))
+	{
+		return false;
+	}
+
+	if (l_numberVariable > a_packet.getDataSize()) // each variable takes several bytes, so the count is corrupted
 	{
 		return false;
 	}
 	a_data.SetId(l_idObject);
 
+	a_data.GetAlterableData().reserve(a_data.GetData().size() + l_numberVariable); // one allocation for all the variables
+
 	try
 	{
-		for (int j = 0; j < l_numberVariable; j++)
+		for (sf::Uint32 j = 0; j < l_numberVariable; j++)
 		{
 			a_data << ReadVariable(a_packet);
 		}
@@ -452,74 +987,61 @@ bool InternalComm::ReadObject(sf::Packet& a_packet, NetworkData& a_data)
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Write the a variable in a packet, this uses the Variable Protocol (Read Me)
+/// \brief Read a count written by WriteVarint
 ///
-/// \param a_packet the packet in wich we will write the variable
+/// \param a_packet the packet we need to read
 ///
-/// \param a_data the data that we will write
+/// \param a_value the value read
+///
+/// \return if the reading is a success
 ///
 ////////////////////////////////////////////////////////////
-void InternalComm::WriteVariable(sf::Packet& a_packet, const Data& a_data)
+bool InternalComm::ReadVarint(sf::Packet& a_packet, sf::Uint32& a_value)
 {
+	size_t l_length;
 
-	// TODO : add support for Color (4*8bits = 32bits)
-	// TODO : add support for vector2f (2*32bits) (no support for vector2 as double)
-	// TODO : reduce the size of the function (1 line per case)
+	return ReadVarint(a_packet, a_value, l_length);
+}
 
-	a_packet << a_data.m_id << (sf::Uint8)a_data.m_type;
 
-	switch (a_data.m_type)
-	{
-	case DT_bool:
-	{
-		const bool* l_bool = static_cast<const bool*>(a_data.m_data);
-		a_packet << *l_bool;
-		break;
-	}
-	case DT_float:
-	{
-		const float* l_float = static_cast<const float*>(a_data.m_data);
-		a_packet << *l_float;
-		break;
-	}
-	case DT_double:
-	{
-		const double* l_double = static_cast<const double*>(a_data.m_data);
-		a_packet << *l_double;
-		break;
-	}
-	case DT_string:
-	{
-		const std::string* l_string = static_cast<const std::string*>(a_data.m_data);
-		a_packet << *l_string;
-		break;
-	}
-	case DT_Int32:
-	{
-		const sf::Int32* l_int32 = static_cast<const sf::Int32*>(a_data.m_data);
-		a_packet << *l_int32;
-		break;
-	}
-	case DT_Uint32:
-	{
-		const sf::Uint32* l_uint32 = static_cast<const sf::Uint32*>(a_data.m_data);;
-		a_packet << *l_uint32;
-		break;
-	}
-	case DT_Uint8:
+////////////////////////////////////////////////////////////
+/// \brief Read a count written by WriteVarint, and the number
+/// of bytes it takes in the packet
+///
+/// \param a_packet the packet we need to read
+///
+/// \param a_value the value read
+///
+/// \param a_length receives the number of bytes read
+///
+/// \return if the reading is a success
+///
+////////////////////////////////////////////////////////////
+bool InternalComm::ReadVarint(sf::Packet& a_packet, sf::Uint32& a_value, size_t& a_length)
+{
+	a_value = 0;
+
+	a_length = 0;
+
+	for (int l_shift = 0; l_shift < 35; l_shift += 7) // 5 bytes at most for 32 bits
 	{
-		const sf::Uint8* l_uint8 = static_cast<const sf::Uint8*>(a_data.m_data);
-		a_packet << *l_uint8;
-		break;
-	}
+		sf::Uint8 l_byte;
 
-	default:
-		throw NetworkException("Error : Bad type while reading!");
-		break;
+		if (!(a_packet >> l_byte))
+			return false;
+
+		a_length++;
+
+		a_value |= (sf::Uint32)(l_byte & 0x7F) << l_shift;
+
+		if ((l_byte & 0x80) == 0)
+			return true;
 	}
 
+	return false; // too long, the packet is corrupted
 }
 
+
 ////////////////////////////////////////////////////////////
 /// \brief Read the next variable in a packet, this uses the Variable Protocol (Read Me)
 ///
@@ -622,6 +1144,8 @@ void InternalComm::ShutDownAllCommunications()
 	CloseServer();
 	CloseClient();
 
+	TransfertScheduler::Stop(); // after the transferts of the server and of the client
+
 	for (InfoServer* server : s_availableServers)
 		delete server;
 }
@@ -645,6 +1169,16 @@ void InternalComm::CloseServer()
 {
 	if (s_server != NULL)
 		delete s_server;
+
+	s_server = NULL;
+
+	s_objectsMutex.lock();
+
+	s_deletedObjects.clear();
+
+	ReleaseDestroyedObjects(); // no client will receive the deletions anymore
+
+	s_objectsMutex.unlock();
 }
 
 ////////////////////////////////////////////////////////////
@@ -655,6 +1189,8 @@ void InternalComm::CloseClient()
 {
 	if (s_client != NULL)
 		delete s_client;
+
+	s_client = NULL;
 }
 
 }
\ No newline at end of file
@@ -23,6 +23,8 @@
 
 #include "Command.h"
 #include "InfoServer.h"
+#include "ObjectPool.h"
+#include "Compression.h"
 
 
 namespace Net
@@ -36,11 +38,29 @@ class Server;
 class Client;
 class NetworkObject;
 class Connection;
+class LoopbackChannel;
 
 ////////////////////////////////////////////////////////////
 // Aliasing
 ////////////////////////////////////////////////////////////
 typedef NetworkObject* (*FactoryMethod)();
+typedef void* (*DestroyMethod)(NetworkObject*);
+typedef void (*ReleaseMethod)(void*);
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] A destroyed object whose memory and id
+/// are kept until its deletion is sent to the clients
+///
+////////////////////////////////////////////////////////////
+struct DestroyedObject
+{
+	sf::Uint16 m_id; ///< The id of the object
+
+	void* m_slot; ///< The memory of the object in the pool of its type
+
+	ReleaseMethod m_release; ///< The function that gives back the memory to the pool
+};
 
 
 
@@ -168,8 +188,21 @@ public:
 	///
 	/// \param a_data the data we need to write
 	///
+	/// \tparam P the packet type, sf::Packet or PacketBuffer
+	///
 	////////////////////////////////////////////////////////////
-	static void WriteObject(sf::Packet& a_packet, const NetworkData& a_data);
+	template<class P>
+	static void WriteObject(P& a_packet, const NetworkData& a_data)
+	{
+		a_packet << a_data.GetId();
+
+		WriteVarint(a_packet, (sf::Uint32)a_data.GetData().size());
+
+		for (const Data& data : a_data.GetData())
+		{
+			WriteVariable(a_packet, data);
+		}
+	}
 
 	////////////////////////////////////////////////////////////
 	/// \brief Read an object in a packet and put the data in a NetworkData
@@ -184,6 +217,58 @@ public:
 	////////////////////////////////////////////////////////////
 	static bool ReadObject(sf::Packet& a_packet, NetworkData& a_data);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Write a count with a variable size : 7 bits per
+	/// byte, the high bit tells that another byte follows. Values
+	/// under 128 take one byte
+	///
+	/// \param a_packet the packet in wich we will write
+	///
+	/// \param a_value the value to write
+	///
+	/// \tparam P the packet type, sf::Packet or PacketBuffer
+	///
+	////////////////////////////////////////////////////////////
+	template<class P>
+	static void WriteVarint(P& a_packet, sf::Uint32 a_value)
+	{
+		while (a_value >= 0x80)
+		{
+			a_packet << (sf::Uint8)(a_value | 0x80);
+
+			a_value >>= 7;
+		}
+
+		a_packet << (sf::Uint8)a_value;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read a count written by WriteVarint
+	///
+	/// \param a_packet the packet we need to read
+	///
+	/// \param a_value the value read
+	///
+	/// \return if the reading is a success
+	///
+	////////////////////////////////////////////////////////////
+	static bool ReadVarint(sf::Packet& a_packet, sf::Uint32& a_value);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read a count written by WriteVarint, and the number
+	/// of bytes it takes in the packet
+	///
+	/// \param a_packet the packet we need to read
+	///
+	/// \param a_value the value read
+	///
+	/// \param a_length receives the number of bytes read
+	///
+	/// \return if the reading is a success
+	///
+	////////////////////////////////////////////////////////////
+	static bool ReadVarint(sf::Packet& a_packet, sf::Uint32& a_value, size_t& a_length);
+
 
 	////////////////////////////////////////////////////////////
 	/// \brief Write the a variable in a packet, this uses the Variable Protocol (Read Me)
@@ -192,8 +277,70 @@ public:
 	///
 	/// \param a_data the data that we will write
 	///
+	/// \tparam P the packet type, sf::Packet or PacketBuffer
+	///
 	////////////////////////////////////////////////////////////
-	static void WriteVariable(sf::Packet& a_packet, const Data& a_data);
+	template<class P>
+	static void WriteVariable(P& a_packet, const Data& a_data)
+	{
+
+		// TODO : add support for Color (4*8bits = 32bits)
+		// TODO : add support for vector2f (2*32bits) (no support for vector2 as double)
+		// TODO : reduce the size of the function (1 line per case)
+
+		a_packet << a_data.m_id << (sf::Uint8)a_data.m_type;
+
+		switch (a_data.m_type)
+		{
+		case DT_bool:
+		{
+			const bool* l_bool = static_cast<const bool*>(a_data.m_data);
+			a_packet << *l_bool;
+			break;
+		}
+		case DT_float:
+		{
+			const float* l_float = static_cast<const float*>(a_data.m_data);
+			a_packet << *l_float;
+			break;
+		}
+		case DT_double:
+		{
+			const double* l_double = static_cast<const double*>(a_data.m_data);
+			a_packet << *l_double;
+			break;
+		}
+		case DT_string:
+		{
+			const std::string* l_string = static_cast<const std::string*>(a_data.m_data);
+			a_packet << *l_string;
+			break;
+		}
+		case DT_Int32:
+		{
+			const sf::Int32* l_int32 = static_cast<const sf::Int32*>(a_data.m_data);
+			a_packet << *l_int32;
+			break;
+		}
+		case DT_Uint32:
+		{
+			const sf::Uint32* l_uint32 = static_cast<const sf::Uint32*>(a_data.m_data);;
+			a_packet << *l_uint32;
+			break;
+		}
+		case DT_Uint8:
+		{
+			const sf::Uint8* l_uint8 = static_cast<const sf::Uint8*>(a_data.m_data);
+			a_packet << *l_uint8;
+			break;
+		}
+
+		default:
+			throw NetworkException("Error : Bad type while reading!");
+			break;
+		}
+
+	}
 
 	////////////////////////////////////////////////////////////
 	/// \brief Read the next variable in a packet, this uses the Variable Protocol (Read Me)
@@ -224,8 +371,15 @@ public:
 	///
 	/// \param a_data the data we need to write
 	///
+	/// \tparam P the packet type, sf::Packet or PacketBuffer
+	///
 	////////////////////////////////////////////////////////////
-	static void WriteCommand(sf::Packet& a_packet, const NetworkData& a_data);
+	template<class P>
+	static void WriteCommand(P& a_packet, const NetworkData& a_data)
+	{
+		// for now similar to an object
+		WriteObject(a_packet, a_data);
+	}
 
 	////////////////////////////////////////////////////////////
 	/// \brief [Client side] Send a received update from the server to
@@ -284,6 +438,50 @@ public:
 	////////////////////////////////////////////////////////////
 	static void NewObjectsWasHandled();
 
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Get the ids of the objects destroyed
+	/// since the last syncronization
+	///
+	/// \return the list of the destroyed ids
+	///
+	////////////////////////////////////////////////////////////
+	static std::vector<sf::Uint16>& GetDeletedObjects();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] indicate that the server has sent
+	/// the deletions to all clients
+	///
+	////////////////////////////////////////////////////////////
+	static void DeletedObjectsWasHandled();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Give back the memory and the ids of
+	/// the destroyed objects, once their deletion was sent to all
+	/// clients. The objects lock must be held
+	///
+	////////////////////////////////////////////////////////////
+	static void ReleaseDestroyedObjects();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the lock of the list of the objects and of the
+	/// new and the destroyed ones, the game thread spawns and
+	/// destroys objects while the server thread sends them
+	///
+	/// \return the lock of the objects lists
+	///
+	////////////////////////////////////////////////////////////
+	static std::mutex& GetObjectsMutex();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destroy a network object, its memory and its id
+	/// will be reused by the next objects. From server side, the
+	/// deletion is sent to all clients
+	///
+	/// \param a_object the object to destroy
+	///
+	////////////////////////////////////////////////////////////
+	static void DestroyObject(NetworkObject* a_object);
+
 	////////////////////////////////////////////////////////////
 	/// \brief this function is the internal connection callback
 	/// it will call the user connection callback
@@ -301,6 +499,27 @@ public:
 	////////////////////////////////////////////////////////////
 	static bool HasRunningServer();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Indicate that an object was destroyed, so its
+	/// encoded state and its hash are not valid anymore
+	///
+	/// \param a_id the id of the object
+	///
+	////////////////////////////////////////////////////////////
+	static void ObjectWasDestroyed(sf::Uint16 a_id);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Get the in process channel if the
+	/// server to connect is running on this application
+	///
+	/// \param a_server the informations about the server to connect
+	///
+	/// \return the loopback channel of the server, NULL if the
+	/// server is not the one of this application
+	///
+	////////////////////////////////////////////////////////////
+	static std::shared_ptr<LoopbackChannel> GetLoopbackChannel(const InfoServer* a_server);
+
 	////////////////////////////////////////////////////////////
 	/// \brief get the flag CanInstanciate, this is a use safety to
 	/// prevent user to manually instanciate NetworkObjects
@@ -310,6 +529,16 @@ public:
 	////////////////////////////////////////////////////////////
 	static bool IsInstanciable();
 
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] get the id that the object being
+	/// instanciated must take
+	///
+	/// \return the id given by the server, -1 if the object must
+	/// take a new id
+	///
+	////////////////////////////////////////////////////////////
+	static int GetForcedId();
+
 
 	////////////////////////////////////////////////////////////
 	/// \brief get the list of all files that must be syncronized
@@ -328,6 +557,220 @@ public:
 	////////////////////////////////////////////////////////////
 	static std::vector<const Connection*> GetNotRespondingConnections();
 
+	////////////////////////////////////////////////////////////
+	/// \brief get the time of the server clock, on the client
+	/// side it is estimated with the clock syncronization
+	///
+	/// \return the server time, zero if there is no connection
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Time GetServerTime();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Choose if the library runs its own threads or if
+	/// everything is done by Poll, from the game loop thread.
+	/// Must be called before starting a server or a client
+	///
+	/// \param a_isPollMode true to run the library with Poll
+	///
+	////////////////////////////////////////////////////////////
+	static void SetPollMode(bool a_isPollMode);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the library is driven by Poll
+	///
+	/// \return true if there is no library thread
+	///
+	////////////////////////////////////////////////////////////
+	static bool IsPollMode();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Choose who gives the received commands
+	/// to the objects. By default the game must call
+	/// HandleReceivedCommands once per frame, without it the
+	/// commands wait until the queue is full then are refused.
+	/// With false the server thread handles them itself, as in
+	/// the previous versions (the game code then runs on the server
+	/// thread)
+	///
+	/// \param a_isDeferred true if the game calls HandleReceivedCommands
+	///
+	////////////////////////////////////////////////////////////
+	static void SetDeferredCommands(bool a_isDeferred);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the received commands wait for the game
+	///
+	/// \return true if the game must call HandleReceivedCommands
+	///
+	////////////////////////////////////////////////////////////
+	static bool IsDeferredCommands();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Limit the bandwidth used by the file transferts,
+	/// so they do not delay the updates and the pings. Each
+	/// client receives file parts with at most a_share of the
+	/// bandwidth that the other frames left unused
+	///
+	/// \param a_bandwidth the bandwidth of a client in bytes per
+	/// second, 0 for no limit (a part is then only sent when the
+	/// send queue of the client is empty)
+	///
+	/// \param a_share the part of the unused bandwidth given to
+	/// the files, between 0 and 1
+	///
+	////////////////////////////////////////////////////////////
+	static void SetFileBandwidth(sf::Uint32 a_bandwidth, float a_share);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the bandwidth of a client for the file
+	/// transferts
+	///
+	/// \return the bandwidth in bytes per second, 0 for no limit
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint32 GetFileBandwidth();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the part of the unused bandwidth given to the
+	/// file transferts
+	///
+	/// \return the share, between 0 and 1
+	///
+	////////////////////////////////////////////////////////////
+	static float GetFileShare();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Enable the compression of the file parts and of
+	/// the frames that stream the world to a new client. It is
+	/// used with a server only if both sides enable it, and a
+	/// part or a frame is only compressed if it shrinks
+	///
+	/// \param a_isEnabled true to compress (the default)
+	///
+	////////////////////////////////////////////////////////////
+	static void SetCompression(bool a_isEnabled);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the compression is enabled
+	///
+	/// \return true if the compression can be used
+	///
+	////////////////////////////////////////////////////////////
+	static bool IsCompressionEnabled();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Choose the directory where the
+	/// received files are cached by content, so a version of a
+	/// file is never downloaded twice, even from another server.
+	/// Must be called before starting a client
+	///
+	/// \param a_directory the directory, empty to disable the
+	/// cache (FILE_CACHE_DIRECTORY by default)
+	///
+	////////////////////////////////////////////////////////////
+	static void SetFileCache(const std::string& a_directory);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the directory of the cache of the received
+	/// files
+	///
+	/// \return the directory, empty if the cache is disabled
+	///
+	////////////////////////////////////////////////////////////
+	static const std::string& GetFileCache();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Limit the size of the cache of the
+	/// received files : when a new entry makes it larger, the
+	/// entries used least recently are removed
+	///
+	/// \param a_bytes the size of the cache in bytes, 0 for no
+	/// limit (FILE_CACHE_BUDGET by default)
+	///
+	////////////////////////////////////////////////////////////
+	static void SetFileCacheBudget(sf::Uint64 a_bytes);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the size limit of the cache of the received
+	/// files
+	///
+	/// \return the size in bytes, 0 for no limit
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint64 GetFileCacheBudget();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Set the dictionary of the realtime
+	/// packets (updates and commands). It is sent to each client
+	/// that accepts the compression when it connects, then the
+	/// packets refer to it. Must be called before starting a
+	/// server
+	///
+	/// \param a_content the dictionary, made by
+	/// CompressionDictionary::Train, empty to remove it
+	///
+	////////////////////////////////////////////////////////////
+	static void SetCompressionDictionary(const std::vector<char>& a_content);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the dictionary of the realtime packets
+	///
+	/// \return the dictionary, empty if there is none
+	///
+	////////////////////////////////////////////////////////////
+	static const CompressionDictionary& GetCompressionDictionary();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Record the realtime packets that are sent, to train
+	/// a dictionary from a real game
+	///
+	/// \param a_maxPackets the number of packets to keep, 0 to
+	/// stop the capture and forget the packets
+	///
+	////////////////////////////////////////////////////////////
+	static void SetTrafficCapture(size_t a_maxPackets);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Record a realtime packet if the capture is running
+	///
+	/// \param a_data the packet, with its command
+	///
+	/// \param a_size the size of the packet
+	///
+	////////////////////////////////////////////////////////////
+	static void CaptureTraffic(const char* a_data, size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the packets recorded by the capture
+	///
+	/// \return a copy of the packets
+	///
+	////////////////////////////////////////////////////////////
+	static std::vector<std::vector<char>> GetCapturedTraffic();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Poll mode] Do all the pending network work : read
+	/// the sockets, handle the messages, send the file parts and
+	/// run the timers. Never waits on a socket
+	///
+	/// \param a_budget the maximum time spent, the work continues
+	/// while there is something to do and some budget left
+	///
+	////////////////////////////////////////////////////////////
+	static void Poll(sf::Time a_budget);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Let the network objects accept or
+	/// reject the commands received from the clients. Must be
+	/// called regularly by the game thread (once per frame), unless
+	/// SetDeferredCommands(false) was called
+	///
+	/// \return the number of commands handled
+	///
+	////////////////////////////////////////////////////////////
+	static int HandleReceivedCommands();
+
 	////////////////////////////////////////////////////////////
 	/// \brief spawn a new object if we are from server side, else
 	/// this will not do anything
@@ -347,15 +790,19 @@ public:
 	{
 		if (s_server != NULL /*&& s_factoryMap.find(typeid(T).name())*/)
 		{
+			RegisterDestroyMethod<T>();
+
 			s_canInstanciate = true;
 
-			T* l_obj = new T(std::forward<Args>(args)...);
+			T* l_obj = ObjectPool<T>::GetPool().Construct(std::forward<Args>(args)...);
 
 			s_canInstanciate = false;
 
 			l_obj->SetTypeName(typeid(T).name());
 
+			s_objectsMutex.lock();
 			s_newObjects.push_back(l_obj);
+			s_objectsMutex.unlock();
 
 			return l_obj;
 		}
@@ -363,6 +810,67 @@ public:
 		return NULL;
 	}
 
+	////////////////////////////////////////////////////////////
+	/// \brief spawn several objects of the same type if we are
+	/// from server side, else this will not do anything
+	///
+	/// The objects are built with their default constructor in
+	/// contiguous memory, then initialized by the given function.
+	/// The clients receive them together, in the same spawn frame
+	///
+	/// \param a_count the number of objects to spawn
+	///
+	/// \param a_init the function called on each object, as
+	/// a_init(T& object, size_t index)
+	///
+	/// \tparam T the class of the objects to instanciate
+	///
+	/// \tparam Init the type of the initialization function
+	///
+	/// \return the new spawned objects
+	///
+	////////////////////////////////////////////////////////////
+	template<class T, class Init>
+	static std::vector<T*> SpawnObjectsFromServer(size_t a_count, Init a_init)
+	{
+		std::vector<T*> l_objects;
+
+		if (s_server != NULL)
+		{
+			RegisterDestroyMethod<T>();
+
+			ObjectPool<T>& l_pool = ObjectPool<T>::GetPool();
+
+			l_pool.Reserve(a_count); // one chunk for the whole batch
+
+			l_objects.reserve(a_count);
+
+			s_canInstanciate = true;
+
+			for (size_t i = 0; i < a_count; i++)
+			{
+				l_objects.push_back(l_pool.Construct());
+			}
+
+			s_canInstanciate = false;
+
+			for (size_t i = 0; i < a_count; i++)
+			{
+				l_objects[i]->SetTypeName(typeid(T).name());
+
+				a_init(*l_objects[i], i);
+			}
+
+			s_objectsMutex.lock();
+
+			s_newObjects.insert(s_newObjects.end(), l_objects.begin(), l_objects.end()); // the initialized values are sent with the creation
+
+			s_objectsMutex.unlock();
+		}
+
+		return l_objects;
+	}
+
 
 	////////////////////////////////////////////////////////////
 	/// \brief add a new instanciable type to allow clients to
@@ -376,6 +884,8 @@ public:
 	{
 		// TODO : check if polymorphism is capable of doing that automatically from the constructor of NetworkObject (Seems not)
 		s_factoryMap[typeid(T).name()] = &InternalComm::InstanciateType<T>;
+
+		RegisterDestroyMethod<T>();
 	}
 
 	////////////////////////////////////////////////////////////
@@ -392,6 +902,44 @@ public:
 		return (*s_factoryMap[a_typeName])();
 	}
 
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] instanciate a network object with
+	/// the id given by the server
+	///
+	/// \param a_factory the factory of the type (see GetFactory)
+	///
+	/// \param a_id the id of the object
+	///
+	/// \return A pointer to the new network object
+	///
+	////////////////////////////////////////////////////////////
+	static NetworkObject* InstanciateType(FactoryMethod a_factory, sf::Uint16 a_id)
+	{
+		s_forcedId = a_id; // the object is directly registered with its final id
+
+		NetworkObject* l_obj = (*a_factory)();
+
+		s_forcedId = -1;
+
+		return l_obj;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] get the factory of a type
+	///
+	/// \param a_typeName the name of the type (typeid(T).name())
+	///
+	/// \return the factory, NULL if the type was not added with
+	/// AddInstanciableType
+	///
+	////////////////////////////////////////////////////////////
+	static FactoryMethod GetFactory(const std::string& a_typeName)
+	{
+		std::map<std::string, FactoryMethod>::iterator l_factory = s_factoryMap.find(a_typeName);
+
+		return l_factory != s_factoryMap.end() ? l_factory->second : NULL;
+	}
+
 
 
 private:
@@ -410,13 +958,63 @@ private:
 	{
 		s_canInstanciate = true;
 
-		NetworkObject* l_obj = new T();
+		NetworkObject* l_obj = ObjectPool<T>::GetPool().Construct();
 
 		s_canInstanciate = false;
 
 		return l_obj;
 	}
 
+	////////////////////////////////////////////////////////////
+	/// \brief This function is call to destroy an object of a
+	/// specific type and give back its memory to the pool
+	///
+	/// \param a_object the object to destroy
+	///
+	/// \tparam T the type of the object
+	///
+	////////////////////////////////////////////////////////////
+	template<class T>
+	static void* DestroyType(NetworkObject* a_object)
+	{
+		return ObjectPool<T>::GetPool().DestroyKeepingSlot(static_cast<T*>(a_object));
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief This function is call to give back the memory of
+	/// a destroyed object to the pool of its type
+	///
+	/// \param a_slot the memory of the object
+	///
+	/// \tparam T the type of the object
+	///
+	////////////////////////////////////////////////////////////
+	template<class T>
+	static void ReleaseType(void* a_slot)
+	{
+		ObjectPool<T>::GetPool().Release(a_slot);
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remember how to destroy the objects of a type,
+	/// only the first call for each type does something
+	///
+	/// \tparam T the type of the objects
+	///
+	////////////////////////////////////////////////////////////
+	template<class T>
+	static void RegisterDestroyMethod()
+	{
+		static bool s_isRegistered = false;
+
+		if (!s_isRegistered)
+		{
+			s_destroyMap[typeid(T).name()] = std::make_pair(&InternalComm::DestroyType<T>, &InternalComm::ReleaseType<T>);
+
+			s_isRegistered = true;
+		}
+	}
+
 
 	////////////////////////////////////////////////////////////
 	// Static member data
@@ -438,12 +1036,44 @@ private:
 
 	static std::map<std::string, FactoryMethod> s_factoryMap; ///< This map is a bit tricky, it store a pointer of a template function capable of instanciate a type
 
+	static std::map<std::string, std::pair<DestroyMethod, ReleaseMethod>> s_destroyMap; ///< Same as s_factoryMap, but for destroying the objects of a type and giving back their memory
+
+	static std::vector<sf::Uint16> s_deletedObjects; ///< The ids of the objects destroyed and not handled yet
+
+	static std::vector<DestroyedObject> s_destroyedObjects; ///< The destroyed objects whose memory and id wait for the deletion to be sent
+
+	static std::mutex s_objectsMutex; ///< Lock of the list of the objects and of the new and the destroyed ones, the game thread spawns and destroys them while the server thread sends them
+
 	static void(*s_newConnectionCallback)(Connection*); ///< The pointer to the callback function to call when a new connection append
 
 	static bool s_canInstanciate; ///< Flag to know if a new network object can be instanciate (use safety)
 
+	static int s_forcedId; ///< The id of the object being instanciated from a creation of the server, -1 if none
+
 	static bool s_isInit; ///< Flag to know if the thread for updating object is currently running 
 
+	static bool s_isPollMode; ///< Flag to know if the library is driven by Poll instead of its threads
+
+	static std::atomic<bool> s_isDeferredCommands; ///< Flag to know if the received commands wait for HandleReceivedCommands
+
+	static std::atomic<sf::Uint32> s_fileBandwidth; ///< The bandwidth of a client for the file transferts in bytes per second, 0 for no limit
+
+	static std::atomic<float> s_fileShare; ///< The part of the unused bandwidth given to the file transferts
+
+	static std::atomic<bool> s_isCompressionEnabled; ///< Flag to know if the file parts and the bulk frames can be compressed
+
+	static std::string s_fileCache; ///< The directory of the cache of the received files, empty if it is disabled
+
+	static sf::Uint64 s_fileCacheBudget; ///< The size limit of the cache of the received files, 0 for no limit
+
+	static CompressionDictionary s_compressionDictionary; ///< The dictionary of the realtime packets, empty if there is none
+
+	static std::atomic<size_t> s_captureSize; ///< The number of realtime packets to record, 0 if the capture is stopped
+
+	static std::vector<std::vector<char>> s_capturedTraffic; ///< The recorded realtime packets
+
+	static std::mutex s_captureMutex; ///< Lock of the recorded packets, they are sent by the server and the client threads
+
 };
 
 }
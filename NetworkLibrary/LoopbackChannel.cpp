@@ -0,0 +1,304 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "LoopbackChannel.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+PacketRing::PacketRing()
+{
+	m_head = 0;
+	m_tail = 0;
+	m_overflowSize = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Producer] Add a frame at the end of the ring, or
+/// of the overflow queue if the ring is full
+///
+/// \param a_frame the frame to add
+///
+////////////////////////////////////////////////////////////
+void PacketRing::Push(const LoopbackFrame& a_frame)
+{
+	if (m_overflowSize.load(std::memory_order_acquire) == 0 && Write(a_frame)) // only the producer adds to the overflow, so it stays empty
+		return;
+
+	m_overflowMutex.lock();
+
+	while (!m_overflow.empty() && Write(m_overflow.front())) // the frames that waited go first
+	{
+		m_overflow.pop_front();
+
+		m_overflowSize--;
+	}
+
+	if (!m_overflow.empty() || !Write(a_frame))
+	{
+		m_overflow.push_back(a_frame);
+
+		m_overflowSize++;
+	}
+
+	m_overflowMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Consumer] Take the oldest frame of the ring, or
+/// of the overflow queue once the ring is empty
+///
+/// \param a_frame the frame that receives the oldest one
+///
+/// \return false if there is nothing to read
+///
+////////////////////////////////////////////////////////////
+bool PacketRing::Pop(LoopbackFrame& a_frame)
+{
+	if (Read(a_frame))
+		return true;
+
+	if (m_overflowSize.load(std::memory_order_acquire) == 0)
+		return false;
+
+	m_overflowMutex.lock();
+
+	bool l_hasRead = Read(a_frame); // the producer may have moved the overflow in the ring in the meantime
+
+	if (!l_hasRead && !m_overflow.empty()) // the ring is empty and the producer can not write in it, so this is the oldest frame
+	{
+		a_frame = std::move(m_overflow.front());
+
+		m_overflow.pop_front();
+
+		m_overflowSize--;
+
+		l_hasRead = true;
+	}
+
+	m_overflowMutex.unlock();
+
+	return l_hasRead;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Producer] Write a frame in the ring
+///
+/// \param a_frame the frame to write
+///
+/// \return false if the ring is full
+///
+////////////////////////////////////////////////////////////
+bool PacketRing::Write(const LoopbackFrame& a_frame)
+{
+	size_t l_tail = m_tail.load(std::memory_order_relaxed);
+
+	if (l_tail - m_head.load(std::memory_order_acquire) == LOOPBACK_RING_SIZE)
+		return false;
+
+	m_frames[l_tail & (LOOPBACK_RING_SIZE - 1)] = a_frame;
+
+	m_tail.store(l_tail + 1, std::memory_order_release); // the frame is written before it becomes visible
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Consumer] Read the oldest frame of the ring
+///
+/// \param a_frame the frame that receives the oldest one
+///
+/// \return false if the ring is empty
+///
+////////////////////////////////////////////////////////////
+bool PacketRing::Read(LoopbackFrame& a_frame)
+{
+	size_t l_head = m_head.load(std::memory_order_relaxed);
+
+	if (l_head == m_tail.load(std::memory_order_acquire))
+		return false;
+
+	LoopbackFrame& l_frame = m_frames[l_head & (LOOPBACK_RING_SIZE - 1)];
+
+	a_frame.m_packet = std::move(l_frame.m_packet); // the ring does not keep the packet alive
+	a_frame.m_frame = std::move(l_frame.m_frame);
+	a_frame.m_session = l_frame.m_session;
+
+	m_head.store(l_head + 1, std::memory_order_release);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+LoopbackChannel::LoopbackChannel()
+{
+	m_session = 0;
+	m_isClosed = false;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Start a new session, the frames of
+/// the previous sessions will be ignored by both sides
+///
+/// \return the id of the new session
+///
+////////////////////////////////////////////////////////////
+sf::Uint32 LoopbackChannel::Open()
+{
+	return ++m_session;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Indicate that the server does not
+/// exist anymore
+///
+////////////////////////////////////////////////////////////
+void LoopbackChannel::Close()
+{
+	m_isClosed = true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the server has been closed
+///
+/// \return true if the server does not exist anymore
+///
+////////////////////////////////////////////////////////////
+bool LoopbackChannel::IsClosed() const
+{
+	return m_isClosed;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Send a packet to the server, the
+/// packet is handed over without any copy
+///
+/// \param a_packet the packet to send, the channel takes it
+///
+/// \param a_session the session of the client
+///
+/// \return false if the server has been closed
+///
+////////////////////////////////////////////////////////////
+bool LoopbackChannel::SendToServer(std::shared_ptr<sf::Packet>& a_packet, sf::Uint32 a_session)
+{
+	if (m_isClosed) // nobody will read it
+		return false;
+
+	LoopbackFrame l_frame;
+
+	l_frame.m_packet = std::move(a_packet);
+	l_frame.m_session = a_session;
+
+	m_toServer.Push(l_frame);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Send a frame to the client, the
+/// frame is shared and not copied
+///
+/// \param a_frame the frame to send
+///
+/// \param a_session the session of the client connection
+///
+/// \return false if the client has opened another session
+///
+////////////////////////////////////////////////////////////
+bool LoopbackChannel::SendToClient(const SharedFrame& a_frame, sf::Uint32 a_session)
+{
+	if (a_session != m_session) // the client ignores the frames of its previous sessions
+		return false;
+
+	LoopbackFrame l_frame;
+
+	l_frame.m_frame = a_frame;
+	l_frame.m_session = a_session;
+
+	m_toClient.Push(l_frame);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Take the next frame sent by the client
+///
+/// \param a_frame the frame that receives the packet
+///
+/// \return false if there is nothing to read
+///
+////////////////////////////////////////////////////////////
+bool LoopbackChannel::ReceiveFromClient(LoopbackFrame& a_frame)
+{
+	return m_toServer.Pop(a_frame);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Client side] Take the next frame sent by the server
+///
+/// \param a_frame the frame that receives the packet
+///
+/// \return false if there is nothing to read
+///
+////////////////////////////////////////////////////////////
+bool LoopbackChannel::ReceiveFromServer(LoopbackFrame& a_frame)
+{
+	return m_toClient.Pop(a_frame);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Read the command type of a packet without
+/// changing its reading position
+///
+/// \param a_packet the packet
+///
+/// \param a_command the command type that was read
+///
+/// \return false if the packet is too short
+///
+////////////////////////////////////////////////////////////
+bool LoopbackChannel::PeekCommand(const sf::Packet& a_packet, sf::Uint16& a_command)
+{
+	if (a_packet.getDataSize() < sizeof(sf::Uint16))
+		return false;
+
+	const sf::Uint8* l_data = static_cast<const sf::Uint8*>(a_packet.getData());
+
+	a_command = (sf::Uint16)((l_data[0] << 8) | l_data[1]); // packets are big endian
+
+	return true;
+}
+}
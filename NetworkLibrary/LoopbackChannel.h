@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+#include "Frame.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define LOOPBACK_RING_SIZE 4096 // frames per direction, must be a power of two
+
+#define LOOPBACK_POLL_DELAY 2 // ms, maximum wait of the server and client loops while a loopback connection is used
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief A packet that travels in a loopback channel
+///
+////////////////////////////////////////////////////////////
+struct LoopbackFrame
+{
+	std::shared_ptr<sf::Packet> m_packet; ///< [Client to server] The packet, the server reads the buffer written by the client without any copy
+
+	SharedFrame m_frame; ///< [Server to client] The frame, the same buffer as the one sent to the other connections
+
+	sf::Uint32 m_session; ///< The session of the local client when the frame was sent
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Lock free ring of frames with one producer and one
+/// consumer
+///
+/// Push must always be called from the same side and Pop from
+/// the other side. The producers of the library are serialized
+/// by the lock of their udp handler, so it is enough.
+/// When the ring is full, the frames wait in an overflow queue
+/// that is drained by the next push or pop, so nothing is lost
+/// and the producer never waits for the consumer
+///
+////////////////////////////////////////////////////////////
+class NET PacketRing
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	PacketRing();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Producer] Add a frame at the end of the ring, or
+	/// of the overflow queue if the ring is full
+	///
+	/// \param a_frame the frame to add
+	///
+	////////////////////////////////////////////////////////////
+	void Push(const LoopbackFrame& a_frame);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Consumer] Take the oldest frame of the ring, or
+	/// of the overflow queue once the ring is empty
+	///
+	/// \param a_frame the frame that receives the oldest one
+	///
+	/// \return false if there is nothing to read
+	///
+	////////////////////////////////////////////////////////////
+	bool Pop(LoopbackFrame& a_frame);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Producer] Write a frame in the ring
+	///
+	/// \param a_frame the frame to write
+	///
+	/// \return false if the ring is full
+	///
+	////////////////////////////////////////////////////////////
+	bool Write(const LoopbackFrame& a_frame);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Consumer] Read the oldest frame of the ring
+	///
+	/// \param a_frame the frame that receives the oldest one
+	///
+	/// \return false if the ring is empty
+	///
+	////////////////////////////////////////////////////////////
+	bool Read(LoopbackFrame& a_frame);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::array<LoopbackFrame, LOOPBACK_RING_SIZE> m_frames; ///< The frames, indexed by position modulo the size
+
+	std::deque<LoopbackFrame> m_overflow; ///< The frames that did not fit in the ring, older frames first
+
+	std::mutex m_overflowMutex; ///< Mutex of the overflow queue, only taken when the ring has been full
+
+	std::atomic<size_t> m_overflowSize; ///< The number of frames in the overflow queue, read without the mutex
+
+	alignas(64) std::atomic<size_t> m_head; ///< The position of the next frame to read, only written by the consumer
+
+	alignas(64) std::atomic<size_t> m_tail; ///< The position of the next frame to write, only written by the producer
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief In process transport between a server and a client
+/// of the same application (CLIENT_AND_SERVER mode)
+///
+/// The packets are handed over through two lock free rings,
+/// so the local player does not pay any socket system call.
+/// The channel is shared by the server and the client, it stays
+/// valid until both have released it
+///
+////////////////////////////////////////////////////////////
+class NET LoopbackChannel
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	LoopbackChannel();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Start a new session, the frames of
+	/// the previous sessions will be ignored by both sides
+	///
+	/// \return the id of the new session
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint32 Open();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Indicate that the server does not
+	/// exist anymore
+	///
+	////////////////////////////////////////////////////////////
+	void Close();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the server has been closed
+	///
+	/// \return true if the server does not exist anymore
+	///
+	////////////////////////////////////////////////////////////
+	bool IsClosed() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Send a packet to the server, the
+	/// packet is handed over without any copy
+	///
+	/// \param a_packet the packet to send, the channel takes it
+	///
+	/// \param a_session the session of the client
+	///
+	/// \return false if the server has been closed
+	///
+	////////////////////////////////////////////////////////////
+	bool SendToServer(std::shared_ptr<sf::Packet>& a_packet, sf::Uint32 a_session);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Send a frame to the client, the
+	/// frame is shared and not copied
+	///
+	/// \param a_frame the frame to send
+	///
+	/// \param a_session the session of the client connection
+	///
+	/// \return false if the client has opened another session
+	///
+	////////////////////////////////////////////////////////////
+	bool SendToClient(const SharedFrame& a_frame, sf::Uint32 a_session);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Take the next frame sent by the client
+	///
+	/// \param a_frame the frame that receives the packet
+	///
+	/// \return false if there is nothing to read
+	///
+	////////////////////////////////////////////////////////////
+	bool ReceiveFromClient(LoopbackFrame& a_frame);
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Client side] Take the next frame sent by the server
+	///
+	/// \param a_frame the frame that receives the packet
+	///
+	/// \return false if there is nothing to read
+	///
+	////////////////////////////////////////////////////////////
+	bool ReceiveFromServer(LoopbackFrame& a_frame);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Read the command type of a packet without
+	/// changing its reading position
+	///
+	/// \param a_packet the packet
+	///
+	/// \param a_command the command type that was read
+	///
+	/// \return false if the packet is too short
+	///
+	////////////////////////////////////////////////////////////
+	static bool PeekCommand(const sf::Packet& a_packet, sf::Uint16& a_command);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	PacketRing m_toServer; ///< The frames from the client to the server
+
+	PacketRing m_toClient; ///< The frames from the server to the client
+
+	std::atomic<sf::Uint32> m_session; ///< The last session opened by the client
+
+	std::atomic<bool> m_isClosed; ///< Flag to know if the server has been closed
+};
+
+}
@@ -28,6 +28,19 @@ NetworkData::NetworkData()
 }
 
 
+////////////////////////////////////////////////////////////
+/// \brief constructor for a scratch NetworkData
+///
+/// \param a_arena the arena where the list of data is stored,
+/// NULL for the heap
+///
+////////////////////////////////////////////////////////////
+NetworkData::NetworkData(ScratchArena* a_arena) : m_data(ScratchAllocator<Data>(a_arena))
+{
+
+}
+
+
 ////////////////////////////////////////////////////////////
 /// \brief equivalent to an add function, it add a data in this package
 ///
@@ -68,7 +81,7 @@ void NetworkData::SetId(sf::Uint16 a_id)
 /// \return the list of all the data
 ///
 ////////////////////////////////////////////////////////////
-const std::vector<Data>& NetworkData::GetData() const
+const DataList& NetworkData::GetData() const
 {
 	return m_data;
 }
@@ -81,7 +94,7 @@ const std::vector<Data>& NetworkData::GetData() const
 /// \return the non constant list of all the data
 ///
 ////////////////////////////////////////////////////////////
-std::vector<Data>& NetworkData::GetAlterableData()
+DataList& NetworkData::GetAlterableData()
 {
 	return m_data;
 }
@@ -23,10 +23,13 @@
 #include "stdafx.h"
 
 #include "Data.h"
+#include "ScratchArena.h"
 
 namespace Net
 {
 
+typedef std::vector<Data, ScratchAllocator<Data>> DataList; ///< The list of the variables of a NetworkData
+
 
 ////////////////////////////////////////////////////////////
 /// \brief This basically represent a serialized object that
@@ -36,6 +39,11 @@ namespace Net
 /// but the user must also used it, since this is also used in
 /// command communication
 ///
+/// A NetworkData decoded from a packet can store its list in
+/// the scratch arena of the receiving thread. Such a NetworkData
+/// must not leave the receive batch, but it can be copied or
+/// assigned to another one (the copy goes to the heap)
+///
 ////////////////////////////////////////////////////////////
 class NET NetworkData
 {
@@ -48,13 +56,22 @@ public:
 	////////////////////////////////////////////////////////////
 	NetworkData();
 
+	////////////////////////////////////////////////////////////
+	/// \brief constructor for a scratch NetworkData
+	///
+	/// \param a_arena the arena where the list of data is stored,
+	/// NULL for the heap
+	///
+	////////////////////////////////////////////////////////////
+	explicit NetworkData(ScratchArena* a_arena);
+
 	////////////////////////////////////////////////////////////
 	/// \brief Get the list of all the variables in this package
 	///
 	/// \return the list of all the data
 	///
 	////////////////////////////////////////////////////////////
-	const std::vector<Data>& GetData() const;
+	const DataList& GetData() const;
 
 	////////////////////////////////////////////////////////////
 	/// \brief Get the list of all the variables in this package
@@ -63,7 +80,7 @@ public:
 	/// \return the non constant list of all the data
 	///
 	////////////////////////////////////////////////////////////
-	std::vector<Data>& GetAlterableData();
+	DataList& GetAlterableData();
 
 	////////////////////////////////////////////////////////////
 	/// \brief get the id of the network object targeted by this NetworkData
@@ -121,7 +138,7 @@ private:
 	sf::Uint16 m_id; ///< Store the id of the concerned network object by this package
 
 	// TODO : use a map with data id as key
-	std::vector<Data> m_data; ///< The list of all syncronizable variables
+	DataList m_data; ///< The list of all syncronizable variables
 };
 
 }
\ No newline at end of file
@@ -30,8 +30,56 @@
 // TODO : give to the end user a interface to modify thoses
 #define CONNECTION_TIMEOUT 1500//ms time for a connection before considered as not responding
 
+#define CONNECTION_DROP_TIMEOUT 10000 //ms without any message before the server close a connection
+
+#define HANDSHAKE_TIMEOUT 5000 //ms for a new TCP connection to send its new connection message
+
+#define PING_INTERVAL 600 //ms without any message before the server ping a client
+
+#define SESSION_GRACE_PERIOD 30000 //ms during which a dropped client can resume its session
+
+#define SESSION_REPLAY_FRAMES 256 //last state frames kept for each TCP client, the ones it missed before a drop are sent again when it resumes its session
+
+#define DEAD_CONNECTION_DELAY 150 //ms before a closed connection is deleted
+
+#define CLOCK_SYNCRO_BURST 8 //number of samples asked at each clock syncronization
+
+#define CLOCK_SYNCRO_INTERVAL 10000 //ms between two clock syncronizations of a client
+
+#define CLOCK_SYNCRO_RETRY 250 //ms before asking again a clock syncronization sample that was lost
+
 #define SERVER_MAX_CONNECTIONS 10
 
+#define SYNCRO_OBJECTS_PER_UPDATE 256 //existing objects sent at most to a new client in each server loop
+
+#define SYNCRO_MAX_PENDING_FRAMES 16 //frames waiting in the send queue of a new client before the server pauses its syncronization
+
+#define SYNCRO_COMPLETE_RESEND 250 //ms before CT_SyncroComplete is sent again to an udp client that has not acknowledged it
+
+#define SESSION_RESEND 250 //ms before CT_Session is sent again to an udp client that has not acknowledged it
+
+#define FRAME_BYTE_BUDGET 1200 //bytes of objects packed in one spawn or update frame (under the usual MTU with the IP, UDP and library headers)
+
+#define FILE_CHUNK_SIZE 32768 //bytes of a file in each part of a transfert, also the unit compared by the file manifests
+
+#define FILE_DELTA_BLOCK 4096 //bytes of the blocks of a client copy that a delta transfert can reuse
+
+#define FILE_DELTA_SCAN 1048576 //bytes of the new version searched for the blocks of the client in each turn of the scheduler
+
+#define FILE_SIGNATURES_PER_PACKET 96 //block signatures in each CT_FileSignatures packet of a client, so the packet fits in one datagram
+
+#define FILE_MAX_BLOCKS (0x7FFFFFFF / FILE_DELTA_BLOCK + 1) //blocks of the largest file (the sizes are sent on 32 bits)
+
+#define FILE_TOKEN_BURST (2 * FILE_CHUNK_SIZE) //bytes of file parts a client can receive at once after a pause, when the file bandwidth is limited
+
+#define FILE_PARTS_IN_FLIGHT 4 //parts of a file sent to a client and not acknowledged yet, enough to keep a high latency link busy
+
+#define FILE_ACK_TIMEOUT 10000 //ms without any acknowledgement of the parts in flight before a transfert to one client fails
+
+#define FILE_PARTS_SUFFIX ".parts" //the hashes of the chunks received by an unfinished transfert are saved in this file, so it can be resumed
+
+#define FILE_DELTA_SUFFIX ".delta" //the new version of a file is built in this temporary file during a delta transfert
+
 
 namespace Net
 {
@@ -88,7 +136,31 @@ enum CommandType
 	CT_CustomCommand,
 	CT_Ping,
 	CT_File,
-	CT_ClockSyncro
+	CT_ClockSyncro,
+	CT_SyncroComplete,
+	CT_Session,
+	CT_WorldHash,
+	CT_FileManifest,
+	CT_FileSignatures,
+	CT_FileDelta,
+	CT_FileAck,
+	CT_Compressed,
+	CT_Dictionary,
+	CT_CommandRefused,
+	CT_FileFailed
+};
+
+////////////////////////////////////////////////////////////
+/// \brief the list of all the deadlines that can be scheduled
+/// in a timer wheel
+///
+////////////////////////////////////////////////////////////
+enum TimerType
+{
+	TT_KeepAlive,       ///< Ping the connection if it was silent for too long
+	TT_Timeout,         ///< Close the connection if it does not answer anymore
+	TT_Handshake,       ///< Close the connection if it never sent its new connection message
+	TT_DeleteConnection ///< Delete a closed connection
 };
 
 ////////////////////////////////////////////////////////////
@@ -18,7 +18,11 @@
 namespace Net
 {
 
-std::map<sf::Uint16, NetworkObject*> NetworkObject::s_networkObjectsList; ///< The list of all network object currently instanciated
+ObjectList NetworkObject::s_networkObjectsList; ///< The list of all network object currently instanciated
+
+std::vector<sf::Uint16> NetworkObject::s_freeIds; ///< The ids of the destroyed objects, reused before giving new ids
+
+std::mutex NetworkObject::s_idsMutex; ///< Lock of the ids, they are taken by the game thread and given back by the server thread
 
 bool NetworkObject::s_threadIsRunning = false; ///< Flag to know if the update thread is running
 
@@ -93,18 +97,55 @@ void NetworkObject::SetCommunicationPriority(CommunicationPriority a_priority)
 ////////////////////////////////////////////////////////////
 NetworkObject::~NetworkObject()
 {
+	InternalComm::GetObjectsMutex().lock(); // the server thread reads the list meanwhile
+
 	s_networkObjectsList.erase(m_networkId);
 
+	InternalComm::GetObjectsMutex().unlock();
+
+	InternalComm::ObjectWasDestroyed((sf::Uint16)m_networkId); // the id is given back by the server once the deletion is sent (ReleaseId)
+
 	delete m_lastSyncronizedData;
 }
 
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Give back the id of a destroyed object,
+/// once its deletion was sent to the clients
+///
+/// \param a_id the id that can be reused
+///
+////////////////////////////////////////////////////////////
+void NetworkObject::ReleaseId(sf::Uint16 a_id)
+{
+	s_idsMutex.lock();
+
+	s_freeIds.push_back(a_id);
+
+	s_idsMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief The network objects live in pools, they are destroyed
+/// with Communication::DestroyObject. Protected so that a
+/// delete of a network object does not compile
+///
+/// \param a_object the memory of the object
+///
+////////////////////////////////////////////////////////////
+void NetworkObject::operator delete(void* a_object)
+{
+	::operator delete(a_object);
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief get the list of all existing network objects
 ///
 /// \return the list of all existing network objects
 ///
 ////////////////////////////////////////////////////////////
-std::map<sf::Uint16, NetworkObject*>& NetworkObject::GetObjectList()
+ObjectList& NetworkObject::GetObjectList()
 {
 	return s_networkObjectsList;
 }
@@ -193,11 +234,15 @@ void NetworkObject::ReceiveUpdate(NetworkData& a_data, bool a_forceId)
 
 	if (a_forceId) //  replace the id
 	{
+		InternalComm::GetObjectsMutex().lock();
+
 		s_networkObjectsList.erase(m_networkId);  // remove
 
 		m_networkId = a_data.GetId();             // change
 
 		s_networkObjectsList[m_networkId] = this; // replace
+
+		InternalComm::GetObjectsMutex().unlock();
 	}
 
 	// quadratic complexity : TODO Use map for NetworkData instead of vector
@@ -242,6 +287,22 @@ void NetworkObject::WasUpdated()
 
 }
 
+////////////////////////////////////////////////////////////
+/// \brief [Server side] Give the relevance of this object for
+/// a client that joins the game, the most relevant objects
+/// are sent first. The user can override this function, for
+/// example with the distance to the player of this client
+///
+/// \param a_client the new client
+///
+/// \return the relevance, the communication priority by default
+///
+////////////////////////////////////////////////////////////
+float NetworkObject::GetRelevance(const Connection* a_client) const
+{
+	return (float)m_priority;
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief get the network id of this object
 ///
@@ -257,14 +318,28 @@ int NetworkObject::GetId() const
 ////////////////////////////////////////////////////////////
 /// \brief [Server side] Get a unique id to attribute to a new object
 ///
-/// From client side, the returned value and the unique id will always
-/// be override by the server
+/// From client side, the id given by the server is directly
+/// used (see InternalComm::GetForcedId)
 ///
 /// \return a unique id
 ///
 ////////////////////////////////////////////////////////////
 int NetworkObject::GetUniqueId()
 {
+	if (InternalComm::GetForcedId() >= 0)
+		return InternalComm::GetForcedId();
+
+	std::lock_guard<std::mutex> l_lock(s_idsMutex);
+
+	if (!s_freeIds.empty()) // the id of a destroyed object, the clients have received its deletion before this creation
+	{
+		int l_id = s_freeIds.back();
+
+		s_freeIds.pop_back();
+
+		return l_id;
+	}
+
 	s_currentId++; // for now, simple way to give ids
 
 	return s_currentId;
@@ -26,10 +26,15 @@
 #include "NetworkData.h"
 #include "InternalComm.h"
 #include "NetworkStruct.h"
+#include "PacketBuffer.h"
 
 namespace Net
 {
 
+class NetworkObject;
+
+typedef std::map<sf::Uint16, NetworkObject*, std::less<sf::Uint16>, PoolAllocator<std::pair<const sf::Uint16, NetworkObject*>>> ObjectList; ///< The registry of the network objects, its nodes are pooled
+
 
 ////////////////////////////////////////////////////////////
 /// \brief Absctract class. Inherit from this class allow objects
@@ -53,8 +58,12 @@ public:
 		if (!InternalComm::IsInstanciable()) //Use safety, end users are not supposed to instanciate manually a network object
 			throw NetworkException("Network objects can only be instanciate with 'SpawnObjectFromServer' or 'InstanciateType'!");
 
+		InternalComm::GetObjectsMutex().lock(); // the server thread reads the list meanwhile
+
 		s_networkObjectsList[m_networkId] = this;
 
+		InternalComm::GetObjectsMutex().unlock();
+
 		m_priority = CP_Normal;
 
 		m_syncronizedData.SetId(m_networkId);
@@ -86,6 +95,19 @@ public:
 	////////////////////////////////////////////////////////////
 	virtual void WasUpdated();
 
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Give the relevance of this object for
+	/// a client that joins the game, the most relevant objects
+	/// are sent first. The user can override this function, for
+	/// example with the distance to the player of this client
+	///
+	/// \param a_client the new client
+	///
+	/// \return the relevance, the communication priority by default
+	///
+	////////////////////////////////////////////////////////////
+	virtual float GetRelevance(const Connection* a_client) const;
+
 	////////////////////////////////////////////////////////////
 	/// \brief The function that internally handle update, it will
 	/// automatically change the value of some variables
@@ -143,7 +165,7 @@ public:
 	/// \return the list of all existing network objects
 	///
 	////////////////////////////////////////////////////////////
-	static std::map<sf::Uint16, NetworkObject*>& GetObjectList();
+	static ObjectList& GetObjectList();
 
 	////////////////////////////////////////////////////////////
 	/// \brief start the update thread
@@ -161,8 +183,27 @@ public:
 	////////////////////////////////////////////////////////////
 	static bool StopUpdateThread();
 
+	////////////////////////////////////////////////////////////
+	/// \brief [Server side] Give back the id of a destroyed object,
+	/// once its deletion was sent to the clients
+	///
+	/// \param a_id the id that can be reused
+	///
+	////////////////////////////////////////////////////////////
+	static void ReleaseId(sf::Uint16 a_id);
+
 protected:
 
+	////////////////////////////////////////////////////////////
+	/// \brief The network objects live in pools, they are destroyed
+	/// with Communication::DestroyObject. Protected so that a
+	/// delete of a network object does not compile
+	///
+	/// \param a_object the memory of the object
+	///
+	////////////////////////////////////////////////////////////
+	static void operator delete(void* a_object);
+
 
 	////////////////////////////////////////////////////////////
 	/// \brief Variatic constructor
@@ -230,8 +271,8 @@ private:
 	////////////////////////////////////////////////////////////
 	/// \brief [Server side] Get a unique id to attribute to a new object
 	///
-	/// From client side, the returned value and the unique id will always
-	/// be override by the server
+	/// From client side, the id given by the server is directly
+	/// used (see InternalComm::GetForcedId)
 	///
 	/// \return a unique id
 	///
@@ -250,7 +291,11 @@ private:
 	// Satic member data
 	////////////////////////////////////////////////////////////
 
-	static std::map<sf::Uint16, NetworkObject*> s_networkObjectsList; ///< The list of all network object currently instanciated
+	static ObjectList s_networkObjectsList; ///< The list of all network object currently instanciated
+
+	static std::vector<sf::Uint16> s_freeIds; ///< The ids of the destroyed objects, reused before giving new ids
+
+	static std::mutex s_idsMutex; ///< Lock of the ids, they are taken by the game thread and given back by the server thread
 
 	static bool s_threadIsRunning; ///< Flag to know if the update thread is running
 
@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define OBJECT_POOL_CHUNK 64 // number of objects allocated at once when a pool has no free slot
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief Storage for the network objects of one type
+///
+/// The objects are built in slots of big contiguous chunks,
+/// and the slot of a destroyed object is reused by the next
+/// one. The memory of the chunks is only freed at the end of
+/// the application
+///
+/// \tparam T the type of the objects
+///
+////////////////////////////////////////////////////////////
+template<class T>
+class ObjectPool
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the pool of the type
+	///
+	/// \return the pool
+	///
+	////////////////////////////////////////////////////////////
+	static ObjectPool& GetPool()
+	{
+		static ObjectPool s_pool;
+
+		return s_pool;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor, free the chunks (the objects still
+	/// alive are not destroyed, they belong to the game)
+	///
+	////////////////////////////////////////////////////////////
+	~ObjectPool()
+	{
+		for (Slot* chunk : m_chunks)
+		{
+			::operator delete(chunk);
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Make sure that several objects can be built
+	/// without allocating, if a chunk is needed it is big
+	/// enough for all of them so they are contiguous
+	///
+	/// \param a_count the number of objects that will be built
+	///
+	////////////////////////////////////////////////////////////
+	void Reserve(size_t a_count)
+	{
+		std::lock_guard<std::mutex> l_lock(m_mutex);
+
+		if (m_numberOfFreeSlots < a_count)
+			AddChunk(a_count);
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Build an object in a free slot
+	///
+	/// \param args parameter package for calling the constructor
+	///
+	/// \tparam Args the parameter package to build the object
+	///
+	/// \return the new object
+	///
+	////////////////////////////////////////////////////////////
+	template<class... Args>
+	T* Construct(Args&&... args)
+	{
+		void* l_slot = TakeSlot();
+
+		try
+		{
+			return new (l_slot) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			GiveBackSlot(l_slot);
+			throw;
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destroy an object built by this pool, its slot
+	/// will be reused
+	///
+	/// \param a_object the object to destroy
+	///
+	////////////////////////////////////////////////////////////
+	void Destroy(T* a_object)
+	{
+		a_object->~T();
+
+		GiveBackSlot(a_object);
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destroy an object built by this pool but keep its
+	/// slot, it must be given back later with Release
+	///
+	/// \param a_object the object to destroy
+	///
+	/// \return the slot of the object
+	///
+	////////////////////////////////////////////////////////////
+	void* DestroyKeepingSlot(T* a_object)
+	{
+		a_object->~T();
+
+		return a_object;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Give back the slot of an object destroyed with
+	/// DestroyKeepingSlot, it will be reused
+	///
+	/// \param a_slot the slot
+	///
+	////////////////////////////////////////////////////////////
+	void Release(void* a_slot)
+	{
+		GiveBackSlot(a_slot);
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of free slots
+	///
+	/// \return the number of objects that can be built without allocating
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetNumberOfFreeSlots() const
+	{
+		return m_numberOfFreeSlots;
+	}
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief A slot of a chunk, it contains an object or a
+	/// link to the next free slot
+	///
+	////////////////////////////////////////////////////////////
+	union Slot
+	{
+		Slot* m_next; ///< The next free slot
+
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type m_object; ///< The storage of the object
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor, the pools are only created by GetPool
+	///
+	////////////////////////////////////////////////////////////
+	ObjectPool()
+	{
+		m_freeSlots = NULL;
+		m_numberOfFreeSlots = 0;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Allocate a new chunk and add its slots at the head
+	/// of the free list, the mutex must be locked
+	///
+	/// \param a_count the minimum number of slots of the chunk
+	///
+	////////////////////////////////////////////////////////////
+	void AddChunk(size_t a_count)
+	{
+		size_t l_chunkSize = a_count > OBJECT_POOL_CHUNK ? a_count : OBJECT_POOL_CHUNK;
+
+		Slot* l_chunk = static_cast<Slot*>(::operator new(l_chunkSize * sizeof(Slot)));
+
+		m_chunks.push_back(l_chunk);
+
+		for (size_t i = l_chunkSize; i > 0; i--) // in reverse, so the slots are taken in the order of the memory
+		{
+			l_chunk[i - 1].m_next = m_freeSlots;
+
+			m_freeSlots = &l_chunk[i - 1];
+		}
+
+		m_numberOfFreeSlots += l_chunkSize;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Take the first free slot
+	///
+	/// \return the slot
+	///
+	////////////////////////////////////////////////////////////
+	void* TakeSlot()
+	{
+		std::lock_guard<std::mutex> l_lock(m_mutex);
+
+		if (m_freeSlots == NULL)
+			AddChunk(1);
+
+		Slot* l_slot = m_freeSlots;
+
+		m_freeSlots = l_slot->m_next;
+		m_numberOfFreeSlots--;
+
+		return l_slot;
+	}
+
+	////////////////////////////////////////////////////////////
+	/// \brief Put a slot back in the free list
+	///
+	/// \param a_slot the slot
+	///
+	////////////////////////////////////////////////////////////
+	void GiveBackSlot(void* a_slot)
+	{
+		std::lock_guard<std::mutex> l_lock(m_mutex);
+
+		Slot* l_slot = static_cast<Slot*>(a_slot);
+
+		l_slot->m_next = m_freeSlots; // the last freed slot is the first reused, it is still in the cache
+
+		m_freeSlots = l_slot;
+		m_numberOfFreeSlots++;
+	}
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::vector<Slot*> m_chunks; ///< All the chunks of the pool
+
+	Slot* m_freeSlots; ///< The first free slot
+
+	size_t m_numberOfFreeSlots; ///< The number of free slots
+
+	std::mutex m_mutex; ///< The objects are built by the game thread and by the client thread
+};
+
+}
@@ -0,0 +1,585 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#include "stdafx.h"
+#include "PacketBuffer.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief A free block of the pool, linked inside its own memory
+///
+////////////////////////////////////////////////////////////
+struct FreeBlock
+{
+	FreeBlock* m_next; ///< The next free block of the same size
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief The free lists of one thread, the blocks are freed
+/// when the thread ends
+///
+////////////////////////////////////////////////////////////
+struct ThreadBlocks
+{
+	FreeBlock* m_lists[BUFFER_POOL_CLASSES]; ///< The free blocks, one list per size
+
+	int m_counts[BUFFER_POOL_CLASSES]; ///< The number of blocks in each list
+
+	ThreadBlocks();
+
+	~ThreadBlocks();
+};
+
+static thread_local ThreadBlocks s_blocks; ///< The free lists of the current thread
+
+static thread_local bool s_areBlocksDestroyed = false; ///< Flag to know if the free lists of the thread were destroyed (the thread is ending)
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+ThreadBlocks::ThreadBlocks()
+{
+	for (int i = 0; i < BUFFER_POOL_CLASSES; i++)
+	{
+		m_lists[i] = NULL;
+		m_counts[i] = 0;
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor, free all the blocks of the thread
+///
+////////////////////////////////////////////////////////////
+ThreadBlocks::~ThreadBlocks()
+{
+	s_areBlocksDestroyed = true; // the blocks released after this are directly freed
+
+	for (int i = 0; i < BUFFER_POOL_CLASSES; i++)
+	{
+		while (m_lists[i] != NULL)
+		{
+			FreeBlock* l_block = m_lists[i];
+
+			m_lists[i] = l_block->m_next;
+
+			::operator delete(l_block);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the size class of a block
+///
+/// \param a_size the asked size
+///
+/// \return the index of the free list, BUFFER_POOL_CLASSES if
+/// the block is too big to be pooled
+///
+////////////////////////////////////////////////////////////
+static int GetSizeClass(size_t a_size)
+{
+	size_t l_blockSize = BUFFER_POOL_MIN_BLOCK;
+
+	int l_class = 0;
+
+	while (l_blockSize < a_size && l_class < BUFFER_POOL_CLASSES)
+	{
+		l_blockSize <<= 1;
+		l_class++;
+	}
+
+	return l_class;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Take a block from the pool of the calling thread
+///
+/// \param a_size the minimum size of the block
+///
+/// \return the block, its real size is GetBlockSize(a_size)
+///
+////////////////////////////////////////////////////////////
+void* BufferPool::Acquire(size_t a_size)
+{
+	int l_class = GetSizeClass(a_size);
+
+	if (l_class == BUFFER_POOL_CLASSES || s_areBlocksDestroyed) // too big, or the thread ends
+		return ::operator new(GetBlockSize(a_size));
+
+	ThreadBlocks& l_blocks = s_blocks;
+
+	if (l_blocks.m_lists[l_class] != NULL)
+	{
+		FreeBlock* l_block = l_blocks.m_lists[l_class];
+
+		l_blocks.m_lists[l_class] = l_block->m_next;
+		l_blocks.m_counts[l_class]--;
+
+		return l_block;
+	}
+
+	return ::operator new(GetBlockSize(a_size));
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Give back a block to the pool of the calling thread
+///
+/// \param a_block the block to release
+///
+/// \param a_size the size that was asked to Acquire
+///
+////////////////////////////////////////////////////////////
+void BufferPool::Release(void* a_block, size_t a_size)
+{
+	if (a_block == NULL)
+		return;
+
+	int l_class = GetSizeClass(a_size);
+
+	if (l_class == BUFFER_POOL_CLASSES || s_areBlocksDestroyed) // too big, or the thread ends
+	{
+		::operator delete(a_block);
+		return;
+	}
+
+	ThreadBlocks& l_blocks = s_blocks;
+
+	if (l_blocks.m_counts[l_class] >= BUFFER_POOL_DEPTH) // the thread already keeps enough blocks
+	{
+		::operator delete(a_block);
+		return;
+	}
+
+	FreeBlock* l_block = static_cast<FreeBlock*>(a_block);
+
+	l_block->m_next = l_blocks.m_lists[l_class];
+
+	l_blocks.m_lists[l_class] = l_block;
+	l_blocks.m_counts[l_class]++;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the real size of the block given for a size
+///
+/// \param a_size the asked size
+///
+/// \return the size of the block
+///
+////////////////////////////////////////////////////////////
+size_t BufferPool::GetBlockSize(size_t a_size)
+{
+	int l_class = GetSizeClass(a_size);
+
+	if (l_class == BUFFER_POOL_CLASSES)
+		return a_size;
+
+	return (size_t)BUFFER_POOL_MIN_BLOCK << l_class;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+PacketBuffer::PacketBuffer()
+{
+	m_storage = m_inline;
+	m_capacity = sizeof(m_inline);
+	m_size = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Move constructor, the pooled block is taken
+///
+////////////////////////////////////////////////////////////
+PacketBuffer::PacketBuffer(PacketBuffer&& other)
+{
+	m_storage = m_inline;
+	m_capacity = sizeof(m_inline);
+	m_size = 0;
+
+	TakeStorage(other);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Move operator, the pooled block is taken
+///
+////////////////////////////////////////////////////////////
+PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other)
+{
+	if (this != &other)
+	{
+		ReleaseStorage();
+
+		TakeStorage(other);
+	}
+
+	return *this;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor, give back the block to the pool
+///
+////////////////////////////////////////////////////////////
+PacketBuffer::~PacketBuffer()
+{
+	ReleaseStorage();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Copy is forbidden, the buffer must be moved
+///
+////////////////////////////////////////////////////////////
+PacketBuffer::PacketBuffer(const PacketBuffer& other)
+{
+	throw NetworkException("Error : illegal operation, packet buffer copy!");
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Copy is forbidden, the buffer must be moved
+///
+////////////////////////////////////////////////////////////
+PacketBuffer& PacketBuffer::operator=(const PacketBuffer& other)
+{
+	throw NetworkException("Error : illegal operation, packet buffer = !");
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Make sure that some data can be written without
+/// changing of storage
+///
+/// \param a_size the size of the data that will be written
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::Reserve(size_t a_size)
+{
+	size_t l_needed = PACKET_BUFFER_HEADER_SIZE + m_size + a_size;
+
+	if (l_needed <= m_capacity)
+		return;
+
+	size_t l_capacity = m_capacity * 2; // grow geometrically, the pool only has power of two blocks anyway
+
+	if (l_capacity < l_needed)
+		l_capacity = l_needed;
+
+	char* l_storage = static_cast<char*>(BufferPool::Acquire(l_capacity));
+
+	std::memcpy(l_storage, m_storage, PACKET_BUFFER_HEADER_SIZE + m_size);
+
+	size_t l_size = m_size;
+
+	ReleaseStorage();
+
+	m_storage = l_storage;
+	m_capacity = BufferPool::GetBlockSize(l_capacity);
+	m_size = l_size;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove all the data, the storage is kept
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::Clear()
+{
+	m_size = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add some bytes at the end of the buffer
+///
+/// \param a_data the bytes to add
+///
+/// \param a_size the number of bytes
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::Append(const void* a_data, size_t a_size)
+{
+	if (a_size == 0)
+		return;
+
+	std::memcpy(Expand(a_size), a_data, a_size);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add some space at the end of the buffer, to write
+/// in it directly (for example with a file read)
+///
+/// \param a_size the number of bytes to add
+///
+/// \return the beginning of the new space
+///
+////////////////////////////////////////////////////////////
+char* PacketBuffer::Expand(size_t a_size)
+{
+	Reserve(a_size);
+
+	char* l_end = m_storage + PACKET_BUFFER_HEADER_SIZE + m_size;
+
+	m_size += a_size;
+
+	return l_end;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Reduce the size of the data
+///
+/// \param a_size the new size, smaller than the current size
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::Truncate(size_t a_size)
+{
+	if (a_size < m_size)
+		m_size = a_size;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the data of the packet
+///
+/// \return the data, without the header
+///
+////////////////////////////////////////////////////////////
+const char* PacketBuffer::GetData() const
+{
+	return m_storage + PACKET_BUFFER_HEADER_SIZE;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the size of the data of the packet
+///
+/// \return the size, without the header
+///
+////////////////////////////////////////////////////////////
+size_t PacketBuffer::GetDataSize() const
+{
+	return m_size;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write the TCP header in the space kept before the
+/// data, the buffer must not change after this
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::WriteHeader()
+{
+	sf::Uint32 l_size = (sf::Uint32)m_size;
+
+	// same header as sf::TcpSocket, so the receivers still use sf::TcpSocket::receive
+	m_storage[0] = (char)((l_size >> 24) & 0xFF);
+	m_storage[1] = (char)((l_size >> 16) & 0xFF);
+	m_storage[2] = (char)((l_size >> 8) & 0xFF);
+	m_storage[3] = (char)(l_size & 0xFF);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the bytes to send on a TCP socket
+///
+/// \return the header (see WriteHeader) and the data
+///
+////////////////////////////////////////////////////////////
+const char* PacketBuffer::GetTcpData() const
+{
+	return m_storage;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the number of bytes to send on a TCP socket
+///
+/// \return the size of the header and the data
+///
+////////////////////////////////////////////////////////////
+size_t PacketBuffer::GetTcpSize() const
+{
+	return PACKET_BUFFER_HEADER_SIZE + m_size;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write a value, with the encoding of sf::Packet
+///
+/// \param a_data the value to write
+///
+/// \return the buffer
+///
+////////////////////////////////////////////////////////////
+PacketBuffer& PacketBuffer::operator<<(bool a_data)
+{
+	return *this << (sf::Uint8)a_data;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Int8 a_data)
+{
+	Append(&a_data, sizeof(a_data));
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Uint8 a_data)
+{
+	Append(&a_data, sizeof(a_data));
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Int16 a_data)
+{
+	return *this << (sf::Uint16)a_data;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Uint16 a_data)
+{
+	char* l_data = Expand(sizeof(a_data)); // big endian
+
+	l_data[0] = (char)(a_data >> 8);
+	l_data[1] = (char)(a_data);
+
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Int32 a_data)
+{
+	return *this << (sf::Uint32)a_data;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Uint32 a_data)
+{
+	char* l_data = Expand(sizeof(a_data)); // big endian
+
+	l_data[0] = (char)(a_data >> 24);
+	l_data[1] = (char)(a_data >> 16);
+	l_data[2] = (char)(a_data >> 8);
+	l_data[3] = (char)(a_data);
+
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Int64 a_data)
+{
+	return *this << (sf::Uint64)a_data;
+}
+
+PacketBuffer& PacketBuffer::operator<<(sf::Uint64 a_data)
+{
+	char* l_data = Expand(sizeof(a_data)); // big endian
+
+	for (int i = 0; i < 8; i++)
+		l_data[i] = (char)(a_data >> (56 - 8 * i));
+
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(float a_data)
+{
+	Append(&a_data, sizeof(a_data)); // like sf::Packet, floating values are not converted
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(double a_data)
+{
+	Append(&a_data, sizeof(a_data)); // like sf::Packet, floating values are not converted
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(const char* a_data)
+{
+	sf::Uint32 l_length = (sf::Uint32)std::strlen(a_data);
+
+	*this << l_length;
+
+	Append(a_data, l_length);
+
+	return *this;
+}
+
+PacketBuffer& PacketBuffer::operator<<(const std::string& a_data)
+{
+	sf::Uint32 l_length = (sf::Uint32)a_data.size();
+
+	*this << l_length;
+
+	Append(a_data.c_str(), l_length);
+
+	return *this;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Give back the pooled block if any, and come back
+/// to the inline storage
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::ReleaseStorage()
+{
+	if (m_storage != m_inline)
+		BufferPool::Release(m_storage, m_capacity);
+
+	m_storage = m_inline;
+	m_capacity = sizeof(m_inline);
+	m_size = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Take the storage of another buffer
+///
+/// \param other the buffer that loses its storage
+///
+////////////////////////////////////////////////////////////
+void PacketBuffer::TakeStorage(PacketBuffer& other)
+{
+	if (other.m_storage == other.m_inline) // small packet, the inline bytes are copied
+	{
+		std::memcpy(m_inline, other.m_inline, PACKET_BUFFER_HEADER_SIZE + other.m_size);
+
+		m_storage = m_inline;
+		m_capacity = sizeof(m_inline);
+	}
+	else
+	{
+		m_storage = other.m_storage;
+		m_capacity = other.m_capacity;
+	}
+
+	m_size = other.m_size;
+
+	other.m_storage = other.m_inline;
+	other.m_capacity = sizeof(other.m_inline);
+	other.m_size = 0;
+}
+
+}
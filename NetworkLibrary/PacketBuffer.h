@@ -0,0 +1,312 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define PACKET_BUFFER_HEADER_SIZE 4 // bytes reserved before the data for the size of the packet (TCP header of sf::TcpSocket)
+
+#define PACKET_BUFFER_INLINE_SIZE 256 // bytes stored inside the buffer itself, enough for pings, commands and small updates
+
+#define BUFFER_POOL_MIN_BLOCK 64 // bytes, the smallest pooled block
+
+#define BUFFER_POOL_CLASSES 12 // the pooled blocks go from 64 bytes to 128 KB (power of two sizes), bigger blocks are not pooled
+
+#define BUFFER_POOL_DEPTH 64 // maximum number of free blocks kept per size and per thread
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief Thread local free lists of memory blocks
+///
+/// Each thread keeps the blocks it has released, so a thread
+/// that sends the same kind of packets all the time reuses
+/// the same blocks and does not call the heap anymore. A block
+/// can be released by another thread than the one that acquired
+/// it, it just changes of free list
+///
+////////////////////////////////////////////////////////////
+class NET BufferPool
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Take a block from the pool of the calling thread
+	///
+	/// \param a_size the minimum size of the block
+	///
+	/// \return the block, its real size is GetBlockSize(a_size)
+	///
+	////////////////////////////////////////////////////////////
+	static void* Acquire(size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Give back a block to the pool of the calling thread
+	///
+	/// \param a_block the block to release
+	///
+	/// \param a_size the size that was asked to Acquire
+	///
+	////////////////////////////////////////////////////////////
+	static void Release(void* a_block, size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the real size of the block given for a size
+	///
+	/// \param a_size the asked size
+	///
+	/// \return the size of the block
+	///
+	////////////////////////////////////////////////////////////
+	static size_t GetBlockSize(size_t a_size);
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Standard allocator that takes its memory in the
+/// buffer pool, for the containers and the shared pointers of
+/// the send paths
+///
+////////////////////////////////////////////////////////////
+template<class T>
+class PoolAllocator
+{
+
+public:
+
+	typedef T value_type;
+
+	PoolAllocator() {}
+
+	template<class U>
+	PoolAllocator(const PoolAllocator<U>&) {}
+
+	T* allocate(size_t a_number)
+	{
+		return static_cast<T*>(BufferPool::Acquire(a_number * sizeof(T)));
+	}
+
+	void deallocate(T* a_pointer, size_t a_number)
+	{
+		BufferPool::Release(a_pointer, a_number * sizeof(T));
+	}
+
+	template<class U>
+	bool operator==(const PoolAllocator<U>&) const { return true; }
+
+	template<class U>
+	bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Buffer where a packet is written before being sent
+///
+/// The encoding is the same as sf::Packet, so the receivers
+/// still read sf::Packet. Small packets are stored inside the
+/// buffer, bigger ones in a block of the buffer pool, and some
+/// space is kept before the data for the TCP header, so the
+/// buffer can be sent without any copy
+///
+////////////////////////////////////////////////////////////
+class NET PacketBuffer
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	PacketBuffer();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Move constructor, the pooled block is taken
+	///
+	////////////////////////////////////////////////////////////
+	PacketBuffer(PacketBuffer&& other);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Move operator, the pooled block is taken
+	///
+	////////////////////////////////////////////////////////////
+	PacketBuffer& operator=(PacketBuffer&& other);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor, give back the block to the pool
+	///
+	////////////////////////////////////////////////////////////
+	~PacketBuffer();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Make sure that some data can be written without
+	/// changing of storage
+	///
+	/// \param a_size the size of the data that will be written
+	///
+	////////////////////////////////////////////////////////////
+	void Reserve(size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove all the data, the storage is kept
+	///
+	////////////////////////////////////////////////////////////
+	void Clear();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add some bytes at the end of the buffer
+	///
+	/// \param a_data the bytes to add
+	///
+	/// \param a_size the number of bytes
+	///
+	////////////////////////////////////////////////////////////
+	void Append(const void* a_data, size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add some space at the end of the buffer, to write
+	/// in it directly (for example with a file read)
+	///
+	/// \param a_size the number of bytes to add
+	///
+	/// \return the beginning of the new space
+	///
+	////////////////////////////////////////////////////////////
+	char* Expand(size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Reduce the size of the data
+	///
+	/// \param a_size the new size, smaller than the current size
+	///
+	////////////////////////////////////////////////////////////
+	void Truncate(size_t a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the data of the packet
+	///
+	/// \return the data, without the header
+	///
+	////////////////////////////////////////////////////////////
+	const char* GetData() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the size of the data of the packet
+	///
+	/// \return the size, without the header
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetDataSize() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write the TCP header in the space kept before the
+	/// data, the buffer must not change after this
+	///
+	////////////////////////////////////////////////////////////
+	void WriteHeader();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the bytes to send on a TCP socket
+	///
+	/// \return the header (see WriteHeader) and the data
+	///
+	////////////////////////////////////////////////////////////
+	const char* GetTcpData() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of bytes to send on a TCP socket
+	///
+	/// \return the size of the header and the data
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetTcpSize() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write a value, with the encoding of sf::Packet
+	///
+	/// \param a_data the value to write
+	///
+	/// \return the buffer
+	///
+	////////////////////////////////////////////////////////////
+	PacketBuffer& operator<<(bool a_data);
+	PacketBuffer& operator<<(sf::Int8 a_data);
+	PacketBuffer& operator<<(sf::Uint8 a_data);
+	PacketBuffer& operator<<(sf::Int16 a_data);
+	PacketBuffer& operator<<(sf::Uint16 a_data);
+	PacketBuffer& operator<<(sf::Int32 a_data);
+	PacketBuffer& operator<<(sf::Uint32 a_data);
+	PacketBuffer& operator<<(sf::Int64 a_data);
+	PacketBuffer& operator<<(sf::Uint64 a_data);
+	PacketBuffer& operator<<(float a_data);
+	PacketBuffer& operator<<(double a_data);
+	PacketBuffer& operator<<(const char* a_data);
+	PacketBuffer& operator<<(const std::string& a_data);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy is forbidden, the buffer must be moved
+	///
+	////////////////////////////////////////////////////////////
+	PacketBuffer(const PacketBuffer& other);
+	PacketBuffer& operator=(const PacketBuffer& other);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Give back the pooled block if any, and come back
+	/// to the inline storage
+	///
+	////////////////////////////////////////////////////////////
+	void ReleaseStorage();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Take the storage of another buffer
+	///
+	/// \param other the buffer that loses its storage
+	///
+	////////////////////////////////////////////////////////////
+	void TakeStorage(PacketBuffer& other);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	char* m_storage; ///< The header and the data, points to m_inline or to a pooled block
+
+	size_t m_capacity; ///< The size of the storage, header included
+
+	size_t m_size; ///< The size of the data, header excluded
+
+	char m_inline[PACKET_BUFFER_HEADER_SIZE + PACKET_BUFFER_INLINE_SIZE]; ///< The storage of the small packets
+};
+
+}
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#include "stdafx.h"
+#include "ScratchArena.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+ScratchArena::ScratchArena()
+{
+	m_currentBlock = 0;
+	m_offset = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor, free all the blocks
+///
+////////////////////////////////////////////////////////////
+ScratchArena::~ScratchArena()
+{
+	for (Block& l_block : m_blocks)
+	{
+		::operator delete(l_block.m_memory);
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Allocate some memory in the arena
+///
+/// \param a_size the size of the memory
+///
+/// \param a_alignment the alignment of the memory, a power of two
+///
+/// \return the memory, valid until the arena is rewound before it
+///
+////////////////////////////////////////////////////////////
+void* ScratchArena::Allocate(size_t a_size, size_t a_alignment)
+{
+	if (m_currentBlock < m_blocks.size())
+	{
+		Block& l_block = m_blocks[m_currentBlock];
+
+		size_t l_start = (m_offset + a_alignment - 1) & ~(a_alignment - 1);
+
+		if (l_start + a_size <= l_block.m_size)
+		{
+			m_offset = l_start + a_size;
+
+			return l_block.m_memory + l_start;
+		}
+
+		m_currentBlock++; // the end of the block is lost until the next rewind
+	}
+
+	// a new block is needed, the blocks of ::operator new are aligned for all the basic types
+	size_t l_blockSize = a_size > SCRATCH_ARENA_BLOCK_SIZE ? a_size : SCRATCH_ARENA_BLOCK_SIZE;
+
+	if (m_currentBlock == m_blocks.size() || m_blocks[m_currentBlock].m_size < l_blockSize) // no free block big enough
+	{
+		Block l_block;
+		l_block.m_memory = static_cast<char*>(::operator new(l_blockSize));
+		l_block.m_size = l_blockSize;
+
+		m_blocks.insert(m_blocks.begin() + m_currentBlock, l_block);
+	}
+
+	m_offset = a_size;
+
+	return m_blocks[m_currentBlock].m_memory;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the current position of the arena
+///
+/// \return the mark to give to Rewind
+///
+////////////////////////////////////////////////////////////
+ScratchMark ScratchArena::GetMark() const
+{
+	ScratchMark l_mark;
+
+	l_mark.m_block = m_currentBlock;
+	l_mark.m_offset = m_offset;
+
+	return l_mark;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Release all the memory allocated after a mark
+///
+/// \param a_mark the mark, taken with GetMark
+///
+////////////////////////////////////////////////////////////
+void ScratchArena::Rewind(const ScratchMark& a_mark)
+{
+	m_currentBlock = a_mark.m_block;
+	m_offset = a_mark.m_offset;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the arena of the calling thread
+///
+/// \return the arena
+///
+////////////////////////////////////////////////////////////
+ScratchArena& ScratchArena::GetThreadArena()
+{
+	static thread_local ScratchArena s_arena;
+
+	return s_arena;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor, mark the arena of the calling thread
+///
+////////////////////////////////////////////////////////////
+ScratchScope::ScratchScope() : m_arena(ScratchArena::GetThreadArena())
+{
+	m_mark = m_arena.GetMark();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor, rewind the arena to the mark
+///
+////////////////////////////////////////////////////////////
+ScratchScope::~ScratchScope()
+{
+	m_arena.Rewind(m_mark);
+}
+
+}
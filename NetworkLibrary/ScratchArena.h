@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define SCRATCH_ARENA_BLOCK_SIZE 16384 // bytes, size of the blocks of the arena (bigger allocations get their own block)
+
+
+namespace Net
+{
+
+
+////////////////////////////////////////////////////////////
+/// \brief A position in a scratch arena
+///
+////////////////////////////////////////////////////////////
+struct ScratchMark
+{
+	size_t m_block; ///< The index of the current block
+
+	size_t m_offset; ///< The first free byte of the current block
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Bump allocator for the short lived data of one
+/// receive batch
+///
+/// An allocation only moves a pointer forward, and nothing is
+/// freed individually : all the memory allocated after a mark
+/// is released at once by rewinding to this mark. The blocks
+/// are kept for the next batches, so the heap is not used
+/// anymore once the arena is warm. Each thread has its own arena
+///
+////////////////////////////////////////////////////////////
+class NET ScratchArena
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	ScratchArena();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor, free all the blocks
+	///
+	////////////////////////////////////////////////////////////
+	~ScratchArena();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Allocate some memory in the arena
+	///
+	/// \param a_size the size of the memory
+	///
+	/// \param a_alignment the alignment of the memory, a power of two
+	///
+	/// \return the memory, valid until the arena is rewound before it
+	///
+	////////////////////////////////////////////////////////////
+	void* Allocate(size_t a_size, size_t a_alignment);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the current position of the arena
+	///
+	/// \return the mark to give to Rewind
+	///
+	////////////////////////////////////////////////////////////
+	ScratchMark GetMark() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Release all the memory allocated after a mark
+	///
+	/// \param a_mark the mark, taken with GetMark
+	///
+	////////////////////////////////////////////////////////////
+	void Rewind(const ScratchMark& a_mark);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the arena of the calling thread
+	///
+	/// \return the arena
+	///
+	////////////////////////////////////////////////////////////
+	static ScratchArena& GetThreadArena();
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy is forbidden, the arena is owned by its thread
+	///
+	////////////////////////////////////////////////////////////
+	ScratchArena(const ScratchArena& other);
+	ScratchArena& operator=(const ScratchArena& other);
+
+	////////////////////////////////////////////////////////////
+	/// \brief A block of memory of the arena
+	///
+	////////////////////////////////////////////////////////////
+	struct Block
+	{
+		char* m_memory; ///< The memory of the block
+
+		size_t m_size; ///< The size of the block
+	};
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::vector<Block> m_blocks; ///< All the blocks, the ones after the current block are free
+
+	size_t m_currentBlock; ///< The index of the block where we allocate
+
+	size_t m_offset; ///< The first free byte of the current block
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Scope of a receive batch, all the memory allocated
+/// in the arena of the thread during the scope is released
+/// when the scope ends
+///
+////////////////////////////////////////////////////////////
+class NET ScratchScope
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor, mark the arena of the calling thread
+	///
+	////////////////////////////////////////////////////////////
+	ScratchScope();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor, rewind the arena to the mark
+	///
+	////////////////////////////////////////////////////////////
+	~ScratchScope();
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy is forbidden, the scope rewinds only once
+	///
+	////////////////////////////////////////////////////////////
+	ScratchScope(const ScratchScope& other);
+	ScratchScope& operator=(const ScratchScope& other);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	ScratchArena& m_arena; ///< The arena of the thread
+
+	ScratchMark m_mark; ///< The position of the arena when the scope started
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Standard allocator that takes its memory in a
+/// scratch arena, or in the heap if it has no arena
+///
+/// The containers copied from a container of the arena, or
+/// assigned with it, use the heap : only the scratch container
+/// itself lives in the arena, so its data can be kept after
+/// the batch by copying or moving it into another container
+///
+////////////////////////////////////////////////////////////
+template<class T>
+class ScratchAllocator
+{
+
+public:
+
+	typedef T value_type;
+
+	typedef std::false_type propagate_on_container_copy_assignment;
+
+	typedef std::false_type propagate_on_container_move_assignment;
+
+	typedef std::false_type propagate_on_container_swap;
+
+	ScratchAllocator() : m_arena(NULL) {}
+
+	explicit ScratchAllocator(ScratchArena* a_arena) : m_arena(a_arena) {}
+
+	template<class U>
+	ScratchAllocator(const ScratchAllocator<U>& other) : m_arena(other.GetArena()) {}
+
+	T* allocate(size_t a_number)
+	{
+		if (m_arena == NULL)
+			return static_cast<T*>(::operator new(a_number * sizeof(T)));
+
+		return static_cast<T*>(m_arena->Allocate(a_number * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* a_pointer, size_t /*a_number*/)
+	{
+		if (m_arena == NULL)
+			::operator delete(a_pointer);
+
+		// the memory of the arena is released by the scope of the batch
+	}
+
+	ScratchAllocator select_on_container_copy_construction() const
+	{
+		return ScratchAllocator(); // a copy goes to the heap, it may outlive the batch
+	}
+
+	ScratchArena* GetArena() const { return m_arena; }
+
+	template<class U>
+	bool operator==(const ScratchAllocator<U>& other) const { return m_arena == other.GetArena(); }
+
+	template<class U>
+	bool operator!=(const ScratchAllocator<U>& other) const { return m_arena != other.GetArena(); }
+
+private:
+
+	ScratchArena* m_arena; ///< The arena, NULL for the heap
+};
+
+}
@@ -15,6 +15,9 @@
 #include "stdafx.h"
 #include "Server.h"
 
+#include "Compression.h"
+#include "TransfertScheduler.h"
+
 namespace Net
 {
 
@@ -57,7 +60,30 @@ Server::Server(const std::string& a_name, bool a_autoConnect, bool a_local, int
 
 	m_maxConnections = a_maxConnections;
 
-	m_serverThread = std::thread(Server::ServerThread, this);
+	m_loopback = std::make_shared<LoopbackChannel>();
+
+	m_loopbackConnection = NULL;
+
+	m_loopbackSession = 0;
+
+	m_hasWarnedCommands = false;
+
+	m_worldHashCheck = 0;
+
+	m_checkedLeaves.fill(0);
+
+	std::random_device l_seed;
+
+	m_tokenGenerator.seed(((sf::Uint64)l_seed() << 32) | l_seed()); // the tokens must not be guessed from the server start time
+
+	m_commandKey = (sf::Uint32)m_tokenGenerator();
+
+	m_syncronizedFiles = InternalComm::GetSyncronizedFiles(); // the next ones are posted by the game thread
+
+	if (InternalComm::IsPollMode()) // the game loop will call Poll, so no thread
+		Start();
+	else
+		m_serverThread = std::thread(Server::ServerThread, this);
 }
 
 
@@ -69,13 +95,16 @@ Server::~Server()
 {
 	m_isRunning = false;
 
-	m_serverThread.join(); // we now expect that the thread will end soon
+	if (m_serverThread.joinable()) // there is no thread in poll mode
+		m_serverThread.join(); // we now expect that the thread will end soon
 
-	for (Connection* connection : m_clients) // TODO : send an end of connection message
-		delete connection;
+	m_loopback->Close(); // the local client keeps the channel alive, but it knows that we are gone
 
-	for (FileTransfer* transfert : m_transferts)
+	for (FileTransfer* transfert : m_transferts) // the transferts use the connections, so they stop first
 		delete transfert;
+
+	for (Connection* connection : m_clients) // TODO : send an end of connection message
+		delete connection;
 }
 
 
@@ -88,7 +117,76 @@ Server::~Server()
 ////////////////////////////////////////////////////////////
 void Server::ClockSyncroForAllClients()
 {
+	PacketBuffer l_packet;
+
+	l_packet << (sf::Uint16)CT_ClockSyncro << (sf::Int64)-1; // no client time : this is a request to start a new syncronization
+
+	SendPacket(l_packet);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the current time of the server clock, this is
+/// the reference clock of all the clients
+///
+/// \return the server time
+///
+////////////////////////////////////////////////////////////
+sf::Time Server::GetTime() const
+{
+	return m_clock.getElapsedTime();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the port used by the server
+///
+/// \return the port of the server (UDP and TCP)
+///
+////////////////////////////////////////////////////////////
+sf::Uint16 Server::GetPort()
+{
+	return m_udpSystem.GetUdpPort();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the in process channel that a client of the
+/// same application uses instead of the sockets
+///
+/// \return the loopback channel of the server
+///
+////////////////////////////////////////////////////////////
+std::shared_ptr<LoopbackChannel> Server::GetLoopbackChannel() const
+{
+	return m_loopback;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Poll mode] Run one loop of the server on the
+/// calling thread, without waiting
+///
+/// \return true if at least one message was received
+///
+////////////////////////////////////////////////////////////
+bool Server::Poll()
+{
+	if (!m_isRunning)
+		return false;
+
+	try
+	{
+		return Update(true);
+	}
+	catch (const NetworkException& ex)
+	{
+		std::cout << std::endl << "Crash by exception : " << ex.what() << std::endl;
 
+		m_isRunning = false; // like the thread, the server stops
+	}
+
+	return false;
 }
 
 
@@ -101,7 +199,7 @@ void Server::ClockSyncroForAllClients()
 ////////////////////////////////////////////////////////////
 void Server::PingOutClient(Connection* a_client)
 {
-	sf::Packet l_packet;
+	PacketBuffer l_packet;
 
 	l_packet << (sf::Uint16)CT_Ping << m_clock.getElapsedTime().asMilliseconds() << true;
 
@@ -155,14 +253,14 @@ void Server::SetCustomInformation(std::string& a_infos)
 ////////////////////////////////////////////////////////////
 void Server::Broadcast(const sf::IpAddress& a_address)
 {
-	sf::Packet l_packet;
+	PacketBuffer l_packet;
 	sf::Uint16 l_broadcastCommand = CT_Broadcast;
 
 	l_packet << l_broadcastCommand << sf::IpAddress::getLocalAddress().toString() << m_udpSystem.GetUdpPort() << m_serverName
 		     << GetNumberOfConnectedClients() << m_maxConnections << m_customInformation;
 
 	std::cout << ".";
-	m_udpSystem.GetUdpSocket().send(l_packet, a_address, BROADCAST_PORT);
+	m_udpSystem.GetUdpSocket().send(l_packet.GetData(), l_packet.GetDataSize(), a_address, BROADCAST_PORT);
 }
 
 
@@ -177,16 +275,43 @@ void Server::Broadcast(const sf::IpAddress& a_address)
 ////////////////////////////////////////////////////////////
 void Server::SendUpdate( std::vector<NetworkData>& a_data, bool a_byBroadcast)
 {
-	sf::Packet l_packet;
+	PacketBuffer l_packet;
+
+	l_packet << (sf::Uint16)CT_UpdateObjects;
 
-	l_packet << (sf::Uint16)CT_UpdateObjects << a_data.size();
+	const size_t l_headerSize = l_packet.GetDataSize();
 
+	// the objects are read until the end of the frame, so there is no count to limit them
 	for (NetworkData& data : a_data)
 	{
+		m_snapshot.Invalidate(data.GetId()); // the joining clients must receive the new state
+
+		m_worldHash.SetDirty(data.GetId());
+
+		RecordChange(data.GetId(), false);
+
+		size_t l_previousSize = l_packet.GetDataSize();
+
 		InternalComm::WriteObject(l_packet, data);
+
+		if (l_packet.GetDataSize() > FRAME_BYTE_BUDGET && l_previousSize > l_headerSize) // the object goes in the next frame
+		{
+			l_packet.Truncate(l_previousSize);
+
+			SendRealtimePacket(l_packet);
+
+			l_packet.Clear();
+
+			l_packet << (sf::Uint16)CT_UpdateObjects;
+
+			InternalComm::WriteObject(l_packet, data);
+		}
 	}
 
-	SendPacket(l_packet);
+	if (l_packet.GetDataSize() > l_headerSize)
+	{
+		SendRealtimePacket(l_packet);
+	}
 }
 
 
@@ -207,13 +332,13 @@ void Server::SendUpdate( std::vector<NetworkData>& a_data, bool a_byBroadcast)
 ////////////////////////////////////////////////////////////
 void Server::SendCommand(NetworkData& a_data, sf::Uint16 a_customCommand, bool a_byBroadcast)
 {
-	sf::Packet l_packet;
+	PacketBuffer l_packet;
 
-	l_packet << (sf::Uint16)CT_CustomCommand << m_serverName << a_customCommand;
+	l_packet << (sf::Uint16)CT_CustomCommand << m_commandKey << a_customCommand;
 
 	InternalComm::WriteCommand(l_packet, a_data);
 
-	SendPacket(l_packet);
+	SendRealtimePacket(l_packet);
 }
 
 
@@ -225,9 +350,9 @@ void Server::SendCommand(NetworkData& a_data, sf::Uint16 a_customCommand, bool a
 ////////////////////////////////////////////////////////////
 void Server::SendDelete(std::vector<sf::Uint16>& a_list)
 {
-	sf::Packet l_packet;
+	PacketBuffer l_packet;
 
-	l_packet << (sf::Uint16)CT_DeleteObject;
+	l_packet << (sf::Uint16)CT_DeleteObject << (sf::Uint16)a_list.size(); // there is at most one deletion per id
 
 	for (sf::Uint16 id : a_list)
 	{
@@ -247,436 +372,1800 @@ void Server::SendDelete(std::vector<sf::Uint16>& a_list)
 ////////////////////////////////////////////////////////////
 void Server::SendPacket(sf::Packet& a_packet)
 {
-	for (Connection* connection : m_clients) //  send the command to every clients currently connected
-	{
-		SendPacketToOneClient(a_packet, connection);
-	}
-}
+	PacketBuffer l_buffer;
 
+	l_buffer.Append(a_packet.getData(), a_packet.getDataSize()); // the only copy, for all the clients
 
+	SendPacket(l_buffer);
+}
 
 
 ////////////////////////////////////////////////////////////
-/// \brief send a packet to only one client over the right 
-/// protocol (UDP or TCP)
+/// \brief send a written buffer to all clients over the
+/// right protocol (UDP or TCP), the buffer can be reused
+/// after this call
 ///
 /// \param a_packet the packet to send
 ///
-/// \param a_client the targeted client
-///
 ////////////////////////////////////////////////////////////
-void Server::SendPacketToOneClient(sf::Packet& a_packet, Connection* a_client)
+void Server::SendPacket(PacketBuffer& a_packet)
 {
-	m_udpSystem.WaitForLock(); // thread safe TODO : lock in SendSocket when possible
+	SharedFrame l_frame = Frame::Create(a_packet); // the frame takes the storage, nothing is copied
 
-	if (a_client->m_isUDPConnection) // UDP
-	{
-		m_udpSystem.GetUdpSocket().send(a_packet, a_client->m_ipAddress, a_client->m_port);
-	}
-	else // TCP
+	m_clientsMutex.lock(); // file transferts can call this from their own thread
+
+	for (Connection* connection : m_clients) //  send the command to every clients currently connected
 	{
-		a_client->m_TCPSocket.send(a_packet);
+		SendFrameToOneClient(l_frame, connection);
 	}
 
-	m_udpSystem.Unlock();
+	m_clientsMutex.unlock();
 }
 
-
 ////////////////////////////////////////////////////////////
-/// \brief This function will handle any new objects that was not
-/// syncronized yet.
+/// \brief send a realtime packet (update or command) to all
+/// clients : it is compressed once with the dictionary, the
+/// clients that received the dictionary get the compressed
+/// frame and the others the packet as it is
+///
+/// \param a_packet the packet to send
 ///
 ////////////////////////////////////////////////////////////
-void Server::HandleNewObjects()
+void Server::SendRealtimePacket(PacketBuffer& a_packet)
 {
-	std::vector<NetworkObject*> l_newObjects = InternalComm::GetNewObjects();
-
-	if (l_newObjects.size() != 0)
-	{
-
-		sf::Packet l_packet;
+	InternalComm::CaptureTraffic(a_packet.GetData(), a_packet.GetDataSize());
 
-		sf::Uint8 l_nbObjects = l_newObjects.size();
+	const CompressionDictionary& l_dictionary = InternalComm::GetCompressionDictionary();
 
-		l_packet << (sf::Uint16)CT_NewObject << l_nbObjects;
+	PacketBuffer l_compressed;
 
-		
+	if (l_dictionary.IsEmpty() || !Compression::CompressFrame(a_packet.GetData(), a_packet.GetDataSize(), l_compressed, &l_dictionary))
+	{
+		SendPacket(a_packet);
 
-		for (NetworkObject* object : l_newObjects)
-		{
-			l_packet << object->GetTypeName();
+		return;
+	}
 
-			InternalComm::WriteObject(l_packet, object->GetSyncronizableData());
-		}
+	SharedFrame l_frame = Frame::Create(a_packet);
 
-		SendPacket(l_packet);
+	SharedFrame l_compressedFrame = Frame::Create(l_compressed); // compressed once, for all the clients
 
-		for (NetworkObject* object : l_newObjects)
-		{
-			object->ConsiderUpToDate(); //  we send it, so we can consider that everything is up to date
-		}
+	m_clientsMutex.lock();
 
-		InternalComm::NewObjectsWasHandled();
+	for (Connection* connection : m_clients)
+	{
+		SendFrameToOneClient(connection->m_hasDictionary ? l_compressedFrame : l_frame, connection);
 	}
+
+	m_clientsMutex.unlock();
 }
 
 
 
 
+
 ////////////////////////////////////////////////////////////
-/// \brief Handle received informations from a client
+/// \brief send a packet to only one client over the right 
+/// protocol (UDP or TCP)
 ///
-/// \param a_packet the received packet
+/// \param a_packet the packet to send
 ///
-/// \param a_idUser the connection at the origin of this packet 
+/// \param a_client the targeted client
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceiveInformation(sf::Packet& a_packet, Connection* a_idUser)
+void Server::SendPacketToOneClient(sf::Packet& a_packet, Connection* a_client)
 {
-	sf::Uint16 l_command;
-
-	try
-	{
-		if (!(a_packet >> l_command))
-		{
-			throw NetworkException("Error : Unreadable message (Command reading)!");
-		}
-			
-		a_idUser->m_lastPing.restart();
-
-		switch (l_command)
-		{
-		case CT_Broadcast: 
-
-			if(!a_idUser->m_isConsideredAlive)// broadcast is not a connection request, so we delete the temp connection
-				delete a_idUser;
-
-			break;
-
-		case CT_CustomCommand: ReceiveCommand(a_packet, a_idUser);       break; 
-		case CT_NewConnection: ReceiveNewConnection(a_packet, a_idUser); break;
-		case CT_Ping:          ReceivePing(a_packet, a_idUser);          break;
-		case CT_File:          ReceiveFile(a_packet, a_idUser);          break;
-		case CT_CheckServer:   ReceiveCheckServer(a_packet, a_idUser);   break;
-		case CT_EndConnection: ReceiveEndConnection(a_packet, a_idUser); break;
-
-		// Update, create and delete objects are not accepted by the server
-		default: throw NetworkException("Error : Unreadable message (Command type)!");
-		}
-
-	}
-	catch (const std::exception&)
-	{
-		// TODO : the message must be resend
-	}
-
+	SendFrameToOneClient(Frame::Create(a_packet), a_client);
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief This is called when the connection was ended from
-/// client side
+/// \brief send a written buffer to only one client over the
+/// right protocol (UDP or TCP), the buffer can be reused
+/// after this call
 ///
-/// \param a_packet the received packet
+/// \param a_packet the packet to send
 ///
-/// \param a_idUser the connection at the origin of this packet 
+/// \param a_client the targeted client
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceiveEndConnection(sf::Packet& a_packet, Connection* a_idUser)
+void Server::SendPacketToOneClient(PacketBuffer& a_packet, Connection* a_client)
 {
-	a_idUser->m_isConsideredAlive = false;
-
-	if (!a_idUser->m_isUDPConnection)
-		a_idUser->m_TCPSocket.disconnect();
+	SendFrameToOneClient(Frame::Create(a_packet), a_client);
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Receive a ping from a client
+/// \brief send a big buffer to only one client, in a
+/// CT_Compressed frame if the client accepts it and if it
+/// shrinks
 ///
-/// \param a_packet the received packet
+/// \param a_packet the packet to send
 ///
-/// \param a_idUser the connection at the origin of this packet 
+/// \param a_client the targeted client
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceivePing(sf::Packet& a_packet, Connection* a_idUser)
+void Server::SendBulkToOneClient(PacketBuffer& a_packet, Connection* a_client)
 {
-	sf::Int32 l_clockTime;
-
-	bool l_mustBeReflected;
-
-	a_packet >> l_clockTime >> l_mustBeReflected;
-
-
-	if (l_mustBeReflected)
+	if (a_client->m_isCompressed && a_packet.GetDataSize() >= COMPRESSION_MIN_SIZE)
 	{
-		sf::Packet l_packet;
+		PacketBuffer l_compressed;
 
-		l_packet << (sf::Uint16)CT_Ping << m_clock.getElapsedTime().asMilliseconds() << false;
+		if (Compression::CompressFrame(a_packet.GetData(), a_packet.GetDataSize(), l_compressed, NULL))
+		{
+			SendPacketToOneClient(l_compressed, a_client);
 
-		SendPacketToOneClient(l_packet, a_idUser); // reflect it
+			return;
+		}
 	}
-}
 
+	SendPacketToOneClient(a_packet, a_client);
+}
 
 ////////////////////////////////////////////////////////////
-/// \brief When the server is non local, the simplest way for a 
-/// client to connect to the server is to used a direct request
-/// This function handle this kind of calls
-///
-/// \param a_packet the received packet
+/// \brief send the dictionary of the realtime packets to a
+/// new client, before any frame that refers to it
 ///
-/// \param a_idUser the connection at the origin of this packet
-/// (supposed temporary)
+/// \param a_client the targeted client
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceiveCheckServer(sf::Packet& a_packet, Connection* a_idUser)
+void Server::SendDictionary(Connection* a_client)
 {
-	if(m_isListening) // if we do not want new connection we do not answer
+	const std::vector<char>& l_content = InternalComm::GetCompressionDictionary().GetContent();
 
-		Broadcast(a_idUser->m_ipAddress);
+	PacketBuffer l_packet;
 
-	//a_idUser is supposed to be a temporary connection, since this is just a call
-	delete a_idUser;
+	l_packet << (sf::Uint16)CT_Dictionary;
+
+	InternalComm::WriteVarint(l_packet, (sf::Uint32)l_content.size());
+
+	l_packet.Append(l_content.data(), l_content.size());
+
+	SendPacketToOneClient(l_packet, a_client);
+
+	a_client->m_hasDictionary = true;
 }
 
+
+
 ////////////////////////////////////////////////////////////
-/// \brief Handle a command received from a client
+/// \brief send a frame to only one client over the right
+/// protocol (UDP or TCP), the frame is not copied
 ///
-/// \param a_packet the received packet
+/// \param a_frame the serialized packet to send
 ///
-/// \param a_idUser the connection at the origin of this packet 
+/// \param a_client the targeted client
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceiveCommand(sf::Packet& a_packet, Connection* a_idUser)
+void Server::SendFrameToOneClient(const SharedFrame& a_frame, Connection* a_client)
 {
-	sf::Uint16 l_customCommand;
-	std::string l_userName;
-
-	if (!(a_packet >> l_userName >> l_customCommand))
-		throw NetworkException("Error : unreadable message (Name reading)!");
-
+	m_udpSystem.WaitForLock(); // thread safe TODO : lock in SendSocket when possible
 
-	if (l_userName != a_idUser->m_name) // TODO: better authentication
-		throw NetworkException("Error : Authentication error!");
+	sf::Uint16 l_command;
 
+	bool l_hasCommand = a_frame->PeekCommand(l_command);
 
-	NetworkData l_data;
+	if (l_hasCommand && (l_command == CT_File || l_command == CT_FileDelta)) // the file parts spend the tokens, the other frames reduce the next refill
+		a_client->m_fileTokens -= a_frame->GetSize();
+	else
+		a_client->m_realtimeBytes += a_frame->GetSize();
 
-	if (InternalComm::ReadCommand(a_packet, l_data))
+	if (a_client->m_isLoopback) // client of this application, the packet is handed over without any socket
 	{
-		Command l_structCommand(l_customCommand, l_data);
-
-		// let the game core decide what to do with this command
-		// this is supposed to be a client side function, but here we simulate a client
-		InternalComm::SendCommandToObject(l_structCommand);
-
-		if(!l_structCommand.IsHandled())
-			throw NetworkException("Error : You must accept ou reject commands in the ReceiveCommand function of your NetworkObjects");
-
-		// if an object must be created because of this command, the info must be sent before reflecting the command 
-		// since the creations will be part of the thread, any new object must be syncro exacly here 
-		HandleNewObjects();
+		// the local client shares the network objects of the server, so it does not need their creations, updates, deletions and commands
+		bool l_isShared = l_hasCommand && (l_command == CT_NewObject || l_command == CT_UpdateObjects 
+			                            || l_command == CT_DeleteObject || l_command == CT_CustomCommand);
 
-		if (l_structCommand.IsValidate())
-		{
-			SendCommand(l_data, l_customCommand); // reflect the command to all clients (lighter that sending the effects)
-		}
+		if (a_client == m_loopbackConnection && !l_isShared && !m_loopback->SendToClient(a_frame, m_loopbackSession)) // the connections of the previous sessions receive nothing
+			a_client->m_isConsideredAlive = false; // the local client has reconnected, the next loopback frame replaces this connection
 	}
-	else
+	else if (a_client->m_isUDPConnection) // UDP
 	{
-		throw NetworkException("Error : Reading command has failed!");
+		m_udpSystem.GetUdpSocket().send(a_frame->GetData(), a_frame->GetSize(), a_client->m_ipAddress, a_client->m_port);
 	}
-}
+	else // TCP
+	{
+		if (l_hasCommand && Frame::IsStateCommand(l_command)) // counted by the client, and replayed if it resumes its session
+		{
+			a_client->m_sentStateFrames++;
 
-////////////////////////////////////////////////////////////
-/// \brief Handle a new connection request from a client
+			a_client->m_stateFrames.push_back(a_frame);
+
+			if (a_client->m_stateFrames.size() > SESSION_REPLAY_FRAMES)
+				a_client->m_stateFrames.pop_front();
+		}
+
+		a_client->SendFrame(a_frame); // the connection keeps a reference on the frame until it is completely sent
+	}
+
+	m_udpSystem.Unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send the frames still waiting in the queues of the
+/// TCP connections (non blocking sockets only)
+///
+////////////////////////////////////////////////////////////
+void Server::FlushSendQueues()
+{
+	m_udpSystem.WaitForLock(); // the queues are filled under the same lock
+
+	for (Connection* connection : m_clients)
+	{
+		if (connection->HasPendingFrames())
+			connection->FlushSendQueue(); // a closed socket is detected by the reception
+	}
+
+	m_udpSystem.Unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief This function will handle any new objects that was not
+/// syncronized yet.
+///
+////////////////////////////////////////////////////////////
+void Server::HandleNewObjects()
+{
+	std::lock_guard<std::mutex> l_lock(InternalComm::GetObjectsMutex()); // the game thread spawns and destroys objects meanwhile
+
+	if (InternalComm::GetDeletedObjects().size() != 0) // before the creations, since they can reuse the ids
+	{
+		const std::vector<sf::Uint16>& l_deleted = InternalComm::GetDeletedObjects();
+
+		for (sf::Uint16 id : l_deleted)
+		{
+			m_snapshot.Invalidate(id);
+
+			m_worldHash.SetDirty(id);
+
+			RecordChange(id, true);
+		}
+
+		for (Connection* client : m_syncronizingClients) // a reused id must not be sent again by a syncronization
+		{
+			std::vector<sf::Uint16>& l_queue = client->m_syncroQueue;
+
+			size_t l_kept = client->m_syncroPosition;
+
+			for (size_t i = client->m_syncroPosition; i < l_queue.size(); i++)
+			{
+				if (std::find(l_deleted.begin(), l_deleted.end(), l_queue[i]) == l_deleted.end())
+					l_queue[l_kept++] = l_queue[i];
+			}
+
+			l_queue.resize(l_kept);
+		}
+
+		SendDelete(InternalComm::GetDeletedObjects());
+
+		InternalComm::DeletedObjectsWasHandled();
+	}
+
+	InternalComm::ReleaseDestroyedObjects(); // the clients have received the deletions, the memory and the ids can be reused
+
+	std::vector<NetworkObject*> l_newObjects = InternalComm::GetNewObjects();
+
+	if (l_newObjects.size() != 0)
+	{
+		SendNewObjects(l_newObjects, NULL);
+
+		for (NetworkObject* object : l_newObjects)
+		{
+			RecordChange((sf::Uint16)object->GetId(), false);
+
+			m_worldHash.SetDirty((sf::Uint16)object->GetId());
+
+			object->ConsiderUpToDate(); //  we send it, so we can consider that everything is up to date
+		}
+
+		InternalComm::NewObjectsWasHandled();
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send the creation of some objects in compact spawn
+/// frames filled up to FRAME_BYTE_BUDGET bytes : the
+/// consecutive objects of the same type share their type name
+///
+/// \param a_objects the objects to create on the clients
+///
+/// \param a_receiver the client to syncronize, NULL for all clients
+///
+////////////////////////////////////////////////////////////
+void Server::SendNewObjects(const std::vector<NetworkObject*>& a_objects, Connection* a_receiver)
+{
+	PacketBuffer l_packet; // the frame
+
+	PacketBuffer l_group; // the objects of the current group, added to the frame when the group is complete
+
+	l_packet << (sf::Uint16)CT_NewObject;
+
+	const size_t l_headerSize = l_packet.GetDataSize();
+
+	size_t l_current = 0;
+
+	// the groups are read until the end of the frame, and the frames are filled up to the byte budget
+	while (l_current < a_objects.size())
+	{
+		const std::string& l_typeName = a_objects[l_current]->GetTypeName();
+
+		size_t l_groupHeaderSize = sizeof(sf::Uint32) + l_typeName.size() + 5; // string and count (5 bytes at most)
+
+		sf::Uint32 l_numberObject = 0;
+
+		bool l_isFrameFull = false;
+
+		l_group.Clear();
+
+		while (l_current < a_objects.size() && a_objects[l_current]->GetTypeName() == l_typeName)
+		{
+			size_t l_previousSize = l_group.GetDataSize();
+
+			m_snapshot.WriteObject(l_group, *a_objects[l_current]); // encoded once for all the clients that join meanwhile
+
+			bool l_isEmptyFrame = l_numberObject == 0 && l_packet.GetDataSize() == l_headerSize; // a bigger object is alone in its frame
+
+			if (l_packet.GetDataSize() + l_groupHeaderSize + l_group.GetDataSize() > FRAME_BYTE_BUDGET && !l_isEmptyFrame)
+			{
+				l_group.Truncate(l_previousSize); // the object goes in the next frame
+
+				l_isFrameFull = true;
+
+				break;
+			}
+
+			l_numberObject++;
+			l_current++;
+		}
+
+		if (l_numberObject != 0)
+		{
+			l_packet << l_typeName;
+
+			InternalComm::WriteVarint(l_packet, l_numberObject);
+
+			l_packet.Append(l_group.GetData(), l_group.GetDataSize());
+		}
+
+		if (l_isFrameFull || l_current == a_objects.size())
+		{
+			if (a_receiver != NULL)
+				SendBulkToOneClient(l_packet, a_receiver); // the objects of a new client share their type names and often their values
+			else
+				SendPacket(l_packet);
+
+			l_packet.Clear(); // the storage is reused by the next frame
+
+			l_packet << (sf::Uint16)CT_NewObject;
+		}
+	}
+}
+
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief Handle received informations from a client
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveInformation(sf::Packet& a_packet, Connection* a_idUser)
+{
+	sf::Uint16 l_command;
+
+	try
+	{
+		if (!(a_packet >> l_command))
+		{
+			throw NetworkException("Error : Unreadable message (Command reading)!");
+		}
+			
+		a_idUser->m_lastPing.restart();
+
+		switch (l_command)
+		{
+		case CT_Broadcast: 
+
+			if(m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser)// broadcast is not a connection request, so we delete the temp connection
+				delete a_idUser;
+
+			break;
+
+		case CT_CustomCommand: ReceiveCommand(a_packet, a_idUser);       break; 
+		case CT_NewConnection: ReceiveNewConnection(a_packet, a_idUser); break;
+		case CT_Ping:          ReceivePing(a_packet, a_idUser);          break;
+		case CT_ClockSyncro:   ReceiveClockSyncro(a_packet, a_idUser);   break;
+		case CT_WorldHash:     ReceiveWorldHash(a_packet, a_idUser);     break;
+		case CT_SyncroComplete: ReceiveSyncroComplete(a_packet, a_idUser); break;
+		case CT_Session:       ReceiveSession(a_packet, a_idUser);       break;
+		case CT_File:          ReceiveFile(a_packet, a_idUser);          break;
+		case CT_FileManifest:  ReceiveFileManifest(a_packet, a_idUser);  break;
+		case CT_FileSignatures: ReceiveFileSignatures(a_packet, a_idUser); break;
+		case CT_FileAck:       ReceiveFileAck(a_packet, a_idUser);       break;
+		case CT_FileFailed:    ReceiveFileFailed(a_packet, a_idUser);    break;
+		case CT_Compressed:    ReceiveCompressed(a_packet, a_idUser);    break;
+		case CT_CheckServer:   ReceiveCheckServer(a_packet, a_idUser);   break;
+		case CT_EndConnection: ReceiveEndConnection(a_packet, a_idUser); break;
+
+		// Update, create and delete objects are not accepted by the server
+		default: throw NetworkException("Error : Unreadable message (Command type)!");
+		}
+
+	}
+	catch (const std::exception&)
+	{
+		// TODO : the message must be resend
+	}
+
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief This is called when the connection was ended from
+/// client side
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveEndConnection(sf::Packet& a_packet, Connection* a_idUser)
+{
+	a_idUser->m_isConsideredAlive = false;
+
+	a_idUser->m_sessionToken = 0; // the client has left on purpose
+
+	if (!a_idUser->m_isUDPConnection)
+		a_idUser->m_TCPSocket.disconnect();
+
+	ScheduleDeletion(a_idUser);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive a clock syncronization request from a client
+/// and send back the server times
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveClockSyncro(sf::Packet& a_packet, Connection* a_idUser)
+{
+	sf::Int64 l_receiveTime = m_clock.getElapsedTime().asMicroseconds();
+
+	sf::Int64 l_clientTime;
+
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser) // only connected clients can syncronize, the client will ask again
+	{
+		delete a_idUser;
+		return;
+	}
+
+	if (!(a_packet >> l_clientTime))
+		throw NetworkException("Error : Unreadable clock syncronization!");
+
+	PacketBuffer l_packet;
+
+	// the client time is sent back, so the client does not need to remember its requests
+	l_packet << (sf::Uint16)CT_ClockSyncro << l_clientTime << l_receiveTime << m_clock.getElapsedTime().asMicroseconds();
+
+	SendPacketToOneClient(l_packet, a_idUser);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive the leaves of the world hash that differ on
+/// a client, and send again the objects of these leaves
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveWorldHash(sf::Packet& a_packet, Connection* a_idUser)
+{
+	sf::Uint32 l_check;
+
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser) // only connected clients are compared
+	{
+		delete a_idUser;
+		return;
+	}
+
+	if (!(a_packet >> l_check))
+		throw NetworkException("Error : reading world hash has failed");
+
+	if (l_check != m_worldHashCheck) // the answer to a previous comparison, our leaves have changed since
+		return;
+
+	std::vector<sf::Uint16> l_deleted;
+
+	std::vector<sf::Uint16> l_resent;
+
+	std::vector<sf::Uint16> l_clientIds;
+
+	size_t l_readSize = sizeof(sf::Uint16) + sizeof(sf::Uint32); // the packet has no reading position, the command and the check were read before
+
+	while (!a_packet.endOfPacket()) // the leaves of the nodes that differ, until the end of the frame
+	{
+		sf::Uint8 l_leaf;
+		sf::Uint64 l_hash;
+		sf::Uint32 l_numberObject;
+		size_t l_length;
+
+		if (!(a_packet >> l_leaf >> l_hash) || !InternalComm::ReadVarint(a_packet, l_numberObject, l_length))
+			throw NetworkException("Error : reading world hash has failed");
+
+		l_readSize += sizeof(sf::Uint8) + sizeof(sf::Uint64) + l_length;
+
+		if (l_numberObject > (a_packet.getDataSize() - l_readSize) / sizeof(sf::Uint16)) // the ids must all be in the packet, so the count is corrupted
+			throw NetworkException("Error : reading world hash has failed");
+
+		l_readSize += l_numberObject * sizeof(sf::Uint16);
+
+		l_clientIds.resize(l_numberObject);
+
+		for (sf::Uint32 i = 0; i < l_numberObject; i++)
+		{
+			if (!(a_packet >> l_clientIds[i]))
+				throw NetworkException("Error : reading world hash has failed");
+		}
+
+		if (l_hash == m_checkedLeaves[l_leaf]) // the node differs because of another leaf
+			continue;
+
+		std::lock_guard<std::mutex> l_lock(InternalComm::GetObjectsMutex()); // the game thread spawns and destroys objects meanwhile
+
+		for (sf::Uint16 id : l_clientIds)
+		{
+			if (NetworkObject::GetObjectList().find(id) == NetworkObject::GetObjectList().end()) // a deletion that the client missed
+				l_deleted.push_back(id);
+		}
+
+		for (sf::Uint32 id = l_leaf; id <= 0xFFFF; id += WORLD_HASH_LEAVES) // we do not know which objects of the leaf differ, so they are all sent
+		{
+			if (NetworkObject::GetObjectList().find((sf::Uint16)id) != NetworkObject::GetObjectList().end())
+				l_resent.push_back((sf::Uint16)id);
+		}
+	}
+
+	if (l_deleted.size() != 0)
+	{
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_DeleteObject << (sf::Uint16)l_deleted.size();
+
+		for (sf::Uint16 id : l_deleted)
+		{
+			l_packet << id;
+		}
+
+		SendPacketToOneClient(l_packet, a_idUser);
+	}
+
+	// the client updates the objects it has, and creates the others. It is not compared again until it is repaired
+	QueueSyncronization(a_idUser, l_resent);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive the acknowledgement of CT_SyncroComplete
+/// from an udp client, the server stops sending it again
 ///
 /// \param a_packet the received packet
 ///
 /// \param a_idUser the connection at the origin of this packet 
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceiveNewConnection(sf::Packet& a_packet, Connection* a_idUser)
+void Server::ReceiveSyncroComplete(sf::Packet& a_packet, Connection* a_idUser)
+{
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser) // the temporary connection of an unknown sender
+	{
+		delete a_idUser;
+		return;
+	}
+
+	std::vector<Connection*>::iterator l_unacknowledged = std::find(m_unacknowledgedSyncros.begin(), m_unacknowledgedSyncros.end(), a_idUser);
+
+	if (l_unacknowledged != m_unacknowledgedSyncros.end())
+		m_unacknowledgedSyncros.erase(l_unacknowledged);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive the acknowledgement of CT_Session from an
+/// udp client, the server stops sending it again
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveSession(sf::Packet& a_packet, Connection* a_idUser)
+{
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser) // the temporary connection of an unknown sender
+	{
+		delete a_idUser;
+		return;
+	}
+
+	std::vector<Connection*>::iterator l_unacknowledged = std::find(m_unacknowledgedSessions.begin(), m_unacknowledgedSessions.end(), a_idUser);
+
+	if (l_unacknowledged != m_unacknowledgedSessions.end())
+		m_unacknowledgedSessions.erase(l_unacknowledged);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive a ping from a client
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceivePing(sf::Packet& a_packet, Connection* a_idUser)
+{
+	sf::Int32 l_clockTime;
+
+	bool l_mustBeReflected;
+
+	a_packet >> l_clockTime >> l_mustBeReflected;
+
+
+	if (l_mustBeReflected)
+	{
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_Ping << m_clock.getElapsedTime().asMilliseconds() << false;
+
+		SendPacketToOneClient(l_packet, a_idUser); // reflect it
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief When the server is non local, the simplest way for a 
+/// client to connect to the server is to used a direct request
+/// This function handle this kind of calls
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet
+/// (supposed temporary)
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveCheckServer(sf::Packet& a_packet, Connection* a_idUser)
+{
+	if(m_isListening) // if we do not want new connection we do not answer
+
+		Broadcast(a_idUser->m_ipAddress);
+
+	//a_idUser is supposed to be a temporary connection, since this is just a call
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser)
+		delete a_idUser;
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Handle a command received from a client
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveCommand(sf::Packet& a_packet, Connection* a_idUser)
+{
+	sf::Uint16 l_customCommand;
+	sf::Uint32 l_commandKey;
+
+	if (!(a_packet >> l_commandKey >> l_customCommand))
+		throw NetworkException("Error : unreadable message (Key reading)!");
+
+	if (a_idUser->m_commandKey == 0 && !a_idUser->m_isLoopback) // no session yet, or a connection that never had one
+		throw NetworkException("Error : Authentication error!");
+
+	if (l_commandKey != a_idUser->m_commandKey) // only the client that received the session knows its key
+		throw NetworkException("Error : Authentication error!");
+
+
+	NetworkData l_data(&ScratchArena::GetThreadArena()); // the queue moves the variables into its own heap list
+
+	if (InternalComm::ReadCommand(a_packet, l_data))
+	{
+		// the game core decides what to do with this command at its own tick (HandleReceivedCommands)
+		if (!m_receivedCommands.Push(l_customCommand, l_data))
+		{
+			if (!m_hasWarnedCommands) // most likely the game never calls HandleReceivedCommands
+			{
+				std::cout << "Warning : the received commands are refused, the game must call Communication::HandleReceivedCommands once per frame, or SetDeferredCommands(false)" << std::endl;
+				m_hasWarnedCommands = true;
+			}
+
+			// the sender knows that its command will never be handled
+			PacketBuffer l_packet;
+			l_packet << (sf::Uint16)CT_CommandRefused << l_customCommand;
+			SendPacketToOneClient(l_packet, a_idUser);
+		}
+	}
+	else
+	{
+		throw NetworkException("Error : Reading command has failed!");
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Game thread] Let the objects accept or reject the
+/// commands received since the last call, the decisions are
+/// sent back to the server thread
+///
+/// \return the number of commands handled
+///
+////////////////////////////////////////////////////////////
+int Server::HandleReceivedCommands()
+{
+	PendingCommand l_pending;
+
+	int l_numberOfCommands = 0;
+
+	while (!m_commandResults.IsFull() && m_receivedCommands.Pop(l_pending)) // if the server is late, the next commands wait the next tick
+	{
+		Command l_structCommand(l_pending.m_commandCode, l_pending.m_data);
+
+		// let the game core decide what to do with this command
+		// this is supposed to be a client side function, but here we simulate a client
+		InternalComm::SendCommandToObject(l_structCommand);
+
+		if (!l_structCommand.IsHandled())
+			throw NetworkException("Error : You must accept ou reject commands in the ReceiveCommand function of your NetworkObjects");
+
+		l_pending.m_isAccepted = l_structCommand.IsValidate();
+
+		m_commandResults.Push(l_pending);
+
+		l_numberOfCommands++;
+	}
+
+	return l_numberOfCommands;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Reflect the commands accepted by the game to all
+/// clients
+///
+/// \return true if at least one decision was received
+///
+////////////////////////////////////////////////////////////
+bool Server::HandleCommandResults()
+{
+	PendingCommand l_result;
+
+	bool l_hasResult = false;
+
+	while (m_commandResults.Pop(l_result))
+	{
+		// if an object was created because of this command, the info must be sent before reflecting the command
+		HandleNewObjects();
+
+		if (l_result.m_isAccepted)
+			SendCommand(l_result.m_data, l_result.m_commandCode); // reflect the command to all clients (lighter that sending the effects)
+
+		l_hasResult = true;
+	}
+
+	return l_hasResult;
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Handle a new connection request from a client
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the connection at the origin of this packet 
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveNewConnection(sf::Packet& a_packet, Connection* a_idUser)
+{
+	if (!m_isListening) // if we do not accept new connection, we return now
+	{
+		if (a_idUser->m_isUDPConnection) // udp new connections are not supposed to arrive here, but we make sure there is no problem
+			delete &a_idUser; // the temp connection must be delete
+
+		return;
+	}
+
+	if (a_idUser->m_isConsideredAlive && a_idUser->m_isUDPConnection) // udp new connections are not supposed to be marked as alive
+		throw NetworkException("Error : This connection already exist!");
+
+	std::string l_name;
+	sf::Uint16 l_port;
+	bool l_isCompressed; // the client can read the compressed frames
+	sf::Uint64 l_token = 0; // the client gives the token and the received frames of its previous session, if it wants to resume it
+	sf::Uint32 l_receivedFrames = 0;
+
+	if (!(a_packet >> l_name >> l_port >> l_isCompressed) || (!a_packet.endOfPacket() && !(a_packet >> l_token >> l_receivedFrames)))
+	{
+		if (a_idUser->m_isUDPConnection)
+			delete &a_idUser; // the temp connection must be delete
+
+		throw NetworkException("Error : New connection failed!");
+	}
+
+	// if we arrive here, we consider the connection as accepted
+	a_idUser->m_isCompressed = l_isCompressed && InternalComm::IsCompressionEnabled() && !a_idUser->m_isLoopback; // nothing to gain without a socket
+
+	if (a_idUser->m_isUDPConnection)
+	{
+		a_idUser->m_name = l_name;
+		a_idUser->m_port = l_port;
+
+		AddNewUdpUser(a_idUser); // we add this new connection (only if UDP, because if we receive a TCP new connection, the connection is already store)
+	}
+	else
+	{
+		// the client gives its udp port, so we make sure that the previous UDP connection of the same client is deleted (why not let them both ?)
+		RemoveUdpUserIfAny(a_idUser->m_ipAddress, l_port);
+
+		m_clients.SetName(a_idUser, l_name);
+		m_clients.SetAddress(a_idUser, a_idUser->m_ipAddress, l_port); // the TCP connection can now be found from the client address
+
+		m_timers.Schedule(a_idUser->m_deadlineTimer, TT_Timeout, sf::milliseconds(m_clientTimeOut)); // the handshake is done
+	}
+	
+
+	// TODO : NewConnectionCallBack before SyncroNewClient generate 2 players find a way to avoid doing SyncroNewClient if the connexion was refused
+	if (a_idUser->m_isConsideredAlive && !a_idUser->m_isUDPConnection && !a_idUser->m_isLoopback) // only the TCP sessions can be resumed
+	{
+		if (a_idUser->m_isCompressed && !InternalComm::GetCompressionDictionary().IsEmpty()) // before any frame that refers to it
+			SendDictionary(a_idUser);
+
+		for (Connection* connection : m_clients) // the client comes back before we noticed that its previous connection was dropped
+		{
+			if (l_token != 0 && connection != a_idUser && connection->m_sessionToken == l_token)
+			{
+				SuspendSession(connection);
+
+				connection->m_sessionToken = 0;
+
+				ShutConnection(connection);
+
+				break;
+			}
+		}
+
+		bool l_isResumed = l_token != 0 && ResumeSession(a_idUser, l_token, l_receivedFrames); // only the changes since the drop are sent
+
+		a_idUser->m_sessionToken = NewSessionToken();
+
+		SendSession(a_idUser, l_isResumed);
+
+		if (!l_isResumed)
+			SyncroNewClient(a_idUser); // we send the current state of the app to this new client
+	}
+	else if (a_idUser->m_isConsideredAlive) // We do not syncro the client, if it was refused
+	{
+		if (!a_idUser->m_isLoopback) // an udp client has no session to resume, but it needs its command key
+			SendSession(a_idUser, false);
+
+		SyncroNewClient(a_idUser); // we send the current state of the app to this new client
+	}
+	else
+	{
+		CloseConnection(a_idUser);
+	}
+
+	InternalComm::NewConnectionCallBack(a_idUser); // the user can close the connection here
+
+
+}
+
+////////////////////////////////////////////////////////////
+/// \brief set if the server is currently listening
+///
+/// If the server is not listening, it will not broadcast and 
+/// will not accept new connections (TODO : implment this second part)
+///
+/// \param a_listening if the server must listening
+///
+////////////////////////////////////////////////////////////
+void Server::SetListeningState(bool a_listening)
+{
+	m_isListening = a_listening;
+}
+
+////////////////////////////////////////////////////////////
+/// \brief set if the server will accept all new connections
+///
+/// TODO : implement this
+///
+/// \param a_autoAccept if the server must accept all connections
+///
+////////////////////////////////////////////////////////////
+void Server::SetAutoAccept(bool a_autoAccept)
+{
+
+}
+
+////////////////////////////////////////////////////////////
+/// \brief get the list of all the clients of the server
+///
+/// \return the list of all clients
+///
+////////////////////////////////////////////////////////////
+const std::vector<Connection*>& Server::GetClients() const
+{
+	return m_clients.GetConnections();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Close the connection with the server if it exist
+///
+/// \param a_connection The connection to close
+///
+////////////////////////////////////////////////////////////
+void Server::CloseConnection(Connection* a_connection)
+{
+	a_connection->m_sessionToken = 0; // closed on purpose, the client can not resume its session
+
+	ShutConnection(a_connection);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Close a connection without ending its session, so
+/// the client can still resume it
+///
+/// \param a_connection The connection to close
+///
+////////////////////////////////////////////////////////////
+void Server::ShutConnection(Connection* a_connection)
+{
+	if (m_clients.FindBySession(a_connection->m_sessionId) == a_connection)
+	{
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_EndConnection;
+
+		SendPacketToOneClient(l_packet, a_connection);
+
+		if (!a_connection->m_isUDPConnection)
+			a_connection->m_TCPSocket.disconnect();
+
+		a_connection->m_isConsideredAlive = false;
+
+		ScheduleDeletion(a_connection);
+	}
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Handle old clients, it send a ping to all clients 
+/// that have not communicated recently to make sure, they 
+/// are still alive, it delete dead connection and it close 
+/// very old connections that not responding
+///
+////////////////////////////////////////////////////////////
+void Server::HandleOldClients()
+{
+	m_timers.Advance(m_clock.getElapsedTime());
+
+	// receiving a message does not touch the timers, so when a timer expires
+	// we check the last message and we only postpone it if the client was not silent
+	while (Timer* l_timer = m_timers.NextExpired())
+	{
+		Connection* l_connection = static_cast<Connection*>(l_timer->GetOwner());
+
+		int l_lastPing = l_connection->m_lastPing.getElapsedTime().asMilliseconds();
+
+		switch (l_timer->GetType())
+		{
+		case TT_KeepAlive:
+
+			if (!l_connection->m_isConsideredAlive) // refused by the user
+			{
+				CloseConnection(l_connection);
+			}
+			else if (l_lastPing >= PING_INTERVAL) // make sure this client is alive because it have not communicated recently
+			{
+				PingOutClient(l_connection);
+
+				m_timers.Schedule(*l_timer, TT_KeepAlive, sf::milliseconds(PING_INTERVAL));
+			}
+			else
+			{
+				m_timers.Schedule(*l_timer, TT_KeepAlive, sf::milliseconds(PING_INTERVAL - l_lastPing));
+			}
+			break;
+
+		case TT_Timeout:
+
+			// clients that not responding are put in the not responding list that the user can access
+			// and clients that stay silent too long are closed
+			if (l_lastPing >= m_clientTimeOut)
+				ShutConnection(l_connection); // the client may come back after a network drop
+			else
+				m_timers.Schedule(*l_timer, TT_Timeout, sf::milliseconds(m_clientTimeOut - l_lastPing));
+			break;
+
+		case TT_Handshake: CloseConnection(l_connection); break; // the new connection message never came
+
+		case TT_DeleteConnection: DeleteConnection(l_connection); break;
+		}
+	}
+
+	ExpireSessions();
+
+	DeleteCompleteTransferts();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Start the timers of a connection that was just
+/// added to the list of clients
+///
+/// \param a_connection the new connection
+///
+/// \param a_deadline the first deadline of the connection
+/// (TT_Handshake or TT_Timeout)
+///
+/// \param a_delay the time before this deadline
+///
+////////////////////////////////////////////////////////////
+void Server::StartConnectionTimers(Connection* a_connection, TimerType a_deadline, int a_delay)
+{
+	m_timers.Schedule(a_connection->m_keepAliveTimer, TT_KeepAlive, sf::milliseconds(PING_INTERVAL));
+
+	m_timers.Schedule(a_connection->m_deadlineTimer, a_deadline, sf::milliseconds(a_delay));
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Stop to listen a closed connection and schedule
+/// its deletion
+///
+/// \param a_connection the closed connection
+///
+////////////////////////////////////////////////////////////
+void Server::ScheduleDeletion(Connection* a_connection)
+{
+	if (m_clients.FindBySession(a_connection->m_sessionId) != a_connection) // temporary connections are not in the table
+		return;
+
+	if (a_connection->m_deadlineTimer.IsScheduled() && a_connection->m_deadlineTimer.GetType() == TT_DeleteConnection)
+		return; // already done
+
+	a_connection->m_keepAliveTimer.Cancel();
+
+	if (a_connection == m_loopbackConnection) // the local client must open a new session to reconnect
+	{
+		m_udpSystem.WaitForLock();
+
+		m_loopbackConnection = NULL;
+
+		m_udpSystem.Unlock();
+	}
+
+	if (!a_connection->m_isUDPConnection && !a_connection->m_isLoopback)
+		m_selector.remove(a_connection->m_TCPSocket); // a closed socket is always ready, we do not want to read it anymore
+
+	// we wait a little, so the last messages of this connection can still be handled
+	m_timers.Schedule(a_connection->m_deadlineTimer, TT_DeleteConnection, sf::milliseconds(DEAD_CONNECTION_DELAY));
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Delete a connection, and the file transferts that
+/// was specific to it
+///
+/// \param a_connection the connection to delete
+///
+////////////////////////////////////////////////////////////
+void Server::DeleteConnection(Connection* a_connection)
+{
+	if (a_connection->m_sessionToken != 0) // dropped without ending its session
+		SuspendSession(a_connection);
+
+	for (std::unordered_set<FileTransfer*>::iterator it = m_transferts.begin(); it != m_transferts.end();)
+	{
+		if ((*it)->GetReceiver() == a_connection)
+		{
+			delete *it; // stop the thread of the transfert
+
+			it = m_transferts.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+
+	m_pendingSignatures.erase(a_connection);
+
+	std::vector<Connection*>::iterator l_syncro = std::find(m_syncronizingClients.begin(), m_syncronizingClients.end(), a_connection);
+
+	if (l_syncro != m_syncronizingClients.end())
+		m_syncronizingClients.erase(l_syncro);
+
+	std::vector<Connection*>::iterator l_unacknowledged = std::find(m_unacknowledgedSyncros.begin(), m_unacknowledgedSyncros.end(), a_connection);
+
+	if (l_unacknowledged != m_unacknowledgedSyncros.end())
+		m_unacknowledgedSyncros.erase(l_unacknowledged);
+
+	std::vector<Connection*>::iterator l_session = std::find(m_unacknowledgedSessions.begin(), m_unacknowledgedSessions.end(), a_connection);
+
+	if (l_session != m_unacknowledgedSessions.end())
+		m_unacknowledgedSessions.erase(l_session);
+
+	if (a_connection == m_loopbackConnection)
+	{
+		m_udpSystem.WaitForLock();
+
+		m_loopbackConnection = NULL;
+
+		m_udpSystem.Unlock();
+	}
+
+	m_clientsMutex.lock();
+
+	m_clients.Remove(a_connection);
+
+	m_clientsMutex.unlock();
+
+	delete a_connection; // also remove its timers from the wheel
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Create a new random session token
+///
+/// \return the token, never 0
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 Server::NewSessionToken()
+{
+	sf::Uint64 l_token = 0;
+
+	while (l_token == 0 || m_suspendedSessions.find(l_token) != m_suspendedSessions.end())
+	{
+		l_token = m_tokenGenerator();
+	}
+
+	return l_token;
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Give a new command key to a client and send it its
+/// session
+///
+/// \param a_client the targeted client
+///
+/// \param a_isResumed if the previous session of the client
+/// was resumed
+///
+////////////////////////////////////////////////////////////
+void Server::SendSession(Connection* a_client, bool a_isResumed)
+{
+	a_client->m_commandKey = 0;
+
+	while (a_client->m_commandKey == 0) // 0 is the key of the loopback clients
+	{
+		a_client->m_commandKey = (sf::Uint32)m_tokenGenerator();
+	}
+
+	PacketBuffer l_packet;
+
+	l_packet << (sf::Uint16)CT_Session << a_client->m_sessionToken << a_isResumed << a_client->m_commandKey << m_commandKey;
+
+	SendPacketToOneClient(l_packet, a_client);
+
+	if (a_client->m_isUDPConnection) // this datagram can be lost, it is sent again until the client acknowledges it
+	{
+		a_client->m_sessionTime = m_clock.getElapsedTime().asMilliseconds();
+
+		if (std::find(m_unacknowledgedSessions.begin(), m_unacknowledgedSessions.end(), a_client) == m_unacknowledgedSessions.end())
+			m_unacknowledgedSessions.push_back(a_client);
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send CT_Session again to the udp clients that have
+/// not acknowledged it for SESSION_RESEND ms, they can not
+/// send any command without their key
+///
+////////////////////////////////////////////////////////////
+void Server::ResendSessions()
+{
+	sf::Int32 l_now = m_clock.getElapsedTime().asMilliseconds();
+
+	for (Connection* client : m_unacknowledgedSessions)
+	{
+		if (client->m_isConsideredAlive && l_now - client->m_sessionTime >= SESSION_RESEND)
+		{
+			PacketBuffer l_packet;
+
+			// the same key, an udp session is never resumed
+			l_packet << (sf::Uint16)CT_Session << client->m_sessionToken << false << client->m_commandKey << m_commandKey;
+
+			SendPacketToOneClient(l_packet, client);
+
+			client->m_sessionTime = l_now;
+		}
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief Keep the session of a dropped client during
+/// SESSION_GRACE_PERIOD, with what it already received
+///
+/// \param a_connection the connection that is deleted
+///
+////////////////////////////////////////////////////////////
+void Server::SuspendSession(Connection* a_connection)
+{
+	SuspendedSession& l_session = m_suspendedSessions[a_connection->m_sessionToken];
+
+	l_session.m_name = a_connection->m_name;
+	l_session.m_sentFrames = a_connection->m_sentStateFrames;
+	l_session.m_replay.swap(a_connection->m_stateFrames); // the connection is deleted after its suspension
+	l_session.m_expireTime = m_clock.getElapsedTime().asMilliseconds() + SESSION_GRACE_PERIOD;
+
+	for (size_t i = a_connection->m_syncroPosition; i < a_connection->m_syncroQueue.size(); i++) // the end of its syncronization was never sent
+	{
+		l_session.m_changedIds.insert(a_connection->m_syncroQueue[i]);
+	}
+
+	for (FileTransfer* transfert : m_transferts) // the files are sent again if the session is resumed
+	{
+		if (transfert->GetReceiver() == a_connection && !transfert->IsComplete())
+			l_session.m_changedFiles.insert(transfert->GetFileName());
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Resume a suspended session : the state frames that
+/// the client missed before the drop are replayed, then only
+/// the objects and files that changed since the drop are sent
+///
+/// \param a_connection the new connection of the client
+///
+/// \param a_token the token of the previous session
+///
+/// \param a_receivedFrames the number of state frames the client
+/// received during the previous session
+///
+/// \return false if the session can not be resumed, the client
+/// must be fully syncronized
+///
+////////////////////////////////////////////////////////////
+bool Server::ResumeSession(Connection* a_connection, sf::Uint64 a_token, sf::Uint32 a_receivedFrames)
+{
+	std::unordered_map<sf::Uint64, SuspendedSession>::iterator l_session = m_suspendedSessions.find(a_token);
+
+	if (l_session == m_suspendedSessions.end()) // unknown or expired
+		return false;
+
+	const SuspendedSession& l_changes = l_session->second;
+
+	// the frames lost in the sockets at the drop can be replayed, if they are still kept
+	if (l_changes.m_name != a_connection->m_name || a_receivedFrames > l_changes.m_sentFrames 
+		|| l_changes.m_sentFrames - a_receivedFrames > l_changes.m_replay.size())
+	{
+		m_suspendedSessions.erase(l_session);
+
+		return false;
+	}
+
+	for (size_t i = l_changes.m_replay.size() - (l_changes.m_sentFrames - a_receivedFrames); i < l_changes.m_replay.size(); i++)
+	{
+		SendFrameToOneClient(l_changes.m_replay[i], a_connection); // before the changes made since the drop
+	}
+
+	if (l_changes.m_deletedIds.size() != 0) // before the creations, since they can reuse the ids
+	{
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_DeleteObject << (sf::Uint16)l_changes.m_deletedIds.size();
+
+		for (sf::Uint16 id : l_changes.m_deletedIds)
+		{
+			l_packet << id;
+		}
+
+		SendPacketToOneClient(l_packet, a_connection);
+	}
+
+	// the client updates the objects it already has, and creates the others
+	QueueSyncronization(a_connection, std::vector<sf::Uint16>(l_changes.m_changedIds.begin(), l_changes.m_changedIds.end()));
+
+	SendFileManifest(a_connection, l_changes.m_changedFiles); // the client may have received a part of them
+
+	m_suspendedSessions.erase(l_session);
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remember in the suspended sessions that an object
+/// was sent again
+///
+/// \param a_id the id of the object
+///
+/// \param a_isDeleted true if the object was deleted, else it
+/// was created or updated
+///
+////////////////////////////////////////////////////////////
+void Server::RecordChange(sf::Uint16 a_id, bool a_isDeleted)
+{
+	for (std::pair<const sf::Uint64, SuspendedSession>& session : m_suspendedSessions)
+	{
+		if (a_isDeleted)
+		{
+			session.second.m_deletedIds.insert(a_id);
+			session.second.m_changedIds.erase(a_id); // a reused id is recorded again by its creation
+		}
+		else
+		{
+			session.second.m_changedIds.insert(a_id);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Forget the suspended sessions older than
+/// SESSION_GRACE_PERIOD
+///
+////////////////////////////////////////////////////////////
+void Server::ExpireSessions()
+{
+	sf::Int32 l_now = m_clock.getElapsedTime().asMilliseconds();
+
+	for (std::unordered_map<sf::Uint64, SuspendedSession>::iterator it = m_suspendedSessions.begin(); it != m_suspendedSessions.end();)
+	{
+		if (l_now >= it->second.m_expireTime)
+			it = m_suspendedSessions.erase(it);
+		else
+			it++;
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Delete the transferts that have sent their whole
+/// file, and the ones that have failed or whose receiver has
+/// stopped acknowledging the parts
+///
+////////////////////////////////////////////////////////////
+void Server::DeleteCompleteTransferts()
+{
+	for (std::unordered_set<FileTransfer*>::iterator it = m_transferts.begin(); it != m_transferts.end();)
+	{
+		if ((*it)->HasTimedOut()) // the receiver is told, it asks the missing chunks again with its next manifest
+			(*it)->StopTransfert();
+
+		if ((*it)->IsComplete() || (*it)->HasFailed()) // the unfinished ones are kept to resume the sessions
+		{
+			delete *it;
+
+			it = m_transferts.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Delete the transfert of a file to a client, before
+/// a new one replaces it
+///
+/// \param a_receiver the client that receives the file
+///
+/// \param a_fileName the path of the file
+///
+////////////////////////////////////////////////////////////
+void Server::DeleteTransfert(Connection* a_receiver, const std::string& a_fileName)
+{
+	for (std::unordered_set<FileTransfer*>::iterator it = m_transferts.begin(); it != m_transferts.end();)
+	{
+		if ((*it)->GetReceiver() == a_receiver && (*it)->GetFileName() == a_fileName)
+		{
+			delete *it;
+
+			it = m_transferts.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive and reflect a part of a file
+///
+/// \param a_packet the packet that contains the part of the file
+///
+/// \param a_idUser the user that send the packet
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveFile(sf::Packet& a_packet, Connection* a_idUser)
+{
+	// TODO : add a way to control the incoming file, because the client must be able to send a file too
+
+	// we arrive in this function only if a client try to syncro a file on other clients
+	SharedFrame l_frame = Frame::Create(a_packet);
+
+	for (Connection* client : m_clients)
+	{
+		if (client != a_idUser)
+		{
+			SendFrameToOneClient(l_frame, client);
+		}
+	}
+
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive the chunks of the syncronized files that
+/// a client does not have, and start to send them
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the user that send the packet
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveFileManifest(sf::Packet& a_packet, Connection* a_idUser)
+{
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser) // only connected clients receive files
+	{
+		delete a_idUser;
+		return;
+	}
+
+	std::vector<sf::Uint32> l_chunks;
+
+	size_t l_readSize = sizeof(sf::Uint16); // the packet has no reading position, the command was read before
+
+	while (!a_packet.endOfPacket()) // the files with missing chunks, until the end of the frame
+	{
+		std::string l_fileName;
+		sf::Uint32 l_numberChunks;
+		size_t l_length;
+
+		if (!(a_packet >> l_fileName) || !InternalComm::ReadVarint(a_packet, l_numberChunks, l_length))
+			throw NetworkException("Error : reading file manifest has failed");
+
+		l_readSize += sizeof(sf::Uint32) + l_fileName.size() + l_length;
+
+		if (l_numberChunks > a_packet.getDataSize() - l_readSize) // each chunk index takes one byte at least, so the count is corrupted
+			throw NetworkException("Error : reading file manifest has failed");
+
+		l_chunks.resize(l_numberChunks);
+
+		for (sf::Uint32 i = 0; i < l_numberChunks; i++)
+		{
+			if (!InternalComm::ReadVarint(a_packet, l_chunks[i], l_length))
+				throw NetworkException("Error : reading file manifest has failed");
+
+			l_readSize += l_length;
+		}
+
+		if (m_syncronizedFiles.count(l_fileName) == 0 || l_chunks.size() == 0) // a client can only ask the syncronized files
+			continue;
+
+		sf::Uint32 l_fileChunks = m_fileManifest.GetNumberChunks(l_fileName);
+
+		bool l_isValid = l_numberChunks <= l_fileChunks;
+
+		for (sf::Uint32 i = 0; i < l_numberChunks && l_isValid; i++)
+		{
+			l_isValid = l_chunks[i] < l_fileChunks;
+		}
+
+		if (!l_isValid) // the manifest of an older version of the file, the client will receive the new one
+			continue;
+
+		DeleteTransfert(a_idUser, l_fileName); // a second manifest of the same file replaces the first one
+
+		m_transferts.insert(new FileTransfer(l_fileName, this, a_idUser, l_chunks));
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive the signatures of the blocks of the copy
+/// of a client, in several packets, and start to send the new
+/// version of the file as a delta against this copy after the
+/// last one
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the user that send the packet
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveFileSignatures(sf::Packet& a_packet, Connection* a_idUser)
+{
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser) // only connected clients receive files
+	{
+		delete a_idUser;
+		return;
+	}
+
+	std::string l_fileName;
+	bool l_isLast;
+	sf::Uint32 l_first;
+	sf::Uint32 l_numberBlocks;
+
+	if (!(a_packet >> l_fileName >> l_isLast) || !InternalComm::ReadVarint(a_packet, l_first) || !InternalComm::ReadVarint(a_packet, l_numberBlocks)
+		|| l_numberBlocks > FILE_SIGNATURES_PER_PACKET || l_first > FILE_MAX_BLOCKS - l_numberBlocks)
+		throw NetworkException("Error : reading file signatures has failed");
+
+	PendingSignatures& l_pending = m_pendingSignatures[a_idUser];
+
+	if (l_first == 0 || l_pending.m_fileName != l_fileName) // the first packet, or a lost one of another file
+	{
+		l_pending.m_fileName = l_fileName;
+		l_pending.m_blocks.clear();
+	}
+
+	BlockSignature l_lost = { 0, 0 }; // a lost packet only makes its blocks sent again
+
+	if (l_pending.m_blocks.size() < l_first)
+		l_pending.m_blocks.resize(l_first, l_lost);
+
+	l_pending.m_blocks.resize(l_first); // a packet received twice
+
+	for (sf::Uint32 i = 0; i < l_numberBlocks; i++)
+	{
+		BlockSignature l_block;
+
+		if (!(a_packet >> l_block.m_weak >> l_block.m_strong))
+			throw NetworkException("Error : reading file signatures has failed");
+
+		l_pending.m_blocks.push_back(l_block);
+	}
+
+	if (!l_isLast) // the transfert starts with all the signatures
+		return;
+
+	std::vector<BlockSignature> l_blocks;
+
+	l_blocks.swap(l_pending.m_blocks);
+
+	m_pendingSignatures.erase(a_idUser);
+
+	if (m_syncronizedFiles.count(l_fileName) == 0) // a client can only ask the syncronized files
+		return;
+
+	DeleteTransfert(a_idUser, l_fileName); // an older version for this client
+
+	m_transferts.insert(new FileTransfer(l_fileName, this, a_idUser, l_blocks));
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Receive the acknowledgement of a part of a file,
+/// so the transfert can send the next ones
+///
+/// \param a_packet the received packet
+///
+/// \param a_idUser the user that send the packet
+///
+////////////////////////////////////////////////////////////
+void Server::ReceiveFileAck(sf::Packet& a_packet, Connection* a_idUser)
 {
-	if (!m_isListening) // if we do not accept new connection, we return now
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser)
 	{
-		if (a_idUser->m_isUDPConnection) // udp new connections are not supposed to arrive here, but we make sure there is no problem
-			delete &a_idUser; // the temp connection must be delete
-
+		delete a_idUser;
 		return;
 	}
 
-	if (a_idUser->m_isConsideredAlive && a_idUser->m_isUDPConnection) // udp new connections are not supposed to be marked as alive
-		throw NetworkException("Error : This connection already exist!");
-
-	if (!(a_packet >> a_idUser->m_name >> a_idUser->m_port))
-	{
-		if (a_idUser->m_isUDPConnection)
-			delete &a_idUser; // the temp connection must be delete
-
-		throw NetworkException("Error : New connection failed!");
-	}
+	std::string l_fileName;
+	sf::Uint32 l_offset;
+	sf::Uint32 l_size;
 
-	// if we arrive here, we consider the connection as accepted
-	if (a_idUser->m_isUDPConnection)
-		AddNewUdpUser(a_idUser); // we add this new connection (only if UDP, because if we receive a TCP new connection, the connection is already store)
-	
+	if (!(a_packet >> l_fileName >> l_offset >> l_size))
+		throw NetworkException("Error : reading file acknowledgement has failed");
 
-	// TODO : NewConnectionCallBack before SyncroNewClient generate 2 players find a way to avoid doing SyncroNewClient if the connexion was refused
-	if (a_idUser->m_isConsideredAlive) // We do not syncro the client, if it was refused
-	{
-		SyncroNewClient(a_idUser); // we send the current state of the app to this new client
-	}
-	else
+	for (FileTransfer* transfert : m_transferts)
 	{
-		CloseConnection(a_idUser);
-	}
-
-	InternalComm::NewConnectionCallBack(a_idUser); // the user can close the connection here
-
+		// a stopped transfert of the same file does not wait for anything, so the acknowledgement goes to the current one
+		if (transfert->GetReceiver() == a_idUser && transfert->GetFileName() == l_fileName && transfert->Acknowledge((int)l_size))
+		{
+			TransfertScheduler::Wake(); // a part can be sent in the freed place of the window
 
+			break;
+		}
+	}
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief set if the server is currently listening
+/// \brief Receive the failure of a file on a client, the
+/// transferts of this file to this client are stopped
 ///
-/// If the server is not listening, it will not broadcast and 
-/// will not accept new connections (TODO : implment this second part)
+/// \param a_packet the received packet
 ///
-/// \param a_listening if the server must listening
+/// \param a_idUser the user that send the packet
 ///
 ////////////////////////////////////////////////////////////
-void Server::SetListeningState(bool a_listening)
+void Server::ReceiveFileFailed(sf::Packet& a_packet, Connection* a_idUser)
 {
-	m_isListening = a_listening;
+	if (m_clients.FindBySession(a_idUser->m_sessionId) != a_idUser)
+	{
+		delete a_idUser;
+		return;
+	}
+
+	std::string l_fileName;
+
+	if (!(a_packet >> l_fileName))
+		throw NetworkException("Error : reading file failure has failed");
+
+	for (std::unordered_set<FileTransfer*>::iterator it = m_transferts.begin(); it != m_transferts.end();)
+	{
+		if ((*it)->GetReceiver() == a_idUser && (*it)->GetFileName() == l_fileName && !(*it)->IsComplete())
+		{
+			delete *it; // the client does not wait for its parts anymore
+
+			it = m_transferts.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////
-/// \brief set if the server will accept all new connections
+/// \brief Called after first step of reading packet, if the
+/// client sends a compressed frame : it is decompressed and
+/// read as if it was received
 ///
-/// TODO : implement this
+/// \param a_packet the received packet
 ///
-/// \param a_autoAccept if the server must accept all connections
+/// \param a_idUser the user that send the packet
 ///
 ////////////////////////////////////////////////////////////
-void Server::SetAutoAccept(bool a_autoAccept)
+void Server::ReceiveCompressed(sf::Packet& a_packet, Connection* a_idUser)
 {
+	if (!a_idUser->m_isCompressed)
+		throw NetworkException("Error : this client does not use the compression");
+
+	const CompressionDictionary* l_dictionary = a_idUser->m_hasDictionary ? &InternalComm::GetCompressionDictionary() : NULL;
+
+	if (!Compression::DecompressFrame(a_packet, m_decompressed, l_dictionary))
+		throw NetworkException("Error : reading compressed frame has failed");
 
+	sf::Packet l_frame;
+
+	l_frame.append(m_decompressed.data(), m_decompressed.size());
+
+	ReceiveInformation(l_frame, a_idUser);
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief get the list of all the clients of the server
+/// \brief Send a part of a file coming from a file transfert
 ///
-/// \return the list of all clients
+/// \param a_packet Some data of the file
+///
+/// \param a_receiver The receiver, if NULL send it to everyone
 ///
 ////////////////////////////////////////////////////////////
-const std::vector<Connection*>& Server::GetClients() const
+void Server::SendPartialFile(PacketBuffer& a_packet, Connection* a_receiver)
 {
-	return m_clients;
+	if (a_receiver == NULL)
+		SendPacket(a_packet);
+	else
+		SendPacketToOneClient(a_packet, a_receiver);
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Close the connection with the server if it exist
+/// \brief Know if a client can receive a new part of a
+/// file : its send queue must be empty, so the realtime
+/// frames never wait behind the files, and it must have some
+/// file bandwidth left
 ///
-/// \param a_connection The connection to close
+/// \param a_receiver The receiver of the part, if NULL all the
+/// clients must be ready
+///
+/// \return false if the part must wait
 ///
 ////////////////////////////////////////////////////////////
-void Server::CloseConnection(Connection* a_connection)
+bool Server::CanSendFilePart(Connection* a_receiver)
 {
-	for (Connection* connection : m_clients)
+	if (a_receiver == NULL) // a part sent to everyone waits for the slowest client
 	{
-		if (a_connection == connection)
-		{
-			sf::Packet l_packet;
+		bool l_canSend = true;
 
-			l_packet << (sf::Uint16)CT_EndConnection;
+		m_clientsMutex.lock();
 
-			SendPacketToOneClient(l_packet, connection);
+		for (Connection* connection : m_clients)
+		{
+			if (!CanSendFilePart(connection))
+			{
+				l_canSend = false;
+				break;
+			}
+		}
 
-			if (!connection->m_isUDPConnection)
-				connection->m_TCPSocket.disconnect();
+		m_clientsMutex.unlock();
 
-			break;
-		}
+		return l_canSend;
 	}
-}
 
-////////////////////////////////////////////////////////////
-/// \brief Handle old clients, it send a ping to all clients 
-/// that have not communicated recently to make sure, they 
-/// are still alive, it delete dead connection and it close 
-/// very old connections that not responding
-///
-////////////////////////////////////////////////////////////
-void Server::HandleOldClients()
-{
-	int l_connectionToDelete = -1;
+	if (a_receiver->m_isLoopback) // no network between the local client and us
+		return true;
 
-	for (int i = 0; i < m_clients.size(); i++) // TODO : again, vector seems to not be the best collection here
-	{
-		int l_lastPing = m_clients[i]->m_lastPing.getElapsedTime().asMilliseconds();
+	m_udpSystem.WaitForLock(); // the queues and the tokens are updated under the same lock
 
-		if (!m_clients[i]->m_isConsideredAlive && l_lastPing >= 150) // delete dead connections
-		{
-			l_connectionToDelete = i;
-		}
+	RefillFileTokens(a_receiver);
 
-		// clients that not responding are put in the not responding list that the user can access
-		// if (l_lastPing >= CLIENT_TIMEOUT) 
-		// finally decided to use an automatic list
+	bool l_canSend = !a_receiver->HasPendingFrames() && a_receiver->m_fileTokens > 0;
 
-		if (l_lastPing >= 600) // make sure this client is alive because it have not communicated recently
-		{
-			PingOutClient(m_clients[i]);
-		}
-	}
+	m_udpSystem.Unlock();
 
-	if (l_connectionToDelete != -1) //we almost never have to delete multiple client at the same time, so one by one (50 ms)
-	{
-		m_clients.erase(m_clients.begin() + l_connectionToDelete);
-	}
+	return l_canSend;
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Receive and reflect a part of a file
-///
-/// \param a_packet the packet that contains the part of the file
+/// \brief Give to a client the file bandwidth that the other
+/// frames left unused since the last refill (token bucket)
 ///
-/// \param a_idUser the user that send the packet
+/// \param a_connection the client
 ///
 ////////////////////////////////////////////////////////////
-void Server::ReceiveFile(sf::Packet& a_packet, Connection* a_idUser)
+void Server::RefillFileTokens(Connection* a_connection)
 {
-	// TODO : add a way to control the incoming file, because the client must be able to send a file too
+	sf::Int32 l_now = m_clock.getElapsedTime().asMilliseconds();
 
-	// we arrive in this function only if a client try to syncro a file on other clients
-	for (Connection* client : m_clients)
+	sf::Int32 l_elapsed = l_now - a_connection->m_fileRefillTime;
+
+	if (l_elapsed <= 0)
+		return;
+
+	sf::Uint32 l_bandwidth = InternalComm::GetFileBandwidth();
+
+	if (l_bandwidth == 0) // no limit, only the send queue paces the files
 	{
-		if (client != a_idUser)
-		{
-			SendPacketToOneClient(a_packet, client);
-		}
+		a_connection->m_fileTokens = FILE_TOKEN_BURST;
 	}
+	else
+	{
+		sf::Int64 l_spare = (sf::Int64)l_bandwidth * l_elapsed / 1000 - (sf::Int64)a_connection->m_realtimeBytes;
 
-}
+		if (l_spare > 0)
+			a_connection->m_fileTokens += (sf::Int64)(l_spare * InternalComm::GetFileShare());
 
-////////////////////////////////////////////////////////////
-/// \brief Send a part of a file coming from a file transfert
-///
-/// \param a_packet Some data of the file
-///
-/// \param a_receiver The receiver, if NULL send it to everyone
-///
-////////////////////////////////////////////////////////////
-void Server::SendPartialFile(sf::Packet& a_packet, Connection* a_receiver)
-{
-	if (a_receiver == NULL)
-		SendPacket(a_packet);
-	else
-		SendPacketToOneClient(a_packet, a_receiver);
+		if (a_connection->m_fileTokens > FILE_TOKEN_BURST) // a pause does not allow a long burst after it
+			a_connection->m_fileTokens = FILE_TOKEN_BURST;
+	}
+
+	a_connection->m_realtimeBytes = 0;
+	a_connection->m_fileRefillTime = l_now;
 }
 
 
@@ -691,15 +2180,12 @@ void Server::SendPartialFile(sf::Packet& a_packet, Connection* a_receiver)
 ////////////////////////////////////////////////////////////
 Connection* Server::GetIdFromName(std::string& a_name)
 {
-	for (Connection* connection : m_clients)
-	{
-		if (connection->m_name == a_name)
-		{
-			return connection;
-		}
-	}
+	Connection* l_connection = m_clients.FindByName(a_name);
+
+	if (l_connection == NULL)
+		throw NetworkException("Error : Unable to find the requested ID!");
 
-	throw NetworkException("Error : Unable to find the requested ID!");
+	return l_connection;
 }
 
 
@@ -714,27 +2200,101 @@ Connection* Server::GetIdFromName(std::string& a_name)
 ////////////////////////////////////////////////////////////
 void Server::AddSyncronizedFile(const std::string& a_filePath)
 {
-	// TODO : handle case where we get a new client while transfering a file
-	m_transferts.insert(new FileTransfer(a_filePath, this)); // send this new file to all currently connected clients
+	m_fileRequestsMutex.lock(); // the server thread owns the transferts, it handles the file in its next loop
+
+	m_addedFiles.push_back(a_filePath);
+
+	m_fileRequestsMutex.unlock();
 }
 
 
 ////////////////////////////////////////////////////////////
 /// \brief If a file was already be syncronized, but that
 /// it receive some important changes, this will resyncronize
-/// all the file on all clients
+/// the changed parts of the file on all clients
 
 /// \param a_filePath the path of the file to syncronize
 ///
 ////////////////////////////////////////////////////////////
 void Server::ResyncronizeFile(const std::string& a_filePath)
 {
-	// TODO : check if this initial transfert has already ended (because sending twice the same file at the same time is never a good idea)
-	m_transferts.insert(new FileTransfer(a_filePath, this)); // resend the file to all currently connected clients
+	m_fileRequestsMutex.lock(); // the server thread owns the sessions, it handles the file in its next loop
+
+	m_resyncronizedFiles.push_back(a_filePath);
+
+	m_fileRequestsMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Handle the files added and resyncronized by the
+/// game thread since the last loop
+///
+////////////////////////////////////////////////////////////
+void Server::HandleFileRequests()
+{
+	std::vector<std::string> l_addedFiles;
+	std::vector<std::string> l_resyncronizedFiles;
+
+	m_fileRequestsMutex.lock();
+
+	l_addedFiles.swap(m_addedFiles);
+	l_resyncronizedFiles.swap(m_resyncronizedFiles);
+
+	m_fileRequestsMutex.unlock();
+
+	for (const std::string& file : l_addedFiles) // before the resyncronizations, a file is always added first
+	{
+		m_syncronizedFiles.insert(file);
+
+		m_fileManifest.Invalidate(file); // in case it was already syncronized
+
+		// TODO : handle case where we get a new client while transfering a file
+		for (std::pair<const sf::Uint64, SuspendedSession>& session : m_suspendedSessions)
+		{
+			session.second.m_changedFiles.insert(file);
+		}
+
+		m_transferts.insert(new FileTransfer(file, this)); // send this new file to all currently connected clients
+	}
+
+	for (const std::string& file : l_resyncronizedFiles)
+	{
+		m_fileManifest.Invalidate(file); // the new clients must compare their copy with the new content
+
+		for (std::pair<const sf::Uint64, SuspendedSession>& session : m_suspendedSessions)
+		{
+			session.second.m_changedFiles.insert(file);
+		}
+
+		// each client answers with the signatures of its copy, then only the changed ranges are sent to it
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_FileSignatures << file << FileTransfer::GetExecutablePath();
+
+		SendPacket(l_packet);
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Indicate that an object was destroyed, so its
+/// encoded state in the world snapshot and its hash are not
+/// valid anymore
+///
+/// \param a_id the id of the object
+///
+////////////////////////////////////////////////////////////
+void Server::ObjectWasDestroyed(sf::Uint16 a_id)
+{
+	m_snapshot.Invalidate(a_id);
+
+	m_worldHash.SetDirty(a_id);
 }
 
+
 ////////////////////////////////////////////////////////////
-/// \brief remove a UDP user from its ip address 
+/// \brief remove a UDP user from its address 
 ///
 /// When a user is connected with TCP protocol, we need
 /// to make he was not already connected with UDP. If so
@@ -742,17 +2302,16 @@ void Server::ResyncronizeFile(const std::string& a_filePath)
 ///
 /// \param a_address ip address of the new client
 ///
+/// \param a_port udp port of the new client
+///
 ////////////////////////////////////////////////////////////
-void Server::RemoveUdpUserIfAny(sf::IpAddress& a_address)
+void Server::RemoveUdpUserIfAny(const sf::IpAddress& a_address, sf::Uint16 a_port)
 {
-	for (unsigned int i = 0; i < m_clients.size(); i++)
+	Connection* l_connection = m_clients.FindByAddress(a_address, a_port);
+
+	if (l_connection != NULL && l_connection->m_isUDPConnection)
 	{
-		if (m_clients[i]->m_ipAddress.toInteger() == a_address.toInteger() && m_clients[i]->m_isUDPConnection)
-		{
-			delete m_clients[i];
-			m_clients.erase(m_clients.begin() + i); // may be we only set it to m_IsConsideredAlive = false ? or just dont change it ?
-			break;
-		}
+		DeleteConnection(l_connection); // may be we only set it to m_IsConsideredAlive = false ? or just dont change it ?
 	}
 }
 
@@ -766,122 +2325,350 @@ void Server::RemoveUdpUserIfAny(sf::IpAddress& a_address)
 /// so we need to create a temporary connection that will be closed
 /// automatically if we do not consider it as a valid connection
 ///
-/// \param a_address the address of the unknow source
+/// \param a_address the address of the unknow source
+///
+/// \param a_port the port of the unknow source
+///
+/// \return A temporary connection
+///
+////////////////////////////////////////////////////////////
+Connection* Server::GiveTempUdpConnection(const sf::IpAddress& a_address, sf::Uint16 a_port)
+{
+	Connection* l_connection = new Connection();
+
+	l_connection->m_ipAddress = a_address; // we only set the address, the name will be change in receiveInformation
+	l_connection->m_port = a_port;
+	l_connection->m_isUDPConnection = true;
+	l_connection->m_isConsideredAlive = false; // temp, so not alive
+
+	return l_connection;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add a new client that wants to use the UDP protocol
+///
+/// TCP users are added inline btw
+///
+/// \param a_connection the new user connection
+///
+////////////////////////////////////////////////////////////
+void Server::AddNewUdpUser(Connection* a_connection)
+{
+	a_connection->m_isUDPConnection = true;
+	a_connection->m_isConsideredAlive = true;
+	a_connection->m_isLocalHost = false;
+
+	m_clientsMutex.lock();
+
+	m_clients.Add(a_connection); // now indexed by its address
+
+	m_clientsMutex.unlock();
+
+	StartConnectionTimers(a_connection, TT_Timeout, m_clientTimeOut);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the connection infos that correspond to an specific
+/// address (ip + port) if this connection exist
+///
+/// \param a_address the ip address of the request
+///
+/// \param a_port the port of the request
+///
+/// \return the connection with this address, NULL if there is none
+///
+////////////////////////////////////////////////////////////
+Connection* Server::GetIdFromAddress(const sf::IpAddress& a_address, sf::Uint16 a_port)
+{
+	return m_clients.FindByAddress(a_address, a_port);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the connection infos that correspond to an specific
+/// session id if this connection exist
+///
+/// \param a_sessionId the session id of the request
+///
+/// \return the connection with this session id, NULL if there is none
+///
+////////////////////////////////////////////////////////////
+Connection* Server::GetIdFromSession(sf::Uint32 a_sessionId)
+{
+	return m_clients.FindBySession(a_sessionId);
+}
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief When a new client is connected, we will send to 
+/// him all the network objects currently existing
+///
+/// The objects are only sorted by relevance here, they are
+/// sent by slices in the next loops of the server
 ///
-/// \return A temporary connection
+/// \param a_newConnection the client to syncronize
 ///
 ////////////////////////////////////////////////////////////
-Connection* Server::GiveTempUdpConnection(sf::IpAddress& a_address)
+void Server::SyncroNewClient(Connection* a_newConnection)
 {
-	Connection* l_connection = new Connection();
+	/*
+	if (a_newConnection->m_isLocalHost) // we just ignore the initial syncro with localhost clients (in all case localhost clients are not supposed to arrived here)
+		return;
+	*/
 
-	l_connection->m_ipAddress = a_address; // we only set the ip address, the name will be change in receiveInformation
-	l_connection->m_isUDPConnection = true;
-	l_connection->m_isConsideredAlive = false; // temp, so not alive
+	SendFileManifest(a_newConnection, m_syncronizedFiles); // the client only asks the chunks it does not have
 
-	return l_connection;
+	std::vector<sf::Uint16> l_ids;
+
+	InternalComm::GetObjectsMutex().lock(); // the game thread spawns and destroys objects meanwhile
+
+	l_ids.reserve(NetworkObject::GetObjectList().size());
+
+	for (std::pair<sf::Uint16, NetworkObject*> object : NetworkObject::GetObjectList())
+	{
+		l_ids.push_back(object.first);
+	}
+
+	InternalComm::GetObjectsMutex().unlock();
+
+	QueueSyncronization(a_newConnection, l_ids);
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Add a new client that wants to use the UDP protocol
+/// \brief Send the manifest of some syncronized files to a
+/// client, it will ask the chunks it does not have
 ///
-/// TCP users are added inline btw
+/// \param a_connection the client to syncronize
 ///
-/// \param a_connection the new user connection
+/// \param a_files the paths of the files
 ///
 ////////////////////////////////////////////////////////////
-void Server::AddNewUdpUser(Connection* a_connection)
+void Server::SendFileManifest(Connection* a_connection, const std::unordered_set<std::string>& a_files)
 {
-	a_connection->m_isUDPConnection = true;
-	a_connection->m_isConsideredAlive = true;
-	a_connection->m_isLocalHost = false;
+	PacketBuffer l_packet;
+
+	l_packet << (sf::Uint16)CT_FileManifest;
+
+	const size_t l_headerSize = l_packet.GetDataSize();
 
-	m_clients.push_back(a_connection);
+	for (const std::string& fileName : a_files)
+	{
+		m_fileManifest.WriteEntry(l_packet, fileName); // a file that can not be read is not syncronized
+	}
+
+	if (l_packet.GetDataSize() > l_headerSize)
+		SendPacketToOneClient(l_packet, a_connection);
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief Get the connection infos that correspond to an specific
-/// ip address if this connection exist
+/// \brief Sort some objects by relevance for a client, they
+/// will be sent by slices in the next loops of the server,
+/// after the objects already waiting for this client
 ///
-/// \param a_address the ip address of the request
+/// \param a_connection the client to syncronize
 ///
-/// \return the connection with this ip address
+/// \param a_ids the ids of the objects to send
 ///
 ////////////////////////////////////////////////////////////
-Connection* Server::GetIdFromIP(sf::IpAddress& a_address)
+void Server::QueueSyncronization(Connection* a_connection, const std::vector<sf::Uint16>& a_ids)
 {
-	for (Connection* connection : m_clients)
+	if (!a_connection->m_isLoopback) // the local client already shares the objects of the server, it just waits CT_SyncroComplete
 	{
-		if (connection->m_ipAddress.toInteger() == a_address.toInteger())
+		InternalComm::GetObjectsMutex().lock(); // the relevances are read before the game thread destroys an object
+
+		std::vector<NetworkObject*> l_newObjects = InternalComm::GetNewObjects(); // they will be sent to all the clients, this one included
+
+		std::sort(l_newObjects.begin(), l_newObjects.end());
+
+		std::vector<std::pair<float, sf::Uint16>> l_objects;
+
+		l_objects.reserve(a_ids.size());
+
+		for (sf::Uint16 id : a_ids)
+		{
+			ObjectList::iterator l_object = NetworkObject::GetObjectList().find(id);
+
+			if (l_object != NetworkObject::GetObjectList().end() && !std::binary_search(l_newObjects.begin(), l_newObjects.end(), l_object->second))
+				l_objects.push_back(std::pair<float, sf::Uint16>(l_object->second->GetRelevance(a_connection), id));
+		}
+
+		InternalComm::GetObjectsMutex().unlock();
+
+		std::stable_sort(l_objects.begin(), l_objects.end(), IsMoreRelevant);
+
+		a_connection->m_syncroQueue.reserve(l_objects.size());
+
+		for (std::pair<float, sf::Uint16> object : l_objects)
 		{
-			return connection;
+			a_connection->m_syncroQueue.push_back(object.second);
 		}
 	}
 
-	return NULL;
-}
+	std::vector<Connection*>::iterator l_syncro = std::find(m_syncronizingClients.begin(), m_syncronizingClients.end(), a_connection);
+
+	if (l_syncro == m_syncronizingClients.end())
+		m_syncronizingClients.push_back(a_connection);
 
+	std::vector<Connection*>::iterator l_unacknowledged = std::find(m_unacknowledgedSyncros.begin(), m_unacknowledgedSyncros.end(), a_connection);
+
+	if (l_unacknowledged != m_unacknowledgedSyncros.end()) // a new CT_SyncroComplete follows this syncronization
+		m_unacknowledgedSyncros.erase(l_unacknowledged);
+}
 
 
 ////////////////////////////////////////////////////////////
-/// \brief When a new client is connected, we will send to 
-/// him all the network objects currently existing
+/// \brief Send the next slice of existing objects to the new
+/// clients, and CT_SyncroComplete when all was sent. An udp
+/// client receives it again until it acknowledges it
 ///
-/// TODO : open a new thread for this specific task
-///
-/// \param a_newConnection the client to syncronize
+/// Each client receives at most SYNCRO_OBJECTS_PER_UPDATE
+/// objects per loop, and nothing while its send queue has
+/// SYNCRO_MAX_PENDING_FRAMES frames waiting
 ///
 ////////////////////////////////////////////////////////////
-void Server::SyncroNewClient(Connection* a_newConnection)
+void Server::StreamSyncronizations()
 {
-	// TODO : make this initial syncronization as an indepandant thread for cases where there are lot of objects to send
+	std::vector<NetworkObject*> l_slice;
 
-	/*
-	if (a_newConnection->m_isLocalHost) // we just ignore the initial syncro with localhost clients (in all case localhost clients are not supposed to arrived here)
-		return;
-	*/
+	m_snapshot.NextTick(); // the clients of this loop share the encoded objects, an older encoding can miss a change
+
+	sf::Int32 l_now = m_clock.getElapsedTime().asMilliseconds();
 
-	for (const std::string& fileName : InternalComm::GetSyncronizedFiles()) // transfert all the files that must be syncronized to the new client
+	InternalComm::GetObjectsMutex().lock(); // the objects of the slices must not be destroyed by the game thread before they are sent
+
+	for (size_t i = 0; i < m_syncronizingClients.size();)
 	{
-		m_transferts.insert(new FileTransfer(fileName, this, a_newConnection));
-	}
+		Connection* l_client = m_syncronizingClients[i];
 
-	// to avoid too large packet, we only send 10 objects per packet
-	int l_numberObject = NetworkObject::GetObjectList().size();
+		if (!l_client->m_isConsideredAlive) // it will be deleted soon
+		{
+			i++;
+			continue;
+		}
 
-	int l_currentIndex = 0;
+		if (l_client->GetNumberOfPendingFrames() >= SYNCRO_MAX_PENDING_FRAMES) // the client does not read as fast as we send, we wait for it
+		{
+			i++;
+			continue;
+		}
 
-	sf::Packet l_packet;
+		l_slice.clear();
 
-	for (std::pair<sf::Uint16, NetworkObject*> object : NetworkObject::GetObjectList())
+		while (l_client->m_syncroPosition < l_client->m_syncroQueue.size() && l_slice.size() < SYNCRO_OBJECTS_PER_UPDATE)
+		{
+			ObjectList::iterator l_object = NetworkObject::GetObjectList().find(l_client->m_syncroQueue[l_client->m_syncroPosition]);
+
+			l_client->m_syncroPosition++;
+
+			if (l_object != NetworkObject::GetObjectList().end()) // else it was deleted meanwhile
+				l_slice.push_back(l_object->second);
+		}
+
+		if (l_slice.size() != 0)
+			SendNewObjects(l_slice, l_client);
+
+		if (l_client->m_syncroPosition < l_client->m_syncroQueue.size())
+		{
+			i++;
+			continue;
+		}
+
+		PacketBuffer l_packet;
+
+		l_packet << (sf::Uint16)CT_SyncroComplete;
+
+		SendPacketToOneClient(l_packet, l_client);
+
+		if (l_client->m_isUDPConnection) // this datagram can be lost, it is sent again until the client acknowledges it
+		{
+			l_client->m_syncroCompleteTime = l_now;
+
+			m_unacknowledgedSyncros.push_back(l_client);
+		}
+
+		std::vector<sf::Uint16>().swap(l_client->m_syncroQueue); // release the memory
+		l_client->m_syncroPosition = 0;
+
+		m_syncronizingClients.erase(m_syncronizingClients.begin() + i);
+	}
+
+	InternalComm::GetObjectsMutex().unlock();
+
+	for (Connection* client : m_unacknowledgedSyncros)
 	{
-		if (l_currentIndex % 10 == 0)
+		if (client->m_isConsideredAlive && l_now - client->m_syncroCompleteTime >= SYNCRO_COMPLETE_RESEND)
 		{
-			sf::Uint8 l_nbObjInThisPacket = ((l_numberObject - l_currentIndex) >= 10 ? 10 : (l_numberObject - l_currentIndex));
+			PacketBuffer l_packet;
 
-			if (l_currentIndex != 0) // send before reset only if it not the begining
-			{
-				SendPacketToOneClient(l_packet, a_newConnection);
-			}
+			l_packet << (sf::Uint16)CT_SyncroComplete;
 
-			l_packet = sf::Packet(); // reset packet
+			SendPacketToOneClient(l_packet, client);
 
-			l_packet << (sf::Uint16)CT_NewObject << l_nbObjInThisPacket;
+			client->m_syncroCompleteTime = l_now;
 		}
-		
-		l_packet << object.second->GetTypeName();
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send the root and the nodes of the world hash to
+/// the syncronized clients, so they can detect a divergence
+///
+////////////////////////////////////////////////////////////
+void Server::CheckWorldHash()
+{
+	m_worldHash.Update();
+
+	m_worldHashCheck++;
 
-		InternalComm::WriteObject(l_packet, object.second->GetSyncronizableData());
+	for (size_t i = 0; i < WORLD_HASH_LEAVES; i++) // the answers are compared with the tree of this moment
+	{
+		m_checkedLeaves[i] = m_worldHash.GetLeaf(i);
+	}
+
+	PacketBuffer l_packet;
+
+	l_packet << (sf::Uint16)CT_WorldHash << m_worldHashCheck << m_worldHash.GetRoot();
 
-		l_currentIndex++;
+	for (size_t i = 0; i < WORLD_HASH_NODES; i++)
+	{
+		l_packet << m_worldHash.GetNode(i);
 	}
 
-	if (l_numberObject % 10 != 0) // case where we need to send a packet that contain less that 10 objects at the end
+	SharedFrame l_frame = Frame::Create(l_packet);
+
+	m_clientsMutex.lock();
+
+	for (Connection* client : m_clients)
 	{
-		SendPacketToOneClient(l_packet, a_newConnection);
+		// the local client shares the objects, and the new clients do not have all of them yet
+		if (!client->m_isLoopback && std::find(m_syncronizingClients.begin(), m_syncronizingClients.end(), client) == m_syncronizingClients.end())
+			SendFrameToOneClient(l_frame, client);
 	}
+
+	m_clientsMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Order the objects of a syncronization, the most
+/// relevant first
+///
+/// \param a_first the relevance and the id of an object
+///
+/// \param a_second the relevance and the id of another object
+///
+/// \return true if the first object must be sent before
+///
+////////////////////////////////////////////////////////////
+bool Server::IsMoreRelevant(const std::pair<float, sf::Uint16>& a_first, const std::pair<float, sf::Uint16>& a_second)
+{
+	return a_first.first > a_second.first;
 }
 
 
@@ -890,35 +2677,56 @@ void Server::SyncroNewClient(Connection* a_newConnection)
 /// \brief Handle the reception of a new connection
 /// from a TCP user
 ///
+/// \return true if a connection was accepted
+///
 ////////////////////////////////////////////////////////////
-void Server::HandleNewTcpConnection()
+bool Server::HandleNewTcpConnection()
 {
 	
 	Connection* l_connection = new Connection(); // prepare the new connection
 
-	if (m_listener.accept(l_connection->m_TCPSocket) != sf::Socket::Done)
+	sf::Socket::Status l_status = m_listener.accept(l_connection->m_TCPSocket);
+
+	if (l_status == sf::Socket::NotReady) // nobody is waiting (poll mode)
+	{
+		delete l_connection;
+		return false;
+	}
+
+	if (l_status != sf::Socket::Done)
 	{
+		delete l_connection;
 		throw NetworkException("Error : Cannot connect to the new client!");
 	}
 
 	if (!m_isListening)
 	{
-		CloseConnection(l_connection);// we immediatly disconect from the the new user if we are not listening
-		return;
+		l_connection->m_TCPSocket.disconnect(); // we immediatly disconect from the the new user if we are not listening
+
+		delete l_connection;
+		return true;
 	}
+
+	l_connection->m_TCPSocket.setBlocking(!InternalComm::IsPollMode());
 	
 	std::cout << std::endl << "New TCP client !" << std::endl;
 
 	l_connection->m_isUDPConnection = false;
 	l_connection->m_isConsideredAlive = true;
 	l_connection->m_isLocalHost = l_connection->m_TCPSocket.getRemoteAddress().toInteger() == sf::IpAddress::getLocalAddress().toInteger() ? true : false;
-	// l_connection.m_ipAddress; // in TCP we don't care about ipAddress (for now)
-
-	RemoveUdpUserIfAny(l_connection->m_TCPSocket.getRemoteAddress()); // we make sure that the previous UDP connection on the same ip is deleted (why not let them both ?)
+	l_connection->m_ipAddress = l_connection->m_TCPSocket.getRemoteAddress(); // the port is only known with the new connection message
 
 	m_selector.add(l_connection->m_TCPSocket);// we now wait any data from this new TCP connection
 
-	m_clients.push_back(l_connection); // remember this new connection
+	m_clientsMutex.lock();
+
+	m_clients.Add(l_connection); // remember this new connection
+
+	m_clientsMutex.unlock();
+
+	StartConnectionTimers(l_connection, TT_Handshake, HANDSHAKE_TIMEOUT); // the client must introduce itself quickly
+
+	return true;
 }
 
 
@@ -926,24 +2734,27 @@ void Server::HandleNewTcpConnection()
 ////////////////////////////////////////////////////////////
 /// \brief Handle the reception of a new Udp message
 ///
+/// \return true if a message was received
+///
 ////////////////////////////////////////////////////////////
-void Server::HandleNewUdpMessage()
+bool Server::HandleNewUdpMessage()
 {
 	sf::Packet l_packet;
 	sf::IpAddress l_ipAddress;
 	unsigned short l_port;
 
-	m_udpSystem.GetUdpSocket().receive(l_packet, l_ipAddress, l_port);
+	if (m_udpSystem.GetUdpSocket().receive(l_packet, l_ipAddress, l_port) != sf::Socket::Done)
+		return false;
 
 	Connection* l_connection;
 
-	l_connection = GetIdFromIP(l_ipAddress);
+	l_connection = GetIdFromAddress(l_ipAddress, l_port);
 
 	bool  l_newEntity = false;
 
-	if (l_connection == NULL) // not a user that we know
+	if (l_connection == NULL || !l_connection->m_isUDPConnection || !l_connection->m_isConsideredAlive) // not a user that we know (TCP users never send us UDP messages, and closed users must reconnect)
 	{
-		l_connection = GiveTempUdpConnection(l_ipAddress); // now it exist temporarily
+		l_connection = GiveTempUdpConnection(l_ipAddress, l_port); // now it exist temporarily
 
 		l_newEntity = true;
 	}
@@ -957,78 +2768,256 @@ void Server::HandleNewUdpMessage()
 	{
 		delete l_connection; // this connection becomes useless
 	}
+
+	return true;
 }
 
 
 ////////////////////////////////////////////////////////////
-/// \brief This function is called as thread for a server,
-/// this is the equivalent of main for server.
+/// \brief Receive the messages of the TCP connections
 ///
-/// \param a_server the server at the origin of the thread
+/// \param a_isPolling if true the sockets are not blocking and
+/// all of them are read, else only the ready ones are read
+///
+/// \return true if at least one message was received
 ///
 ////////////////////////////////////////////////////////////
-void Server::ServerThread(Server* a_server)
+bool Server::HandleTcpMessages(bool a_isPolling)
 {
-	try
+	bool l_hasReceived = false;
+
+	// index loop, because a new connection message can remove a previous UDP connection of the table
+	for (size_t i = 0; i < m_clients.size(); i++)
 	{
-		// Start to listen
-		sf::Clock l_clock; // starts the broadcast clock
+		Connection* TCPconnection = m_clients[i];
+
+		if (TCPconnection->m_isUDPConnection || TCPconnection->m_isLoopback)
+			continue;
+
+		if (!a_isPolling && !m_selector.isReady(TCPconnection->m_TCPSocket))
+			continue;
+
+		if (TCPconnection->m_deadlineTimer.IsScheduled() && TCPconnection->m_deadlineTimer.GetType() == TT_DeleteConnection)
+			continue; // closed, we do not read it anymore
+
+		sf::Packet l_packet;
+
+		sf::Socket::Status l_status = TCPconnection->m_TCPSocket.receive(l_packet);
+
+		if (l_status == sf::Socket::Disconnected || l_status == sf::Socket::Error) // the client has left without warning us
+		{
+			TCPconnection->m_isConsideredAlive = false;
 
-	    // bind listener to the port (TCP side)
-		if (a_server->m_listener.listen(a_server->m_udpSystem.GetUdpPort()) != sf::Socket::Done)
+			ScheduleDeletion(TCPconnection);
+		}
+		else if (l_status == sf::Socket::Done) // a non blocking socket can have received only a part of the packet
 		{
-			throw NetworkException("Error : Server listener fail!");
+			ReceiveInformation(l_packet, TCPconnection); // received data are supposed to be processed in the ReceiveInformation method
+
+			l_hasReceived = true;
 		}
+	}
 
-		a_server->m_selector.add(a_server->m_listener);
+	return l_hasReceived;
+}
 
-		a_server->m_selector.add(a_server->m_udpSystem.GetUdpSocket());
-		
-		while (a_server->m_isRunning)
+
+////////////////////////////////////////////////////////////
+/// \brief Start to listen the TCP connections
+///
+////////////////////////////////////////////////////////////
+void Server::Start()
+{
+	// bind listener to the port (TCP side)
+	if (m_listener.listen(m_udpSystem.GetUdpPort()) != sf::Socket::Done)
+	{
+		throw NetworkException("Error : Server listener fail!");
+	}
+
+	m_listener.setBlocking(!InternalComm::IsPollMode());
+
+	m_selector.add(m_listener);
+
+	m_selector.add(m_udpSystem.GetUdpSocket());
+
+	m_broadcastClock.restart();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief One loop of the server : receive, dispatch,
+/// replication, timers and broadcast
+///
+/// \param a_isPolling if true nothing waits (poll mode), else
+/// the loop waits the sockets for a short time
+///
+/// \return true if at least one message was received
+///
+////////////////////////////////////////////////////////////
+bool Server::Update(bool a_isPolling)
+{
+	ScratchScope l_scratch; // the decoding scratch of this loop is released at its end
+
+	bool l_hasReceived = false;
+
+	if (a_isPolling) // non blocking sockets, we just try to read all of them
+	{
+		l_hasReceived |= HandleNewTcpConnection();
+
+		l_hasReceived |= HandleNewUdpMessage();
+
+		l_hasReceived |= HandleTcpMessages(true);
+	}
+	else
+	{
+		// 50ms loop to allow the thread to stop quickly, and much less when the loopback must be read
+		int l_waitTime = m_loopbackConnection != NULL ? LOOPBACK_POLL_DELAY : 50;
+
+		if (m_selector.wait(sf::milliseconds(l_waitTime)))
 		{
+			if (m_selector.isReady(m_listener)) // Listener for TCP connections
+				HandleNewTcpConnection();
 
-			if (a_server->m_selector.wait(sf::milliseconds(50))) // 50ms loop to allow the thread to stop quickly
-			{
+			if (m_selector.isReady(m_udpSystem.GetUdpSocket())) // Udp
+				HandleNewUdpMessage();
 
-				if (a_server->m_selector.isReady(a_server->m_listener)) // Listener for TCP connections
-				{
-					a_server->HandleNewTcpConnection();
-				}
+			HandleTcpMessages(false);
 
-				if (a_server->m_selector.isReady(a_server->m_udpSystem.GetUdpSocket())) // Udp
-				{
-					a_server->HandleNewUdpMessage();
-				}
-				
+			l_hasReceived = true;
+		}
+	}
 
-				for (Connection* TCPconnection : a_server->m_clients)
-				{
-					if (a_server->m_selector.isReady(TCPconnection->m_TCPSocket)) // TCP
-					{
-						sf::Packet l_packet;
+	l_hasReceived |= HandleLoopbackMessages(); // the local client does not wake up the selector
 
-						TCPconnection->m_TCPSocket.receive(l_packet);
+	if (!InternalComm::IsDeferredCommands()) // compatibility, the server thread runs the game code
+		HandleReceivedCommands();
 
-						a_server->ReceiveInformation(l_packet, TCPconnection); // received data are supposed to be processed in the ReceiveInformation method
-					}
-				}
-			}
+	l_hasReceived |= HandleCommandResults();
 
-			a_server->HandleNewObjects(); // in case new objects was created indepandently of clients actions
+	HandleNewObjects(); // in case new objects was created indepandently of clients actions
 
-			a_server->HandleOldClients();
+	HandleFileRequests();
 
-			// also broadcast regullary (every 0.5s)
-			sf::Time l_elapsedTime = l_clock.getElapsedTime();
-			if (l_elapsedTime.asMilliseconds() >= 500)
+	StreamSyncronizations(); // after the new objects and the deletions, so the queues of the new clients are up to date
+
+	ResendSessions();
+
+	if (m_worldHashClock.getElapsedTime().asMilliseconds() >= WORLD_HASH_INTERVAL)
+	{
+		CheckWorldHash();
+
+		m_worldHashClock.restart();
+	}
+
+	FlushSendQueues(); // in poll mode, the frames that did not fit in the sockets
+
+	TransfertScheduler::Wake(); // the send queues and the file tokens may allow new parts
+
+	HandleOldClients();
+
+	// also broadcast regullary (every 0.5s)
+	if (m_broadcastClock.getElapsedTime().asMilliseconds() >= 500)
+	{
+		if (m_isListening)
+		{
+			Broadcast();
+		}
+		m_broadcastClock.restart();
+	}
+
+	return l_hasReceived;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Handle the packets sent by the client of the same
+/// application through the loopback channel
+///
+/// \return true if at least one message was received
+///
+////////////////////////////////////////////////////////////
+bool Server::HandleLoopbackMessages()
+{
+	bool l_hasReceived = false;
+
+	LoopbackFrame l_frame;
+
+	while (m_loopback->ReceiveFromClient(l_frame))
+	{
+		if (l_frame.m_session < m_loopbackSession) // sent before the client reconnected
+			continue;
+
+		if (l_frame.m_session > m_loopbackSession) // the local client has opened a new session, this is the equivalent of a TCP accept
+		{
+			if (m_loopbackConnection != NULL) // the previous session is over
 			{
-				if (a_server->m_isListening)
-				{
-					a_server->Broadcast();
-				}
-				l_clock.restart();
+				m_loopbackConnection->m_isConsideredAlive = false;
+
+				ScheduleDeletion(m_loopbackConnection);
 			}
 
+			m_udpSystem.WaitForLock();
+
+			m_loopbackSession = l_frame.m_session;
+
+			m_udpSystem.Unlock();
+
+			if (!m_isListening) // the session is refused, all its packets will be ignored
+				continue;
+
+			std::cout << std::endl << "New loopback client !" << std::endl;
+
+			Connection* l_connection = new Connection();
+
+			l_connection->m_isUDPConnection = false;
+			l_connection->m_isLoopback = true;
+			l_connection->m_isConsideredAlive = true;
+			l_connection->m_isLocalHost = true;
+			l_connection->m_ipAddress = sf::IpAddress::getLocalAddress(); // the port is only known with the new connection message
+
+			m_clientsMutex.lock();
+
+			m_clients.Add(l_connection);
+
+			m_clientsMutex.unlock();
+
+			m_udpSystem.WaitForLock();
+
+			m_loopbackConnection = l_connection;
+
+			m_udpSystem.Unlock();
+
+			StartConnectionTimers(l_connection, TT_Handshake, HANDSHAKE_TIMEOUT);
+		}
+
+		if (m_loopbackConnection == NULL) // refused or closed, the client must open a new session
+			continue;
+
+		ReceiveInformation(*l_frame.m_packet, m_loopbackConnection);
+
+		l_hasReceived = true;
+	}
+
+	return l_hasReceived;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief This function is called as thread for a server,
+/// this is the equivalent of main for server.
+///
+/// \param a_server the server at the origin of the thread
+///
+////////////////////////////////////////////////////////////
+void Server::ServerThread(Server* a_server)
+{
+	try
+	{
+		a_server->Start();
+		
+		while (a_server->m_isRunning)
+		{
+			a_server->Update(false);
 		}
 	}
 	catch (const NetworkException& ex)
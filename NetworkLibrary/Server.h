@@ -27,11 +27,17 @@
 
 #include "InternalComm.h"
 #include "Connection.h"
+#include "CommandQueue.h"
+#include "ConnectionTable.h"
+#include "LoopbackChannel.h"
 #include "NetworkObject.h" 
 
 
 #include "UdpHandler.h"
 #include "FileTransfer.h"
+#include "WorldSnapshot.h"
+#include "WorldHash.h"
+#include "FileManifest.h"
 
 namespace Net
 {
@@ -81,11 +87,57 @@ public:
 	/// \brief Syncronize the clock of all connected client to
 	/// the server clock
 	///
-	/// TODO : implement this
+	/// Clients already syncronize themselves at the connection
+	/// and regularly after, this only force a new syncronization
 	///
 	////////////////////////////////////////////////////////////
 	void ClockSyncroForAllClients();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Get the current time of the server clock, this is
+	/// the reference clock of all the clients
+	///
+	/// \return the server time
+	///
+	////////////////////////////////////////////////////////////
+	sf::Time GetTime() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the port used by the server
+	///
+	/// \return the port of the server (UDP and TCP)
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint16 GetPort();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the in process channel that a client of the
+	/// same application uses instead of the sockets
+	///
+	/// \return the loopback channel of the server
+	///
+	////////////////////////////////////////////////////////////
+	std::shared_ptr<LoopbackChannel> GetLoopbackChannel() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Poll mode] Run one loop of the server on the
+	/// calling thread, without waiting
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool Poll();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Game thread] Let the objects accept or reject the
+	/// commands received since the last call, the decisions are
+	/// sent back to the server thread
+	///
+	/// \return the number of commands handled
+	///
+	////////////////////////////////////////////////////////////
+	int HandleReceivedCommands();
+
 	////////////////////////////////////////////////////////////
 	/// \brief Send a ping to a specific client that it will send back
 	///
@@ -167,14 +219,27 @@ public:
 
 	////////////////////////////////////////////////////////////
 	/// \brief Get the connection infos that correspond to an specific
-	/// ip address if this connection exist
+	/// address (ip + port) if this connection exist
 	///
 	/// \param a_address the ip address of the request
 	///
-	/// \return the connection with this ip address
+	/// \param a_port the port of the request
+	///
+	/// \return the connection with this address, NULL if there is none
 	///
 	////////////////////////////////////////////////////////////
-	Connection* GetIdFromIP(sf::IpAddress& a_address);
+	Connection* GetIdFromAddress(const sf::IpAddress& a_address, sf::Uint16 a_port);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the connection infos that correspond to an specific
+	/// session id if this connection exist
+	///
+	/// \param a_sessionId the session id of the request
+	///
+	/// \return the connection with this session id, NULL if there is none
+	///
+	////////////////////////////////////////////////////////////
+	Connection* GetIdFromSession(sf::Uint32 a_sessionId);
 
 	////////////////////////////////////////////////////////////
 	/// \brief Get the connection infos that correspond to an specific
@@ -213,12 +278,27 @@ public:
 	/// \param a_receiver The receiver, if NULL send it to everyone
 	///
 	////////////////////////////////////////////////////////////
-	void SendPartialFile(sf::Packet& a_packet, Connection* a_receiver);
+	void SendPartialFile(PacketBuffer& a_packet, Connection* a_receiver);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if a client can receive a new part of a
+	/// file : its send queue must be empty, so the realtime
+	/// frames never wait behind the files, and it must have some
+	/// file bandwidth left
+	///
+	/// \param a_receiver The receiver of the part, if NULL all the
+	/// clients must be ready
+	///
+	/// \return false if the part must wait
+	///
+	////////////////////////////////////////////////////////////
+	bool CanSendFilePart(Connection* a_receiver);
 
 
 	////////////////////////////////////////////////////////////
-	/// \brief Add a file taht will be syncronized on each client 
-	/// that will connect
+	/// \brief [Game thread] Add a file taht will be syncronized on
+	/// each client that will connect, the server thread handles it
+	/// in its next loop
 	/// if the server.exe and the client.exe are in the same
 	/// repertory, this will not append (because already here)
 	///
@@ -228,15 +308,26 @@ public:
 	void AddSyncronizedFile(const std::string& a_filePath);
 
 	////////////////////////////////////////////////////////////
-	/// \brief If a file was already be syncronized, but that
-	/// it receive some important changes, this will resyncronize
-	/// all the file on all clients
+	/// \brief [Game thread] If a file was already be syncronized,
+	/// but that it receive some important changes, this will
+	/// resyncronize the changed parts of the file on all clients
+	/// in the next loop of the server thread
 
 	/// \param a_filePath the path of the file to syncronize
 	///
 	////////////////////////////////////////////////////////////
 	void ResyncronizeFile(const std::string& a_filePath);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Indicate that an object was destroyed, so its
+	/// encoded state in the world snapshot and its hash are not
+	/// valid anymore
+	///
+	/// \param a_id the id of the object
+	///
+	////////////////////////////////////////////////////////////
+	void ObjectWasDestroyed(sf::Uint16 a_id);
+
 private:
 
 	////////////////////////////////////////////////////////////
@@ -256,6 +347,27 @@ private:
 	////////////////////////////////////////////////////////////
 	void SendPacket(sf::Packet& a_packet);
 
+	////////////////////////////////////////////////////////////
+	/// \brief send a written buffer to all clients over the
+	/// right protocol (UDP or TCP), the buffer can be reused
+	/// after this call
+	///
+	/// \param a_packet the packet to send
+	///
+	////////////////////////////////////////////////////////////
+	void SendPacket(PacketBuffer& a_packet);
+
+	////////////////////////////////////////////////////////////
+	/// \brief send a realtime packet (update or command) to all
+	/// clients : it is compressed once with the dictionary, the
+	/// clients that received the dictionary get the compressed
+	/// frame and the others the packet as it is
+	///
+	/// \param a_packet the packet to send
+	///
+	////////////////////////////////////////////////////////////
+	void SendRealtimePacket(PacketBuffer& a_packet);
+
 	////////////////////////////////////////////////////////////
 	/// \brief send a packet to only one client over the right 
 	/// protocol (UDP or TCP)
@@ -267,6 +379,57 @@ private:
 	////////////////////////////////////////////////////////////
 	void SendPacketToOneClient(sf::Packet& a_packet, Connection* a_client);
 
+	////////////////////////////////////////////////////////////
+	/// \brief send a written buffer to only one client over the
+	/// right protocol (UDP or TCP), the buffer can be reused
+	/// after this call
+	///
+	/// \param a_packet the packet to send
+	///
+	/// \param a_client the targeted client
+	///
+	////////////////////////////////////////////////////////////
+	void SendPacketToOneClient(PacketBuffer& a_packet, Connection* a_client);
+
+	////////////////////////////////////////////////////////////
+	/// \brief send a frame to only one client over the right
+	/// protocol (UDP or TCP), the frame is not copied
+	///
+	/// \param a_frame the serialized packet to send
+	///
+	/// \param a_client the targeted client
+	///
+	////////////////////////////////////////////////////////////
+	void SendFrameToOneClient(const SharedFrame& a_frame, Connection* a_client);
+
+	////////////////////////////////////////////////////////////
+	/// \brief send a big buffer to only one client, in a
+	/// CT_Compressed frame if the client accepts it and if it
+	/// shrinks
+	///
+	/// \param a_packet the packet to send
+	///
+	/// \param a_client the targeted client
+	///
+	////////////////////////////////////////////////////////////
+	void SendBulkToOneClient(PacketBuffer& a_packet, Connection* a_client);
+
+	////////////////////////////////////////////////////////////
+	/// \brief send the dictionary of the realtime packets to a
+	/// new client, before any frame that refers to it
+	///
+	/// \param a_client the targeted client
+	///
+	////////////////////////////////////////////////////////////
+	void SendDictionary(Connection* a_client);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the frames still waiting in the queues of the
+	/// TCP connections (non blocking sockets only)
+	///
+	////////////////////////////////////////////////////////////
+	void FlushSendQueues();
+
 	////////////////////////////////////////////////////////////
 	/// \brief Handle received informations from a client
 	///
@@ -318,6 +481,50 @@ private:
 	////////////////////////////////////////////////////////////
 	void ReceivePing(sf::Packet& a_packet, Connection* a_idUser);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Receive a clock syncronization request from a client
+	/// and send back the server times
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the connection at the origin of this packet 
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveClockSyncro(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the leaves of the world hash that differ on
+	/// a client, and send again the objects of these leaves
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the connection at the origin of this packet 
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveWorldHash(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the acknowledgement of CT_SyncroComplete
+	/// from an udp client, the server stops sending it again
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the connection at the origin of this packet 
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveSyncroComplete(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the acknowledgement of CT_Session from an
+	/// udp client, the server stops sending it again
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the connection at the origin of this packet 
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveSession(sf::Packet& a_packet, Connection* a_idUser);
+
 	////////////////////////////////////////////////////////////
 	/// \brief When the server is non local, the simplest way for a 
 	/// client to connect to the server is to used a direct request
@@ -335,14 +542,47 @@ private:
 	/// \brief Handle the reception of a new connection
 	/// from a TCP user
 	///
+	/// \return true if a connection was accepted
+	///
 	////////////////////////////////////////////////////////////
-	void HandleNewTcpConnection();
+	bool HandleNewTcpConnection();
 
 	////////////////////////////////////////////////////////////
 	/// \brief Handle the reception of a new Udp message
 	///
+	/// \return true if a message was received
+	///
 	////////////////////////////////////////////////////////////
-	void HandleNewUdpMessage();
+	bool HandleNewUdpMessage();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the messages of the TCP connections
+	///
+	/// \param a_isPolling if true the sockets are not blocking and
+	/// all of them are read, else only the ready ones are read
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool HandleTcpMessages(bool a_isPolling);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Handle the packets sent by the client of the same
+	/// application through the loopback channel
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool HandleLoopbackMessages();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Reflect the commands accepted by the game to all
+	/// clients
+	///
+	/// \return true if at least one decision was received
+	///
+	////////////////////////////////////////////////////////////
+	bool HandleCommandResults();
 
 	////////////////////////////////////////////////////////////
 	/// \brief Do a broadcast with server informations
@@ -360,6 +600,34 @@ private:
 	///
 	////////////////////////////////////////////////////////////
 	void HandleNewObjects();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Handle the files added and resyncronized by the
+	/// game thread since the last loop
+	///
+	////////////////////////////////////////////////////////////
+	void HandleFileRequests();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Give to a client the file bandwidth that the other
+	/// frames left unused since the last refill (token bucket)
+	///
+	/// \param a_connection the client
+	///
+	////////////////////////////////////////////////////////////
+	void RefillFileTokens(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the creation of some objects in compact spawn
+	/// frames filled up to FRAME_BYTE_BUDGET bytes : the
+	/// consecutive objects of the same type share their type name
+	///
+	/// \param a_objects the objects to create on the clients
+	///
+	/// \param a_receiver the client to syncronize, NULL for all clients
+	///
+	////////////////////////////////////////////////////////////
+	void SendNewObjects(const std::vector<NetworkObject*>& a_objects, Connection* a_receiver);
 	
 	////////////////////////////////////////////////////////////
 	/// \brief Add a new client that wants to use the UDP protocol
@@ -375,13 +643,69 @@ private:
 	/// \brief When a new client is connected, we will send to 
 	/// him all the network objects currently existing
 	///
-	/// TODO : open a new thread for this specific task
+	/// The objects are only sorted by relevance here, they are
+	/// sent by slices in the next loops of the server
 	///
 	/// \param a_newConnection the client to syncronize
 	///
 	////////////////////////////////////////////////////////////
 	void SyncroNewClient(Connection* a_newConnection);
 
+	////////////////////////////////////////////////////////////
+	/// \brief Send the manifest of some syncronized files to a
+	/// client, it will ask the chunks it does not have
+	///
+	/// \param a_connection the client to syncronize
+	///
+	/// \param a_files the paths of the files
+	///
+	////////////////////////////////////////////////////////////
+	void SendFileManifest(Connection* a_connection, const std::unordered_set<std::string>& a_files);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Sort some objects by relevance for a client, they
+	/// will be sent by slices in the next loops of the server,
+	/// after the objects already waiting for this client
+	///
+	/// \param a_connection the client to syncronize
+	///
+	/// \param a_ids the ids of the objects to send
+	///
+	////////////////////////////////////////////////////////////
+	void QueueSyncronization(Connection* a_connection, const std::vector<sf::Uint16>& a_ids);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the next slice of existing objects to the new
+	/// clients, and CT_SyncroComplete when all was sent. An udp
+	/// client receives it again until it acknowledges it
+	///
+	/// Each client receives at most SYNCRO_OBJECTS_PER_UPDATE
+	/// objects per loop, and nothing while its send queue has
+	/// SYNCRO_MAX_PENDING_FRAMES frames waiting
+	///
+	////////////////////////////////////////////////////////////
+	void StreamSyncronizations();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the root and the nodes of the world hash to
+	/// the syncronized clients, so they can detect a divergence
+	///
+	////////////////////////////////////////////////////////////
+	void CheckWorldHash();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Order the objects of a syncronization, the most
+	/// relevant first
+	///
+	/// \param a_first the relevance and the id of an object
+	///
+	/// \param a_second the relevance and the id of another object
+	///
+	/// \return true if the first object must be sent before
+	///
+	////////////////////////////////////////////////////////////
+	static bool IsMoreRelevant(const std::pair<float, sf::Uint16>& a_first, const std::pair<float, sf::Uint16>& a_second);
+
 	////////////////////////////////////////////////////////////
 	/// \brief Create a temporary/dead connection that use the UDP
 	/// protocol and with a given ip address
@@ -393,10 +717,12 @@ private:
 	///
 	/// \param a_address the address of the unknow source
 	///
+	/// \param a_port the port of the unknow source
+	///
 	/// \return A temporary connection
 	///
 	////////////////////////////////////////////////////////////
-	Connection* GiveTempUdpConnection(sf::IpAddress& a_address);
+	Connection* GiveTempUdpConnection(const sf::IpAddress& a_address, sf::Uint16 a_port);
 
 
 	////////////////////////////////////////////////////////////
@@ -405,8 +731,144 @@ private:
 	/// are still alive, it delete dead connection and it close 
 	/// very old connections that not responding
 	///
+	/// Only the connections whose timer expired are visited
+	///
 	////////////////////////////////////////////////////////////
 	void HandleOldClients();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Start the timers of a connection that was just
+	/// added to the list of clients
+	///
+	/// \param a_connection the new connection
+	///
+	/// \param a_deadline the first deadline of the connection
+	/// (TT_Handshake or TT_Timeout)
+	///
+	/// \param a_delay the time before this deadline
+	///
+	////////////////////////////////////////////////////////////
+	void StartConnectionTimers(Connection* a_connection, TimerType a_deadline, int a_delay);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Stop to listen a closed connection and schedule
+	/// its deletion
+	///
+	/// \param a_connection the closed connection
+	///
+	////////////////////////////////////////////////////////////
+	void ScheduleDeletion(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Delete a connection, and the file transferts that
+	/// was specific to it
+	///
+	/// \param a_connection the connection to delete
+	///
+	////////////////////////////////////////////////////////////
+	void DeleteConnection(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Close a connection without ending its session, so
+	/// the client can still resume it
+	///
+	/// \param a_connection The connection to close
+	///
+	////////////////////////////////////////////////////////////
+	void ShutConnection(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Create a new random session token
+	///
+	/// \return the token, never 0
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint64 NewSessionToken();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Give a new command key to a client and send it its
+	/// session
+	///
+	/// \param a_client the targeted client
+	///
+	/// \param a_isResumed if the previous session of the client
+	/// was resumed
+	///
+	////////////////////////////////////////////////////////////
+	void SendSession(Connection* a_client, bool a_isResumed);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send CT_Session again to the udp clients that have
+	/// not acknowledged it for SESSION_RESEND ms, they can not
+	/// send any command without their key
+	///
+	////////////////////////////////////////////////////////////
+	void ResendSessions();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Keep the session of a dropped client during
+	/// SESSION_GRACE_PERIOD, with what it already received
+	///
+	/// \param a_connection the connection that is deleted
+	///
+	////////////////////////////////////////////////////////////
+	void SuspendSession(Connection* a_connection);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Resume a suspended session : the state frames that
+	/// the client missed before the drop are replayed, then only
+	/// the objects and files that changed since the drop are sent
+	///
+	/// \param a_connection the new connection of the client
+	///
+	/// \param a_token the token of the previous session
+	///
+	/// \param a_receivedFrames the number of state frames the client
+	/// received during the previous session
+	///
+	/// \return false if the session can not be resumed, the client
+	/// must be fully syncronized
+	///
+	////////////////////////////////////////////////////////////
+	bool ResumeSession(Connection* a_connection, sf::Uint64 a_token, sf::Uint32 a_receivedFrames);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remember in the suspended sessions that an object
+	/// was sent again
+	///
+	/// \param a_id the id of the object
+	///
+	/// \param a_isDeleted true if the object was deleted, else it
+	/// was created or updated
+	///
+	////////////////////////////////////////////////////////////
+	void RecordChange(sf::Uint16 a_id, bool a_isDeleted);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Forget the suspended sessions older than
+	/// SESSION_GRACE_PERIOD
+	///
+	////////////////////////////////////////////////////////////
+	void ExpireSessions();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Delete the transferts that have sent their whole
+	/// file, and the ones that have failed or whose receiver has
+	/// stopped acknowledging the parts
+	///
+	////////////////////////////////////////////////////////////
+	void DeleteCompleteTransferts();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Delete the transfert of a file to a client, before
+	/// a new one replaces it
+	///
+	/// \param a_receiver the client that receives the file
+	///
+	/// \param a_fileName the path of the file
+	///
+	////////////////////////////////////////////////////////////
+	void DeleteTransfert(Connection* a_receiver, const std::string& a_fileName);
 	
 	////////////////////////////////////////////////////////////
 	/// \brief Receive and reflect a part of a file
@@ -419,7 +881,65 @@ private:
 	void ReceiveFile(sf::Packet& a_packet, Connection* a_idUser);
 
 	////////////////////////////////////////////////////////////
-	/// \brief remove a UDP user from its ip address 
+	/// \brief Receive the chunks of the syncronized files that
+	/// a client does not have, and start to send them
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the user that send the packet
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileManifest(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the signatures of the blocks of the copy
+	/// of a client, in several packets, and start to send the new
+	/// version of the file as a delta against this copy after the
+	/// last one
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the user that send the packet
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileSignatures(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the acknowledgement of a part of a file,
+	/// so the transfert can send the next ones
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the user that send the packet
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileAck(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Receive the failure of a file on a client, the
+	/// transferts of this file to this client are stopped
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the user that send the packet
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveFileFailed(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Called after first step of reading packet, if the
+	/// client sends a compressed frame : it is decompressed and
+	/// read as if it was received
+	///
+	/// \param a_packet the received packet
+	///
+	/// \param a_idUser the user that send the packet
+	///
+	////////////////////////////////////////////////////////////
+	void ReceiveCompressed(sf::Packet& a_packet, Connection* a_idUser);
+
+	////////////////////////////////////////////////////////////
+	/// \brief remove a UDP user from its address 
 	///
 	/// When a user is connected with TCP protocol, we need
 	/// to make he was not already connected with UDP. If so
@@ -427,8 +947,28 @@ private:
 	///
 	/// \param a_address ip address of the new client
 	///
+	/// \param a_port udp port of the new client
+	///
 	////////////////////////////////////////////////////////////
-	void RemoveUdpUserIfAny(sf::IpAddress& a_address);
+	void RemoveUdpUserIfAny(const sf::IpAddress& a_address, sf::Uint16 a_port);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Start to listen the TCP connections
+	///
+	////////////////////////////////////////////////////////////
+	void Start();
+
+	////////////////////////////////////////////////////////////
+	/// \brief One loop of the server : receive, dispatch,
+	/// replication, timers and broadcast
+	///
+	/// \param a_isPolling if true nothing waits (poll mode), else
+	/// the loop waits the sockets for a short time
+	///
+	/// \return true if at least one message was received
+	///
+	////////////////////////////////////////////////////////////
+	bool Update(bool a_isPolling);
 
 	////////////////////////////////////////////////////////////
 	/// \brief This function is called as thread for a server,
@@ -447,12 +987,15 @@ private:
 	UdpHandler m_udpSystem;             ///< The system that handle all the udp communication
 	sf::TcpListener m_listener;         ///< The TCP listener for listen new TCP connections
 	sf::SocketSelector m_selector;      ///< The socket selector to wait on the socket simultaniously
-	std::vector<Connection*> m_clients; ///< The list of all currently connected clients
+	ConnectionTable m_clients;          ///< The list of all currently connected clients, indexed by address, session and name
+	std::mutex m_clientsMutex;          ///< Lock the list of clients when it changes, since file transferts read it from their threads
+	TimerWheel m_timers;                ///< The deadlines of all the connections (pings, timeouts, deletions)
 	std::string m_serverName;           ///< The name of the server
 	std::thread m_serverThread;         ///< The stored thread used to run the server
 	std::string m_customInformation;    ///< More information about this server, this is custom data given by the user
 	sf::Uint8 m_maxConnections;         ///< The maximum connection allowed by the server
 	sf::Clock m_clock;                  ///< The clock of the server
+	sf::Clock m_broadcastClock;         ///< The time since the last broadcast
 	int m_clientTimeOut;                ///< The maximum time between ping before considering that a client is dead
 
 	bool m_isRunning;    ///< Flag to know if the server is running
@@ -461,6 +1004,75 @@ private:
 	bool m_isAutoAccept; ///< Flag to know if the server automatically accept new connections
 
 	std::unordered_set<FileTransfer*> m_transferts;		 ///< The list of all transfert currently active
+
+	////////////////////////////////////////////////////////////
+	/// \brief The signatures of a file received from a client,
+	/// until its last packet
+	///
+	////////////////////////////////////////////////////////////
+	struct PendingSignatures
+	{
+		std::string m_fileName;              ///< The name of the file
+		std::vector<BlockSignature> m_blocks; ///< The signatures received, in the order of the blocks
+	};
+
+	std::unordered_map<Connection*, PendingSignatures> m_pendingSignatures; ///< The signatures that are still received, by client
+
+	std::unordered_set<std::string> m_syncronizedFiles; ///< The syncronized files, the copy of the server thread
+
+	std::vector<std::string> m_addedFiles;          ///< The files added by the game thread, waiting for the server thread
+	std::vector<std::string> m_resyncronizedFiles;  ///< The files resyncronized by the game thread, waiting for the server thread
+	std::mutex m_fileRequestsMutex;                 ///< Lock of the added and resyncronized files
+
+	FileManifest m_fileManifest; ///< The chunk hashes of the syncronized files, computed once for all the clients
+
+	std::vector<Connection*> m_syncronizingClients; ///< The new clients that still receive the existing objects
+
+	std::vector<Connection*> m_unacknowledgedSyncros; ///< The udp clients that have not acknowledged CT_SyncroComplete yet
+
+	std::vector<Connection*> m_unacknowledgedSessions; ///< The udp clients that have not acknowledged CT_Session yet
+
+	WorldSnapshot m_snapshot; ///< The objects already encoded for the spawn frames, shared by the joining clients
+
+	WorldHash m_worldHash; ///< The hash tree of the objects, compared with the one of the clients
+
+	sf::Clock m_worldHashClock; ///< The time since the last comparison of the world hash
+
+	sf::Uint32 m_worldHashCheck; ///< The id of the last comparison, the late answers are ignored
+
+	std::array<sf::Uint64, WORLD_HASH_LEAVES> m_checkedLeaves; ///< The leaves of the last comparison, the answers of the clients are compared with them
+
+	std::vector<char> m_decompressed; ///< The storage of the last decompressed frame, kept to avoid an allocation per frame
+
+	////////////////////////////////////////////////////////////
+	/// \brief What a dropped client already has, kept to resume
+	/// its session
+	///
+	////////////////////////////////////////////////////////////
+	struct SuspendedSession
+	{
+		std::string m_name;                              ///< The name of the client
+		sf::Uint32 m_sentFrames;                         ///< The number of state frames sent to the client before the drop
+		std::deque<SharedFrame> m_replay;                ///< The last state frames sent before the drop, the client may have missed some of them
+		sf::Int32 m_expireTime;                          ///< The server time when the session is forgotten (in ms)
+		std::unordered_set<sf::Uint16> m_changedIds;     ///< The objects created or updated since the drop (or never sent)
+		std::unordered_set<sf::Uint16> m_deletedIds;     ///< The objects deleted since the drop
+		std::unordered_set<std::string> m_changedFiles;  ///< The syncronized files that were not completely received
+	};
+
+	std::unordered_map<sf::Uint64, SuspendedSession> m_suspendedSessions; ///< The sessions of the dropped clients, indexed by token
+
+	std::mt19937_64 m_tokenGenerator; ///< The random generator of the session tokens and of the command keys
+
+	sf::Uint32 m_commandKey; ///< The random key carried by the commands of the server, the clients receive it with their session
+
+	CommandQueue m_receivedCommands;      ///< The commands received by the network threads, waiting for the game
+	CommandResultRing m_commandResults;   ///< The decisions of the game, waiting for the server thread
+	bool m_hasWarnedCommands;             ///< Flag to know if the full command queue was already reported
+
+	std::shared_ptr<LoopbackChannel> m_loopback; ///< The in process channel with the client of the same application
+	Connection* m_loopbackConnection;            ///< The connection of the local client, NULL if it does not use the loopback
+	sf::Uint32 m_loopbackSession;                ///< The last session of the loopback channel that was accepted
 };
 
 }
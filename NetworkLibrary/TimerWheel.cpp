@@ -0,0 +1,383 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "TimerWheel.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+Timer::Timer()
+{
+	m_next = NULL;
+	m_prev = NULL;
+	m_slot = NULL;
+	m_wheel = NULL;
+	m_expireTick = 0;
+	m_type = TT_KeepAlive;
+	m_owner = NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor, cancel the timer if needed
+///
+////////////////////////////////////////////////////////////
+Timer::~Timer()
+{
+	Cancel();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove the timer from its wheel, nothing happens
+/// if it is not scheduled
+///
+////////////////////////////////////////////////////////////
+void Timer::Cancel()
+{
+	if (m_wheel != NULL)
+		m_wheel->Unlink(*this);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Know if the timer is waiting in a wheel
+///
+/// \return true if the timer is scheduled or expired but not
+/// yet handled
+///
+////////////////////////////////////////////////////////////
+bool Timer::IsScheduled() const
+{
+	return m_wheel != NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the type of the last scheduled deadline
+///
+/// \return the type of the timer
+///
+////////////////////////////////////////////////////////////
+TimerType Timer::GetType() const
+{
+	return m_type;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Set the object concerned by this timer
+///
+/// \param a_owner the owner of the timer
+///
+////////////////////////////////////////////////////////////
+void Timer::SetOwner(void* a_owner)
+{
+	m_owner = a_owner;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the object concerned by this timer
+///
+/// \return the owner of the timer
+///
+////////////////////////////////////////////////////////////
+void* Timer::GetOwner() const
+{
+	return m_owner;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+TimerWheel::TimerWheel()
+{
+	for (Timer*& slot : m_root)
+		slot = NULL;
+
+	for (int i = 0; i < TIMER_WHEEL_UPPER_LEVELS; i++)
+	{
+		for (Timer*& slot : m_levels[i])
+			slot = NULL;
+	}
+
+	m_expired = NULL;
+	m_currentTick = 0;
+	m_numberOfTimers = 0;
+	m_numberOfExpired = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor, all the remaining timers are detached
+///
+////////////////////////////////////////////////////////////
+TimerWheel::~TimerWheel()
+{
+	while (NextExpired() != NULL) // first the expired ones
+		;
+
+	for (Timer*& slot : m_root)
+	{
+		while (slot != NULL)
+			Unlink(*slot);
+	}
+
+	for (int i = 0; i < TIMER_WHEEL_UPPER_LEVELS; i++)
+	{
+		for (Timer*& slot : m_levels[i])
+		{
+			while (slot != NULL)
+				Unlink(*slot);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Schedule a timer, if it was already scheduled the
+/// previous deadline is replaced
+///
+/// \param a_timer the timer to schedule
+///
+/// \param a_type the type of the deadline
+///
+/// \param a_delay the time before the expiration (at least one tick)
+///
+////////////////////////////////////////////////////////////
+void TimerWheel::Schedule(Timer& a_timer, TimerType a_type, sf::Time a_delay)
+{
+	a_timer.Cancel();
+
+	sf::Int32 l_delay = a_delay.asMilliseconds();
+
+	sf::Uint64 l_ticks = l_delay <= 0 ? 1 : (l_delay + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK; // round up, a timer never expires early
+
+	a_timer.m_type = a_type;
+	a_timer.m_wheel = this;
+	a_timer.m_expireTick = m_currentTick + l_ticks;
+
+	m_numberOfTimers++;
+
+	Place(a_timer);
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Move the wheel forward, all the timers that expire
+/// before the given time are put in the expired list
+///
+/// \param a_now the current time of the clock that drive the wheel
+///
+////////////////////////////////////////////////////////////
+void TimerWheel::Advance(sf::Time a_now)
+{
+	sf::Uint64 l_targetTick = a_now.asMilliseconds() / TIMER_WHEEL_TICK;
+
+	while (m_currentTick < l_targetTick)
+	{
+		if (m_numberOfTimers == m_numberOfExpired) // empty slots, nothing to visit
+		{
+			m_currentTick = l_targetTick;
+			break;
+		}
+
+		m_currentTick++;
+
+		int l_index = m_currentTick & ((1 << TIMER_WHEEL_ROOT_BITS) - 1);
+
+		if (l_index == 0) // the root level made a full turn, bring the timers of the next upper slot down
+		{
+			for (int i = 0; i < TIMER_WHEEL_UPPER_LEVELS; i++)
+			{
+				int l_shift = TIMER_WHEEL_ROOT_BITS + i * TIMER_WHEEL_LEVEL_BITS;
+
+				if (Cascade(i, (m_currentTick >> l_shift) & ((1 << TIMER_WHEEL_LEVEL_BITS) - 1)) != 0)
+					break; // only cascade the next level if this one made a full turn too
+			}
+		}
+
+		while (m_root[l_index] != NULL) // all the timers of this slot expire now
+		{
+			Timer* l_timer = m_root[l_index];
+
+			Unlink(*l_timer);
+
+			l_timer->m_wheel = this;
+			m_numberOfTimers++;
+			m_numberOfExpired++;
+
+			Link(*l_timer, &m_expired);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Take the next expired timer
+///
+/// The timer is removed from the wheel before being returned,
+/// so it can be scheduled again. Expired timers that are
+/// cancelled or destroyed are never returned
+///
+/// \return the expired timer, or NULL if there is none
+///
+////////////////////////////////////////////////////////////
+Timer* TimerWheel::NextExpired()
+{
+	Timer* l_timer = m_expired;
+
+	if (l_timer != NULL)
+		Unlink(*l_timer);
+
+	return l_timer;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the number of timers in the wheel
+///
+/// \return the number of scheduled timers
+///
+////////////////////////////////////////////////////////////
+size_t TimerWheel::GetNumberOfTimers() const
+{
+	return m_numberOfTimers;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Put a timer in the slot that match its expiration
+///
+/// \param a_timer the timer
+///
+////////////////////////////////////////////////////////////
+void TimerWheel::Place(Timer& a_timer)
+{
+	sf::Uint64 l_delta = a_timer.m_expireTick - m_currentTick;
+
+	sf::Uint64 l_maxDelta = (sf::Uint64)1 << (TIMER_WHEEL_ROOT_BITS + TIMER_WHEEL_UPPER_LEVELS * TIMER_WHEEL_LEVEL_BITS);
+
+	if (l_delta >= l_maxDelta) // too far, the timer will be checked again at the end of the wheel
+	{
+		a_timer.m_expireTick = m_currentTick + l_maxDelta - 1;
+		l_delta = l_maxDelta - 1;
+	}
+
+	if (l_delta < ((sf::Uint64)1 << TIMER_WHEEL_ROOT_BITS))
+	{
+		Link(a_timer, &m_root[a_timer.m_expireTick & ((1 << TIMER_WHEEL_ROOT_BITS) - 1)]);
+		return;
+	}
+
+	for (int i = 0; i < TIMER_WHEEL_UPPER_LEVELS; i++)
+	{
+		int l_shift = TIMER_WHEEL_ROOT_BITS + i * TIMER_WHEEL_LEVEL_BITS;
+
+		if (l_delta < ((sf::Uint64)1 << (l_shift + TIMER_WHEEL_LEVEL_BITS)) || i == TIMER_WHEEL_UPPER_LEVELS - 1)
+		{
+			Link(a_timer, &m_levels[i][(a_timer.m_expireTick >> l_shift) & ((1 << TIMER_WHEEL_LEVEL_BITS) - 1)]);
+			return;
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Move all the timers of an upper slot to the lower
+/// levels
+///
+/// \param a_level the upper level
+///
+/// \param a_index the index of the slot in the level
+///
+/// \return the index of the slot
+///
+////////////////////////////////////////////////////////////
+int TimerWheel::Cascade(int a_level, int a_index)
+{
+	Timer* l_timer = m_levels[a_level][a_index];
+
+	m_levels[a_level][a_index] = NULL;
+
+	while (l_timer != NULL)
+	{
+		Timer* l_next = l_timer->m_next;
+
+		Place(*l_timer); // the timer is now closer, so it goes in a finer slot
+
+		l_timer = l_next;
+	}
+
+	return a_index;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add a timer at the head of a slot
+///
+/// \param a_timer the timer
+///
+/// \param a_slot the head of the slot
+///
+////////////////////////////////////////////////////////////
+void TimerWheel::Link(Timer& a_timer, Timer** a_slot)
+{
+	a_timer.m_slot = a_slot;
+	a_timer.m_prev = NULL;
+	a_timer.m_next = *a_slot;
+
+	if (*a_slot != NULL)
+		(*a_slot)->m_prev = &a_timer;
+
+	*a_slot = &a_timer;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove a timer from its slot
+///
+/// \param a_timer the timer
+///
+////////////////////////////////////////////////////////////
+void TimerWheel::Unlink(Timer& a_timer)
+{
+	if (a_timer.m_prev != NULL)
+		a_timer.m_prev->m_next = a_timer.m_next;
+	else
+		*a_timer.m_slot = a_timer.m_next;
+
+	if (a_timer.m_next != NULL)
+		a_timer.m_next->m_prev = a_timer.m_prev;
+
+	if (a_timer.m_slot == &m_expired)
+		m_numberOfExpired--;
+
+	m_numberOfTimers--;
+
+	a_timer.m_next = NULL;
+	a_timer.m_prev = NULL;
+	a_timer.m_slot = NULL;
+	a_timer.m_wheel = NULL;
+}
+
+}
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define TIMER_WHEEL_TICK 10 // ms, the resolution of the timers
+
+#define TIMER_WHEEL_ROOT_BITS 8 // the first level has 256 slots of one tick
+
+#define TIMER_WHEEL_LEVEL_BITS 6 // the upper levels have 64 slots each
+
+#define TIMER_WHEEL_UPPER_LEVELS 3 // with 3 upper levels, the wheel covers 2^26 ticks (about 7 days)
+
+
+namespace Net
+{
+
+class TimerWheel;
+
+
+////////////////////////////////////////////////////////////
+/// \brief A deadline that can be scheduled in a timer wheel
+///
+/// The timer is an intrusive node: it does not allocate
+/// anything and it automatically leaves its wheel when it is
+/// destroyed, so an object can own its timers safely
+///
+////////////////////////////////////////////////////////////
+class NET Timer
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	Timer();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor, cancel the timer if needed
+	///
+	////////////////////////////////////////////////////////////
+	~Timer();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove the timer from its wheel, nothing happens
+	/// if it is not scheduled
+	///
+	////////////////////////////////////////////////////////////
+	void Cancel();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Know if the timer is waiting in a wheel
+	///
+	/// \return true if the timer is scheduled or expired but not
+	/// yet handled
+	///
+	////////////////////////////////////////////////////////////
+	bool IsScheduled() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the type of the last scheduled deadline
+	///
+	/// \return the type of the timer
+	///
+	////////////////////////////////////////////////////////////
+	TimerType GetType() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Set the object concerned by this timer
+	///
+	/// \param a_owner the owner of the timer
+	///
+	////////////////////////////////////////////////////////////
+	void SetOwner(void* a_owner);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the object concerned by this timer
+	///
+	/// \return the owner of the timer
+	///
+	////////////////////////////////////////////////////////////
+	void* GetOwner() const;
+
+private:
+
+	friend class TimerWheel;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy is forbidden, a timer is linked by address
+	///
+	////////////////////////////////////////////////////////////
+	Timer(const Timer& other);
+	Timer& operator=(const Timer& other);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	Timer* m_next; ///< The next timer of the same slot
+
+	Timer* m_prev; ///< The previous timer of the same slot
+
+	Timer** m_slot; ///< The head of the slot that contains this timer
+
+	TimerWheel* m_wheel; ///< The wheel where the timer is scheduled, NULL if not scheduled
+
+	sf::Uint64 m_expireTick; ///< The tick when the timer expires
+
+	TimerType m_type; ///< The type of the deadline
+
+	void* m_owner; ///< The object concerned by this timer
+};
+
+
+////////////////////////////////////////////////////////////
+/// \brief Hierarchical hashed timer wheel
+///
+/// Scheduling and cancelling a timer is O(1). The wheel is
+/// advanced by the event loop, and only the slots of the
+/// elapsed ticks are visited. Far timers are kept in coarse
+/// upper levels and cascaded down when their time comes
+///
+////////////////////////////////////////////////////////////
+class NET TimerWheel
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	TimerWheel();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor, all the remaining timers are detached
+	///
+	////////////////////////////////////////////////////////////
+	~TimerWheel();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Schedule a timer, if it was already scheduled the
+	/// previous deadline is replaced
+	///
+	/// \param a_timer the timer to schedule
+	///
+	/// \param a_type the type of the deadline
+	///
+	/// \param a_delay the time before the expiration (at least one tick)
+	///
+	////////////////////////////////////////////////////////////
+	void Schedule(Timer& a_timer, TimerType a_type, sf::Time a_delay);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Move the wheel forward, all the timers that expire
+	/// before the given time are put in the expired list
+	///
+	/// \param a_now the current time of the clock that drive the wheel
+	///
+	////////////////////////////////////////////////////////////
+	void Advance(sf::Time a_now);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Take the next expired timer
+	///
+	/// The timer is removed from the wheel before being returned,
+	/// so it can be scheduled again. Expired timers that are
+	/// cancelled or destroyed are never returned
+	///
+	/// \return the expired timer, or NULL if there is none
+	///
+	////////////////////////////////////////////////////////////
+	Timer* NextExpired();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the number of timers in the wheel
+	///
+	/// \return the number of scheduled timers
+	///
+	////////////////////////////////////////////////////////////
+	size_t GetNumberOfTimers() const;
+
+private:
+
+	friend class Timer;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Put a timer in the slot that match its expiration
+	///
+	/// \param a_timer the timer
+	///
+	////////////////////////////////////////////////////////////
+	void Place(Timer& a_timer);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Move all the timers of an upper slot to the lower
+	/// levels
+	///
+	/// \param a_level the upper level
+	///
+	/// \param a_index the index of the slot in the level
+	///
+	/// \return the index of the slot
+	///
+	////////////////////////////////////////////////////////////
+	int Cascade(int a_level, int a_index);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add a timer at the head of a slot
+	///
+	/// \param a_timer the timer
+	///
+	/// \param a_slot the head of the slot
+	///
+	////////////////////////////////////////////////////////////
+	void Link(Timer& a_timer, Timer** a_slot);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove a timer from its slot
+	///
+	/// \param a_timer the timer
+	///
+	////////////////////////////////////////////////////////////
+	void Unlink(Timer& a_timer);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	Timer* m_root[1 << TIMER_WHEEL_ROOT_BITS]; ///< The slots of one tick
+
+	Timer* m_levels[TIMER_WHEEL_UPPER_LEVELS][1 << TIMER_WHEEL_LEVEL_BITS]; ///< The coarse slots for far timers
+
+	Timer* m_expired; ///< The timers that expired and wait to be handled
+
+	sf::Uint64 m_currentTick; ///< The last tick processed by the wheel
+
+	size_t m_numberOfTimers; ///< The number of timers in the slots and in the expired list
+
+	size_t m_numberOfExpired; ///< The number of timers in the expired list
+};
+
+}
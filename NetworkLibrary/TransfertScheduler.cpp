@@ -0,0 +1,347 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+#include "stdafx.h"
+#include "TransfertScheduler.h"
+
+#include "FileTransfer.h"
+#include "Compression.h"
+
+namespace Net
+{
+
+std::unordered_set<FileTransfer*> TransfertScheduler::s_transferts; ///< The transferts that are sending a file
+
+std::unordered_map<std::string, TransfertScheduler::SharedFile> TransfertScheduler::s_files; ///< The files mapped for the transferts, by path
+
+std::mutex TransfertScheduler::s_mutex; ///< Lock of the list of transferts, held while their parts are sent
+
+std::mutex TransfertScheduler::s_filesMutex; ///< Lock of the mapped files
+
+std::condition_variable TransfertScheduler::s_wake; ///< Wakes the thread up when it waits for a ready receiver
+
+std::thread TransfertScheduler::s_thread; ///< The thread that sends the parts, it is not used in poll mode. An ended thread is joined by the next Add or by Stop
+
+bool TransfertScheduler::s_isRunning = false; ///< If the thread is running
+
+bool TransfertScheduler::s_isStopping = false; ///< Flag to ask the thread to end
+
+
+////////////////////////////////////////////////////////////
+/// \brief Add a transfert to send, the thread is started if
+/// it is not running
+///
+/// \param a_transfert the transfert
+///
+////////////////////////////////////////////////////////////
+void TransfertScheduler::Add(FileTransfer* a_transfert)
+{
+	s_mutex.lock();
+
+	s_transferts.insert(a_transfert);
+
+	if (!InternalComm::IsPollMode() && !s_isRunning) // in poll mode the game loop sends the parts
+	{
+		if (s_thread.joinable()) // the previous thread has already ended
+			s_thread.join();
+
+		s_isRunning = true;
+		s_isStopping = false;
+		s_thread = std::thread(Run);
+	}
+
+	s_mutex.unlock();
+
+	s_wake.notify_one();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove a transfert, no part of it is sent after
+/// this call
+///
+/// \param a_transfert the transfert
+///
+////////////////////////////////////////////////////////////
+void TransfertScheduler::Remove(FileTransfer* a_transfert)
+{
+	s_mutex.lock(); // waits for the part that is maybe being sent
+
+	s_transferts.erase(a_transfert);
+
+	s_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Wake the thread up when a receiver may be ready
+/// again (acknowledged part, flushed send queue)
+///
+////////////////////////////////////////////////////////////
+void TransfertScheduler::Wake()
+{
+	s_wake.notify_one(); // a missed notification only costs the idle delay
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Stop the thread and wait for its end, must be
+/// called at the shutdown. The transferts that are still in
+/// the list are sent by the thread of the next Add
+///
+////////////////////////////////////////////////////////////
+void TransfertScheduler::Stop()
+{
+	s_mutex.lock();
+
+	s_isStopping = true;
+
+	s_mutex.unlock();
+
+	s_wake.notify_one();
+
+	if (s_thread.joinable())
+		s_thread.join();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Poll mode] Send the next part of all the
+/// transferts, this replaces the thread
+///
+/// \return true if at least one part was sent
+///
+////////////////////////////////////////////////////////////
+bool TransfertScheduler::Poll()
+{
+	s_mutex.lock();
+
+	bool l_hasSent = SendParts();
+
+	s_mutex.unlock();
+
+	return l_hasSent;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the mapping of a file to send, the file is
+/// opened only if no other transfert is sending it
+///
+/// \param a_path the path of the file
+///
+/// \param a_view receives the content of the file, NULL for
+/// an empty file
+///
+/// \param a_size receives the size of the file
+///
+/// \return false if the file can not be opened or mapped
+///
+////////////////////////////////////////////////////////////
+bool TransfertScheduler::AcquireFile(const std::string& a_path, char*& a_view, int& a_size)
+{
+	s_filesMutex.lock();
+
+	std::unordered_map<std::string, SharedFile>::iterator l_file = s_files.find(a_path);
+
+	if (l_file == s_files.end()) // the first transfert of this file
+	{
+		SharedFile l_newFile;
+
+		l_newFile.m_handle = NULL;
+		l_newFile.m_mapping = NULL;
+		l_newFile.m_view = NULL;
+		l_newFile.m_size = 0;
+		l_newFile.m_users = 0;
+
+		if (!FileTransfer::OpenView(a_path, false, l_newFile.m_size, l_newFile.m_handle, l_newFile.m_mapping, l_newFile.m_view))
+		{
+			FileTransfer::CloseView(l_newFile.m_handle, l_newFile.m_mapping, l_newFile.m_view);
+
+			s_filesMutex.unlock();
+
+			return false;
+		}
+
+		l_file = s_files.insert(std::make_pair(a_path, l_newFile)).first;
+
+		size_t l_numberChunks = (l_file->second.m_size + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+
+		l_file->second.m_compressedChunks.resize(l_numberChunks); // never resized after, so a given chunk stays valid
+		l_file->second.m_chunkStates.resize(l_numberChunks, CS_Unknown);
+	}
+
+	l_file->second.m_users++;
+
+	a_view = l_file->second.m_view;
+	a_size = l_file->second.m_size;
+
+	s_filesMutex.unlock();
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Release a mapping given by AcquireFile, the file
+/// is closed after its last transfert
+///
+/// \param a_path the path of the file
+///
+////////////////////////////////////////////////////////////
+void TransfertScheduler::ReleaseFile(const std::string& a_path)
+{
+	s_filesMutex.lock();
+
+	std::unordered_map<std::string, SharedFile>::iterator l_file = s_files.find(a_path);
+
+	if (l_file != s_files.end() && --l_file->second.m_users == 0) // a new version of the file will be mapped again
+	{
+		FileTransfer::CloseView(l_file->second.m_handle, l_file->second.m_mapping, l_file->second.m_view);
+
+		s_files.erase(l_file);
+	}
+
+	s_filesMutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get a chunk of a file acquired by AcquireFile in
+/// its compressed form. Each chunk is compressed once, for
+/// the first receiver that asks it, and kept for the others
+/// until the file is released
+///
+/// \param a_path the path of the file
+///
+/// \param a_chunk the index of the chunk
+///
+/// \param a_data receives the compressed chunk
+///
+/// \param a_size receives the size of the compressed chunk
+///
+/// \return false if the chunk does not shrink, it must be
+/// sent as it is
+///
+////////////////////////////////////////////////////////////
+bool TransfertScheduler::GetCompressedChunk(const std::string& a_path, sf::Uint32 a_chunk, const char*& a_data, sf::Uint32& a_size)
+{
+	s_filesMutex.lock();
+
+	std::unordered_map<std::string, SharedFile>::iterator l_file = s_files.find(a_path);
+
+	if (l_file == s_files.end() || a_chunk >= l_file->second.m_chunkStates.size())
+	{
+		s_filesMutex.unlock();
+
+		return false;
+	}
+
+	SharedFile& l_shared = l_file->second;
+
+	if (l_shared.m_chunkStates[a_chunk] == CS_Unknown)
+	{
+		size_t l_size = (size_t)FileTransfer::GetChunkSize(a_chunk, l_shared.m_size);
+
+		std::vector<char>& l_compressed = l_shared.m_compressedChunks[a_chunk];
+
+		l_compressed.resize(l_size - 1); // only a compression that shrinks is kept
+
+		size_t l_compressedSize = Compression::Compress(l_shared.m_view + (size_t)a_chunk * FILE_CHUNK_SIZE, l_size, l_compressed.data(), l_compressed.size());
+
+		if (l_compressedSize != 0)
+		{
+			l_compressed.resize(l_compressedSize);
+			l_compressed.shrink_to_fit();
+
+			l_shared.m_chunkStates[a_chunk] = CS_Compressed;
+		}
+		else
+		{
+			std::vector<char>().swap(l_compressed);
+
+			l_shared.m_chunkStates[a_chunk] = CS_Stored;
+		}
+	}
+
+	bool l_isCompressed = l_shared.m_chunkStates[a_chunk] == CS_Compressed;
+
+	if (l_isCompressed) // the chunk is not modified anymore, it can be read after the unlock while the caller holds the file
+	{
+		a_data = l_shared.m_compressedChunks[a_chunk].data();
+		a_size = (sf::Uint32)l_shared.m_compressedChunks[a_chunk].size();
+	}
+
+	s_filesMutex.unlock();
+
+	return l_isCompressed;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief The main function of the thread, it ends when
+/// there is no transfert anymore or when it is stopped
+///
+////////////////////////////////////////////////////////////
+void TransfertScheduler::Run()
+{
+	while (true)
+	{
+		std::unique_lock<std::mutex> l_lock(s_mutex); // released at each turn, so Remove does not wait for the idle delay
+
+		if (s_transferts.empty() || s_isStopping)
+		{
+			s_isRunning = false; // the next transfert starts a new thread
+
+			return;
+		}
+
+		if (!SendParts()) // all the receivers are still reading the previous parts
+			s_wake.wait_for(l_lock, std::chrono::milliseconds(TRANSFERT_IDLE_DELAY));
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Send the next part of each transfert whose
+/// receiver is ready, the ended transferts are removed. Must
+/// be called with s_mutex locked
+///
+/// \return true if at least one part was sent
+///
+////////////////////////////////////////////////////////////
+bool TransfertScheduler::SendParts()
+{
+	bool l_hasSent = false;
+
+	for (std::unordered_set<FileTransfer*>::iterator it = s_transferts.begin(); it != s_transferts.end();)
+	{
+		if (!(*it)->IsReadyToSend()) // its receiver has not read the previous parts yet
+		{
+			it++;
+			continue;
+		}
+
+		l_hasSent = true;
+
+		if ((*it)->SendNextPart())
+			it++;
+		else
+			it = s_transferts.erase(it); // the owner of the transfert still deletes it
+	}
+
+	return l_hasSent;
+}
+
+}
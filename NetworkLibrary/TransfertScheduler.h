@@ -0,0 +1,209 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "NetworkEnums.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define TRANSFERT_IDLE_DELAY 20 // ms, longest wait of the scheduler thread when all the receivers are still reading the previous parts, Wake ends it sooner
+
+
+namespace Net
+{
+
+	class FileTransfer;
+
+////////////////////////////////////////////////////////////
+/// \brief Send the parts of all the file transferts of the
+/// application from one thread (or from Poll in poll mode)
+///
+/// Each file is mapped once and shared by all the transferts
+/// that send it, every transfert keeps its own position in the
+/// file. A receiver whose send queue is full is skipped, so
+/// each client reads the files at its own pace, and the memory
+/// and the threads do not grow with the number of clients
+///
+////////////////////////////////////////////////////////////
+class NET TransfertScheduler
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Add a transfert to send, the thread is started if
+	/// it is not running
+	///
+	/// \param a_transfert the transfert
+	///
+	////////////////////////////////////////////////////////////
+	static void Add(FileTransfer* a_transfert);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove a transfert, no part of it is sent after
+	/// this call
+	///
+	/// \param a_transfert the transfert
+	///
+	////////////////////////////////////////////////////////////
+	static void Remove(FileTransfer* a_transfert);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Wake the thread up when a receiver may be ready
+	/// again (acknowledged part, flushed send queue)
+	///
+	////////////////////////////////////////////////////////////
+	static void Wake();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Stop the thread and wait for its end, must be
+	/// called at the shutdown. The transferts that are still in
+	/// the list are sent by the thread of the next Add
+	///
+	////////////////////////////////////////////////////////////
+	static void Stop();
+
+	////////////////////////////////////////////////////////////
+	/// \brief [Poll mode] Send the next part of all the
+	/// transferts, this replaces the thread
+	///
+	/// \return true if at least one part was sent
+	///
+	////////////////////////////////////////////////////////////
+	static bool Poll();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the mapping of a file to send, the file is
+	/// opened only if no other transfert is sending it
+	///
+	/// \param a_path the path of the file
+	///
+	/// \param a_view receives the content of the file, NULL for
+	/// an empty file
+	///
+	/// \param a_size receives the size of the file
+	///
+	/// \return false if the file can not be opened or mapped
+	///
+	////////////////////////////////////////////////////////////
+	static bool AcquireFile(const std::string& a_path, char*& a_view, int& a_size);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Release a mapping given by AcquireFile, the file
+	/// is closed after its last transfert
+	///
+	/// \param a_path the path of the file
+	///
+	////////////////////////////////////////////////////////////
+	static void ReleaseFile(const std::string& a_path);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get a chunk of a file acquired by AcquireFile in
+	/// its compressed form. Each chunk is compressed once, for
+	/// the first receiver that asks it, and kept for the others
+	/// until the file is released
+	///
+	/// \param a_path the path of the file
+	///
+	/// \param a_chunk the index of the chunk
+	///
+	/// \param a_data receives the compressed chunk
+	///
+	/// \param a_size receives the size of the compressed chunk
+	///
+	/// \return false if the chunk does not shrink, it must be
+	/// sent as it is
+	///
+	////////////////////////////////////////////////////////////
+	static bool GetCompressedChunk(const std::string& a_path, sf::Uint32 a_chunk, const char*& a_data, sf::Uint32& a_size);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief The state of the compressed form of a chunk
+	///
+	////////////////////////////////////////////////////////////
+	enum ChunkState
+	{
+		CS_Unknown,    ///< Not compressed yet
+		CS_Compressed, ///< Compressed, it is in the cache
+		CS_Stored      ///< It does not shrink, it is sent as it is
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief A file mapped for all its transferts
+	///
+	////////////////////////////////////////////////////////////
+	struct SharedFile
+	{
+		HANDLE m_handle;  ///< The opened file
+		HANDLE m_mapping; ///< The mapping of the file
+		char* m_view;     ///< The content of the file, NULL if it is empty
+		int m_size;       ///< The size of the file
+		int m_users;      ///< The number of transferts that use the mapping
+
+		std::vector<std::vector<char>> m_compressedChunks; ///< The compressed chunks, shared by the receivers that accept the compression
+		std::vector<sf::Uint8> m_chunkStates;              ///< The ChunkState of each chunk
+	};
+
+	////////////////////////////////////////////////////////////
+	/// \brief The main function of the thread, it ends when
+	/// there is no transfert anymore or when it is stopped
+	///
+	////////////////////////////////////////////////////////////
+	static void Run();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Send the next part of each transfert whose
+	/// receiver is ready, the ended transferts are removed. Must
+	/// be called with s_mutex locked
+	///
+	/// \return true if at least one part was sent
+	///
+	////////////////////////////////////////////////////////////
+	static bool SendParts();
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	static std::unordered_set<FileTransfer*> s_transferts; ///< The transferts that are sending a file
+
+	static std::unordered_map<std::string, SharedFile> s_files; ///< The files mapped for the transferts, by path
+
+	static std::mutex s_mutex; ///< Lock of the list of transferts, held while their parts are sent
+
+	static std::mutex s_filesMutex; ///< Lock of the mapped files
+
+	static std::condition_variable s_wake; ///< Wakes the thread up when it waits for a ready receiver
+
+	static std::thread s_thread; ///< The thread that sends the parts, it is not used in poll mode. An ended thread is joined by the next Add or by Stop
+
+	static bool s_isRunning; ///< If the thread is running
+
+	static bool s_isStopping; ///< Flag to ask the thread to end
+};
+
+}
@@ -14,6 +14,7 @@
 
 #include "stdafx.h"
 #include "UdpHandler.h"
+#include "InternalComm.h"
 
 namespace Net
 {
@@ -22,6 +23,8 @@ bool UdpHandler::s_isThreadRunning; ///< Flag to know if the master thread is ru
 
 std::thread UdpHandler::s_thread; ///< The master thread (only one per machine)
 
+UdpHandler* UdpHandler::s_master = NULL; ///< The master handler of this application, NULL if the master is elsewhere
+
 	
 ////////////////////////////////////////////////////////////
 /// \brief The constructor, it will determine if we are master
@@ -39,6 +42,8 @@ UdpHandler::UdpHandler()
 
 	m_port = m_UdpSocket.getLocalPort();
 
+	m_UdpSocket.setBlocking(!InternalComm::IsPollMode()); // in poll mode the game loop must never wait
+
 	std::cout << "Application port : " << m_port << std::endl;
 
 	// We try to 'take control' of the master port
@@ -68,11 +73,30 @@ UdpHandler::UdpHandler()
 
 		m_slavesPorts.push_back(m_port); // Master is also considered as its own slave for less lines
 
-		s_isThreadRunning = true;
-		s_thread = std::thread(UdpHandler::UdpThread, this); // run the thread 
+		m_selector.add(m_UdpSocketForBroadcast);
+		m_selector.add(m_UdpSocketForSlaves);
+
+		s_master = this;
+
+		if (!InternalComm::IsPollMode()) // in poll mode, the game loop does the work of the thread
+		{
+			s_isThreadRunning = true;
+			s_thread = std::thread(UdpHandler::UdpThread, this); // run the thread 
+		}
 	}
 }
 
+
+////////////////////////////////////////////////////////////
+/// \brief Destructor
+///
+////////////////////////////////////////////////////////////
+UdpHandler::~UdpHandler()
+{
+	if (s_master == this)
+		s_master = NULL;
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief Get the 'effective' Udp socket. This socket is 
 /// supposed to be used like a normal one because everything
@@ -139,6 +163,18 @@ void UdpHandler::StopUdpSharingSystem()
 	}
 }
 
+
+////////////////////////////////////////////////////////////
+/// \brief [Poll mode] Do the work of the listener thread of
+/// the master if it is on this application, without waiting
+///
+////////////////////////////////////////////////////////////
+void UdpHandler::PollUdpSharingSystem()
+{
+	if (s_master != NULL && !s_isThreadRunning)
+		s_master->HandleMasterSockets(sf::microseconds(1)); // zero would mean an infinite wait
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief The function ran by the listener thread for the master
 ///
@@ -148,45 +184,51 @@ void UdpHandler::StopUdpSharingSystem()
 ////////////////////////////////////////////////////////////
 void UdpHandler::UdpThread(UdpHandler* a_handler)
 {
-	sf::SocketSelector l_selector;
+	while (s_isThreadRunning)
+	{
+		a_handler->HandleMasterSockets(sf::milliseconds(50)); // 50ms loop to allow the thread to stop quickly
+	}
+}
 
-	l_selector.add(a_handler->m_UdpSocketForBroadcast);
-	l_selector.add(a_handler->m_UdpSocketForSlaves);
 
-		
-	while (s_isThreadRunning)
+////////////////////////////////////////////////////////////
+/// \brief Reflect the broadcasts and register the new slaves
+/// (master only)
+///
+/// \param a_timeout the maximum time to wait the sockets
+///
+////////////////////////////////////////////////////////////
+void UdpHandler::HandleMasterSockets(sf::Time a_timeout)
+{
+	if (m_selector.wait(a_timeout))
 	{
+		sf::Packet l_packet;
+		sf::IpAddress l_ipAddress;
+		unsigned short l_port;
 
-		if (l_selector.wait(sf::milliseconds(50))) // 50ms loop to allow the thread to stop quickly
+			
+		if (m_selector.isReady(m_UdpSocketForSlaves))
 		{
-			sf::Packet l_packet;
-			sf::IpAddress l_ipAddress;
-			unsigned short l_port;
+			m_UdpSocketForSlaves.receive(l_packet, l_ipAddress, l_port);
 
 				
-			if (l_selector.isReady(a_handler->m_UdpSocketForSlaves))
+			if (l_port != 0) // TODO : why do we receive 0 when connections are down ??
 			{
-				a_handler->m_UdpSocketForSlaves.receive(l_packet, l_ipAddress, l_port);
-
-					
-				if (l_port != 0) // TODO : why do we receive 0 when connections are down ??
-				{
-					std::cout << std::endl << "New slave: " << l_port << std::endl;
-					a_handler->m_slavesPorts.push_back(l_port); // TODO : no duplicates
-				}
+				std::cout << std::endl << "New slave: " << l_port << std::endl;
+				m_slavesPorts.push_back(l_port); // TODO : no duplicates
 			}
-				
-			if (l_selector.isReady(a_handler->m_UdpSocketForBroadcast))
-			{
-				a_handler->m_UdpSocketForBroadcast.receive(l_packet, l_ipAddress, l_port);
-
-				// reflect broadcast (broadcasts must contain the original ip and port because of that)
-				for (sf::Uint16 port : a_handler->m_slavesPorts)
-				{
-					a_handler->m_UdpSocketForSlaves.send(l_packet, sf::IpAddress::LocalHost, port);
-				}
+		}
+			
+		if (m_selector.isReady(m_UdpSocketForBroadcast))
+		{
+			m_UdpSocketForBroadcast.receive(l_packet, l_ipAddress, l_port);
 
+			// reflect broadcast (broadcasts must contain the original ip and port because of that)
+			for (sf::Uint16 port : m_slavesPorts)
+			{
+				m_UdpSocketForSlaves.send(l_packet, sf::IpAddress::LocalHost, port);
 			}
+
 		}
 	}
 }
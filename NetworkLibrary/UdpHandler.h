@@ -51,6 +51,12 @@ public:
 	////////////////////////////////////////////////////////////
 	UdpHandler();
 
+	////////////////////////////////////////////////////////////
+	/// \brief Destructor
+	///
+	////////////////////////////////////////////////////////////
+	~UdpHandler();
+
 	////////////////////////////////////////////////////////////
 	/// \brief Get the 'effective' Udp socket. This socket is 
 	/// supposed to be used like a normal one because everything
@@ -96,8 +102,24 @@ public:
 	////////////////////////////////////////////////////////////
 	static void StopUdpSharingSystem();
 
+	////////////////////////////////////////////////////////////
+	/// \brief [Poll mode] Do the work of the listener thread of
+	/// the master if it is on this application, without waiting
+	///
+	////////////////////////////////////////////////////////////
+	static void PollUdpSharingSystem();
+
 private:
 
+	////////////////////////////////////////////////////////////
+	/// \brief Reflect the broadcasts and register the new slaves
+	/// (master only)
+	///
+	/// \param a_timeout the maximum time to wait the sockets
+	///
+	////////////////////////////////////////////////////////////
+	void HandleMasterSockets(sf::Time a_timeout);
+
 	////////////////////////////////////////////////////////////
 	/// \brief The function ran by the listener thread for the master
 	///
@@ -116,6 +138,8 @@ private:
 
 	static std::thread s_thread; ///< The master thread (only one per machine)
 
+	static UdpHandler* s_master; ///< The master handler of this application, NULL if the master is elsewhere
+
 	////////////////////////////////////////////////////////////
 	// member data
 	////////////////////////////////////////////////////////////
@@ -132,6 +156,8 @@ private:
 
 	sf::Uint16 m_port; ///< The port used to communicate with this entity
 
+	sf::SocketSelector m_selector; ///< The selector of the master sockets
+
 	std::mutex m_mutex; ///< Lock for avoiding collisions when sending a lot of data
 };
 }
@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#include "stdafx.h"
+#include "WorldHash.h"
+
+#include "NetworkObject.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+WorldHash::WorldHash()
+{
+	m_leaves.fill(0);
+
+	m_nodes.fill(0);
+
+	m_isNodeDirty.fill(true);
+
+	m_root = 0;
+
+	m_scrubPosition = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Indicate that an object was created, changed or
+/// deleted, it will be hashed again at the next update
+///
+/// \param a_id the id of the object
+///
+////////////////////////////////////////////////////////////
+void WorldHash::SetDirty(sf::Uint16 a_id)
+{
+	m_mutex.lock();
+
+	m_dirtyIds.insert(a_id);
+
+	m_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Hash again the dirty objects and WORLD_HASH_SCRUB
+/// other objects (in case they were changed without notice),
+/// then the nodes that changed and the root
+///
+////////////////////////////////////////////////////////////
+void WorldHash::Update()
+{
+	InternalComm::GetObjectsMutex().lock(); // the game thread spawns and destroys objects meanwhile, always taken before our lock
+
+	m_mutex.lock();
+
+	for (sf::Uint16 id : m_dirtyIds)
+	{
+		Rehash(id);
+	}
+
+	m_dirtyIds.clear();
+
+	// the scrub goes round the objects, so a corruption is found even if it was never notified
+	ObjectList& l_objects = NetworkObject::GetObjectList();
+
+	ObjectList::iterator l_object = l_objects.lower_bound(m_scrubPosition);
+
+	for (int i = 0; i < WORLD_HASH_SCRUB && !l_objects.empty(); i++)
+	{
+		if (l_object == l_objects.end())
+			l_object = l_objects.begin();
+
+		Rehash(l_object->first);
+
+		l_object++;
+	}
+
+	m_scrubPosition = l_object == l_objects.end() ? 0 : l_object->first;
+
+	bool l_isRootDirty = false;
+
+	for (size_t i = 0; i < WORLD_HASH_NODES; i++)
+	{
+		if (!m_isNodeDirty[i])
+			continue;
+
+		const size_t l_leavesPerNode = WORLD_HASH_LEAVES / WORLD_HASH_NODES;
+
+		m_nodes[i] = Hash(&m_leaves[i * l_leavesPerNode], l_leavesPerNode * sizeof(sf::Uint64));
+		m_isNodeDirty[i] = false;
+
+		l_isRootDirty = true;
+	}
+
+	if (l_isRootDirty)
+		m_root = Hash(m_nodes.data(), sizeof(m_nodes));
+
+	m_mutex.unlock();
+
+	InternalComm::GetObjectsMutex().unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the hash of the whole world
+///
+/// \return the root of the tree
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 WorldHash::GetRoot() const
+{
+	return m_root;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the hash of a node
+///
+/// \param a_index the index of the node
+///
+/// \return the hash of the leaves of this node
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 WorldHash::GetNode(size_t a_index) const
+{
+	return m_nodes[a_index];
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the hash of a leaf
+///
+/// \param a_index the index of the leaf
+///
+/// \return the hash of the objects of this leaf
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 WorldHash::GetLeaf(size_t a_index) const
+{
+	return m_leaves[a_index];
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Get the leaf where an object is hashed
+///
+/// \param a_id the id of the object
+///
+/// \return the index of the leaf
+///
+////////////////////////////////////////////////////////////
+size_t WorldHash::GetLeafIndex(sf::Uint16 a_id)
+{
+	return a_id % WORLD_HASH_LEAVES; // the ids are given in sequence, so the objects are spread evenly
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Replace the hash of an object in its leaf
+///
+/// \param a_id the id of the object
+///
+////////////////////////////////////////////////////////////
+void WorldHash::Rehash(sf::Uint16 a_id)
+{
+	sf::Uint64 l_hash = 0; // 0 if the object does not exist
+
+	ObjectList::iterator l_object = NetworkObject::GetObjectList().find(a_id);
+
+	if (l_object != NetworkObject::GetObjectList().end())
+	{
+		// the same bytes as a spawn frame, plus the type, so the server and the clients get the same hash
+		m_encoder.Clear();
+
+		InternalComm::WriteObject(m_encoder, l_object->second->GetSyncronizableData());
+
+		const std::string& l_typeName = l_object->second->GetTypeName();
+
+		l_hash = Hash(l_typeName.data(), l_typeName.size());
+		l_hash = Hash(m_encoder.GetData(), m_encoder.GetDataSize(), l_hash);
+	}
+
+	sf::Uint64& l_previous = m_objectHashes[a_id];
+
+	if (l_previous == l_hash)
+	{
+		if (l_hash == 0)
+			m_objectHashes.erase(a_id);
+
+		return;
+	}
+
+	size_t l_leaf = GetLeafIndex(a_id);
+
+	m_leaves[l_leaf] ^= l_previous ^ l_hash; // the xor removes the previous hash and adds the new one
+	m_isNodeDirty[l_leaf / (WORLD_HASH_LEAVES / WORLD_HASH_NODES)] = true;
+
+	if (l_hash == 0)
+		m_objectHashes.erase(a_id);
+	else
+		l_previous = l_hash;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief FNV-1a hash of some bytes
+///
+/// \param a_data the bytes
+///
+/// \param a_size the number of bytes
+///
+/// \param a_hash the hash of the previous bytes
+///
+/// \return the hash
+///
+////////////////////////////////////////////////////////////
+sf::Uint64 WorldHash::Hash(const void* a_data, size_t a_size, sf::Uint64 a_hash)
+{
+	const sf::Uint8* l_bytes = static_cast<const sf::Uint8*>(a_data);
+
+	for (size_t i = 0; i < a_size; i++)
+	{
+		a_hash ^= l_bytes[i];
+		a_hash *= 1099511628211ULL;
+	}
+
+	return a_hash;
+}
+
+}
@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "PacketBuffer.h"
+
+
+
+////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////
+#define WORLD_HASH_LEAVES 256 // the objects are spread in the leaves by id
+
+#define WORLD_HASH_NODES 16 // each node covers WORLD_HASH_LEAVES / WORLD_HASH_NODES leaves, and the root covers the nodes
+
+#define WORLD_HASH_SCRUB 64 // objects hashed again at each update even if nobody said they changed
+
+#define WORLD_HASH_INTERVAL 5000 // ms between two comparisons of the world hash with the clients
+
+
+namespace Net
+{
+
+class NetworkObject;
+
+
+////////////////////////////////////////////////////////////
+/// \brief Hash tree over the state of all the network objects
+///
+/// The server and the clients compute the same tree. Comparing
+/// the roots detects a divergence, then comparing the nodes and
+/// the leaves finds the few objects that differ. Each leaf is
+/// the xor of the hashes of its objects, so only the objects
+/// that changed are hashed again
+///
+////////////////////////////////////////////////////////////
+class NET WorldHash
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	WorldHash();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Indicate that an object was created, changed or
+	/// deleted, it will be hashed again at the next update
+	///
+	/// \param a_id the id of the object
+	///
+	////////////////////////////////////////////////////////////
+	void SetDirty(sf::Uint16 a_id);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Hash again the dirty objects and WORLD_HASH_SCRUB
+	/// other objects (in case they were changed without notice),
+	/// then the nodes that changed and the root
+	///
+	////////////////////////////////////////////////////////////
+	void Update();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the hash of the whole world
+	///
+	/// \return the root of the tree
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint64 GetRoot() const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the hash of a node
+	///
+	/// \param a_index the index of the node
+	///
+	/// \return the hash of the leaves of this node
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint64 GetNode(size_t a_index) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the hash of a leaf
+	///
+	/// \param a_index the index of the leaf
+	///
+	/// \return the hash of the objects of this leaf
+	///
+	////////////////////////////////////////////////////////////
+	sf::Uint64 GetLeaf(size_t a_index) const;
+
+	////////////////////////////////////////////////////////////
+	/// \brief Get the leaf where an object is hashed
+	///
+	/// \param a_id the id of the object
+	///
+	/// \return the index of the leaf
+	///
+	////////////////////////////////////////////////////////////
+	static size_t GetLeafIndex(sf::Uint16 a_id);
+
+	////////////////////////////////////////////////////////////
+	/// \brief FNV-1a hash of some bytes
+	///
+	/// \param a_data the bytes
+	///
+	/// \param a_size the number of bytes
+	///
+	/// \param a_hash the hash of the previous bytes
+	///
+	/// \return the hash
+	///
+	////////////////////////////////////////////////////////////
+	static sf::Uint64 Hash(const void* a_data, size_t a_size, sf::Uint64 a_hash = 14695981039346656037ULL);
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy is forbidden, the tree is owned by its entity
+	///
+	////////////////////////////////////////////////////////////
+	WorldHash(const WorldHash& other);
+	WorldHash& operator=(const WorldHash& other);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Replace the hash of an object in its leaf
+	///
+	/// \param a_id the id of the object
+	///
+	////////////////////////////////////////////////////////////
+	void Rehash(sf::Uint16 a_id);
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::unordered_map<sf::Uint16, sf::Uint64> m_objectHashes; ///< The hash of each object, to remove it from its leaf
+
+	std::unordered_set<sf::Uint16> m_dirtyIds; ///< The objects to hash again
+
+	std::array<sf::Uint64, WORLD_HASH_LEAVES> m_leaves; ///< The xor of the hashes of the objects of each leaf
+
+	std::array<sf::Uint64, WORLD_HASH_NODES> m_nodes; ///< The hash of the leaves of each node
+
+	std::array<bool, WORLD_HASH_NODES> m_isNodeDirty; ///< Flags to know the nodes to hash again
+
+	sf::Uint64 m_root; ///< The hash of the nodes
+
+	sf::Uint16 m_scrubPosition; ///< The id where the next scrub starts
+
+	PacketBuffer m_encoder; ///< The buffer where the objects are encoded before being hashed
+
+	std::mutex m_mutex; ///< The objects can be destroyed from the game thread
+};
+
+}
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+#include "stdafx.h"
+#include "WorldSnapshot.h"
+
+#include "NetworkObject.h"
+
+namespace Net
+{
+
+////////////////////////////////////////////////////////////
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////
+WorldSnapshot::WorldSnapshot()
+{
+	m_tick = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Write an object in a packet, with the same format
+/// than InternalComm::WriteObject. The object is encoded only
+/// if it is not in the snapshot or if it was encoded in a
+/// previous tick
+///
+/// \param a_packet the packet to fill
+///
+/// \param a_object the object to write
+///
+////////////////////////////////////////////////////////////
+void WorldSnapshot::WriteObject(PacketBuffer& a_packet, const NetworkObject& a_object)
+{
+	m_mutex.lock();
+
+	Entry& l_entry = m_objects[(sf::Uint16)a_object.GetId()];
+
+	if (l_entry.m_bytes.empty() || l_entry.m_encodeTick != m_tick) // it can have changed without any update sent
+	{
+		m_encoder.Clear();
+
+		InternalComm::WriteObject(m_encoder, a_object.GetSyncronizableData());
+
+		l_entry.m_bytes.assign(m_encoder.GetData(), m_encoder.GetData() + m_encoder.GetDataSize());
+		l_entry.m_encodeTick = m_tick;
+	}
+
+	a_packet.Append(l_entry.m_bytes.data(), l_entry.m_bytes.size()); // the other joining clients get the same bytes
+
+	m_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Remove an object from the snapshot, it will be
+/// encoded again the next time it is written
+///
+/// \param a_id the id of the object that changed or was deleted
+///
+////////////////////////////////////////////////////////////
+void WorldSnapshot::Invalidate(sf::Uint16 a_id)
+{
+	m_mutex.lock();
+
+	m_objects.erase(a_id);
+
+	m_mutex.unlock();
+}
+
+
+////////////////////////////////////////////////////////////
+/// \brief Start a new tick of the server, the objects encoded
+/// before will be encoded again
+///
+////////////////////////////////////////////////////////////
+void WorldSnapshot::NextTick()
+{
+	m_mutex.lock();
+
+	m_tick++;
+
+	m_mutex.unlock();
+}
+
+}
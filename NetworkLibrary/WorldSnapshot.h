@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////
+//
+// Net - Network library for games
+// copyleft 2018 - 2019 Alexandre Lepoittevin
+//
+// This library is provided in open source without any license.
+// This code is available as demonstration purpose, and do not implied any working warranty
+// and availability of features.
+//
+// This library can be freely altered and redistributed for any purpose at the only condition
+// to not alter this notice and to not misrepresent the author.
+//
+////////////////////////////////////////////////////////////
+
+
+
+#pragma once
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "stdafx.h"
+
+#include "PacketBuffer.h"
+
+
+
+namespace Net
+{
+
+class NetworkObject;
+
+
+////////////////////////////////////////////////////////////
+/// \brief [Server side] The objects of the world, already
+/// encoded for the spawn frames
+///
+/// The clients that join at the same time (map change, server
+/// restart) share the same bytes instead of encoding every
+/// object again for each of them. An encoded object is only
+/// shared during the server loop (tick) where it was encoded,
+/// since the game can change it without sending an update, and
+/// it is invalidated when an update or a deletion of this object
+/// is sent. So the clients only need the updates sent after they
+/// received it
+///
+////////////////////////////////////////////////////////////
+class NET WorldSnapshot
+{
+
+public:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Constructor
+	///
+	////////////////////////////////////////////////////////////
+	WorldSnapshot();
+
+	////////////////////////////////////////////////////////////
+	/// \brief Write an object in a packet, with the same format
+	/// than InternalComm::WriteObject. The object is encoded only
+	/// if it is not in the snapshot or if it was encoded in a
+	/// previous tick
+	///
+	/// \param a_packet the packet to fill
+	///
+	/// \param a_object the object to write
+	///
+	////////////////////////////////////////////////////////////
+	void WriteObject(PacketBuffer& a_packet, const NetworkObject& a_object);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Remove an object from the snapshot, it will be
+	/// encoded again the next time it is written
+	///
+	/// \param a_id the id of the object that changed or was deleted
+	///
+	////////////////////////////////////////////////////////////
+	void Invalidate(sf::Uint16 a_id);
+
+	////////////////////////////////////////////////////////////
+	/// \brief Start a new tick of the server, the objects encoded
+	/// before will be encoded again
+	///
+	////////////////////////////////////////////////////////////
+	void NextTick();
+
+private:
+
+	////////////////////////////////////////////////////////////
+	/// \brief Copy is forbidden, the snapshot is owned by its server
+	///
+	////////////////////////////////////////////////////////////
+	WorldSnapshot(const WorldSnapshot& other);
+	WorldSnapshot& operator=(const WorldSnapshot& other);
+
+	////////////////////////////////////////////////////////////
+	/// \brief One encoded object
+	///
+	////////////////////////////////////////////////////////////
+	struct Entry
+	{
+		std::vector<char> m_bytes; ///< The object as written by InternalComm::WriteObject
+		sf::Uint32 m_encodeTick;   ///< The tick when the object was encoded
+	};
+
+	////////////////////////////////////////////////////////////
+	// Member data
+	////////////////////////////////////////////////////////////
+
+	std::unordered_map<sf::Uint16, Entry> m_objects; ///< The encoded objects, indexed by id
+
+	PacketBuffer m_encoder; ///< The buffer where the objects are encoded, its storage is reused
+
+	sf::Uint32 m_tick; ///< The current tick of the server
+
+	std::mutex m_mutex; ///< The updates and the deletions can be sent from the game thread
+};
+
+}
@@ -27,11 +27,19 @@
 #include <fstream>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <list>
 #include <queue>
+#include <deque>
 #include <type_traits>
 #include <unordered_set>
+#include <unordered_map>
+#include <random>
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
 
 // TODO : to remove
 #include <array>
@@ -52,6 +52,8 @@ void EventHandler(sf::RenderWindow& a_window)
 
 void GameLoop()
 {
+	Net::Communication::HandleReceivedCommands(); // the objects accept or reject the commands of the clients (server side only)
+
 	for (PlayerObject* player : PlayerObject::s_player) // update the elements that need to be
 	{
 		player->update(hasFocus());